@@ -133,6 +133,16 @@ void DBuffer::readBuf_LE(char *pcBuf, int nBufSize) {
   readBuf(SwapEndian::LittleIter(pcBuf, nBufSize), nBufSize);
 }
 
+const char *DBuffer::readBufView(int nBufSize) {
+  if (isInput() == false || nBufSize < 0 || numRemainingBytes() < nBufSize) {
+    throw Exception("Unable to read the data");
+  }
+
+  const char *pcView = &m_pcData[m_nReadPtr];
+  m_nReadPtr += nBufSize;
+  return pcView;
+}
+
 int DBuffer::numRemainingBytes(void) {
   if (isInput()) {
     return m_nSize - m_nReadPtr;
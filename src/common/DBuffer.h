@@ -57,6 +57,8 @@ public:
 
   void writeBuf_LE(const char *pcBuf, int nBufSize);
   void readBuf_LE(char *pcBuf, int nBufSize);
+  /* like readBuf, without copy : the view is valid as long as the input */
+  const char *readBufView(int nBufSize);
   int numRemainingBytes(void);
   const char *convertOutputToInput(void);
 
@@ -26,8 +26,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <windows.h>
 #else
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <unistd.h>
+#if !defined(__MORPHOS__) && !defined(__amigaos4__)
+#include <sys/mman.h>
+#endif
 #endif
 #include <stdarg.h>
 #include <sys/stat.h>
@@ -40,6 +44,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "VFileIO.h"
 #include "helpers/Log.h"
 #include "helpers/SwapEndian.h"
+#include "helpers/System.h"
 #include "helpers/Text.h"
 #include "helpers/VExcept.h"
 #include "md5sum/md5file.h"
@@ -453,21 +458,23 @@ std::vector<std::string> XMFS::findPhysFiles(FileDataType i_fdt,
 #endif
 
   if (i_fdt == FDT_DATA) {
-    /* Look in package */
-    for (unsigned int i = 0; i < m_PackFiles.size(); i++) {
-      /* Make sure about the directory... */
-      int k = Files.find_last_of('/');
-      std::string Ds1 = Files.substr(0, k + 1);
-      k = m_PackFiles[i].Name.find_last_of('/');
-      std::string Ds2 = m_PackFiles[i].Name.substr(0, k + 1);
-      if (Ds1.substr(0, 2) == "./")
-        Ds1.erase(Ds1.begin(), Ds1.begin() + 2);
-
-      if (Ds1 == Ds2 && str_match_wildcard((char *)Files.c_str(),
-                                           (char *)m_PackFiles[i].Name.c_str(),
-                                           true)) {
-        /* Match. */
-        Result.push_back(m_PackFiles[i].Name);
+    /* Look in package -- only the files of the directory */
+    int k = Files.find_last_of('/');
+    std::string Ds1 = Files.substr(0, k + 1);
+    if (Ds1.substr(0, 2) == "./")
+      Ds1.erase(Ds1.begin(), Ds1.begin() + 2);
+
+    HashNamespace::unordered_map<std::string,
+                                 std::vector<unsigned int> >::const_iterator
+      v_dir = m_PackDirsIndex.find(Ds1);
+    if (v_dir != m_PackDirsIndex.end()) {
+      for (unsigned int i = 0; i < v_dir->second.size(); i++) {
+        const PackFile &v_packFile = m_PackFiles[v_dir->second[i]];
+        if (str_match_wildcard(
+              (char *)Files.c_str(), (char *)v_packFile.Name.c_str(), true)) {
+          /* Match. */
+          Result.push_back(v_packFile.Name);
+        }
       }
     }
   }
@@ -541,33 +548,20 @@ FileHandle *XMFS::openIFile(FileDataType i_fdt,
 
   if (i_fdt == FDT_DATA) {
     if (pfh->fp == NULL) {
-      int v_packsize = m_PackFiles.size();
-
-      // remove all ./ of the Path
-      std::string v_path = Path;
-      while (v_path.substr(0, 2) == "./") {
-        v_path = v_path.substr(2, v_path.length() - 2);
-      }
-
       /* No luck so far, look in the data package */
-      for (unsigned int i = 0; i < v_packsize; i++) {
-        if (m_PackFiles[i].Name == v_path) {
-          /* Found it, yeah. */
-          pfh->fp = fopen(m_BinDataFile.c_str(), "rb");
-          if (pfh->fp != NULL) {
-            fseek(pfh->fp, m_PackFiles[i].nOffset, SEEK_SET);
-            pfh->Type = FHT_PACKAGE;
-            pfh->nSize = m_PackFiles[i].nSize;
-            pfh->nOffset = ftell(pfh->fp);
-            //            printf("OPENED '%s' IN PACKAGE!\n",Path.c_str());
-          } else
-            break;
-        }
+      const PackFile *v_packFile = _FindPackFile(Path);
+      if (v_packFile != NULL) {
+        /* Found it, yeah. */
+        pfh->Type = FHT_PACKAGE;
+        pfh->nSize = v_packFile->nSize;
+        pfh->nOffset = v_packFile->nOffset;
+        pfh->pcData = m_packData + v_packFile->nOffset;
+        pfh->nPos = 0;
       }
     }
   }
 
-  if (pfh->fp == NULL) {
+  if (pfh->fp == NULL && pfh->Type != FHT_PACKAGE) {
     delete pfh;
     return NULL;
   }
@@ -584,11 +578,45 @@ FileHandle *XMFS::openIFile(FileDataType i_fdt,
   return pfh;
 }
 
+FileHandle *XMFS::openOMemory(const std::string &i_name) {
+  FileHandle *pfh = new FileHandle;
+
+  pfh->Type = FHT_MEMORY;
+  pfh->bWrite = true;
+  pfh->Name = i_name;
+  pfh->pMemory = new std::string();
+
+  return pfh;
+}
+
+const std::string &XMFS::getMemoryData(FileHandle *pfh) {
+  if (pfh->Type != FHT_MEMORY || pfh->pMemory == NULL)
+    _ThrowFileError(pfh, "getMemoryData -> not a memory output");
+  return *pfh->pMemory;
+}
+
+FileHandle *XMFS::openIMemory(const std::string &i_name,
+                              const char *i_data,
+                              int i_size) {
+  FileHandle *pfh = new FileHandle;
+
+  pfh->Type = FHT_MEMORY;
+  pfh->bRead = true;
+  pfh->Name = i_name;
+  pfh->pcData = i_data;
+  pfh->nSize = i_size;
+  pfh->nPos = 0;
+
+  return pfh;
+}
+
 void XMFS::closeFile(FileHandle *pfh) {
   if (pfh->Type == FHT_STDIO) {
     fclose(pfh->fp);
   } else if (pfh->Type == FHT_PACKAGE) {
-    fclose(pfh->fp);
+    /* nothing to close, the package stays mapped */
+  } else if (pfh->Type == FHT_MEMORY) {
+    delete pfh->pMemory;
   } else
     _ThrowFileError(pfh, "closeFile -> invalid type");
   delete pfh;
@@ -600,17 +628,13 @@ bool XMFS::readBuf(FileHandle *pfh, char *pcBuf, unsigned int nBufSize) {
   if (pfh->Type == FHT_STDIO) {
     if (fread(pcBuf, 1, nBufSize, pfh->fp) != nBufSize)
       return false;
-  } else if (pfh->Type == FHT_PACKAGE) {
-    int nRem = pfh->nSize - (ftell(pfh->fp) - pfh->nOffset);
-    //      printf("reading %d bytes. %d left  (%d %d
-    //      %d).\n",nBufSize,nRem,pfh->nSize,ftell(pfh->fp),pfh->nOffset);
+  } else if (pfh->Type == FHT_PACKAGE || pfh->Type == FHT_MEMORY) {
     if (nBufSize == 0)
       return true;
-    if (nRem > 0) {
-      if (fread(pcBuf, 1, nBufSize, pfh->fp) != nBufSize)
-        return false;
-    } else
+    if (nBufSize > (unsigned int)(pfh->nSize - pfh->nPos))
       return false;
+    memcpy(pcBuf, pfh->pcData + pfh->nPos, nBufSize);
+    pfh->nPos += nBufSize;
   } else
     _ThrowFileError(pfh, "readBuf -> invalid type");
   return true;
@@ -622,6 +646,9 @@ bool XMFS::writeBuf(FileHandle *pfh, char *pcBuf, unsigned int nBufSize) {
   if (pfh->Type == FHT_STDIO) {
     if (fwrite(pcBuf, 1, nBufSize, pfh->fp) != nBufSize)
       return false;
+  } else if (pfh->Type == FHT_MEMORY) {
+    pfh->pMemory->append(pcBuf, nBufSize);
+    pfh->nSize = pfh->nPos = pfh->pMemory->size();
   } else
     _ThrowFileError(pfh, "writeBuf -> invalid type");
   return true;
@@ -630,8 +657,10 @@ bool XMFS::writeBuf(FileHandle *pfh, char *pcBuf, unsigned int nBufSize) {
 bool XMFS::setOffset(FileHandle *pfh, int nOffset) {
   if (pfh->Type == FHT_STDIO) {
     fseek(pfh->fp, nOffset, SEEK_SET);
-  } else if (pfh->Type == FHT_PACKAGE) {
-    fseek(pfh->fp, nOffset + pfh->nOffset, SEEK_SET);
+  } else if (pfh->Type == FHT_PACKAGE || pfh->Type == FHT_MEMORY) {
+    if (pfh->bWrite || nOffset < 0 || nOffset > pfh->nSize)
+      return false;
+    pfh->nPos = nOffset;
   } else
     _ThrowFileError(pfh, "setOffset -> invalid type");
   return true; /* blahh, this is not right, but... */
@@ -640,8 +669,8 @@ bool XMFS::setOffset(FileHandle *pfh, int nOffset) {
 bool XMFS::setEnd(FileHandle *pfh) {
   if (pfh->Type == FHT_STDIO) {
     fseek(pfh->fp, 0, SEEK_END);
-  } else if (pfh->Type == FHT_PACKAGE) {
-    fseek(pfh->fp, pfh->nSize + pfh->nOffset, SEEK_SET);
+  } else if (pfh->Type == FHT_PACKAGE || pfh->Type == FHT_MEMORY) {
+    pfh->nPos = pfh->nSize;
   } else
     _ThrowFileError(pfh, "setEnd -> invalid type");
   return true; /* ... */
@@ -651,8 +680,8 @@ int XMFS::getOffset(FileHandle *pfh) {
   int nOffset = 0;
   if (pfh->Type == FHT_STDIO) {
     nOffset = ftell(pfh->fp);
-  } else if (pfh->Type == FHT_PACKAGE) {
-    nOffset = ftell(pfh->fp) - pfh->nOffset;
+  } else if (pfh->Type == FHT_PACKAGE || pfh->Type == FHT_MEMORY) {
+    nOffset = pfh->nPos;
   } else
     _ThrowFileError(pfh, "getOffset -> invalid type");
   return nOffset;
@@ -667,9 +696,8 @@ bool XMFS::isEnd(FileHandle *pfh) {
   if (pfh->Type == FHT_STDIO) {
     if (!feof(pfh->fp))
       bEnd = false;
-  } else if (pfh->Type == FHT_PACKAGE) {
-    int nRem = pfh->nSize - (ftell(pfh->fp) - pfh->nOffset);
-    if (nRem > 0)
+  } else if (pfh->Type == FHT_PACKAGE || pfh->Type == FHT_MEMORY) {
+    if (pfh->nPos < pfh->nSize)
       bEnd = false;
   } else
     _ThrowFileError(pfh, "isEnd -> invalid type");
@@ -684,6 +712,13 @@ std::string XMFS::readFileToEnd(FileHandle *pfh) {
 
   v_res = "";
 
+  /* package and memory files are already in memory */
+  if (pfh->Type == FHT_PACKAGE || pfh->Type == FHT_MEMORY) {
+    v_res.assign(pfh->pcData + pfh->nPos, pfh->nSize - pfh->nPos);
+    pfh->nPos = pfh->nSize;
+    return v_res;
+  }
+
   while (v_remaining > 0) {
     v_toread = v_remaining > 16384 ? 16384 : v_remaining;
     if (readBuf(pfh, v_buffer, v_toread) == false) {
@@ -859,6 +894,13 @@ void XMFS::writeLineF(FileHandle *pfh, char *pcFmt, ...) {
 
 /* For buffered reading: */
 int XMFS::readBufferedChar(FileHandle *pfh) {
+  /* No buffer needed for package and memory files */
+  if (pfh->Type == FHT_PACKAGE || pfh->Type == FHT_MEMORY) {
+    if (pfh->nPos >= pfh->nSize)
+      return 0; /* end-of-file */
+    return pfh->pcData[pfh->nPos++];
+  }
+
   /* Need to buffer? */
   if (pfh->nWrite == pfh->nRead)
     if (fillBuffer(pfh) == 0)
@@ -875,6 +917,12 @@ int XMFS::readBufferedChar(FileHandle *pfh) {
 }
 
 int XMFS::peekNextBufferedChar(FileHandle *pfh) {
+  if (pfh->Type == FHT_PACKAGE || pfh->Type == FHT_MEMORY) {
+    if (pfh->nPos >= pfh->nSize)
+      return 0; /* end-of-file */
+    return pfh->pcData[pfh->nPos];
+  }
+
   /* Need to buffer? */
   if (pfh->nWrite == pfh->nRead)
     if (fillBuffer(pfh) == 0)
@@ -1159,6 +1207,46 @@ bool XMFS::m_bGotSystemDataDir;
 std::string XMFS::m_BinDataFile = "";
 std::string XMFS::m_binCheckSum = "";
 std::vector<PackFile> XMFS::m_PackFiles;
+HashNamespace::unordered_map<std::string, unsigned int> XMFS::m_PackFilesIndex;
+HashNamespace::unordered_map<std::string, std::vector<unsigned int> >
+  XMFS::m_PackDirsIndex;
+unsigned long long XMFS::m_packLoadingTime = 0;
+const char *XMFS::m_packData = NULL;
+size_t XMFS::m_packDataSize = 0;
+bool XMFS::m_packDataMapped = false;
+
+void XMFS::_IndexPackFiles() {
+  m_PackFilesIndex.clear();
+  m_PackDirsIndex.clear();
+
+  for (unsigned int i = 0; i < m_PackFiles.size(); i++) {
+    const std::string &v_name = m_PackFiles[i].Name;
+
+    /* keep the first one in case of duplicates */
+    if (m_PackFilesIndex.find(v_name) == m_PackFilesIndex.end()) {
+      m_PackFilesIndex[v_name] = i;
+    }
+
+    size_t k = v_name.find_last_of('/');
+    m_PackDirsIndex[k == std::string::npos ? "" : v_name.substr(0, k + 1)]
+      .push_back(i);
+  }
+}
+
+const PackFile *XMFS::_FindPackFile(const std::string &i_path) {
+  /* package names have no leading ./ */
+  size_t v_start = 0;
+  while (i_path.compare(v_start, 2, "./") == 0) {
+    v_start += 2;
+  }
+
+  HashNamespace::unordered_map<std::string, unsigned int>::const_iterator it =
+    m_PackFilesIndex.find(v_start == 0 ? i_path : i_path.substr(v_start));
+  if (it == m_PackFilesIndex.end()) {
+    return NULL;
+  }
+  return &m_PackFiles[it->second];
+}
 
 void XMFS::init(const std::string &AppDir,
                 const std::string &i_binFile,
@@ -1370,48 +1458,61 @@ void XMFS::init(const std::string &AppDir,
   }
 
   /* Initialize binary data package if any */
-  FILE *fp = fopen(m_BinDataFile.c_str(), "rb");
-  if (fp == NULL) {
+  unsigned long long v_packStartTime = System::getTimeUs();
+  m_PackFiles.clear();
+  _UnmapPackage();
+  if (mapFile(m_BinDataFile, &m_packData, &m_packDataSize, &m_packDataMapped) ==
+      false) {
     throw Exception("Package " + i_binFile + " not found !");
   }
 
-  char cBuf[256];
-  char md5sum[256];
-  fread(cBuf, 4, 1, fp);
-  if (!strncmp(cBuf, "XBI3", 4)) {
+  const unsigned char *v_pack = (const unsigned char *)m_packData;
+  size_t v_pos = 0;
+
+  if (m_packDataSize >= 5 && !strncmp(m_packData, "XBI3", 4)) {
     int nNameLen;
     int md5sumLen;
     PackFile v_packFile;
     size_t v_extension_place;
     std::string v_extension;
+    std::string v_md5sum;
+    v_pos = 4;
 
     /* get bin checksum of the package.list */
-    md5sumLen = fgetc(fp);
-    fread(md5sum, md5sumLen, 1, fp);
-    md5sum[md5sumLen] = '\0';
-    m_binCheckSum = md5sum;
+    md5sumLen = v_pack[v_pos++];
+    if (v_pos + md5sumLen > m_packDataSize) {
+      throw Exception("Invalid binary data package format");
+    }
+    m_binCheckSum = std::string(m_packData + v_pos, md5sumLen);
+    v_pos += md5sumLen;
 
-    while ((nNameLen = fgetc(fp)) >= 0) {
-      //          printf("%d  \n",nNameLen);
+    while (v_pos < m_packDataSize) {
       /* Read file name */
-      fread(cBuf, nNameLen, 1, fp);
-      cBuf[nNameLen] = '\0';
+      nNameLen = v_pack[v_pos++];
+      if (v_pos + nNameLen + 1 > m_packDataSize) {
+        throw Exception("Invalid binary data package format");
+      }
+      v_packFile.Name = std::string(m_packData + v_pos, nNameLen);
+      v_pos += nNameLen;
 
-      md5sumLen = fgetc(fp);
-      fread(md5sum, md5sumLen, 1, fp);
-      md5sum[md5sumLen] = '\0';
-      //          printf("      %s\n",cBuf);
+      md5sumLen = v_pack[v_pos++];
+      if (v_pos + md5sumLen + 4 > m_packDataSize) {
+        throw Exception("Invalid binary data package format");
+      }
+      v_md5sum = std::string(m_packData + v_pos, md5sumLen);
+      v_pos += md5sumLen;
 
       /* Read file size */
       int nSize;
 
       /* Patch by Michel Daenzer (applied 2005-10-25) */
-      unsigned char nSizeBuf[4];
-      fread(nSizeBuf, 4, 1, fp);
+      const unsigned char *nSizeBuf = v_pack + v_pos;
       nSize =
         nSizeBuf[0] | nSizeBuf[1] << 8 | nSizeBuf[2] << 16 | nSizeBuf[3] << 24;
-
-      v_packFile.Name = cBuf;
+      v_pos += 4;
+      if (nSize < 0 || v_pos + nSize > m_packDataSize) {
+        throw Exception("Invalid binary data package format");
+      }
 
       v_extension = "";
       v_extension_place = v_packFile.Name.rfind(".");
@@ -1427,18 +1528,20 @@ void XMFS::init(const std::string &AppDir,
                          v_extension != "ogg" && // music
                          v_extension != "wav" // sound
                          )) {
-        v_packFile.md5sum = md5sum;
-        v_packFile.nOffset = ftell(fp);
+        v_packFile.md5sum = v_md5sum;
+        v_packFile.nOffset = v_pos;
         v_packFile.nSize = nSize;
         m_PackFiles.push_back(v_packFile);
       }
 
-      fseek(fp, nSize, SEEK_CUR);
+      v_pos += nSize;
     }
   } else {
     throw Exception("Invalid binary data package format");
   }
-  fclose(fp);
+
+  _IndexPackFiles();
+  m_packLoadingTime = System::getTimeUs() - v_packStartTime;
 
   m_isInitialized = true;
 
@@ -1463,6 +1566,106 @@ void XMFS::init(const std::string &AppDir,
   }
 }
 
+bool XMFS::mapFile(const std::string &i_path,
+                   const char **o_data,
+                   size_t *o_size,
+                   bool *o_mapped) {
+  *o_data = NULL;
+  *o_size = 0;
+  *o_mapped = false;
+
+#if defined(WIN32)
+  HANDLE v_file = CreateFileA(i_path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              NULL,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              NULL);
+  if (v_file != INVALID_HANDLE_VALUE) {
+    LARGE_INTEGER v_size;
+    if (GetFileSizeEx(v_file, &v_size) && v_size.QuadPart > 0) {
+      HANDLE v_mapping =
+        CreateFileMappingA(v_file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (v_mapping != NULL) {
+        void *v_view = MapViewOfFile(v_mapping, FILE_MAP_READ, 0, 0, 0);
+        /* the view keeps the mapping alive */
+        CloseHandle(v_mapping);
+        if (v_view != NULL) {
+          *o_data = (const char *)v_view;
+          *o_size = (size_t)v_size.QuadPart;
+          *o_mapped = true;
+        }
+      }
+    }
+    CloseHandle(v_file);
+  }
+#elif !defined(__MORPHOS__) && !defined(__amigaos4__)
+  int v_fd = open(i_path.c_str(), O_RDONLY);
+  if (v_fd >= 0) {
+    struct stat v_st;
+    if (fstat(v_fd, &v_st) == 0 && v_st.st_size > 0) {
+      void *v_map = mmap(NULL, v_st.st_size, PROT_READ, MAP_PRIVATE, v_fd, 0);
+      if (v_map != MAP_FAILED) {
+        *o_data = (const char *)v_map;
+        *o_size = (size_t)v_st.st_size;
+        *o_mapped = true;
+      }
+    }
+    close(v_fd);
+  }
+#endif
+
+  if (*o_data != NULL) {
+    return true;
+  }
+
+  /* no mapping available, load the file in memory */
+  FILE *fp = fopen(i_path.c_str(), "rb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  fseek(fp, 0, SEEK_END);
+  long v_size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  char *v_data = v_size > 0 ? (char *)malloc(v_size) : NULL;
+  if (v_data == NULL || fread(v_data, 1, v_size, fp) != (size_t)v_size) {
+    free(v_data);
+    fclose(fp);
+    return false;
+  }
+  fclose(fp);
+
+  *o_data = v_data;
+  *o_size = (size_t)v_size;
+  return true;
+}
+
+void XMFS::unmapFile(const char *i_data, size_t i_size, bool i_mapped) {
+  if (i_data == NULL) {
+    return;
+  }
+
+  if (i_mapped) {
+#if defined(WIN32)
+    UnmapViewOfFile((LPCVOID)i_data);
+#elif !defined(__MORPHOS__) && !defined(__amigaos4__)
+    munmap((void *)i_data, i_size);
+#endif
+  } else {
+    free((void *)i_data);
+  }
+}
+
+void XMFS::_UnmapPackage() {
+  unmapFile(m_packData, m_packDataSize, m_packDataMapped);
+  m_packData = NULL;
+  m_packDataSize = 0;
+  m_packDataMapped = false;
+}
+
 void XMFS::uninit() {
 #ifndef WIN32
   if (m_xdgHd != NULL) {
@@ -1470,6 +1673,10 @@ void XMFS::uninit() {
     free(m_xdgHd);
   }
 #endif
+  m_PackFiles.clear();
+  m_PackFilesIndex.clear();
+  m_PackDirsIndex.clear();
+  _UnmapPackage();
   m_isInitialized = false;
 }
 
@@ -1598,14 +1805,9 @@ std::string XMFS::md5sum(FileDataType i_fdt, std::string i_filePath) {
 
   if (i_fdt == FDT_DATA) {
     /* package */
-    for (unsigned int i = 0; i < m_PackFiles.size(); i++) {
-      if (m_PackFiles[i].Name == i_filePath ||
-          (std::string("./") + m_PackFiles[i].Name) == i_filePath) {
-        /* Found it, yeah. */
-        // printf("md5sum(%s) = %s\n", m_PackFiles[i].Name.c_str(),
-        // m_PackFiles[i].md5sum.c_str());
-        return m_PackFiles[i].md5sum;
-      }
+    const PackFile *v_packFile = _FindPackFile(i_filePath);
+    if (v_packFile != NULL) {
+      return v_packFile->md5sum;
     }
   }
 
@@ -27,11 +27,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <basedir.h>
 #endif
 #include "VFileIO_types.h"
+#include "include/xm_hashmap.h"
 
 /*===========================================================================
   File handle types
   ===========================================================================*/
-enum FileHandleType { FHT_UNASSIGNED, FHT_STDIO, FHT_PACKAGE };
+enum FileHandleType { FHT_UNASSIGNED, FHT_STDIO, FHT_PACKAGE, FHT_MEMORY };
 
 /*===========================================================================
   Packaged files
@@ -52,6 +53,9 @@ struct FileHandle {
     Type = FHT_UNASSIGNED;
     nRead = nWrite = nSize = 0;
     fp = NULL;
+    nOffset = nPos = 0;
+    pcData = NULL;
+    pMemory = NULL;
     bRead = bWrite = false;
   }
 
@@ -67,6 +71,14 @@ struct FileHandle {
 
   int nOffset; /* in package */
 
+  /* Package and memory input files are views over some memory, fp is not
+     used */
+  const char *pcData;
+  int nPos;
+
+  /* Memory output files */
+  std::string *pMemory;
+
   /* I/O mode */
   bool bRead, bWrite;
 };
@@ -106,6 +118,14 @@ public:
                                std::string Path,
                                bool i_includeCurrentDir = false);
 
+  /* memory files : the output is kept in memory until the file is closed,
+     the input is a view over data which must outlive the file */
+  static FileHandle *openOMemory(const std::string &i_name);
+  static const std::string &getMemoryData(FileHandle *pfh);
+  static FileHandle *openIMemory(const std::string &i_name,
+                                 const char *i_data,
+                                 int i_size);
+
   static void closeFile(FileHandle *pfh);
   static bool areSamePath(const std::string &i_path1,
                           const std::string &i_path2);
@@ -173,6 +193,14 @@ public:
 
   static int mkDir(const char *pcPath);
 
+  /* read only mapping of a whole real file -- it is loaded in memory where
+     files can't be mapped ; return false if the file can't be read */
+  static bool mapFile(const std::string &i_path,
+                      const char **o_data,
+                      size_t *o_size,
+                      bool *o_mapped);
+  static void unmapFile(const char *i_data, size_t i_size, bool i_mapped);
+
   /* Data interfaces */
   static std::string getUserDir(FileDataType i_fdt);
   static std::string getUserDirUTF8(FileDataType i_fdt);
@@ -207,6 +235,10 @@ public:
                               const std::string &i_relative_path);
   static std::string binCheckSum();
 
+  /* package loading stats, to log once the logger is up */
+  static unsigned int packFilesNumber() { return m_PackFiles.size(); }
+  static unsigned long long packLoadingTime() { return m_packLoadingTime; }
+
   static void deleteFile(const std::string &i_filepath);
 
 private:
@@ -222,6 +254,9 @@ private:
   static void _FindFilesRecursive(const std::string &Dir,
                                   const std::string &Wildcard,
                                   std::vector<std::string> &List);
+  static void _IndexPackFiles();
+  static void _UnmapPackage();
+  static const PackFile *_FindPackFile(const std::string &i_path);
 
   /* Data */
   static std::string m_UserDataDir, m_UserDataDirUTF8, m_UserConfigDir,
@@ -230,6 +265,18 @@ private:
 
   static std::string m_BinDataFile;
   static std::vector<PackFile> m_PackFiles;
+  /* name -> index in m_PackFiles */
+  static HashNamespace::unordered_map<std::string, unsigned int>
+    m_PackFilesIndex;
+  /* directory ("" or ending with '/') -> indexes of the files it contains */
+  static HashNamespace::unordered_map<std::string, std::vector<unsigned int> >
+    m_PackDirsIndex;
+  static unsigned long long m_packLoadingTime; /* us */
+
+  /* the whole package, mapped (or loaded if it can't be mapped) at init */
+  static const char *m_packData;
+  static size_t m_packDataSize;
+  static bool m_packDataMapped;
   static std::string m_binCheckSum;
 
   // migrate from .xmoto to xdg base directories
@@ -34,6 +34,10 @@ XMLDocument::~XMLDocument() {
   }
 }
 
+void XMLDocument::init() {
+  xmlInitParser();
+}
+
 void XMLDocument::clean() {
   xmlCleanupParser();
 }
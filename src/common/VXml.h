@@ -31,6 +31,8 @@ public:
   XMLDocument();
   ~XMLDocument();
 
+  // init the parser ; required before parsing from several threads
+  static void init();
   // clean the class
   static void clean();
 
@@ -60,6 +60,7 @@ XMArguments::XMArguments() {
   m_opt_timedemo = false;
   m_opt_testTheme = false;
   m_opt_benchmark = false;
+  m_opt_benchmarkOutput = false;
   m_opt_cleanCache = false;
   m_opt_cleanNoWWWLevels = false;
   m_opt_gdebug = false;
@@ -77,6 +78,14 @@ XMArguments::XMArguments() {
   m_opt_serverOnly = false;
   m_opt_serverPort = false;
   m_opt_serverAdminPassword = false;
+  m_opt_serverTickStats = false;
+  m_opt_serverTickStatsFile = false;
+  m_opt_loadClients = false;
+  m_opt_loadClientsDuration = false;
+  m_opt_verifyReplays = false;
+  m_opt_verifyThreads = false;
+  m_opt_benchmarkCollisions = false;
+  m_opt_benchmarkPhysics = false;
   m_opt_updateLevelsOnly = false;
   m_opt_clientConnectAtStartup = false;
   m_opt_adminMode = false;
@@ -158,11 +167,14 @@ void XMArguments::parse(int i_argc, char **i_argv) {
     } else if (v_opt == "--nowww") {
       m_opt_nowww = true;
     } else if (v_opt == "-r" || v_opt == "--replay") {
-      m_opt_replay = true;
       if (i + 1 >= i_argc) {
         throw SyntaxError("missing replay file");
       }
-      m_replay_file = i_argv[i + 1];
+      if (m_opt_replay == false) {
+        m_replay_file = i_argv[i + 1];
+      }
+      m_opt_replay = true;
+      m_replay_files.push_back(i_argv[i + 1]);
       i++;
     } else if (v_opt == "-l" || v_opt == "--level") {
       m_opt_levelID = true;
@@ -212,6 +224,13 @@ void XMArguments::parse(int i_argc, char **i_argv) {
       m_opt_testTheme = true;
     } else if (v_opt == "--benchmark") {
       m_opt_benchmark = true;
+    } else if (v_opt == "--benchmarkOutput") {
+      m_opt_benchmarkOutput = true;
+      if (i + 1 >= i_argc) {
+        throw SyntaxError("missing value");
+      }
+      m_opt_benchmarkOutput_value = i_argv[i + 1];
+      i++;
     } else if (v_opt == "--cleancache") {
       m_opt_cleanCache = true;
     } else if (v_opt == "--noLog") {
@@ -290,6 +309,76 @@ void XMArguments::parse(int i_argc, char **i_argv) {
       }
       m_opt_serverAdminPassword_value = i_argv[i + 1];
       i++;
+    } else if (v_opt == "--serverTickStats") {
+      m_opt_serverTickStats = true;
+      if (i + 1 >= i_argc) {
+        throw SyntaxError("missing value");
+      }
+      m_opt_serverTickStats_value = atoi(i_argv[i + 1]);
+      if (m_opt_serverTickStats_value < 0) {
+        throw SyntaxError("invalid value");
+      }
+      i++;
+    } else if (v_opt == "--serverTickStatsFile") {
+      m_opt_serverTickStatsFile = true;
+      if (i + 1 >= i_argc) {
+        throw SyntaxError("missing value");
+      }
+      m_opt_serverTickStatsFile_value = i_argv[i + 1];
+      i++;
+    } else if (v_opt == "--loadClients") {
+      m_opt_loadClients = true;
+      if (i + 1 >= i_argc) {
+        throw SyntaxError("missing value");
+      }
+      m_opt_loadClients_value = atoi(i_argv[i + 1]);
+      if (m_opt_loadClients_value < 1) {
+        throw SyntaxError("invalid value");
+      }
+      i++;
+    } else if (v_opt == "--loadClientsDuration") {
+      m_opt_loadClientsDuration = true;
+      if (i + 1 >= i_argc) {
+        throw SyntaxError("missing value");
+      }
+      m_opt_loadClientsDuration_value = atoi(i_argv[i + 1]);
+      if (m_opt_loadClientsDuration_value < 1) {
+        throw SyntaxError("invalid value");
+      }
+      i++;
+    } else if (v_opt == "--verifyReplays") {
+      m_opt_verifyReplays = true;
+      while (i + 1 < i_argc && i_argv[i + 1][0] != '-') {
+        m_verifyReplays_files.push_back(i_argv[i + 1]);
+        i++;
+      }
+      if (m_verifyReplays_files.size() == 0) {
+        throw SyntaxError("missing replay");
+      }
+    } else if (v_opt == "--verifyThreads") {
+      m_opt_verifyThreads = true;
+      if (i + 1 >= i_argc) {
+        throw SyntaxError("missing value");
+      }
+      m_opt_verifyThreads_value = atoi(i_argv[i + 1]);
+      if (m_opt_verifyThreads_value < 1) {
+        throw SyntaxError("invalid value");
+      }
+      i++;
+    } else if (v_opt == "--benchmarkCollisions") {
+      m_opt_benchmarkCollisions = true;
+      while (i + 1 < i_argc && i_argv[i + 1][0] != '-') {
+        m_benchmarkCollisions_levels.push_back(
+          XMArguments::levelArg2levelId(i_argv[i + 1]));
+        i++;
+      }
+    } else if (v_opt == "--benchmarkPhysics") {
+      m_opt_benchmarkPhysics = true;
+      while (i + 1 < i_argc && i_argv[i + 1][0] != '-') {
+        m_benchmarkPhysics_levels.push_back(
+          XMArguments::levelArg2levelId(i_argv[i + 1]));
+        i++;
+      }
     } else if (v_opt == "--updateLevelsOnly") {
       m_opt_updateLevelsOnly = true;
     } else if (v_opt == "--connectAtStartup") {
@@ -313,8 +402,11 @@ void XMArguments::parse(int i_argc, char **i_argv) {
       std::string v_extension = XMFS::getFileExtension(v_arg);
 
       if (v_extension == "rpl") { /* replay file */
+        if (m_opt_replay == false) {
+          m_replay_file = v_arg;
+        }
         m_opt_replay = true;
-        m_replay_file = v_arg;
+        m_replay_files.push_back(v_arg);
       } else if (v_extension == "lvl") { /* level file */
         m_opt_levelFile = true;
         m_levelFile_file = v_arg;
@@ -448,6 +540,10 @@ std::string XMArguments::getOpt_replay_file() const {
   return m_replay_file;
 }
 
+const std::vector<std::string> &XMArguments::getOpt_replay_files() const {
+  return m_replay_files;
+}
+
 bool XMArguments::isOptLevelID() const {
   return m_opt_levelID;
 }
@@ -532,6 +628,14 @@ bool XMArguments::isOptBenchmark() const {
   return m_opt_benchmark;
 }
 
+bool XMArguments::isOptBenchmarkOutput() const {
+  return m_opt_benchmarkOutput;
+}
+
+std::string XMArguments::getOptBenchmarkOutput_value() const {
+  return m_opt_benchmarkOutput_value;
+}
+
 bool XMArguments::isOptCleanCache() const {
   return m_opt_cleanCache;
 }
@@ -636,6 +740,73 @@ std::string XMArguments::getOptServerAdminPassword_value() const {
   return m_opt_serverAdminPassword_value;
 }
 
+bool XMArguments::isOptServerTickStats() const {
+  return m_opt_serverTickStats;
+}
+
+int XMArguments::getOptServerTickStats_value() const {
+  return m_opt_serverTickStats_value;
+}
+
+bool XMArguments::isOptServerTickStatsFile() const {
+  return m_opt_serverTickStatsFile;
+}
+
+std::string XMArguments::getOptServerTickStatsFile_value() const {
+  return m_opt_serverTickStatsFile_value;
+}
+
+bool XMArguments::isOptLoadClients() const {
+  return m_opt_loadClients;
+}
+
+int XMArguments::getOptLoadClients_value() const {
+  return m_opt_loadClients_value;
+}
+
+bool XMArguments::isOptLoadClientsDuration() const {
+  return m_opt_loadClientsDuration;
+}
+
+int XMArguments::getOptLoadClientsDuration_value() const {
+  return m_opt_loadClientsDuration_value;
+}
+
+bool XMArguments::isOptVerifyReplays() const {
+  return m_opt_verifyReplays;
+}
+
+const std::vector<std::string> &XMArguments::getOptVerifyReplays_files()
+  const {
+  return m_verifyReplays_files;
+}
+
+bool XMArguments::isOptVerifyThreads() const {
+  return m_opt_verifyThreads;
+}
+
+int XMArguments::getOptVerifyThreads_value() const {
+  return m_opt_verifyThreads_value;
+}
+
+bool XMArguments::isOptBenchmarkCollisions() const {
+  return m_opt_benchmarkCollisions;
+}
+
+const std::vector<std::string> &
+XMArguments::getOptBenchmarkCollisions_levels() const {
+  return m_benchmarkCollisions_levels;
+}
+
+bool XMArguments::isOptBenchmarkPhysics() const {
+  return m_opt_benchmarkPhysics;
+}
+
+const std::vector<std::string> &
+XMArguments::getOptBenchmarkPhysics_levels() const {
+  return m_benchmarkPhysics_levels;
+}
+
 bool XMArguments::isOptClientConnectAtStartup() const {
   return m_opt_clientConnectAtStartup;
 }
@@ -691,7 +862,11 @@ void XMArguments::help(const std::string &i_cmd) {
   printf("\t\ta good OpenGL-enabled video card.\n");
   printf("\t--benchmark\n\t\tOnly meaningful when combined with --replay\n");
   printf("\t\tand --timedemo. Useful to determine the graphics\n");
-  printf("\t\tperformance.\n");
+  printf("\t\tperformance. Several replays can be given, they are\n");
+  printf("\t\tplayed one after the other.\n");
+  printf("\t--benchmarkOutput FILE\n\t\tWrite the times of the benchmark "
+         "phases per replay to FILE (json if it ends with .json, csv "
+         "else).\n");
   printf("\t--cleancache\n\t\tDeletes the content of the level cache.\n");
   printf("\t--cleanNoWWWLevels\n\t\tCheck web levels list and remove levels "
          "which are not available on the web.\n");
@@ -718,6 +893,23 @@ void XMArguments::help(const std::string &i_cmd) {
     "\t--serverPort PORT\n\t\tSpecify the server port (with --server only).\n");
   printf("\t--serverAdminPassword PASSWORD\n\t\tSpecify a server admin "
          "password which is always valid (with --server only).\n");
+  printf("\t--serverTickStats SECONDS\n\t\tLog the time spent in each phase "
+         "of the server ticks every SECONDS (0 to disable).\n");
+  printf("\t--serverTickStatsFile FILE\n\t\tAppend these stats to the csv "
+         "file FILE (with --serverTickStats only).\n");
+  printf("\t--loadClients NB\n\t\tConnect NB simulated players (no gui) to "
+         "the local server on --serverPort and log the network stats.\n");
+  printf("\t--loadClientsDuration SECONDS\n\t\tTime the simulated players "
+         "play (with --loadClients only, default is 60).\n");
+  printf("\t--verifyReplays REPLAY...\n\t\tPlay the replays back without "
+         "graphics and check that they are consistent (no gui) ; exit with 1 "
+         "if some are not.\n");
+  printf("\t--verifyThreads NB\n\t\tPlay NB replays at once (with "
+         "--verifyReplays only, default is the number of cpus).\n");
+  printf("\t--benchmarkCollisions [LEVEL...]\n\t\tTime the wheel collision "
+         "queries on the levels (all of them by default, no gui).\n");
+  printf("\t--benchmarkPhysics [LEVEL...]\n\t\tPlay the levels with scripted "
+         "controls and time the physics (all of them by default, no gui).\n");
   printf("\t--updateLevelsOnly\n\t\tOnly update levels (no gui).\n");
   printf(
     "\t--connectAtStartup\n\t\tConnect the client to the server at startup.\n");
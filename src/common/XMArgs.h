@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define __XMARGS_H__
 
 #include <string>
+#include <vector>
 
 class XMArguments {
 public:
@@ -52,6 +53,7 @@ public:
   bool isOptNoWWW() const;
   bool isOptReplay() const;
   std::string getOpt_replay_file() const;
+  const std::vector<std::string> &getOpt_replay_files() const;
   bool isOptLevelID() const;
   std::string getOpt_levelID_id() const;
   bool isOptLevelFile() const;
@@ -72,6 +74,8 @@ public:
   bool isOptNoLog() const;
   bool isOptTestTheme() const;
   bool isOptBenchmark() const;
+  bool isOptBenchmarkOutput() const;
+  std::string getOptBenchmarkOutput_value() const;
   bool isOptCleanCache() const;
   bool isOptCleanNoWWWLevels() const;
   bool isOptReplayInfos() const;
@@ -99,6 +103,22 @@ public:
   int getOptServerPort_value() const;
   bool isOptServerAdminPassword() const;
   std::string getOptServerAdminPassword_value() const;
+  bool isOptServerTickStats() const;
+  int getOptServerTickStats_value() const;
+  bool isOptServerTickStatsFile() const;
+  std::string getOptServerTickStatsFile_value() const;
+  bool isOptLoadClients() const;
+  int getOptLoadClients_value() const;
+  bool isOptLoadClientsDuration() const;
+  int getOptLoadClientsDuration_value() const;
+  bool isOptVerifyReplays() const;
+  const std::vector<std::string> &getOptVerifyReplays_files() const;
+  bool isOptVerifyThreads() const;
+  int getOptVerifyThreads_value() const;
+  bool isOptBenchmarkCollisions() const;
+  const std::vector<std::string> &getOptBenchmarkCollisions_levels() const;
+  bool isOptBenchmarkPhysics() const;
+  const std::vector<std::string> &getOptBenchmarkPhysics_levels() const;
   bool isOptUpdateLevelsOnly() const;
   bool isOptClientConnectAtStartup() const;
   bool isOptAdminMode() const;
@@ -149,6 +169,7 @@ private:
   /* replays */
   bool m_opt_replay;
   std::string m_replay_file;
+  std::vector<std::string> m_replay_files; // all the .rpl arguments
   bool m_opt_listReplays;
   bool m_opt_replayInfos;
   std::string m_replayInfos_file;
@@ -173,6 +194,8 @@ private:
   bool m_opt_timedemo;
   bool m_opt_testTheme;
   bool m_opt_benchmark;
+  bool m_opt_benchmarkOutput;
+  std::string m_opt_benchmarkOutput_value;
   bool m_opt_cleanCache;
   bool m_opt_cleanNoWWWLevels;
 
@@ -200,6 +223,28 @@ private:
   int m_opt_serverPort_value;
   bool m_opt_serverAdminPassword;
   std::string m_opt_serverAdminPassword_value;
+  bool m_opt_serverTickStats;
+  int m_opt_serverTickStats_value;
+  bool m_opt_serverTickStatsFile;
+  std::string m_opt_serverTickStatsFile_value;
+  bool m_opt_loadClients;
+  int m_opt_loadClients_value;
+  bool m_opt_loadClientsDuration;
+  int m_opt_loadClientsDuration_value;
+
+  /* replays verification */
+  bool m_opt_verifyReplays;
+  std::vector<std::string> m_verifyReplays_files;
+  bool m_opt_verifyThreads;
+  int m_opt_verifyThreads_value;
+
+  /* collision benchmark */
+  bool m_opt_benchmarkCollisions;
+  std::vector<std::string> m_benchmarkCollisions_levels;
+
+  /* physics benchmark */
+  bool m_opt_benchmarkPhysics;
+  std::vector<std::string> m_benchmarkPhysics_levels;
 
   /* net */
   bool m_opt_clientConnectAtStartup;
@@ -59,6 +59,7 @@ void XMSession::setToDefault() {
   m_www = DEFAULT_WWW;
   m_www_password = DEFAULT_WWW_PASSWORD;
   m_benchmark = DEFAULT_BENCHMARK;
+  m_benchmarkOutput = DEFAULT_BENCHMARK_OUTPUT;
   m_debug = DEFAULT_DEBUG;
   m_sqlTrace = DEFAULT_SQLTRACE;
   m_gdebug = DEFAULT_GDEBUG;
@@ -148,6 +149,8 @@ void XMSession::setToDefault() {
   m_clientConnectAtStartup = DEFAULT_CLIENTCONNECTATSTARTUP;
   m_serverPort = DEFAULT_SERVERPORT;
   m_serverMaxClients = DEFAULT_SERVERMAXCLIENTS;
+  m_serverTickStatsPeriod = DEFAULT_SERVERTICKSTATSPERIOD;
+  m_serverTickStatsFile = "";
   m_clientServerName = DEFAULT_CLIENTSERVERNAME;
   m_clientGhostMode = DEFAULT_CLIENTGHOSTMODE;
   m_clientServerPort = DEFAULT_CLIENTSERVERPORT;
@@ -197,6 +200,10 @@ void XMSession::load(const XMArguments *i_xmargs) {
     m_benchmark = true;
   }
 
+  if (i_xmargs->isOptBenchmarkOutput()) {
+    m_benchmarkOutput = i_xmargs->getOptBenchmarkOutput_value();
+  }
+
   if (i_xmargs->isOptDebug()) {
     m_debug = true;
   }
@@ -275,6 +282,14 @@ void XMSession::load(const XMArguments *i_xmargs) {
     m_clientConnectAtStartup = true;
   }
 
+  if (i_xmargs->isOptServerTickStats()) {
+    m_serverTickStatsPeriod = i_xmargs->getOptServerTickStats_value();
+  }
+
+  if (i_xmargs->isOptServerTickStatsFile()) {
+    m_serverTickStatsFile = i_xmargs->getOptServerTickStatsFile_value();
+  }
+
   if (i_xmargs->isOptAdminMode()) {
     m_adminMode = true;
   }
@@ -718,6 +733,10 @@ bool XMSession::benchmark() const {
   return m_benchmark;
 }
 
+std::string XMSession::benchmarkOutput() const {
+  return m_benchmarkOutput;
+}
+
 bool XMSession::debug() const {
   return m_debug;
 }
@@ -1450,6 +1469,24 @@ void XMSession::setServerMaxClients(unsigned int i_value) {
   m_serverMaxClients = i_value;
 }
 
+unsigned int XMSession::serverTickStatsPeriod() const {
+  return m_serverTickStatsPeriod;
+}
+
+void XMSession::setServerTickStatsPeriod(unsigned int i_value) {
+  PROPAGATE(XMSession, setServerTickStatsPeriod, i_value, unsigned int);
+  m_serverTickStatsPeriod = i_value;
+}
+
+std::string XMSession::serverTickStatsFile() const {
+  return m_serverTickStatsFile;
+}
+
+void XMSession::setServerTickStatsFile(const std::string &i_value) {
+  PROPAGATE_REF(XMSession, setServerTickStatsFile, i_value, std::string);
+  m_serverTickStatsFile = i_value;
+}
+
 std::string XMSession::clientServerName() const {
   return m_clientServerName;
 }
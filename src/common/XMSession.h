@@ -126,6 +126,7 @@ public:
   bool www() const;
   void setWWW(bool i_value);
   bool benchmark() const;
+  std::string benchmarkOutput() const;
   bool debug() const;
   bool sqlTrace() const;
   std::string profile() const;
@@ -293,6 +294,10 @@ public:
   void setServerPort(int i_value);
   unsigned int serverMaxClients() const;
   void setServerMaxClients(unsigned int i_value);
+  unsigned int serverTickStatsPeriod() const;
+  void setServerTickStatsPeriod(unsigned int i_value);
+  std::string serverTickStatsFile() const;
+  void setServerTickStatsFile(const std::string &i_value);
   std::string clientServerName() const;
   void setClientServerName(const std::string &i_value);
   bool clientGhostMode() const;
@@ -343,6 +348,7 @@ private:
   std::string m_drawlib;
   bool m_www;
   bool m_benchmark;
+  std::string m_benchmarkOutput;
   bool m_debug;
   bool m_sqlTrace;
   std::string m_profile;
@@ -438,6 +444,8 @@ private:
   bool m_clientConnectAtStartup;
   int m_serverPort;
   unsigned int m_serverMaxClients;
+  unsigned int m_serverTickStatsPeriod; // seconds, 0 for no periodic stats
+  std::string m_serverTickStatsFile;
   std::string m_clientServerName;
   int m_clientServerPort;
   int m_clientFramerateUpload;
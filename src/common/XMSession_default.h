@@ -52,6 +52,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define DEFAULT_WWW true
 #define DEFAULT_WWW_PASSWORD ""
 #define DEFAULT_BENCHMARK false
+#define DEFAULT_BENCHMARK_OUTPUT ""
 #define DEFAULT_DEBUG false
 #define DEFAULT_SQLTRACE false
 #define DEFAULT_GDEBUG false
@@ -133,6 +134,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define DEFAULT_CLIENTCONNECTATSTARTUP false
 #define DEFAULT_SERVERPORT 4130
 #define DEFAULT_SERVERMAXCLIENTS 64
+#define DEFAULT_SERVERTICKSTATSPERIOD 0
 #define DEFAULT_CLIENTSERVERNAME "games.tuxfamily.org"
 #define DEFAULT_CLIENTGHOSTMODE true
 #define DEFAULT_CLIENTSERVERPORT DEFAULT_SERVERPORT
@@ -28,7 +28,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "xmoto/GameText.h"
 #include <sstream>
 
-#define XMDB_VERSION 36
+#define XMDB_VERSION 37
 #define DB_MAX_SQL_RUNTIME 0.25
 #define DB_BUSY_TIMEOUT 60000 // 60 seconds
 
@@ -967,6 +967,16 @@ void xmDatabase::upgradeXmDbToVersion(int i_fromVersion,
         throw Exception("Unable to update xmDb from 35: " + e.getMsg());
       }
 
+    case 36:
+      try {
+        // to read again only the replays which changed
+        simpleSql("ALTER TABLE replays ADD COLUMN fileSize DEFAULT -1;");
+        simpleSql("ALTER TABLE replays ADD COLUMN fileMtime DEFAULT -1;");
+        updateXmDbVersion(37, i_interface);
+      } catch (Exception &e) {
+        throw Exception("Unable to update xmDb from 36: " + e.getMsg());
+      }
+
       // next
   }
 }
@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "common/VFileIO_types.h"
 #include "helpers/MultiSingleton.h"
 #include "xmDatabaseUpdateInterface.h"
+#include <map>
 #include <sqlite3.h>
 #include <string>
 #include <vector>
@@ -143,15 +144,21 @@ public:
 
   /* replays */
   bool replays_isIndexUptodate() const;
+  // the replays not added again are kept
   void replays_add_begin();
   void replays_add(const std::string &i_id_level,
                    const std::string &i_name,
                    const std::string &i_id_profile,
                    bool i_isFinished,
-                   int i_finishTime);
+                   int i_finishTime,
+                   long long i_fileSize = -1,
+                   long long i_fileMtime = -1);
   void replays_add_end();
   void replays_delete(const std::string &i_replay);
   bool replays_exists(const std::string &i_name);
+  // name => (size, modification time) of the file the replay was read from
+  void replays_fileStamps(
+    std::map<std::string, std::pair<long long, long long> > &o_stamps);
   void replays_print();
 
   /* themes */
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "helpers/Log.h"
 #include "xmDatabase.h"
 #include "xmscene/Level.h"
+#include "xmscene/LevelCacheManifest.h"
 #include <sstream>
 
 void xmDatabase::levels_add_begin(bool i_isToReload) {
@@ -309,7 +310,7 @@ bool xmDatabase::levels_add_fast(const std::string &i_filepath,
   }
 
   // checksum
-  v_checksum = XMFS::md5sum(FDT_DATA, i_filepath);
+  v_checksum = LevelCacheManifest::instance()->checkSum(i_filepath);
   i = 0;
   v_found = false;
   while (i < nrow && v_found == false) {
@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "xmDatabase.h"
 #include "xmoto/GameText.h"
 #include <math.h>
+#include <stdlib.h>
 #include <sstream>
 
 bool xmDatabase::replays_isIndexUptodate() const {
@@ -29,24 +30,26 @@ bool xmDatabase::replays_isIndexUptodate() const {
 
 void xmDatabase::replays_add_begin() {
   simpleSql("BEGIN TRANSACTION;");
-  simpleSql("DELETE FROM replays;");
 }
 
 void xmDatabase::replays_add(const std::string &i_id_level,
                              const std::string &i_name,
                              const std::string &i_id_profile,
                              bool i_isFinished,
-                             int i_finishTime) {
-  std::ostringstream v_finishTime;
-
-  v_finishTime << i_finishTime;
-
-  simpleSql(
-    "INSERT INTO replays(id_level, name, id_profile, isFinished, finishTime) "
-    "VALUES (\"" +
-    protectString(i_id_level) + "\", \"" + protectString(i_name) + "\", \"" +
-    protectString(i_id_profile) + "\", " +
-    std::string(i_isFinished ? "1" : "0") + ", " + v_finishTime.str() + ");");
+                             int i_finishTime,
+                             long long i_fileSize,
+                             long long i_fileMtime) {
+  std::ostringstream v_values;
+
+  v_values << i_finishTime << ", " << i_fileSize << ", " << i_fileMtime;
+
+  simpleSql("INSERT INTO replays(id_level, name, id_profile, isFinished, "
+            "finishTime, fileSize, fileMtime) "
+            "VALUES (\"" +
+            protectString(i_id_level) + "\", \"" + protectString(i_name) +
+            "\", \"" + protectString(i_id_profile) + "\", " +
+            std::string(i_isFinished ? "1" : "0") + ", " + v_values.str() +
+            ");");
 }
 
 void xmDatabase::replays_add_end() {
@@ -69,6 +72,20 @@ bool xmDatabase::replays_exists(const std::string &i_name) {
   return nrow == 1;
 }
 
+void xmDatabase::replays_fileStamps(
+  std::map<std::string, std::pair<long long, long long> > &o_stamps) {
+  char **v_result;
+  unsigned int nrow;
+
+  v_result = readDB("SELECT name, fileSize, fileMtime FROM replays;", nrow);
+  for (unsigned int i = 0; i < nrow; i++) {
+    o_stamps[getResult(v_result, 3, i, 0)] =
+      std::pair<long long, long long>(atoll(getResult(v_result, 3, i, 1)),
+                                      atoll(getResult(v_result, 3, i, 2)));
+  }
+  read_DB_free(v_result);
+}
+
 void xmDatabase::replays_print() {
   char **v_result;
   unsigned int nrow;
@@ -0,0 +1,86 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "PhaseTimer.h"
+#include "System.h"
+
+PhaseTimer::PhaseTimer(unsigned int i_nbPhases, unsigned int i_outerPhase) {
+  m_running = false;
+  m_outerPhase = i_outerPhase;
+  m_phase = i_outerPhase;
+  m_phaseStart = 0;
+  m_times.resize(i_nbPhases, 0);
+}
+
+void PhaseTimer::start() {
+  for (unsigned int i = 0; i < m_times.size(); i++) {
+    m_times[i] = 0;
+  }
+  m_phases.clear();
+  m_phase = m_outerPhase;
+  m_phaseStart = System::getTimeUs();
+  m_running = true;
+}
+
+void PhaseTimer::stop() {
+  if (m_running == false) {
+    return;
+  }
+  charge(System::getTimeUs());
+  m_running = false;
+}
+
+void PhaseTimer::charge(unsigned long long i_now) {
+  if (m_running) {
+    m_times[m_phase] += i_now - m_phaseStart;
+  }
+  m_phaseStart = i_now;
+}
+
+void PhaseTimer::enterPhase(unsigned int i_phase) {
+  charge(System::getTimeUs());
+  m_phases.push_back(m_phase);
+  m_phase = i_phase;
+}
+
+void PhaseTimer::leavePhase() {
+  charge(System::getTimeUs());
+  if (m_phases.empty() == false) {
+    m_phase = m_phases.back();
+    m_phases.pop_back();
+  }
+}
+
+unsigned long long PhaseTimer::time(unsigned int i_phase) const {
+  return m_times[i_phase];
+}
+
+PhaseTimerScope::PhaseTimerScope(PhaseTimer *i_timer, unsigned int i_phase) {
+  m_timer = i_timer->isRunning() ? i_timer : NULL;
+  if (m_timer != NULL) {
+    m_timer->enterPhase(i_phase);
+  }
+}
+
+PhaseTimerScope::~PhaseTimerScope() {
+  if (m_timer != NULL) {
+    m_timer->leavePhase();
+  }
+}
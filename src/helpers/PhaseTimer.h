@@ -0,0 +1,67 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __PHASETIMER_H__
+#define __PHASETIMER_H__
+
+#include <vector>
+
+/*
+  time spent in phases numbered from 0 ; phases can be nested, the time is
+  always charged to the innermost one, or to the outer phase out of any.
+  Times are only charged between start() and stop().
+*/
+class PhaseTimer {
+public:
+  PhaseTimer(unsigned int i_nbPhases, unsigned int i_outerPhase);
+
+  // forget the times and the entered phases
+  void start();
+  // the times are kept until the next start()
+  void stop();
+  bool isRunning() const { return m_running; }
+
+  void enterPhase(unsigned int i_phase);
+  void leavePhase();
+
+  unsigned long long time(unsigned int i_phase) const; // us
+
+private:
+  void charge(unsigned long long i_now);
+
+  bool m_running;
+  unsigned int m_outerPhase;
+  unsigned int m_phase;
+  std::vector<unsigned int> m_phases; // entered phases
+  unsigned long long m_phaseStart;
+  std::vector<unsigned long long> m_times;
+};
+
+// charge the time of its scope to a phase while the timer is running
+class PhaseTimerScope {
+public:
+  PhaseTimerScope(PhaseTimer *i_timer, unsigned int i_phase);
+  ~PhaseTimerScope();
+
+private:
+  PhaseTimer *m_timer; // NULL if the timer was not running
+};
+
+#endif
@@ -25,6 +25,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "include/xm_SDL.h"
 #include <sstream>
 
+#if defined(WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <sys/time.h>
+#include <unistd.h>
+#else
+#include <time.h>
+#endif
+
 #if defined(WIN32) || defined(__APPLE__)
 #else
 #include <sys/types.h>
@@ -150,3 +159,37 @@ std::string System::getMemoryInfo() {
 
   return v_res;
 }
+
+unsigned int System::getNumberOfCpus() {
+  long n;
+
+#if defined(WIN32)
+  SYSTEM_INFO v_info;
+  GetSystemInfo(&v_info);
+  n = v_info.dwNumberOfProcessors;
+#else
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  if (n < 1) {
+    return 1;
+  }
+  return (unsigned int)n;
+}
+
+unsigned long long System::getTimeUs() {
+#if defined(WIN32)
+  LARGE_INTEGER v_counter, v_freq;
+  QueryPerformanceCounter(&v_counter);
+  QueryPerformanceFrequency(&v_freq);
+  return (unsigned long long)(v_counter.QuadPart * 1000000.0 / v_freq.QuadPart);
+#elif defined(__APPLE__)
+  struct timeval v_tv;
+  gettimeofday(&v_tv, NULL);
+  return (unsigned long long)v_tv.tv_sec * 1000000ULL + v_tv.tv_usec;
+#else
+  struct timespec v_ts;
+  clock_gettime(CLOCK_MONOTONIC, &v_ts);
+  return (unsigned long long)v_ts.tv_sec * 1000000ULL + v_ts.tv_nsec / 1000;
+#endif
+}
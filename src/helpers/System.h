@@ -28,6 +28,10 @@ class System {
 public:
   static std::vector<std::string> *getDisplayModes(int windowed);
   static std::string getMemoryInfo();
+  // number of cpus available, at least 1
+  static unsigned int getNumberOfCpus();
+  // monotonic clock in microseconds, to measure short durations
+  static unsigned long long getTimeUs();
 };
 
 #endif
@@ -142,6 +142,25 @@ unsigned int ActionReader::getSubPacketSize(void *data,
   unsigned int i = 0;
   unsigned int res;
 
+  // binary framing : the size is in the fixed header, which is part of the
+  // packet
+  if (len > 0 && ((unsigned char *)data)[0] == XM_NET_BINARY_MAGIC) {
+    if (len < XM_NET_BINARY_HEADER_SIZE) {
+      return 0;
+    }
+    o_cmdStart = 0;
+    res = XM_NET_BINARY_HEADER_SIZE + (((unsigned char *)data)[3] |
+                                       (((unsigned char *)data)[4] << 8));
+
+    if (res > XM_MAX_PACKET_SIZE) {
+      Logger::LogData(data, len);
+      LogWarning("net: nasty client detected (4)");
+      throw Exception("net: nasty client detected");
+    }
+
+    return res;
+  }
+
   while (i < len && i < XM_MAX_PACKET_SIZE_DIGITS + 1) {
     if (((char *)data)[i] == '\n') {
       o_cmdStart = i + 1;
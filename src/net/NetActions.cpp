@@ -23,13 +23,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "common/DBuffer.h"
 #include "common/XMBuild.h"
 #include "common/XMSession.h"
+#include "NetUDPSendQueue.h"
 #include "extSDL_net.h"
 #include "helpers/Log.h"
 #include "helpers/Net.h"
 #include "helpers/SwapEndian.h"
+#include "helpers/System.h"
 #include "helpers/Text.h"
 #include "helpers/VExcept.h"
 #include "helpers/utf8.h"
+#include "include/xm_hashmap.h"
 #include <sstream>
 
 char NetAction::m_buffer[NETACTION_MAX_PACKET_SIZE];
@@ -37,8 +40,14 @@ unsigned int NetAction::m_biggestTCPPacketSent = 0;
 unsigned int NetAction::m_biggestUDPPacketSent = 0;
 unsigned int NetAction::m_nbTCPPacketsSent = 0;
 unsigned int NetAction::m_nbUDPPacketsSent = 0;
+unsigned int NetAction::m_nbUDPSendCalls = 0;
 unsigned int NetAction::m_TCPPacketsSizeSent = 0;
 unsigned int NetAction::m_UDPPacketsSizeSent = 0;
+unsigned int NetAction::m_nbEncodings = 0;
+unsigned int NetAction::m_nbBinaryEncodings = 0;
+unsigned int NetAction::m_nbPacketsSharedSent = 0;
+unsigned long long NetAction::m_encodingTime = 0;
+unsigned long long NetAction::m_sendingTime = 0;
 
 std::string NA_chatMessage::ActionKey = "message";
 std::string NA_chatMessagePP::ActionKey = "messagePP";
@@ -66,6 +75,9 @@ std::string NA_gameEvents::ActionKey = "e";
 std::string NA_srvCmd::ActionKey = "srvCmd";
 std::string NA_srvCmdAsw::ActionKey = "srvCmdAsw";
 std::string NA_ping::ActionKey = "ping";
+// frames are sent a lot
+std::string NA_frameDelta::ActionKey = "fd";
+std::string NA_frameAck::ActionKey = "fa";
 
 NetActionType NA_chatMessage::NAType = TNA_chatMessage;
 NetActionType NA_chatMessagePP::NAType = TNA_chatMessagePP;
@@ -90,11 +102,16 @@ NetActionType NA_gameEvents::NAType = TNA_gameEvents;
 NetActionType NA_srvCmd::NAType = TNA_srvCmd;
 NetActionType NA_srvCmdAsw::NAType = TNA_srvCmdAsw;
 NetActionType NA_ping::NAType = TNA_ping;
+NetActionType NA_frameDelta::NAType = TNA_frameDelta;
+NetActionType NA_frameAck::NAType = TNA_frameAck;
 
 NetAction::NetAction(bool i_forceTcp) {
   m_source = -2; // < -1 => undefined
   m_subsource = -2;
   m_forceTCP = i_forceTcp;
+  m_binaryFraming = false;
+  m_udpSendQueue = NULL;
+  m_encodingPacket = NULL;
 }
 
 NetAction::~NetAction() {}
@@ -113,12 +130,97 @@ void NetAction::logStats() {
   LogInfo("%-36s : %u",
           "net: number of UDP packets sent",
           NetAction::m_nbUDPPacketsSent);
+  LogInfo("%-36s : %u",
+          "net: number of UDP send calls",
+          NetAction::m_nbUDPSendCalls);
+  LogInfo("%-36s : %.2f",
+          "net: UDP packets per send call",
+          NetAction::m_nbUDPSendCalls == 0
+            ? 0.0
+            : NetAction::m_nbUDPPacketsSent /
+                (float)NetAction::m_nbUDPSendCalls);
   LogInfo("%-36s : %s",
           "net: biggest UDP packet sent",
           XMNet::getFancyBytes(NetAction::m_biggestUDPPacketSent).c_str());
   LogInfo("%-36s : %s",
           "net: size of UDP packets sent",
           XMNet::getFancyBytes(NetAction::m_UDPPacketsSizeSent).c_str());
+  LogInfo(
+    "%-36s : %u", "net: number of actions encoded", NetAction::m_nbEncodings);
+  LogInfo("%-36s : %u",
+          "net: number of binary actions encoded",
+          NetAction::m_nbBinaryEncodings);
+  LogInfo("%-36s : %u",
+          "net: number of shared packets sent",
+          NetAction::m_nbPacketsSharedSent);
+  LogInfo("%-36s : %.3f ms",
+          "net: time spent encoding",
+          NetAction::m_encodingTime / 1000.0);
+  LogInfo("%-36s : %.3f ms",
+          "net: time spent sending",
+          NetAction::m_sendingTime / 1000.0);
+}
+
+NetPacket::NetPacket() {
+  m_data = NULL;
+  m_size = 0;
+  m_allowTcp = false;
+  m_allowUdp = false;
+  m_refs = 1;
+}
+
+NetPacket::~NetPacket() {
+  if (m_data != NULL) {
+    delete[] m_data;
+  }
+}
+
+void NetPacket::ref() {
+  m_refs++;
+}
+
+void NetPacket::unref() {
+  m_refs--;
+  if (m_refs == 0) {
+    delete this;
+  }
+}
+
+const char *NetPacket::data() const {
+  return m_data;
+}
+
+unsigned int NetPacket::size() const {
+  return m_size;
+}
+
+void NetPacket::set(const char *i_data,
+                    unsigned int i_size,
+                    bool i_allowTcp,
+                    bool i_allowUdp) {
+  if (m_data != NULL) {
+    delete[] m_data;
+  }
+  m_data = new char[i_size];
+  memcpy(m_data, i_data, i_size);
+  m_size = i_size;
+  m_allowTcp = i_allowTcp;
+  m_allowUdp = i_allowUdp;
+}
+
+void NetPacket::send(TCPsocket *i_tcpsd,
+                     UDPsocket *i_udpsd,
+                     UDPpacket *i_sendPacket,
+                     IPaddress *i_udpRemoteIP,
+                     NetUDPSendQueue *i_udpQueue) {
+  NetAction::m_nbPacketsSharedSent++;
+  NetAction::sendBuffer(m_data,
+                        m_size,
+                        m_allowTcp ? i_tcpsd : NULL,
+                        m_allowUdp ? i_udpsd : NULL,
+                        i_sendPacket,
+                        i_udpRemoteIP,
+                        i_udpQueue);
 }
 
 void NetAction::send(TCPsocket *i_tcpsd,
@@ -127,76 +229,166 @@ void NetAction::send(TCPsocket *i_tcpsd,
                      IPaddress *i_udpRemoteIP,
                      const void *subPacketData,
                      int subPacketLen) {
-  unsigned int nread;
-  std::string v_data;
+  unsigned long long v_startTime;
 
   if (m_source < -1 || m_subsource < -1) {
     throw Exception("Invalid source");
   }
 
-  unsigned int v_subPacketSize = subPacketLen + 1;
-  std::ostringstream v_nb, v_src, v_subsrc;
-  v_src << m_source;
-  v_subsrc << m_subsource;
-  unsigned int v_subHeaderSize = v_src.str().length() + 1 +
-                                 v_subsrc.str().length() + 1 +
-                                 actionKey().length() + 1;
-  v_nb << (v_subHeaderSize + v_subPacketSize);
-  unsigned int v_headerSize = v_nb.str().length() + 1 + v_subHeaderSize;
+  v_startTime = System::getTimeUs();
+
+  unsigned int v_totalPacketSize;
 
-  unsigned int v_totalPacketSize = v_headerSize + v_subPacketSize;
+  if (m_binaryFraming) {
+    unsigned int v_subPacketSize = subPacketLen + 1;
+    v_totalPacketSize = XM_NET_BINARY_HEADER_SIZE + v_subPacketSize;
 
-  if (v_totalPacketSize > NETACTION_MAX_PACKET_SIZE) {
-    throw Exception("net: too big packet to send");
+    if (v_totalPacketSize > NETACTION_MAX_PACKET_SIZE) {
+      throw Exception("net: too big packet to send");
+    }
+
+    m_buffer[0] = (char)XM_NET_BINARY_MAGIC;
+    m_buffer[1] = (char)actionType();
+    m_buffer[2] = (char)m_subsource;
+    m_buffer[3] = v_subPacketSize & 0xFF;
+    m_buffer[4] = (v_subPacketSize >> 8) & 0xFF;
+    m_buffer[5] = m_source & 0xFF;
+    m_buffer[6] = (m_source >> 8) & 0xFF;
+    m_buffer[7] = (m_source >> 16) & 0xFF;
+    m_buffer[8] = (m_source >> 24) & 0xFF;
+    if (subPacketLen != 0) {
+      memcpy(m_buffer + XM_NET_BINARY_HEADER_SIZE, subPacketData, subPacketLen);
+    }
+    m_buffer[v_totalPacketSize - 1] = '\n';
+
+    NetAction::m_nbBinaryEncodings++;
+
+  } else {
+    char v_src[16], v_subsrc[16], v_nb[16];
+    unsigned int v_subPacketSize = subPacketLen + 1;
+    unsigned int v_subHeaderSize =
+      snprintf(v_src, sizeof(v_src), "%i", m_source) + 1 +
+      snprintf(v_subsrc, sizeof(v_subsrc), "%i", m_subsource) + 1 +
+      actionKey().length() + 1;
+    unsigned int v_headerSize =
+      snprintf(v_nb, sizeof(v_nb), "%u", v_subHeaderSize + v_subPacketSize) +
+      1 + v_subHeaderSize;
+
+    v_totalPacketSize = v_headerSize + v_subPacketSize;
+
+    if (v_totalPacketSize > NETACTION_MAX_PACKET_SIZE) {
+      throw Exception("net: too big packet to send");
+    }
+
+    snprintf(m_buffer,
+             NETACTION_MAX_PACKET_SIZE,
+             "%s\n%s\n%s\n%s\n",
+             v_nb,
+             v_src,
+             v_subsrc,
+             actionKey().c_str());
+    if (subPacketLen != 0) {
+      memcpy(m_buffer + v_headerSize, subPacketData, subPacketLen);
+    }
+    m_buffer[v_totalPacketSize - 1] = '\n';
   }
 
-  snprintf(m_buffer,
-           NETACTION_MAX_PACKET_SIZE,
-           "%s\n%s\n%s\n%s\n",
-           v_nb.str().c_str(),
-           v_src.str().c_str(),
-           v_subsrc.str().c_str(),
-           actionKey().c_str());
-  if (subPacketLen != 0) {
-    memcpy(m_buffer + v_headerSize, subPacketData, subPacketLen);
+  NetAction::m_nbEncodings++;
+  NetAction::m_encodingTime += System::getTimeUs() - v_startTime;
+
+  // encode() : keep the bytes and the transports allowed by the action
+  if (m_encodingPacket != NULL) {
+    m_encodingPacket->set(m_buffer,
+                          v_totalPacketSize,
+                          i_tcpsd != NULL,
+                          i_udpsd != NULL && m_forceTCP == false);
+    return;
   }
-  m_buffer[v_totalPacketSize - 1] = '\n';
 
-  if (i_udpsd != NULL && m_forceTCP == false) {
-    if ((v_totalPacketSize) > (unsigned int)i_sendPacket->maxlen) {
+  sendBuffer(m_buffer,
+             v_totalPacketSize,
+             i_tcpsd,
+             m_forceTCP ? NULL : i_udpsd,
+             i_sendPacket,
+             i_udpRemoteIP,
+             m_udpSendQueue);
+}
+
+void NetAction::sendBuffer(const char *i_buffer,
+                           unsigned int i_size,
+                           TCPsocket *i_tcpsd,
+                           UDPsocket *i_udpsd,
+                           UDPpacket *i_sendPacket,
+                           IPaddress *i_udpRemoteIP,
+                           NetUDPSendQueue *i_udpQueue) {
+  unsigned int nread;
+  unsigned long long v_startTime = System::getTimeUs();
+
+  if (i_udpsd != NULL) {
+    if (i_size > (unsigned int)i_sendPacket->maxlen) {
       LogWarning("UDP packet too big");
     } else {
-      i_sendPacket->len = v_totalPacketSize;
-      memcpy(i_sendPacket->data, m_buffer, v_totalPacketSize);
-
-      i_sendPacket->address = *i_udpRemoteIP;
-      if (SDLNet_UDP_Send(*i_udpsd, -1, i_sendPacket) == 0) {
-        LogWarning("SDLNet_UDP_Send failed : %s", SDLNet_GetError());
+      if (i_udpQueue != NULL) {
+        i_udpQueue->push(i_buffer, i_size, i_udpRemoteIP);
+      } else {
+        i_sendPacket->len = i_size;
+        memcpy(i_sendPacket->data, i_buffer, i_size);
+
+        i_sendPacket->address = *i_udpRemoteIP;
+        if (SDLNet_UDP_Send(*i_udpsd, -1, i_sendPacket) == 0) {
+          LogWarning("SDLNet_UDP_Send failed : %s", SDLNet_GetError());
+        }
+        NetAction::m_nbUDPSendCalls++;
       }
 
-      if (v_totalPacketSize > NetAction::m_biggestUDPPacketSent) {
-        NetAction::m_biggestUDPPacketSent = v_totalPacketSize;
+      if (i_size > NetAction::m_biggestUDPPacketSent) {
+        NetAction::m_biggestUDPPacketSent = i_size;
       }
       NetAction::m_nbUDPPacketsSent++;
-      NetAction::m_UDPPacketsSizeSent += v_totalPacketSize;
+      NetAction::m_UDPPacketsSizeSent += i_size;
     }
 
   } else if (i_tcpsd != NULL) {
     // don't send the \0
     if ((nread = SDLNet_TCP_Send_noBlocking(
-           *i_tcpsd, m_buffer, v_totalPacketSize)) != v_totalPacketSize) {
+           *i_tcpsd, i_buffer, i_size)) != i_size) {
+      NetAction::m_sendingTime += System::getTimeUs() - v_startTime;
       throw Exception("TCP_Send failed");
     }
 
-    if (v_totalPacketSize > NetAction::m_biggestTCPPacketSent) {
-      NetAction::m_biggestTCPPacketSent = v_totalPacketSize;
+    if (i_size > NetAction::m_biggestTCPPacketSent) {
+      NetAction::m_biggestTCPPacketSent = i_size;
     }
     NetAction::m_nbTCPPacketsSent++;
-    NetAction::m_TCPPacketsSizeSent += v_totalPacketSize;
+    NetAction::m_TCPPacketsSizeSent += i_size;
 
   } else {
     LogWarning("Packet not send, no protocol set");
   }
+
+  NetAction::m_sendingTime += System::getTimeUs() - v_startTime;
+}
+
+NetPacket *NetAction::encode() {
+  // the actions choose their transport from the sockets they get : give them
+  // all, and keep what they pass on
+  TCPsocket v_tcpsd = NULL;
+  UDPsocket v_udpsd = NULL;
+  UDPpacket v_sendPacket;
+  IPaddress v_udpRemoteIP;
+  NetPacket *v_packet = new NetPacket();
+
+  m_encodingPacket = v_packet;
+  try {
+    send(&v_tcpsd, &v_udpsd, &v_sendPacket, &v_udpRemoteIP);
+  } catch (Exception &e) {
+    m_encodingPacket = NULL;
+    v_packet->unref();
+    throw e;
+  }
+  m_encodingPacket = NULL;
+
+  return v_packet;
 }
 
 void NetAction::setSource(int i_src, int i_subsrc) {
@@ -204,6 +396,18 @@ void NetAction::setSource(int i_src, int i_subsrc) {
   m_subsource = i_subsrc;
 }
 
+void NetAction::setBinaryFraming(bool i_value) {
+  m_binaryFraming = i_value;
+}
+
+bool NetAction::binaryFraming() const {
+  return m_binaryFraming;
+}
+
+void NetAction::setUDPSendQueue(NetUDPSendQueue *i_udpQueue) {
+  m_udpSendQueue = i_udpQueue;
+}
+
 int NetAction::getSource() const {
   return m_source;
 }
@@ -215,172 +419,228 @@ int NetAction::getSubSource() const {
 void NetAction::getNetAction(NetActionU *o_netAction,
                              void *data,
                              unsigned int len) {
-  std::string v_cmd;
   int v_src, v_subsrc;
+  NetActionType v_type;
   unsigned int v_totalOffset = 0;
+  bool v_binary = len > 0 && ((unsigned char *)data)[0] == XM_NET_BINARY_MAGIC;
 
-  v_src = atoi(
-    getLine(((char *)data) + v_totalOffset, len - v_totalOffset, &v_totalOffset)
-      .c_str());
-  v_subsrc = atoi(
-    getLine(((char *)data + v_totalOffset), len - v_totalOffset, &v_totalOffset)
-      .c_str());
-
-  if (v_src < -1 || v_subsrc < 0 ||
-      v_subsrc >= NETACTION_MAX_SUBSRC) { // subsrc must be 0, 1 or 2 or 3
-    throw Exception("Invalid source");
-  }
-
-  v_cmd = getLine(((char *)data + v_totalOffset), len, &v_totalOffset);
-
-  // printf("cmd = %s (%i/%i)\n", v_cmd.c_str(), v_totalOffset,
-  // len-v_totalOffset);
-
-  if (v_cmd == NA_frame::ActionKey) {
-    o_netAction->frame =
-      NA_frame(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->frame);
-  }
-
-  else if (v_cmd == NA_playerControl::ActionKey) {
-    o_netAction->playerControl =
-      NA_playerControl(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->playerControl);
-  }
-
-  else if (v_cmd == NA_chatMessage::ActionKey) {
-    o_netAction->chatMessage =
-      NA_chatMessage(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->chatMessage);
-  }
-
-  else if (v_cmd == NA_chatMessagePP::ActionKey) {
-    o_netAction->chatMessagePP =
-      NA_chatMessagePP(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->chatMessagePP);
-  }
-
-  else if (v_cmd == NA_clientInfos::ActionKey) {
-    o_netAction->clientInfos =
-      NA_clientInfos(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->clientInfos);
-  }
-
-  else if (v_cmd == NA_udpBindQuery::ActionKey) {
-    o_netAction->udpBindQuery =
-      NA_udpBindQuery(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->udpBindQuery);
-  }
-
-  else if (v_cmd == NA_udpBindValidation::ActionKey) {
-    o_netAction->udpBindValidation =
-      NA_udpBindValidation(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->udpBindValidation);
-  }
-
-  else if (v_cmd == NA_udpBind::ActionKey) {
-    o_netAction->udpBind =
-      NA_udpBind(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->udpBind);
-  }
-
-  else if (v_cmd == NA_changeName::ActionKey) {
-    o_netAction->changeName =
-      NA_changeName(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->changeName);
-  }
-
-  else if (v_cmd == NA_playingLevel::ActionKey) {
-    o_netAction->playingLevel =
-      NA_playingLevel(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->playingLevel);
-  }
-
-  else if (v_cmd == NA_serverError::ActionKey) {
-    o_netAction->serverError =
-      NA_serverError(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->serverError);
-  }
-
-  else if (v_cmd == NA_changeClients::ActionKey) {
-    o_netAction->changeClients =
-      NA_changeClients(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->changeClients);
-  }
-
-  else if (v_cmd == NA_slaveClientsPoints::ActionKey) {
-    o_netAction->slaveClientsPoints = NA_slaveClientsPoints(
-      ((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->slaveClientsPoints);
-  }
-
-  else if (v_cmd == NA_clientsNumber::ActionKey) {
-    o_netAction->clientsNumber =
-      NA_clientsNumber(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->clientsNumber);
-  }
-
-  else if (v_cmd == NA_clientsNumberQuery::ActionKey) {
-    o_netAction->clientsNumberQuery = NA_clientsNumberQuery(
-      ((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->clientsNumberQuery);
-  }
-
-  else if (v_cmd == NA_clientMode::ActionKey) {
-    o_netAction->clientMode =
-      NA_clientMode(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->clientMode);
-  }
+  if (v_binary) {
+    unsigned char *v_header = (unsigned char *)data;
 
-  else if (v_cmd == NA_prepareToPlay::ActionKey) {
-    o_netAction->prepareToPlay =
-      NA_prepareToPlay(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->prepareToPlay);
-  }
-
-  else if (v_cmd == NA_killAlert::ActionKey) {
-    o_netAction->killAlert =
-      NA_killAlert(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->killAlert);
-  }
-
-  else if (v_cmd == NA_prepareToGo::ActionKey) {
-    o_netAction->prepareToGo =
-      NA_prepareToGo(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->prepareToGo);
-  }
+    if (len < XM_NET_BINARY_HEADER_SIZE ||
+        (unsigned int)(v_header[3] | (v_header[4] << 8)) !=
+          len - XM_NET_BINARY_HEADER_SIZE) {
+      throw Exception("net: invalid binary packet");
+    }
+    v_type = (NetActionType)v_header[1];
+    v_subsrc = v_header[2];
+    v_src = (int)((unsigned int)v_header[5] | ((unsigned int)v_header[6] << 8) |
+                  ((unsigned int)v_header[7] << 16) |
+                  ((unsigned int)v_header[8] << 24));
+    v_totalOffset = XM_NET_BINARY_HEADER_SIZE;
 
-  else if (v_cmd == NA_gameEvents::ActionKey) {
-    o_netAction->gameEvents =
-      NA_gameEvents(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->gameEvents);
+  } else {
+    v_src = atoi(getLine(((char *)data) + v_totalOffset,
+                         len - v_totalOffset,
+                         &v_totalOffset)
+                   .c_str());
+    v_subsrc = atoi(getLine(((char *)data + v_totalOffset),
+                            len - v_totalOffset,
+                            &v_totalOffset)
+                      .c_str());
   }
 
-  else if (v_cmd == NA_srvCmd::ActionKey) {
-    o_netAction->srvCmd =
-      NA_srvCmd(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->srvCmd);
+  if (v_src < -1 || v_subsrc < 0 ||
+      v_subsrc >= NETACTION_MAX_SUBSRC) { // subsrc must be 0, 1 or 2 or 3
+    throw Exception("Invalid source");
   }
 
-  else if (v_cmd == NA_srvCmdAsw::ActionKey) {
-    o_netAction->srvCmdAsw =
-      NA_srvCmdAsw(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->srvCmdAsw);
+  if (v_binary == false) {
+    v_type = getActionType(
+      getLine(((char *)data + v_totalOffset), len, &v_totalOffset));
   }
 
-  else if (v_cmd == NA_ping::ActionKey) {
-    o_netAction->ping =
-      NA_ping(((char *)data) + v_totalOffset, len - v_totalOffset);
-    o_netAction->master = &(o_netAction->ping);
+  char *v_data = ((char *)data) + v_totalOffset;
+  unsigned int v_len = len - v_totalOffset;
+
+  switch (v_type) {
+    case TNA_frame:
+      o_netAction->frame = NA_frame(v_data, v_len);
+      o_netAction->master = &(o_netAction->frame);
+      break;
+
+    case TNA_playerControl:
+      o_netAction->playerControl = NA_playerControl(v_data, v_len);
+      o_netAction->master = &(o_netAction->playerControl);
+      break;
+
+    case TNA_chatMessage:
+      o_netAction->chatMessage = NA_chatMessage(v_data, v_len);
+      o_netAction->master = &(o_netAction->chatMessage);
+      break;
+
+    case TNA_chatMessagePP:
+      o_netAction->chatMessagePP = NA_chatMessagePP(v_data, v_len);
+      o_netAction->master = &(o_netAction->chatMessagePP);
+      break;
+
+    case TNA_clientInfos:
+      o_netAction->clientInfos = NA_clientInfos(v_data, v_len);
+      o_netAction->master = &(o_netAction->clientInfos);
+      break;
+
+    case TNA_udpBindQuery:
+      o_netAction->udpBindQuery = NA_udpBindQuery(v_data, v_len);
+      o_netAction->master = &(o_netAction->udpBindQuery);
+      break;
+
+    case TNA_udpBindValidation:
+      o_netAction->udpBindValidation = NA_udpBindValidation(v_data, v_len);
+      o_netAction->master = &(o_netAction->udpBindValidation);
+      break;
+
+    case TNA_udpBind:
+      o_netAction->udpBind = NA_udpBind(v_data, v_len);
+      o_netAction->master = &(o_netAction->udpBind);
+      break;
+
+    case TNA_changeName:
+      o_netAction->changeName = NA_changeName(v_data, v_len);
+      o_netAction->master = &(o_netAction->changeName);
+      break;
+
+    case TNA_playingLevel:
+      o_netAction->playingLevel = NA_playingLevel(v_data, v_len);
+      o_netAction->master = &(o_netAction->playingLevel);
+      break;
+
+    case TNA_serverError:
+      o_netAction->serverError = NA_serverError(v_data, v_len);
+      o_netAction->master = &(o_netAction->serverError);
+      break;
+
+    case TNA_changeClients:
+      o_netAction->changeClients = NA_changeClients(v_data, v_len);
+      o_netAction->master = &(o_netAction->changeClients);
+      break;
+
+    case TNA_slaveClientsPoints:
+      o_netAction->slaveClientsPoints = NA_slaveClientsPoints(v_data, v_len);
+      o_netAction->master = &(o_netAction->slaveClientsPoints);
+      break;
+
+    case TNA_clientsNumber:
+      o_netAction->clientsNumber = NA_clientsNumber(v_data, v_len);
+      o_netAction->master = &(o_netAction->clientsNumber);
+      break;
+
+    case TNA_clientsNumberQuery:
+      o_netAction->clientsNumberQuery = NA_clientsNumberQuery(v_data, v_len);
+      o_netAction->master = &(o_netAction->clientsNumberQuery);
+      break;
+
+    case TNA_clientMode:
+      o_netAction->clientMode = NA_clientMode(v_data, v_len);
+      o_netAction->master = &(o_netAction->clientMode);
+      break;
+
+    case TNA_prepareToPlay:
+      o_netAction->prepareToPlay = NA_prepareToPlay(v_data, v_len);
+      o_netAction->master = &(o_netAction->prepareToPlay);
+      break;
+
+    case TNA_killAlert:
+      o_netAction->killAlert = NA_killAlert(v_data, v_len);
+      o_netAction->master = &(o_netAction->killAlert);
+      break;
+
+    case TNA_prepareToGo:
+      o_netAction->prepareToGo = NA_prepareToGo(v_data, v_len);
+      o_netAction->master = &(o_netAction->prepareToGo);
+      break;
+
+    case TNA_gameEvents:
+      o_netAction->gameEvents = NA_gameEvents(v_data, v_len);
+      o_netAction->master = &(o_netAction->gameEvents);
+      break;
+
+    case TNA_srvCmd:
+      o_netAction->srvCmd = NA_srvCmd(v_data, v_len);
+      o_netAction->master = &(o_netAction->srvCmd);
+      break;
+
+    case TNA_srvCmdAsw:
+      o_netAction->srvCmdAsw = NA_srvCmdAsw(v_data, v_len);
+      o_netAction->master = &(o_netAction->srvCmdAsw);
+      break;
+
+    case TNA_ping:
+      o_netAction->ping = NA_ping(v_data, v_len);
+      o_netAction->master = &(o_netAction->ping);
+      break;
+
+    case TNA_frameDelta:
+      o_netAction->frameDelta = NA_frameDelta(v_data, v_len);
+      o_netAction->master = &(o_netAction->frameDelta);
+      break;
+
+    case TNA_frameAck:
+      o_netAction->frameAck = NA_frameAck(v_data, v_len);
+      o_netAction->master = &(o_netAction->frameAck);
+      break;
+
+    default:
+      throw Exception("net: invalid command");
   }
 
-  else {
-    //((char*)data)[len-1] = '\0';
-    // LogInfo("Invalid command : %s", (char*)data);
+  o_netAction->master->setSource(v_src, v_subsrc);
+  o_netAction->master->setBinaryFraming(v_binary);
+}
+
+static HashNamespace::unordered_map<std::string, NetActionType>
+buildActionTypes() {
+  HashNamespace::unordered_map<std::string, NetActionType> v_types;
+
+  v_types[NA_frame::ActionKey] = NA_frame::NAType;
+  v_types[NA_playerControl::ActionKey] = NA_playerControl::NAType;
+  v_types[NA_chatMessage::ActionKey] = NA_chatMessage::NAType;
+  v_types[NA_chatMessagePP::ActionKey] = NA_chatMessagePP::NAType;
+  v_types[NA_clientInfos::ActionKey] = NA_clientInfos::NAType;
+  v_types[NA_udpBindQuery::ActionKey] = NA_udpBindQuery::NAType;
+  v_types[NA_udpBindValidation::ActionKey] = NA_udpBindValidation::NAType;
+  v_types[NA_udpBind::ActionKey] = NA_udpBind::NAType;
+  v_types[NA_changeName::ActionKey] = NA_changeName::NAType;
+  v_types[NA_playingLevel::ActionKey] = NA_playingLevel::NAType;
+  v_types[NA_serverError::ActionKey] = NA_serverError::NAType;
+  v_types[NA_changeClients::ActionKey] = NA_changeClients::NAType;
+  v_types[NA_slaveClientsPoints::ActionKey] = NA_slaveClientsPoints::NAType;
+  v_types[NA_clientsNumber::ActionKey] = NA_clientsNumber::NAType;
+  v_types[NA_clientsNumberQuery::ActionKey] = NA_clientsNumberQuery::NAType;
+  v_types[NA_clientMode::ActionKey] = NA_clientMode::NAType;
+  v_types[NA_prepareToPlay::ActionKey] = NA_prepareToPlay::NAType;
+  v_types[NA_killAlert::ActionKey] = NA_killAlert::NAType;
+  v_types[NA_prepareToGo::ActionKey] = NA_prepareToGo::NAType;
+  v_types[NA_gameEvents::ActionKey] = NA_gameEvents::NAType;
+  v_types[NA_srvCmd::ActionKey] = NA_srvCmd::NAType;
+  v_types[NA_srvCmdAsw::ActionKey] = NA_srvCmdAsw::NAType;
+  v_types[NA_ping::ActionKey] = NA_ping::NAType;
+  v_types[NA_frameDelta::ActionKey] = NA_frameDelta::NAType;
+  v_types[NA_frameAck::ActionKey] = NA_frameAck::NAType;
+
+  return v_types;
+}
+
+NetActionType NetAction::getActionType(const std::string &i_actionKey) {
+  // built once, even if the client and the server run in the same process
+  static const HashNamespace::unordered_map<std::string, NetActionType>
+    v_types = buildActionTypes();
+
+  HashNamespace::unordered_map<std::string, NetActionType>::const_iterator it =
+    v_types.find(i_actionKey);
+  if (it == v_types.end()) {
     throw Exception("net: invalid command");
   }
-
-  o_netAction->master->setSource(v_src, v_subsrc);
+  return it->second;
 }
 
 std::string NetAction::getLine(void *data,
@@ -607,22 +867,13 @@ void NA_frame::send(TCPsocket *i_tcpsd,
                     UDPsocket *i_udpsd,
                     UDPpacket *i_sendPacket,
                     IPaddress *i_udpRemoteIP) {
-  if (i_udpsd != NULL) {
-    // if udp is available, prefer udp
-    NetAction::send(NULL,
-                    i_udpsd,
-                    i_sendPacket,
-                    i_udpRemoteIP,
-                    &m_state,
-                    sizeof(SerializedBikeState));
-  } else {
-    NetAction::send(i_tcpsd,
-                    i_udpsd,
-                    i_sendPacket,
-                    i_udpRemoteIP,
-                    &m_state,
-                    sizeof(SerializedBikeState));
-  }
+  // if udp is available, NetAction::send() prefers it
+  NetAction::send(i_tcpsd,
+                  i_udpsd,
+                  i_sendPacket,
+                  i_udpRemoteIP,
+                  &m_state,
+                  sizeof(SerializedBikeState));
 }
 
 SerializedBikeState *NA_frame::getState() {
@@ -1409,3 +1660,134 @@ int NA_ping::id() const {
 bool NA_ping::isPong() const {
   return m_isPong;
 }
+
+NA_frameDelta::NA_frameDelta()
+  : NetAction(false) {
+  m_size = 0;
+  m_seq = 0;
+  m_hasBase = false;
+  m_baseSeq = 0;
+}
+
+NA_frameDelta::NA_frameDelta(unsigned short i_seq,
+                             const SerializedBikeState *i_base,
+                             unsigned short i_baseSeq,
+                             const SerializedBikeState &i_state,
+                             SerializedBikeState &o_rebuilt)
+  : NetAction(false) {
+  m_size =
+    NetFrameDelta::encode(i_seq, i_base, i_baseSeq, i_state, m_data, o_rebuilt);
+  m_seq = i_seq;
+  m_hasBase = i_base != NULL;
+  m_baseSeq = i_baseSeq;
+}
+
+NA_frameDelta::NA_frameDelta(void *data, unsigned int len)
+  : NetAction(false) {
+  if (len - 1 > XM_NET_FRAME_DELTA_MAX_SIZE) {
+    throw Exception("Invalid NA_frameDelta");
+  }
+  m_size = len - 1; // -1 because in the protocol, you always finish by a \n
+  memcpy(m_data, data, m_size);
+  NetFrameDelta::readHeader(m_data, m_size, m_seq, m_hasBase, m_baseSeq);
+}
+
+NA_frameDelta::~NA_frameDelta() {}
+
+void NA_frameDelta::send(TCPsocket *i_tcpsd,
+                         UDPsocket *i_udpsd,
+                         UDPpacket *i_sendPacket,
+                         IPaddress *i_udpRemoteIP) {
+  NetAction::send(
+    i_tcpsd, i_udpsd, i_sendPacket, i_udpRemoteIP, m_data, m_size);
+}
+
+unsigned short NA_frameDelta::seq() const {
+  return m_seq;
+}
+
+bool NA_frameDelta::hasBase() const {
+  return m_hasBase;
+}
+
+unsigned short NA_frameDelta::baseSeq() const {
+  return m_baseSeq;
+}
+
+void NA_frameDelta::getState(const SerializedBikeState *i_base,
+                             SerializedBikeState *o_state) {
+  NetFrameDelta::decode(m_data, m_size, i_base, *o_state);
+}
+
+NA_frameAck::NA_frameAck()
+  : NetAction(false) {}
+
+NA_frameAck::NA_frameAck(void *data, unsigned int len)
+  : NetAction(false) {
+  unsigned int v_localOffset = 0;
+  NetFrameAck v_ack;
+
+  if (len == 1) { // no ack (only \n)
+    return;
+  }
+
+  while (v_localOffset < len) {
+    v_ack.Src = atoi(getLine(((char *)data) + v_localOffset,
+                             len - v_localOffset,
+                             &v_localOffset)
+                       .c_str());
+    v_ack.SubSrc = atoi(getLine(((char *)data) + v_localOffset,
+                                len - v_localOffset,
+                                &v_localOffset)
+                          .c_str());
+    v_ack.Seq = atoi(getLine(((char *)data) + v_localOffset,
+                             len - v_localOffset,
+                             &v_localOffset)
+                       .c_str());
+    m_acks.push_back(v_ack);
+  }
+}
+
+NA_frameAck::~NA_frameAck() {}
+
+void NA_frameAck::send(TCPsocket *i_tcpsd,
+                       UDPsocket *i_udpsd,
+                       UDPpacket *i_sendPacket,
+                       IPaddress *i_udpRemoteIP) {
+  std::ostringstream v_send;
+
+  for (unsigned int i = 0; i < m_acks.size(); i++) {
+    v_send << m_acks[i].Src << "\n";
+    v_send << m_acks[i].SubSrc << "\n";
+    v_send << m_acks[i].Seq << "\n";
+  }
+
+  if (m_acks.size() > 0) {
+    NetAction::send(i_tcpsd,
+                    i_udpsd,
+                    i_sendPacket,
+                    i_udpRemoteIP,
+                    v_send.str().c_str(),
+                    v_send.str().size() -
+                      1); // don't send the \0 and the last \n
+  } else {
+    NetAction::send(i_tcpsd,
+                    i_udpsd,
+                    i_sendPacket,
+                    i_udpRemoteIP,
+                    v_send.str().c_str(),
+                    v_send.str().size()); // don't send the \0
+  }
+}
+
+const std::vector<NetFrameAck> &NA_frameAck::getAcks() const {
+  return m_acks;
+}
+
+void NA_frameAck::add(const NetFrameAck &i_ack) {
+  m_acks.push_back(i_ack);
+}
+
+void NA_frameAck::clear() {
+  m_acks.clear();
+}
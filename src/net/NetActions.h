@@ -24,10 +24,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "../include/xm_SDL_net.h"
 #include "../xmscene/BasicSceneStructs.h"
 #include "BasicStructures.h"
+#include "NetFrameDelta.h"
 #include <string>
 #include <vector>
 
-#define XM_NET_PROTOCOL_VERSION 6
+#define XM_NET_PROTOCOL_VERSION 8
 /*
 DELTA 1->2:
 clientInfos : add xmversion string
@@ -39,8 +40,25 @@ DELTA 4->5
 add slaveClientsPoints
 DELTA 5->6
 add pings
+DELTA 6->7
+binary framing (the text framing is still understood)
+DELTA 7->8
+add frameDelta and frameAck
 */
 
+// first protocol version understanding the binary framing
+#define XM_NET_PROTOCOL_BINARY 7
+// first protocol version understanding the delta frames
+#define XM_NET_PROTOCOL_FRAMEDELTA 8
+
+/*
+  binary framing, all numbers in little endian :
+  magic (1 byte) | action type (1) | subsrc (1) | payload size (2) | src (4)
+  the magic can't start a text packet, which always starts by its size
+*/
+#define XM_NET_BINARY_MAGIC 0xFE
+#define XM_NET_BINARY_HEADER_SIZE 9
+
 #define NETACTION_MAX_PACKET_SIZE 1024 * 8 // bytes
 #define NETACTION_MAX_SUBSRC 4 // maximum 4 players by client
 #define XM_NET_MAX_EVENTS_SHOT_SIZE 1024 * 8
@@ -49,6 +67,7 @@ class NetClient;
 class ServerThread;
 class DBuffer;
 
+// the values are sent in the binary framing : add new types at the end
 enum NetActionType {
   TNA_clientInfos,
   TNA_udpBindQuery,
@@ -72,7 +91,9 @@ enum NetActionType {
   TNA_gameEvents,
   TNA_srvCmd,
   TNA_srvCmdAsw,
-  TNA_ping
+  TNA_ping,
+  TNA_frameDelta,
+  TNA_frameAck
 };
 
 struct NetInfosClient {
@@ -85,8 +106,53 @@ struct NetPointsClient {
   int Points;
 };
 
+struct NetFrameAck {
+  int Src; // source of the frames (-1 for the own frames of the client)
+  int SubSrc;
+  unsigned short Seq;
+};
+
 struct NetActionU;
 
+/*
+  a net action encoded once, to be sent as is to several clients.
+  It's immutable ; it's deleted when the last reference is released.
+*/
+class NetUDPSendQueue;
+
+class NetPacket {
+public:
+  NetPacket();
+
+  void ref();
+  void unref();
+
+  const char *data() const;
+  unsigned int size() const;
+
+  // same transport choice as NetAction::send()
+  void send(TCPsocket *i_tcpsd,
+            UDPsocket *i_udpsd,
+            UDPpacket *i_sendPacket,
+            IPaddress *i_udpRemoteIP,
+            NetUDPSendQueue *i_udpQueue = NULL);
+
+private:
+  ~NetPacket();
+  void set(const char *i_data,
+           unsigned int i_size,
+           bool i_allowTcp,
+           bool i_allowUdp);
+
+  char *m_data;
+  unsigned int m_size;
+  bool m_allowTcp; // the action accepts to be sent over tcp
+  bool m_allowUdp; // the action accepts to be sent over udp
+  unsigned int m_refs;
+
+  friend class NetAction;
+};
+
 class NetAction {
 public:
   NetAction(bool i_forceTcp);
@@ -100,6 +166,17 @@ public:
                     IPaddress *i_udpRemoteIP);
   void setSource(int i_src, int i_subsrc);
 
+  // framing used to send the action, or the one it was received with
+  void setBinaryFraming(bool i_value);
+  bool binaryFraming() const;
+
+  // when set, udp datagrams are queued instead of being sent at once
+  void setUDPSendQueue(NetUDPSendQueue *i_udpQueue);
+
+  // encode the action (with its current source) without sending it ; the
+  // caller owns one reference on the returned packet
+  NetPacket *encode();
+
   int getSource() const;
   int getSubSource() const;
 
@@ -114,10 +191,25 @@ public:
   static unsigned int m_biggestUDPPacketSent;
   static unsigned int m_nbTCPPacketsSent;
   static unsigned int m_nbUDPPacketsSent;
+  static unsigned int m_nbUDPSendCalls; // system calls sending udp packets
   static unsigned int m_TCPPacketsSizeSent;
   static unsigned int m_UDPPacketsSizeSent;
+  static unsigned int m_nbEncodings;
+  static unsigned int m_nbBinaryEncodings;
+  static unsigned int m_nbPacketsSharedSent; // sends of an encoded packet
+  static unsigned long long m_encodingTime; // microseconds
+  static unsigned long long m_sendingTime; // microseconds
   /* ***** */
 
+  // send a fully encoded buffer, updating the stats
+  static void sendBuffer(const char *i_buffer,
+                         unsigned int i_size,
+                         TCPsocket *i_tcpsd,
+                         UDPsocket *i_udpsd,
+                         UDPpacket *i_sendPacket,
+                         IPaddress *i_udpRemoteIP,
+                         NetUDPSendQueue *i_udpQueue = NULL);
+
 protected:
   void send(TCPsocket *i_tcpsd,
             UDPsocket *i_udpsd,
@@ -145,12 +237,17 @@ protected:
   static std::string getLineCheckUTF8(void *data,
                                       unsigned int len,
                                       unsigned int *o_local_offset);
+  static NetActionType getActionType(const std::string &i_actionKey);
 
 private:
   static char m_buffer[NETACTION_MAX_PACKET_SIZE];
 
   bool m_forceTCP; // by default, xmoto try to use UDP when available ; for some
   // actions, TCP can be forced
+  bool m_binaryFraming;
+  NetUDPSendQueue *m_udpSendQueue;
+  NetPacket *m_encodingPacket; // while encode() runs, send() fills it instead
+  // of sending
 };
 
 class NA_udpBind : public NetAction {
@@ -683,6 +780,66 @@ private:
   bool m_isPong; // is it an answer of a ping ?
 };
 
+/* a frame encoded relatively to a frame the client acknowledged */
+class NA_frameDelta : public NetAction {
+public:
+  NA_frameDelta();
+  // o_rebuilt is the frame as the client will decode it
+  NA_frameDelta(unsigned short i_seq,
+                const SerializedBikeState *i_base /* NULL for a full frame */,
+                unsigned short i_baseSeq,
+                const SerializedBikeState &i_state,
+                SerializedBikeState &o_rebuilt);
+  NA_frameDelta(void *data, unsigned int len);
+  virtual ~NA_frameDelta();
+  std::string actionKey() { return ActionKey; }
+  NetActionType actionType() { return NAType; }
+  static std::string ActionKey;
+  static NetActionType NAType;
+
+  void send(TCPsocket *i_tcpsd,
+            UDPsocket *i_udpsd,
+            UDPpacket *i_sendPacket,
+            IPaddress *i_udpRemoteIP);
+
+  unsigned short seq() const;
+  bool hasBase() const;
+  unsigned short baseSeq() const;
+  // i_base is the frame baseSeq() if hasBase()
+  void getState(const SerializedBikeState *i_base, SerializedBikeState *o_state);
+
+private:
+  char m_data[XM_NET_FRAME_DELTA_MAX_SIZE];
+  unsigned int m_size;
+  unsigned short m_seq;
+  bool m_hasBase;
+  unsigned short m_baseSeq;
+};
+
+/* frames received by the client, to be used as baselines by the server */
+class NA_frameAck : public NetAction {
+public:
+  NA_frameAck();
+  NA_frameAck(void *data, unsigned int len);
+  virtual ~NA_frameAck();
+  std::string actionKey() { return ActionKey; }
+  NetActionType actionType() { return NAType; }
+  static std::string ActionKey;
+  static NetActionType NAType;
+
+  void send(TCPsocket *i_tcpsd,
+            UDPsocket *i_udpsd,
+            UDPpacket *i_sendPacket,
+            IPaddress *i_udpRemoteIP);
+
+  const std::vector<NetFrameAck> &getAcks() const;
+  void add(const NetFrameAck &i_ack);
+  void clear();
+
+private:
+  std::vector<NetFrameAck> m_acks;
+};
+
 /* structure to avoid allocation of the NetAction while netaction are read and
  * manage one by one */
 struct NetActionU {
@@ -713,6 +870,8 @@ public:
   NA_srvCmd srvCmd;
   NA_srvCmdAsw srvCmdAsw;
   NA_ping ping;
+  NA_frameDelta frameDelta;
+  NA_frameAck frameAck;
 };
 
 #endif
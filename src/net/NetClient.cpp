@@ -50,6 +50,7 @@ NetClient::NetClient() {
   m_isConnected = false;
   m_serverReceivesUdp = false;
   m_serverSendsUdp = false;
+  m_serverUsesBinaryFraming = false;
   m_universe = NULL;
   m_mode = NETCLIENT_GHOST_MODE;
   m_points = 0;
@@ -78,6 +79,7 @@ NetClient::NetClient() {
 }
 
 NetClient::~NetClient() {
+  clearFrameHistories();
   delete m_otherClientsLevelsList;
   delete m_tcpReader;
   SDLNet_FreePacket(m_udpSendPacket);
@@ -198,6 +200,8 @@ void NetClient::manageNetworkOneStep(int i_timeout, xmDatabase *pDb) {
       throw Exception("TCP action failed");
     }
   }
+
+  sendFrameAcks();
 }
 
 void NetClient::fastConnectDisconnect(const std::string &i_server, int i_port) {
@@ -223,6 +227,7 @@ void NetClient::connect(const std::string &i_server, int i_port) {
   // reset udp server information
   m_serverReceivesUdp = false;
   m_serverSendsUdp = false;
+  m_serverUsesBinaryFraming = false;
 
   if (SDLNet_ResolveHost(&serverIp, i_server.c_str(), i_port) < 0) {
     throw Exception(SDLNet_GetError());
@@ -293,6 +298,8 @@ void NetClient::disconnect() {
     m_otherClients.clear();
   }
 
+  clearFrameHistories();
+
   m_isConnected = false;
   StateManager::instance()->sendAsynchronousMessage("CLIENT_STATUS_CHANGED");
 }
@@ -311,6 +318,7 @@ UDPsocket *NetClient::udpSocket() {
 
 void NetClient::send(NetAction *i_netAction, int i_subsrc, bool i_forceUdp) {
   i_netAction->setSource(0, i_subsrc);
+  i_netAction->setBinaryFraming(m_serverUsesBinaryFraming);
 
   try {
     if (i_forceUdp) {
@@ -344,6 +352,7 @@ void NetClient::endPlay() {
     }
   }
   m_universe = NULL;
+  clearFrameHistories();
 }
 
 void NetClient::changeMode(NetClientMode i_mode) {
@@ -403,6 +412,12 @@ void NetClient::updateOtherClientsMode(std::vector<int> i_slavePlayers) {
 }
 
 void NetClient::manageAction(xmDatabase *pDb, NetAction *i_netAction) {
+  // the server sends binary packets only to clients understanding them
+  if (i_netAction->binaryFraming() && m_serverUsesBinaryFraming == false) {
+    m_serverUsesBinaryFraming = true;
+    LogInfo("client: the server uses the binary framing");
+  }
+
   switch (i_netAction->actionType()) {
     case TNA_clientInfos:
     case TNA_clientMode:
@@ -498,120 +513,42 @@ void NetClient::manageAction(xmDatabase *pDb, NetAction *i_netAction) {
     } break;
 
     case TNA_frame: {
-      NetGhost *v_ghost = NULL;
-      int v_clientId = -1;
-
-      if (m_universe == NULL) {
-        return;
-      }
-
-      /* the server sending us our own frame */
-      if (i_netAction->getSource() == -1) {
-        if (m_mode == NETCLIENT_SLAVE_MODE) { /* ONLY IN SLAVE MODE */
-          if (GameApp::getXMTimeInt() - m_currentOwnFramesTime > 1000) {
-            m_lastOwnFPS = (m_currentOwnFramesNb * 1000) /
-                           (GameApp::getXMTimeInt() - m_currentOwnFramesTime);
-            m_currentOwnFramesTime = GameApp::getXMTimeInt();
-            m_currentOwnFramesNb = 0;
-          }
-          m_currentOwnFramesNb++;
-
-          for (unsigned int i = 0; i < m_universe->getScenes().size(); i++) {
-            for (unsigned int j = 0;
-                 j < m_universe->getScenes()[i]->Players().size();
-                 j++) {
-              BikeState::convertStateFromReplay(
-                ((NA_frame *)i_netAction)->getState(),
-                m_universe->getScenes()[i]->Players()[j]->getStateForUpdate(),
-                m_universe->getScenes()[i]->getPhysicsSettings());
-
-              // adjust the time of the server frame to the time of the local
-              // scene
-              m_universe->getScenes()[i]->setTargetTime(
-                ((NA_frame *)i_netAction)->getState()->fGameTime * 100.0);
-            }
-
-            // if the game is in pause, at least update the player position
-            if (m_universe->getScenes()[i]->isPaused()) {
-              m_universe->getScenes()[i]->updatePlayers(0 /* 0 to not update */,
-                                                        true);
-            }
-          }
-        }
-
-      } else {
-        // search the client
-        for (unsigned int i = 0; i < m_otherClients.size(); i++) {
-          if (m_otherClients[i]->id() == i_netAction->getSource()) {
-            v_clientId = i;
-            break;
-          }
-        }
-        if (v_clientId < 0) {
-          return; // client not declared
-        }
+      manageFrame(i_netAction->getSource(),
+                  i_netAction->getSubSource(),
+                  ((NA_frame *)i_netAction)->getState());
+    } break;
 
-        // check if the ghost already exists
-        if (m_otherClients[v_clientId]->netGhost(i_netAction->getSubSource()) !=
-            NULL) {
-          v_ghost =
-            m_otherClients[v_clientId]->netGhost(i_netAction->getSubSource());
+    case TNA_frameDelta: {
+      NA_frameDelta *v_na = (NA_frameDelta *)i_netAction;
+      NetFrameHistory *v_history =
+        frameHistory(v_na->getSource(), v_na->getSubSource());
+      const SerializedBikeState *v_base = NULL;
+      SerializedBikeState v_state;
+      NetFrameAck v_ack;
+
+      if (v_na->hasBase()) {
+        v_base = v_history->get(v_na->baseSeq());
+        if (v_base == NULL) {
+          // baseline lost or too old ; the server sends a full frame once it
+          // doesn't get acks anymore
+          return;
         }
+      }
+      v_na->getState(v_base, &v_state);
+      v_history->store(v_na->seq(), v_state);
 
-        if (v_ghost == NULL) {
-          /* add the net ghost */
-
-          // if this is a client of the current party, add it as normal player
-          bool v_isSlaveMode =
-            m_otherClients[v_clientId]->mode() == NETCLIENT_SLAVE_MODE;
-
-          for (unsigned int i = 0; i < m_universe->getScenes().size(); i++) {
-            if (v_isSlaveMode) {
-              v_ghost = m_universe->getScenes()[i]->addNetGhost(
-                m_otherClients[v_clientId]->name(),
-                Theme::instance(),
-                Theme::instance()->getNetPlayerTheme(),
-                TColor(0, 255, 255, 0),
-                TColor(GET_RED(Theme::instance()
-                                 ->getNetPlayerTheme()
-                                 ->getUglyRiderColor()),
-                       GET_GREEN(Theme::instance()
-                                   ->getNetPlayerTheme()
-                                   ->getUglyRiderColor()),
-                       GET_BLUE(Theme::instance()
-                                  ->getNetPlayerTheme()
-                                  ->getUglyRiderColor()),
-                       0));
-            } else {
-              v_ghost = m_universe->getScenes()[i]->addNetGhost(
-                m_otherClients[v_clientId]->name(),
-                Theme::instance(),
-                Theme::instance()->getGhostTheme(),
-                TColor(255, 255, 255, 0),
-                TColor(
-                  GET_RED(
-                    Theme::instance()->getGhostTheme()->getUglyRiderColor()),
-                  GET_GREEN(
-                    Theme::instance()->getGhostTheme()->getUglyRiderColor()),
-                  GET_BLUE(
-                    Theme::instance()->getGhostTheme()->getUglyRiderColor()),
-                  0));
-            }
-            m_otherClients[v_clientId]->setNetGhost(i_netAction->getSubSource(),
-                                                    v_ghost);
-          }
-        }
+      v_ack.Src = v_na->getSource();
+      v_ack.SubSrc = v_na->getSubSource();
+      v_ack.Seq = v_na->seq();
+      m_frameAcks.add(v_ack);
 
-        // take the physic of the first world
-        if (m_universe->getScenes().size() > 0) {
-          BikeState::convertStateFromReplay(
-            ((NA_frame *)i_netAction)->getState(),
-            v_ghost->getStateForUpdate(),
-            m_universe->getScenes()[0]->getPhysicsSettings());
-        }
-      }
+      manageFrame(v_na->getSource(), v_na->getSubSource(), &v_state);
     } break;
 
+    case TNA_frameAck:
+      /* should not happend */
+      break;
+
     case TNA_changeName: {
       // change the client name
       for (unsigned int i = 0; i < m_otherClients.size(); i++) {
@@ -990,3 +927,154 @@ std::string NetClient::getMemoriedPPAsString(const std::string &i_suffix) {
   }
   return v_res;
 }
+
+void NetClient::manageFrame(int i_src,
+                            int i_subsrc,
+                            SerializedBikeState *i_state) {
+  NetGhost *v_ghost = NULL;
+  int v_clientId = -1;
+
+  if (m_universe == NULL) {
+    return;
+  }
+
+  /* the server sending us our own frame */
+  if (i_src == -1) {
+    if (m_mode == NETCLIENT_SLAVE_MODE) { /* ONLY IN SLAVE MODE */
+      if (GameApp::getXMTimeInt() - m_currentOwnFramesTime > 1000) {
+        m_lastOwnFPS = (m_currentOwnFramesNb * 1000) /
+                       (GameApp::getXMTimeInt() - m_currentOwnFramesTime);
+        m_currentOwnFramesTime = GameApp::getXMTimeInt();
+        m_currentOwnFramesNb = 0;
+      }
+      m_currentOwnFramesNb++;
+
+      for (unsigned int i = 0; i < m_universe->getScenes().size(); i++) {
+        for (unsigned int j = 0;
+             j < m_universe->getScenes()[i]->Players().size();
+             j++) {
+          BikeState::convertStateFromReplay(
+            i_state,
+            m_universe->getScenes()[i]->Players()[j]->getStateForUpdate(),
+            m_universe->getScenes()[i]->getPhysicsSettings());
+
+          // adjust the time of the server frame to the time of the local
+          // scene
+          m_universe->getScenes()[i]->setTargetTime(i_state->fGameTime *
+                                                    100.0);
+        }
+
+        // if the game is in pause, at least update the player position
+        if (m_universe->getScenes()[i]->isPaused()) {
+          m_universe->getScenes()[i]->updatePlayers(0 /* 0 to not update */,
+                                                    true);
+        }
+      }
+    }
+
+  } else {
+    // search the client
+    for (unsigned int i = 0; i < m_otherClients.size(); i++) {
+      if (m_otherClients[i]->id() == i_src) {
+        v_clientId = i;
+        break;
+      }
+    }
+    if (v_clientId < 0) {
+      return; // client not declared
+    }
+
+    // check if the ghost already exists
+    if (m_otherClients[v_clientId]->netGhost(i_subsrc) != NULL) {
+      v_ghost = m_otherClients[v_clientId]->netGhost(i_subsrc);
+    }
+
+    if (v_ghost == NULL) {
+      /* add the net ghost */
+
+      // if this is a client of the current party, add it as normal player
+      bool v_isSlaveMode =
+        m_otherClients[v_clientId]->mode() == NETCLIENT_SLAVE_MODE;
+
+      for (unsigned int i = 0; i < m_universe->getScenes().size(); i++) {
+        if (v_isSlaveMode) {
+          v_ghost = m_universe->getScenes()[i]->addNetGhost(
+            m_otherClients[v_clientId]->name(),
+            Theme::instance(),
+            Theme::instance()->getNetPlayerTheme(),
+            TColor(0, 255, 255, 0),
+            TColor(GET_RED(Theme::instance()
+                             ->getNetPlayerTheme()
+                             ->getUglyRiderColor()),
+                   GET_GREEN(Theme::instance()
+                               ->getNetPlayerTheme()
+                               ->getUglyRiderColor()),
+                   GET_BLUE(Theme::instance()
+                              ->getNetPlayerTheme()
+                              ->getUglyRiderColor()),
+                   0));
+        } else {
+          v_ghost = m_universe->getScenes()[i]->addNetGhost(
+            m_otherClients[v_clientId]->name(),
+            Theme::instance(),
+            Theme::instance()->getGhostTheme(),
+            TColor(255, 255, 255, 0),
+            TColor(GET_RED(
+                     Theme::instance()->getGhostTheme()->getUglyRiderColor()),
+                   GET_GREEN(
+                     Theme::instance()->getGhostTheme()->getUglyRiderColor()),
+                   GET_BLUE(
+                     Theme::instance()->getGhostTheme()->getUglyRiderColor()),
+                   0));
+        }
+        m_otherClients[v_clientId]->setNetGhost(i_subsrc, v_ghost);
+      }
+    }
+
+    // take the physic of the first world
+    if (m_universe->getScenes().size() > 0) {
+      BikeState::convertStateFromReplay(
+        i_state,
+        v_ghost->getStateForUpdate(),
+        m_universe->getScenes()[0]->getPhysicsSettings());
+    }
+  }
+}
+
+NetFrameHistory *NetClient::frameHistory(int i_src, int i_subsrc) {
+  int v_key = (i_src + 1) * NETACTION_MAX_SUBSRC + i_subsrc;
+  HashNamespace::unordered_map<int, NetFrameHistory *>::iterator it =
+    m_frameHistories.find(v_key);
+
+  if (it != m_frameHistories.end()) {
+    return it->second;
+  }
+
+  NetFrameHistory *v_history = new NetFrameHistory();
+  m_frameHistories[v_key] = v_history;
+  return v_history;
+}
+
+void NetClient::clearFrameHistories() {
+  HashNamespace::unordered_map<int, NetFrameHistory *>::iterator it;
+
+  for (it = m_frameHistories.begin(); it != m_frameHistories.end(); it++) {
+    delete it->second;
+  }
+  m_frameHistories.clear();
+  m_frameAcks.clear();
+}
+
+void NetClient::sendFrameAcks() {
+  if (m_frameAcks.getAcks().size() == 0) {
+    return;
+  }
+
+  try {
+    send(&m_frameAcks, 0);
+  } catch (Exception &e) {
+    m_frameAcks.clear();
+    throw e;
+  }
+  m_frameAcks.clear();
+}
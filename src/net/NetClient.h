@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "../helpers/Singleton.h"
 #include "../include/xm_SDL.h"
 #include "../include/xm_SDL_net.h"
+#include "../include/xm_hashmap.h"
 #include "NetActions.h"
 #include <string>
 #include <vector>
@@ -121,6 +122,7 @@ private:
   IPaddress serverIp;
   bool m_serverReceivesUdp;
   bool m_serverSendsUdp;
+  bool m_serverUsesBinaryFraming; // the server understands it too then
   TCPsocket m_tcpsd;
   UDPsocket m_udpsd;
   UDPpacket *m_udpSendPacket;
@@ -145,8 +147,16 @@ private:
   void updateOtherClientsMode(std::vector<int> i_slavePlayers);
 
   void manageAction(xmDatabase *pDb, NetAction *i_netAction);
+  void manageFrame(int i_src, int i_subsrc, SerializedBikeState *i_state);
   void cleanOtherClientsGhosts();
 
+  // delta frames received, one history per player
+  HashNamespace::unordered_map<int, NetFrameHistory *> m_frameHistories;
+  NA_frameAck m_frameAcks; // to send at the end of the network step
+  NetFrameHistory *frameHistory(int i_src, int i_subsrc); // created if needed
+  void clearFrameHistories();
+  void sendFrameAcks();
+
   int m_lastOwnFPS;
   int m_currentOwnFramesNb;
   int m_currentOwnFramesTime;
@@ -0,0 +1,400 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "NetFrameDelta.h"
+#include "helpers/SwapEndian.h"
+#include "helpers/VExcept.h"
+#include <math.h>
+#include <string.h>
+
+#define XM_NET_FRAME_DELTA_HEADER_SIZE 9
+#define XM_NET_FRAME_DELTA_PRECISION 1000.0f
+
+/* flags of the header */
+#define XM_NET_FRAME_DELTA_HAS_BASE 0x01
+#define XM_NET_FRAME_DELTA_RAW_TIME 0x02
+#define XM_NET_FRAME_DELTA_RAW_X 0x04
+#define XM_NET_FRAME_DELTA_RAW_Y 0x08
+
+/*
+  fields, in the order they are written ; one bit of the mask each
+  header : seq (2) | base seq (2) | mask (4) | flags (1)
+*/
+enum NetFrameDeltaField {
+  NFD_GAMETIME, /* quantized */
+  NFD_FRAMEX, /* quantized */
+  NFD_FRAMEY, /* quantized */
+  NFD_MAXXDIFF, /* raw */
+  NFD_MAXYDIFF, /* raw */
+  NFD_REARWHEELROT,
+  NFD_FRONTWHEELROT,
+  NFD_FRAMEROT,
+  NFD_FLAGS,
+  NFD_ENGINERPM,
+  NFD_CHARS /* the 12 signed chars, from cRearWheelX to cKneeY */
+};
+#define XM_NET_FRAME_DELTA_NB_CHARS 12
+
+static void writeShort(char *o_buffer, unsigned int &io_offset, int i_value) {
+  o_buffer[io_offset++] = i_value & 0xFF;
+  o_buffer[io_offset++] = (i_value >> 8) & 0xFF;
+}
+
+static int readShort(const char *i_buffer,
+                     unsigned int i_size,
+                     unsigned int &io_offset) {
+  if (io_offset + 2 > i_size) {
+    throw Exception("net: invalid frame delta");
+  }
+  int v_res = ((unsigned char)i_buffer[io_offset]) |
+              (((unsigned char)i_buffer[io_offset + 1]) << 8);
+  io_offset += 2;
+  return v_res;
+}
+
+static unsigned char readByte(const char *i_buffer,
+                              unsigned int i_size,
+                              unsigned int &io_offset) {
+  if (io_offset + 1 > i_size) {
+    throw Exception("net: invalid frame delta");
+  }
+  return (unsigned char)i_buffer[io_offset++];
+}
+
+static float readFloat(const char *i_buffer,
+                       unsigned int i_size,
+                       unsigned int &io_offset) {
+  if (io_offset + 4 > i_size) {
+    throw Exception("net: invalid frame delta");
+  }
+  float v_res = SwapEndian::read4LFloat(i_buffer + io_offset);
+  io_offset += 4;
+  return v_res;
+}
+
+static signed char *stateChars(SerializedBikeState &i_state) {
+  return &i_state.cRearWheelX;
+}
+
+static const signed char *stateChars(const SerializedBikeState &i_state) {
+  return &i_state.cRearWheelX;
+}
+
+/* write a float as a quantized delta when possible ; o_rebuilt is the value
+   the receiver will get */
+static void writeQuantized(char *o_buffer,
+                           unsigned int &io_offset,
+                           float i_base,
+                           float i_value,
+                           unsigned char i_rawFlag,
+                           unsigned char &io_flags,
+                           float &o_rebuilt) {
+  long v_q = lroundf((i_value - i_base) * XM_NET_FRAME_DELTA_PRECISION);
+
+  if (v_q >= -32768 && v_q <= 32767) {
+    writeShort(o_buffer, io_offset, (int)v_q);
+    o_rebuilt = i_base + ((short)v_q) / XM_NET_FRAME_DELTA_PRECISION;
+  } else {
+    SwapEndian::write4LFloat(o_buffer + io_offset, i_value);
+    io_offset += 4;
+    io_flags |= i_rawFlag;
+    o_rebuilt = i_value;
+  }
+}
+
+static float readQuantized(const char *i_buffer,
+                           unsigned int i_size,
+                           unsigned int &io_offset,
+                           float i_base,
+                           bool i_raw) {
+  if (i_raw) {
+    return readFloat(i_buffer, i_size, io_offset);
+  }
+  return i_base +
+         ((short)readShort(i_buffer, i_size, io_offset)) /
+           XM_NET_FRAME_DELTA_PRECISION;
+}
+
+NetFrameHistory::NetFrameHistory() {
+  for (unsigned int i = 0; i < XM_NET_FRAME_HISTORY; i++) {
+    m_seqs[i] = 0;
+    m_valids[i] = false;
+  }
+  m_hasAck = false;
+  m_ackSeq = 0;
+  m_nextSeq = 0;
+}
+
+unsigned short NetFrameHistory::nextSeq() {
+  return m_nextSeq++;
+}
+
+void NetFrameHistory::clear() {
+  for (unsigned int i = 0; i < XM_NET_FRAME_HISTORY; i++) {
+    m_valids[i] = false;
+  }
+  m_hasAck = false;
+}
+
+void NetFrameHistory::store(unsigned short i_seq,
+                            const SerializedBikeState &i_state) {
+  unsigned int n = i_seq % XM_NET_FRAME_HISTORY;
+
+  m_states[n] = i_state;
+  m_seqs[n] = i_seq;
+  m_valids[n] = true;
+}
+
+const SerializedBikeState *NetFrameHistory::get(unsigned short i_seq) const {
+  unsigned int n = i_seq % XM_NET_FRAME_HISTORY;
+
+  if (m_valids[n] == false || m_seqs[n] != i_seq) {
+    return NULL;
+  }
+  return &(m_states[n]);
+}
+
+void NetFrameHistory::ack(unsigned short i_seq) {
+  // unknown frame (an other round, or too old) : ignore it
+  if (get(i_seq) == NULL) {
+    return;
+  }
+
+  // keep the most recent ack, acks can arrive in any order
+  if (m_hasAck == false || (short)(i_seq - m_ackSeq) > 0) {
+    m_hasAck = true;
+    m_ackSeq = i_seq;
+  }
+}
+
+const SerializedBikeState *NetFrameHistory::baseline(
+  unsigned short &o_seq) const {
+  if (m_hasAck == false) {
+    return NULL;
+  }
+  o_seq = m_ackSeq;
+  return get(m_ackSeq); // NULL once overwritten by newer frames
+}
+
+unsigned int NetFrameDelta::encode(unsigned short i_seq,
+                                   const SerializedBikeState *i_base,
+                                   unsigned short i_baseSeq,
+                                   const SerializedBikeState &i_state,
+                                   char *o_buffer,
+                                   SerializedBikeState &o_rebuilt) {
+  SerializedBikeState v_zero;
+  const SerializedBikeState *v_base = i_base;
+  unsigned int v_mask = 0;
+  unsigned char v_flags = 0;
+  unsigned int v_offset = XM_NET_FRAME_DELTA_HEADER_SIZE;
+
+  if (v_base == NULL) {
+    memset(&v_zero, 0, sizeof(v_zero));
+    v_base = &v_zero;
+    // full frame : floats are sent raw to be exact
+    v_flags |= XM_NET_FRAME_DELTA_RAW_TIME | XM_NET_FRAME_DELTA_RAW_X |
+               XM_NET_FRAME_DELTA_RAW_Y;
+  } else {
+    v_flags |= XM_NET_FRAME_DELTA_HAS_BASE;
+  }
+
+  o_rebuilt = *v_base;
+
+  /* quantized floats */
+  const float *v_baseFloats[3] = {
+    &v_base->fGameTime, &v_base->fFrameX, &v_base->fFrameY
+  };
+  const float *v_floats[3] = {
+    &i_state.fGameTime, &i_state.fFrameX, &i_state.fFrameY
+  };
+  float *v_rebuiltFloats[3] = {
+    &o_rebuilt.fGameTime, &o_rebuilt.fFrameX, &o_rebuilt.fFrameY
+  };
+  unsigned char v_rawFlags[3] = { XM_NET_FRAME_DELTA_RAW_TIME,
+                                  XM_NET_FRAME_DELTA_RAW_X,
+                                  XM_NET_FRAME_DELTA_RAW_Y };
+
+  for (unsigned int i = 0; i < 3; i++) {
+    if (i_base == NULL || *(v_floats[i]) != *(v_baseFloats[i])) {
+      v_mask |= 1 << (NFD_GAMETIME + i);
+      if (v_flags & v_rawFlags[i]) {
+        SwapEndian::write4LFloat(o_buffer + v_offset, *(v_floats[i]));
+        v_offset += 4;
+        *(v_rebuiltFloats[i]) = *(v_floats[i]);
+      } else {
+        writeQuantized(o_buffer,
+                       v_offset,
+                       *(v_baseFloats[i]),
+                       *(v_floats[i]),
+                       v_rawFlags[i],
+                       v_flags,
+                       *(v_rebuiltFloats[i]));
+      }
+    }
+  }
+
+  /* raw floats : they scale the wheels and limbs positions */
+  if (i_base == NULL || i_state.fMaxXDiff != v_base->fMaxXDiff) {
+    v_mask |= 1 << NFD_MAXXDIFF;
+    SwapEndian::write4LFloat(o_buffer + v_offset, i_state.fMaxXDiff);
+    v_offset += 4;
+    o_rebuilt.fMaxXDiff = i_state.fMaxXDiff;
+  }
+  if (i_base == NULL || i_state.fMaxYDiff != v_base->fMaxYDiff) {
+    v_mask |= 1 << NFD_MAXYDIFF;
+    SwapEndian::write4LFloat(o_buffer + v_offset, i_state.fMaxYDiff);
+    v_offset += 4;
+    o_rebuilt.fMaxYDiff = i_state.fMaxYDiff;
+  }
+
+  /* rotations */
+  if (i_base == NULL || i_state.nRearWheelRot != v_base->nRearWheelRot) {
+    v_mask |= 1 << NFD_REARWHEELROT;
+    writeShort(o_buffer, v_offset, i_state.nRearWheelRot);
+  }
+  if (i_base == NULL || i_state.nFrontWheelRot != v_base->nFrontWheelRot) {
+    v_mask |= 1 << NFD_FRONTWHEELROT;
+    writeShort(o_buffer, v_offset, i_state.nFrontWheelRot);
+  }
+  if (i_base == NULL || i_state.nFrameRot != v_base->nFrameRot) {
+    v_mask |= 1 << NFD_FRAMEROT;
+    writeShort(o_buffer, v_offset, i_state.nFrameRot);
+  }
+  o_rebuilt.nRearWheelRot = i_state.nRearWheelRot;
+  o_rebuilt.nFrontWheelRot = i_state.nFrontWheelRot;
+  o_rebuilt.nFrameRot = i_state.nFrameRot;
+
+  /* bytes */
+  if (i_base == NULL || i_state.cFlags != v_base->cFlags) {
+    v_mask |= 1 << NFD_FLAGS;
+    o_buffer[v_offset++] = i_state.cFlags;
+  }
+  if (i_base == NULL || i_state.cBikeEngineRPM != v_base->cBikeEngineRPM) {
+    v_mask |= 1 << NFD_ENGINERPM;
+    o_buffer[v_offset++] = i_state.cBikeEngineRPM;
+  }
+  o_rebuilt.cFlags = i_state.cFlags;
+  o_rebuilt.cBikeEngineRPM = i_state.cBikeEngineRPM;
+
+  for (unsigned int i = 0; i < XM_NET_FRAME_DELTA_NB_CHARS; i++) {
+    if (i_base == NULL || stateChars(i_state)[i] != stateChars(*v_base)[i]) {
+      v_mask |= 1 << (NFD_CHARS + i);
+      o_buffer[v_offset++] = stateChars(i_state)[i];
+    }
+    stateChars(o_rebuilt)[i] = stateChars(i_state)[i];
+  }
+
+  /* header */
+  unsigned int v_headerOffset = 0;
+  writeShort(o_buffer, v_headerOffset, i_seq);
+  writeShort(o_buffer, v_headerOffset, i_baseSeq);
+  writeShort(o_buffer, v_headerOffset, v_mask & 0xFFFF);
+  writeShort(o_buffer, v_headerOffset, (v_mask >> 16) & 0xFFFF);
+  o_buffer[v_headerOffset++] = v_flags;
+
+  return v_offset;
+}
+
+void NetFrameDelta::readHeader(const char *i_buffer,
+                               unsigned int i_size,
+                               unsigned short &o_seq,
+                               bool &o_hasBase,
+                               unsigned short &o_baseSeq) {
+  unsigned int v_offset = 0;
+
+  if (i_size < XM_NET_FRAME_DELTA_HEADER_SIZE) {
+    throw Exception("net: invalid frame delta");
+  }
+
+  o_seq = readShort(i_buffer, i_size, v_offset);
+  o_baseSeq = readShort(i_buffer, i_size, v_offset);
+  o_hasBase = (i_buffer[XM_NET_FRAME_DELTA_HEADER_SIZE - 1] &
+               XM_NET_FRAME_DELTA_HAS_BASE) != 0;
+}
+
+void NetFrameDelta::decode(const char *i_buffer,
+                           unsigned int i_size,
+                           const SerializedBikeState *i_base,
+                           SerializedBikeState &o_state) {
+  unsigned int v_offset = 4;
+  unsigned int v_mask;
+  unsigned char v_flags;
+
+  v_mask = readShort(i_buffer, i_size, v_offset);
+  v_mask |= readShort(i_buffer, i_size, v_offset) << 16;
+  v_flags = readByte(i_buffer, i_size, v_offset);
+
+  if (v_flags & XM_NET_FRAME_DELTA_HAS_BASE) {
+    if (i_base == NULL) {
+      throw Exception("net: frame delta without its baseline");
+    }
+    o_state = *i_base;
+  } else {
+    memset(&o_state, 0, sizeof(o_state));
+  }
+
+  if (v_mask & (1 << NFD_GAMETIME)) {
+    o_state.fGameTime = readQuantized(i_buffer,
+                                      i_size,
+                                      v_offset,
+                                      o_state.fGameTime,
+                                      v_flags & XM_NET_FRAME_DELTA_RAW_TIME);
+  }
+  if (v_mask & (1 << NFD_FRAMEX)) {
+    o_state.fFrameX = readQuantized(i_buffer,
+                                    i_size,
+                                    v_offset,
+                                    o_state.fFrameX,
+                                    v_flags & XM_NET_FRAME_DELTA_RAW_X);
+  }
+  if (v_mask & (1 << NFD_FRAMEY)) {
+    o_state.fFrameY = readQuantized(i_buffer,
+                                    i_size,
+                                    v_offset,
+                                    o_state.fFrameY,
+                                    v_flags & XM_NET_FRAME_DELTA_RAW_Y);
+  }
+  if (v_mask & (1 << NFD_MAXXDIFF)) {
+    o_state.fMaxXDiff = readFloat(i_buffer, i_size, v_offset);
+  }
+  if (v_mask & (1 << NFD_MAXYDIFF)) {
+    o_state.fMaxYDiff = readFloat(i_buffer, i_size, v_offset);
+  }
+  if (v_mask & (1 << NFD_REARWHEELROT)) {
+    o_state.nRearWheelRot = readShort(i_buffer, i_size, v_offset);
+  }
+  if (v_mask & (1 << NFD_FRONTWHEELROT)) {
+    o_state.nFrontWheelRot = readShort(i_buffer, i_size, v_offset);
+  }
+  if (v_mask & (1 << NFD_FRAMEROT)) {
+    o_state.nFrameRot = readShort(i_buffer, i_size, v_offset);
+  }
+  if (v_mask & (1 << NFD_FLAGS)) {
+    o_state.cFlags = readByte(i_buffer, i_size, v_offset);
+  }
+  if (v_mask & (1 << NFD_ENGINERPM)) {
+    o_state.cBikeEngineRPM = readByte(i_buffer, i_size, v_offset);
+  }
+  for (unsigned int i = 0; i < XM_NET_FRAME_DELTA_NB_CHARS; i++) {
+    if (v_mask & (1 << (NFD_CHARS + i))) {
+      stateChars(o_state)[i] = (signed char)readByte(i_buffer, i_size, v_offset);
+    }
+  }
+}
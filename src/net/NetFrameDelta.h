@@ -0,0 +1,94 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __NETFRAMEDELTA_H__
+#define __NETFRAMEDELTA_H__
+
+#include "../xmscene/BasicSceneStructs.h"
+
+#define XM_NET_FRAME_HISTORY 32 // frames kept to encode/decode deltas
+// biggest encoded frame : header + all the fields sent raw
+#define XM_NET_FRAME_DELTA_MAX_SIZE 64
+
+/*
+  frames of one player sent to one client. The sender keeps the frames as the
+  client rebuilds them, the receiver keeps the frames it rebuilt ; both keep
+  the last XM_NET_FRAME_HISTORY ones, identified by their sequence number.
+  The sender numbers the frames of each history, so that the ring holds the
+  last frames of this player whatever the number of players ; the numbers wrap
+  after 65536 frames, get() checks the exact number
+*/
+class NetFrameHistory {
+public:
+  NetFrameHistory();
+
+  // sender side : number of the next frame to store
+  unsigned short nextSeq();
+  // forget the frames and the ack, but keep the numbering so that late acks
+  // of the forgotten frames are ignored
+  void clear();
+
+  void store(unsigned short i_seq, const SerializedBikeState &i_state);
+  // NULL if the frame is unknown or too old
+  const SerializedBikeState *get(unsigned short i_seq) const;
+
+  // sender side : last frame acknowledged by the client
+  void ack(unsigned short i_seq);
+  // NULL when the frame must be sent in full
+  const SerializedBikeState *baseline(unsigned short &o_seq) const;
+
+private:
+  SerializedBikeState m_states[XM_NET_FRAME_HISTORY];
+  unsigned short m_seqs[XM_NET_FRAME_HISTORY];
+  bool m_valids[XM_NET_FRAME_HISTORY];
+  bool m_hasAck;
+  unsigned short m_ackSeq;
+  unsigned short m_nextSeq;
+};
+
+/*
+  encoding of a frame relatively to a baseline : only the changed fields are
+  sent ; positions and time are sent as deltas quantized to 1/1000
+*/
+class NetFrameDelta {
+public:
+  // i_base NULL for a full frame ; o_rebuilt is the frame the receiver will
+  // get, to be used as baseline later ; return the size written in o_buffer
+  static unsigned int encode(unsigned short i_seq,
+                             const SerializedBikeState *i_base,
+                             unsigned short i_baseSeq,
+                             const SerializedBikeState &i_state,
+                             char *o_buffer /* XM_NET_FRAME_DELTA_MAX_SIZE */,
+                             SerializedBikeState &o_rebuilt);
+
+  // read the sequence numbers of an encoded frame
+  static void readHeader(const char *i_buffer,
+                         unsigned int i_size,
+                         unsigned short &o_seq,
+                         bool &o_hasBase,
+                         unsigned short &o_baseSeq);
+
+  static void decode(const char *i_buffer,
+                     unsigned int i_size,
+                     const SerializedBikeState *i_base,
+                     SerializedBikeState &o_state);
+};
+
+#endif
@@ -0,0 +1,518 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "NetLoadClient.h"
+#include "ActionReader.h"
+#include "NetSocketPoller.h"
+#include "helpers/Log.h"
+#include "helpers/Net.h"
+#include "helpers/System.h"
+#include "helpers/VExcept.h"
+#include "helpers/VMath.h"
+#include "include/xm_SDL.h"
+#include <sstream>
+#include <string.h>
+
+#define XM_LOADBOT_MAX_UDP_PACKET_SIZE 1024 // bytes
+#define XM_LOADBOT_CONTROLS_PER_SECOND 10
+#define XM_LOADBOT_FRAMES_PER_SECOND 25
+#define XM_LOADBOT_GHOSTS_RATIO 4 // one bot over 4 plays in ghost mode
+#define XM_LOADBOT_GHOSTS_LEVEL "loadclient"
+#define XM_LOADCLIENT_CONNECTION_DELAY 10 // ms between two connections
+#define XM_LOADCLIENT_STATS_PERIOD 5 // seconds
+#define XM_LOADCLIENT_SRVCMD_TIMEOUT 2 // seconds
+
+NetLoadBot::NetLoadBot(unsigned int i_num, NetClientMode i_mode) {
+  std::ostringstream v_rd;
+
+  m_num = i_num;
+  m_mode = i_mode;
+  m_isConnected = false;
+  m_nbSends = 0;
+  m_poller = NULL;
+  m_tcpTag.bot = this;
+  m_tcpTag.udp = false;
+  m_udpTag.bot = this;
+  m_udpTag.udp = true;
+
+  m_udpPacket = SDLNet_AllocPacket(XM_LOADBOT_MAX_UDP_PACKET_SIZE);
+  if (!m_udpPacket) {
+    throw Exception("SDLNet_AllocPacket: " + std::string(SDLNet_GetError()));
+  }
+  m_tcpReader = new ActionReader();
+
+  v_rd << randomIntNum(1, RAND_MAX);
+  m_udpBindKey = v_rd.str();
+
+  resetStats();
+}
+
+NetLoadBot::~NetLoadBot() {
+  disconnect();
+  delete m_tcpReader;
+  SDLNet_FreePacket(m_udpPacket);
+}
+
+void NetLoadBot::connect(IPaddress *i_serverIp, NetSocketPoller *i_poller) {
+  std::ostringstream v_name;
+
+  m_serverIp = *i_serverIp;
+  m_serverReceivesUdp = false;
+  m_serverSendsUdp = false;
+  m_serverUsesBinaryFraming = false;
+
+  if (!(m_tcpsd = SDLNet_TCP_Open(&m_serverIp))) {
+    throw Exception(SDLNet_GetError());
+  }
+
+  if ((m_udpsd = SDLNet_UDP_Open(0)) == 0) {
+    SDLNet_TCP_Close(m_tcpsd);
+    throw Exception(SDLNet_GetError());
+  }
+
+  try {
+    i_poller->addTCPSocket(m_tcpsd, &m_tcpTag);
+    i_poller->addUDPSocket(m_udpsd, &m_udpTag);
+  } catch (Exception &e) {
+    i_poller->delTCPSocket(m_tcpsd);
+    SDLNet_TCP_Close(m_tcpsd);
+    SDLNet_UDP_Close(m_udpsd);
+    throw e;
+  }
+  m_poller = i_poller;
+  m_isConnected = true;
+  m_nextSendTime = System::getTimeUs();
+
+  // same handshake as NetClient::connect()
+  try {
+    NA_clientInfos na(XM_NET_PROTOCOL_VERSION, m_udpBindKey);
+    send(&na);
+
+    v_name << "bot" << m_num;
+    NA_changeName nan(v_name.str());
+    send(&nan);
+
+    NA_clientMode nam(m_mode);
+    send(&nam);
+
+    if (m_mode == NETCLIENT_GHOST_MODE) {
+      // ghosts receive the frames of the ghosts playing the same level
+      NA_playingLevel nal(XM_LOADBOT_GHOSTS_LEVEL);
+      send(&nal);
+    }
+  } catch (Exception &e) {
+    disconnect();
+    throw e;
+  }
+}
+
+void NetLoadBot::disconnect() {
+  if (m_isConnected == false) {
+    return;
+  }
+
+  m_poller->delTCPSocket(m_tcpsd);
+  m_poller->delUDPSocket(m_udpsd);
+  SDLNet_TCP_Close(m_tcpsd);
+  SDLNet_UDP_Close(m_udpsd);
+  m_isConnected = false;
+}
+
+bool NetLoadBot::isConnected() const {
+  return m_isConnected;
+}
+
+void NetLoadBot::send(NetAction *i_netAction, bool i_forceUdp) {
+  i_netAction->setSource(0, 0);
+  i_netAction->setBinaryFraming(m_serverUsesBinaryFraming);
+
+  if (i_forceUdp) {
+    i_netAction->send(NULL, &m_udpsd, m_udpPacket, &m_serverIp);
+  } else if (m_serverReceivesUdp) {
+    i_netAction->send(&m_tcpsd, &m_udpsd, m_udpPacket, &m_serverIp);
+  } else {
+    i_netAction->send(&m_tcpsd, NULL, NULL, NULL);
+  }
+}
+
+void NetLoadBot::manageNetwork(bool i_udp, NetActionU *i_netAction) {
+  if (m_isConnected == false) {
+    return;
+  }
+
+  try {
+    if (i_udp) {
+      while (SDLNet_UDP_Recv(m_udpsd, m_udpPacket) == 1) {
+        ActionReader::UDPReadAction(
+          m_udpPacket->data, m_udpPacket->len, i_netAction);
+        manageAction(i_netAction->master);
+      }
+    } else {
+      while (m_tcpReader->TCPReadAction(&m_tcpsd, i_netAction)) {
+        manageAction(i_netAction->master);
+      }
+    }
+  } catch (Exception &e) {
+    LogWarning("loadclient: bot %u disconnected (%s)",
+               m_num,
+               e.getMsg().c_str());
+    disconnect();
+  }
+}
+
+void NetLoadBot::manageAction(NetAction *i_netAction) {
+  if (i_netAction->binaryFraming()) {
+    m_serverUsesBinaryFraming = true;
+  }
+
+  switch (i_netAction->actionType()) {
+    case TNA_udpBindQuery: {
+      NA_udpBind na(m_udpBindKey);
+      // send the packet 3 times to get more change it arrives
+      for (unsigned int i = 0; i < 3; i++) {
+        send(&na, true);
+      }
+    } break;
+
+    case TNA_udpBind: {
+      if (m_serverSendsUdp == false) {
+        m_serverSendsUdp = true;
+        NA_udpBindValidation na;
+        send(&na);
+      }
+      m_serverReceivesUdp = true;
+    } break;
+
+    case TNA_udpBindValidation:
+      m_serverReceivesUdp = true;
+      break;
+
+    case TNA_frame:
+      if (i_netAction->getSource() == -1) {
+        ownFrameReceived();
+      } else {
+        m_nbOtherFrames++;
+      }
+      break;
+
+    case TNA_frameDelta: {
+      // the frame is not rebuilt : acknowledging it is enough to keep the
+      // server sending deltas
+      NetFrameAck v_ack;
+      v_ack.Src = i_netAction->getSource();
+      v_ack.SubSrc = i_netAction->getSubSource();
+      v_ack.Seq = ((NA_frameDelta *)i_netAction)->seq();
+      m_frameAcks.add(v_ack);
+
+      if (i_netAction->getSource() == -1) {
+        ownFrameReceived();
+      } else {
+        m_nbOtherFrames++;
+      }
+    } break;
+
+    case TNA_ping: {
+      if (((NA_ping *)i_netAction)->isPong() == false) {
+        NA_ping na((NA_ping *)i_netAction);
+        send(&na);
+      }
+    } break;
+
+    case TNA_srvCmdAsw:
+      m_lastSrvCmdAnswer = ((NA_srvCmdAsw *)i_netAction)->getAnswer();
+      break;
+
+    case TNA_serverError:
+      throw Exception("server error");
+      break;
+
+    default:
+      break;
+  }
+}
+
+void NetLoadBot::ownFrameReceived() {
+  unsigned long long v_now = System::getTimeUs();
+
+  if (m_nbOwnFrames != 0) {
+    unsigned long long v_interval = v_now - m_lastOwnFrameTime;
+
+    m_ownFramesIntervalSum += v_interval;
+    if (v_interval > m_ownFramesIntervalMax) {
+      m_ownFramesIntervalMax = v_interval;
+    }
+  }
+  m_lastOwnFrameTime = v_now;
+  m_nbOwnFrames++;
+}
+
+void NetLoadBot::step(unsigned long long i_now) {
+  if (m_isConnected == false) {
+    return;
+  }
+
+  try {
+    if (m_frameAcks.getAcks().size() != 0) {
+      send(&m_frameAcks);
+      m_frameAcks.clear();
+    }
+
+    if (i_now < m_nextSendTime) {
+      return;
+    }
+
+    if (m_mode == NETCLIENT_SLAVE_MODE) {
+      // release the throttle from time to time, like a player
+      NA_playerControl na(PC_THROTTLE, m_nbSends % 4 == 3 ? 0.0f : 1.0f);
+      send(&na);
+      m_nextSendTime += 1000000 / XM_LOADBOT_CONTROLS_PER_SECOND;
+    } else {
+      SerializedBikeState v_state;
+
+      memset(&v_state, 0, sizeof(v_state));
+      v_state.fGameTime = m_nbSends / (float)XM_LOADBOT_FRAMES_PER_SECOND;
+      v_state.fFrameX = m_num * 2.0 + m_nbSends * 0.2;
+      v_state.fFrameY = 1.0;
+      v_state.fMaxXDiff = 2.0;
+      v_state.fMaxYDiff = 2.0;
+      NA_frame na(&v_state);
+      send(&na);
+      m_nextSendTime += 1000000 / XM_LOADBOT_FRAMES_PER_SECOND;
+    }
+    m_nbSends++;
+
+    // too late, don't send a burst to catch up
+    if (m_nextSendTime < i_now) {
+      m_nextSendTime = i_now;
+    }
+  } catch (Exception &e) {
+    LogWarning("loadclient: bot %u send failed (%s)",
+               m_num,
+               e.getMsg().c_str());
+    disconnect();
+  }
+}
+
+void NetLoadBot::sendSrvCmd(const std::string &i_cmd) {
+  NA_srvCmd na(i_cmd);
+
+  m_lastSrvCmdAnswer = "";
+  send(&na);
+}
+
+std::string NetLoadBot::lastSrvCmdAnswer() const {
+  return m_lastSrvCmdAnswer;
+}
+
+unsigned int NetLoadBot::nbOwnFrames() const {
+  return m_nbOwnFrames;
+}
+
+unsigned int NetLoadBot::nbOtherFrames() const {
+  return m_nbOtherFrames;
+}
+
+unsigned long long NetLoadBot::ownFramesIntervalSum() const {
+  return m_ownFramesIntervalSum;
+}
+
+unsigned long long NetLoadBot::ownFramesIntervalMax() const {
+  return m_ownFramesIntervalMax;
+}
+
+void NetLoadBot::resetStats() {
+  m_nbOwnFrames = 0;
+  m_nbOtherFrames = 0;
+  m_lastOwnFrameTime = 0;
+  m_ownFramesIntervalSum = 0;
+  m_ownFramesIntervalMax = 0;
+}
+
+NetLoadClient::NetLoadClient(const std::string &i_server,
+                             int i_port,
+                             unsigned int i_nbBots,
+                             unsigned int i_duration) {
+  m_server = i_server;
+  m_port = i_port;
+  m_duration = i_duration;
+  m_poller = NetSocketPoller::create();
+
+  for (unsigned int i = 0; i < i_nbBots; i++) {
+    m_bots.push_back(new NetLoadBot(i,
+                                    i % XM_LOADBOT_GHOSTS_RATIO ==
+                                        XM_LOADBOT_GHOSTS_RATIO - 1
+                                      ? NETCLIENT_GHOST_MODE
+                                      : NETCLIENT_SLAVE_MODE));
+  }
+
+  m_lastTCPPacketsReceived = 0;
+  m_lastUDPPacketsReceived = 0;
+  m_lastTCPPacketsSent = 0;
+  m_lastUDPPacketsSent = 0;
+}
+
+NetLoadClient::~NetLoadClient() {
+  for (unsigned int i = 0; i < m_bots.size(); i++) {
+    delete m_bots[i];
+  }
+  delete m_poller;
+}
+
+void NetLoadClient::run() {
+  IPaddress v_serverIp;
+  unsigned long long v_start, v_now, v_lastStats;
+  unsigned int v_nbConnected = 0;
+
+  if (SDLNet_ResolveHost(&v_serverIp, m_server.c_str(), m_port) < 0) {
+    throw Exception(SDLNet_GetError());
+  }
+
+  LogInfo("loadclient: %u bots on %s:%i (polling with %s)",
+          (unsigned int)m_bots.size(),
+          m_server.c_str(),
+          m_port,
+          m_poller->name().c_str());
+
+  for (unsigned int i = 0; i < m_bots.size(); i++) {
+    try {
+      m_bots[i]->connect(&v_serverIp, m_poller);
+      v_nbConnected++;
+    } catch (Exception &e) {
+      LogWarning(
+        "loadclient: bot %u can't connect (%s)", i, e.getMsg().c_str());
+    }
+    SDL_Delay(XM_LOADCLIENT_CONNECTION_DELAY);
+  }
+  LogInfo("loadclient: %u bots connected", v_nbConnected);
+
+  if (v_nbConnected == 0) {
+    return;
+  }
+
+  v_start = v_lastStats = System::getTimeUs();
+  do {
+    m_poller->wait(1, m_readySockets);
+    for (unsigned int n = 0; n < m_readySockets.size(); n++) {
+      NetLoadSocketTag *v_tag = (NetLoadSocketTag *)m_readySockets[n];
+      v_tag->bot->manageNetwork(v_tag->udp, &m_netAction);
+    }
+
+    v_now = System::getTimeUs();
+    for (unsigned int i = 0; i < m_bots.size(); i++) {
+      m_bots[i]->step(v_now);
+    }
+
+    if (v_now - v_lastStats >= XM_LOADCLIENT_STATS_PERIOD * 1000000ULL) {
+      logStats(v_now - v_lastStats);
+      v_lastStats = v_now;
+    }
+  } while (v_now - v_start < m_duration * 1000000ULL);
+
+  // the frame lateness and the ticks times are only known by the server ;
+  // stats are for admins, a local client can login without password
+  for (unsigned int i = 0; i < m_bots.size(); i++) {
+    if (m_bots[i]->isConnected()) {
+      try {
+        srvCmd(m_bots[i], "login");
+        LogInfo("loadclient: server stats\n%s",
+                srvCmd(m_bots[i], "stats").c_str());
+        LogInfo("loadclient: server ticks\n%s",
+                srvCmd(m_bots[i], "ticks").c_str());
+      } catch (Exception &e) {
+        LogWarning("loadclient: unable to get the server stats (%s)",
+                   e.getMsg().c_str());
+      }
+      break;
+    }
+  }
+
+  for (unsigned int i = 0; i < m_bots.size(); i++) {
+    m_bots[i]->disconnect();
+  }
+}
+
+std::string NetLoadClient::srvCmd(NetLoadBot *i_bot,
+                                  const std::string &i_cmd) {
+  unsigned long long v_start;
+
+  i_bot->sendSrvCmd(i_cmd);
+  v_start = System::getTimeUs();
+  do {
+    m_poller->wait(10, m_readySockets);
+    for (unsigned int n = 0; n < m_readySockets.size(); n++) {
+      NetLoadSocketTag *v_tag = (NetLoadSocketTag *)m_readySockets[n];
+      v_tag->bot->manageNetwork(v_tag->udp, &m_netAction);
+    }
+  } while (i_bot->lastSrvCmdAnswer() == "" &&
+           System::getTimeUs() - v_start <
+             XM_LOADCLIENT_SRVCMD_TIMEOUT * 1000000ULL);
+
+  return i_bot->lastSrvCmdAnswer();
+}
+
+void NetLoadClient::logStats(unsigned long long i_elapsed) {
+  unsigned int v_nbConnected = 0;
+  unsigned int v_nbOwnFrames = 0;
+  unsigned int v_nbOtherFrames = 0;
+  unsigned long long v_intervalSum = 0;
+  unsigned long long v_intervalMax = 0;
+  unsigned int v_nbIntervals = 0;
+  float v_seconds = i_elapsed / 1000000.0;
+
+  for (unsigned int i = 0; i < m_bots.size(); i++) {
+    if (m_bots[i]->isConnected()) {
+      v_nbConnected++;
+    }
+    v_nbOwnFrames += m_bots[i]->nbOwnFrames();
+    v_nbOtherFrames += m_bots[i]->nbOtherFrames();
+    v_intervalSum += m_bots[i]->ownFramesIntervalSum();
+    if (m_bots[i]->nbOwnFrames() > 1) {
+      v_nbIntervals += m_bots[i]->nbOwnFrames() - 1;
+    }
+    if (m_bots[i]->ownFramesIntervalMax() > v_intervalMax) {
+      v_intervalMax = m_bots[i]->ownFramesIntervalMax();
+    }
+    m_bots[i]->resetStats();
+  }
+
+  LogInfo("loadclient: %u/%u bots connected",
+          v_nbConnected,
+          (unsigned int)m_bots.size());
+  LogInfo("loadclient: packets sent/s : TCP %.1f, UDP %.1f",
+          (NetAction::m_nbTCPPacketsSent - m_lastTCPPacketsSent) / v_seconds,
+          (NetAction::m_nbUDPPacketsSent - m_lastUDPPacketsSent) / v_seconds);
+  LogInfo(
+    "loadclient: packets received/s : TCP %.1f, UDP %.1f",
+    (ActionReader::m_nbTCPPacketsReceived - m_lastTCPPacketsReceived) /
+      v_seconds,
+    (ActionReader::m_nbUDPPacketsReceived - m_lastUDPPacketsReceived) /
+      v_seconds);
+  LogInfo("loadclient: frames received/s : own %.1f, others %.1f",
+          v_nbOwnFrames / v_seconds,
+          v_nbOtherFrames / v_seconds);
+  LogInfo("loadclient: own frames interval : average %.2f ms, max %.2f ms",
+          v_nbIntervals == 0 ? 0.0 : v_intervalSum / 1000.0 / v_nbIntervals,
+          v_intervalMax / 1000.0);
+
+  m_lastTCPPacketsSent = NetAction::m_nbTCPPacketsSent;
+  m_lastUDPPacketsSent = NetAction::m_nbUDPPacketsSent;
+  m_lastTCPPacketsReceived = ActionReader::m_nbTCPPacketsReceived;
+  m_lastUDPPacketsReceived = ActionReader::m_nbUDPPacketsReceived;
+}
@@ -0,0 +1,137 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __NETLOADCLIENT_H__
+#define __NETLOADCLIENT_H__
+
+#include "../include/xm_SDL_net.h"
+#include "BasicStructures.h"
+#include "NetActions.h"
+#include <string>
+#include <vector>
+
+#define XM_LOADCLIENT_DEFAULT_DURATION 60 // seconds
+
+class ActionReader;
+class NetLoadBot;
+class NetSocketPoller;
+
+// given back by the poller for a socket of a bot
+struct NetLoadSocketTag {
+  NetLoadBot *bot;
+  bool udp;
+};
+
+/*
+  a simulated player, without scene nor graphics : it connects like NetClient,
+  then sends controls (slave mode) or frames (ghost mode) at the rates of a
+  real client
+*/
+class NetLoadBot {
+public:
+  NetLoadBot(unsigned int i_num, NetClientMode i_mode);
+  ~NetLoadBot();
+
+  void connect(IPaddress *i_serverIp, NetSocketPoller *i_poller);
+  void disconnect();
+  bool isConnected() const;
+
+  // i_udp : the udp socket is ready, else the tcp one
+  void manageNetwork(bool i_udp, NetActionU *i_netAction);
+  // send what is due at i_now (microseconds)
+  void step(unsigned long long i_now);
+
+  void sendSrvCmd(const std::string &i_cmd);
+  std::string lastSrvCmdAnswer() const;
+
+  /* stats */
+  unsigned int nbOwnFrames() const;
+  unsigned int nbOtherFrames() const;
+  unsigned long long ownFramesIntervalSum() const; // microseconds
+  unsigned long long ownFramesIntervalMax() const;
+  void resetStats();
+
+private:
+  void manageAction(NetAction *i_netAction);
+  void send(NetAction *i_netAction, bool i_forceUdp = false);
+  void ownFrameReceived();
+
+  unsigned int m_num;
+  NetClientMode m_mode;
+  bool m_isConnected;
+  TCPsocket m_tcpsd;
+  UDPsocket m_udpsd;
+  UDPpacket *m_udpPacket;
+  IPaddress m_serverIp;
+  ActionReader *m_tcpReader;
+  NetSocketPoller *m_poller;
+  NetLoadSocketTag m_tcpTag;
+  NetLoadSocketTag m_udpTag;
+  std::string m_udpBindKey;
+  bool m_serverReceivesUdp;
+  bool m_serverSendsUdp;
+  bool m_serverUsesBinaryFraming;
+
+  unsigned long long m_nextSendTime;
+  unsigned int m_nbSends;
+  NA_frameAck m_frameAcks; // waiting to be sent
+  std::string m_lastSrvCmdAnswer;
+
+  unsigned int m_nbOwnFrames;
+  unsigned int m_nbOtherFrames;
+  unsigned long long m_lastOwnFrameTime;
+  unsigned long long m_ownFramesIntervalSum;
+  unsigned long long m_ownFramesIntervalMax;
+};
+
+/*
+  runs bots against a server to measure how many clients it can sustain ;
+  statistics are logged regularly, and the server ones at the end
+*/
+class NetLoadClient {
+public:
+  NetLoadClient(const std::string &i_server,
+                int i_port,
+                unsigned int i_nbBots,
+                unsigned int i_duration /* seconds */);
+  ~NetLoadClient();
+
+  void run();
+
+private:
+  void logStats(unsigned long long i_elapsed);
+  // send a command and wait for its answer ; "" on timeout
+  std::string srvCmd(NetLoadBot *i_bot, const std::string &i_cmd);
+
+  std::string m_server;
+  int m_port;
+  unsigned int m_duration;
+  std::vector<NetLoadBot *> m_bots;
+  NetSocketPoller *m_poller;
+  std::vector<void *> m_readySockets;
+  NetActionU m_netAction;
+
+  unsigned int m_lastTCPPacketsReceived;
+  unsigned int m_lastUDPPacketsReceived;
+  unsigned int m_lastTCPPacketsSent;
+  unsigned int m_lastUDPPacketsSent;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "NetRelevanceGrid.h"
+#include <math.h>
+
+NetRelevanceGrid::NetRelevanceGrid() {
+  m_cellSize = 1.0;
+}
+
+NetRelevanceGrid::~NetRelevanceGrid() {}
+
+void NetRelevanceGrid::reset(float i_cellSize) {
+  m_cellSize = i_cellSize > 0.0 ? i_cellSize : 1.0;
+
+  // keep the cells used by the last frame to not reallocate them each frame,
+  // free the ones nobody entered since
+  HashNamespace::unordered_map<long long, std::vector<Entry> >::iterator it =
+    m_cells.begin();
+  while (it != m_cells.end()) {
+    if (it->second.empty()) {
+      it = m_cells.erase(it);
+    } else {
+      it->second.clear();
+      it++;
+    }
+  }
+}
+
+long long NetRelevanceGrid::cellKey(int i_cx, int i_cy) const {
+  return (((long long)i_cx) << 32) | (unsigned int)i_cy;
+}
+
+int NetRelevanceGrid::cellCoord(float i_v) const {
+  return (int)floorf(i_v / m_cellSize);
+}
+
+void NetRelevanceGrid::add(unsigned int i_id, float i_x, float i_y) {
+  Entry v_entry;
+
+  v_entry.id = i_id;
+  v_entry.x = i_x;
+  v_entry.y = i_y;
+  m_cells[cellKey(cellCoord(i_x), cellCoord(i_y))].push_back(v_entry);
+}
+
+void NetRelevanceGrid::getAround(float i_x,
+                                 float i_y,
+                                 float i_radius,
+                                 std::vector<unsigned int> &o_ids) const {
+  int v_minX = cellCoord(i_x - i_radius);
+  int v_maxX = cellCoord(i_x + i_radius);
+  int v_minY = cellCoord(i_y - i_radius);
+  int v_maxY = cellCoord(i_y + i_radius);
+  float v_radius2 = i_radius * i_radius;
+
+  for (int cx = v_minX; cx <= v_maxX; cx++) {
+    for (int cy = v_minY; cy <= v_maxY; cy++) {
+      HashNamespace::unordered_map<long long,
+                                   std::vector<Entry> >::const_iterator it =
+        m_cells.find(cellKey(cx, cy));
+      if (it == m_cells.end()) {
+        continue;
+      }
+
+      for (unsigned int i = 0; i < it->second.size(); i++) {
+        float dx = it->second[i].x - i_x;
+        float dy = it->second[i].y - i_y;
+        if (dx * dx + dy * dy <= v_radius2) {
+          o_ids.push_back(it->second[i].id);
+        }
+      }
+    }
+  }
+}
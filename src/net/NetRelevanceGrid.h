@@ -0,0 +1,59 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __NETRELEVANCEGRID_H__
+#define __NETRELEVANCEGRID_H__
+
+#include "../include/xm_hashmap.h"
+#include <vector>
+
+/*
+  positions of the players of a scene, bucketed in square cells, to find
+  quickly the players around an other one
+*/
+class NetRelevanceGrid {
+public:
+  NetRelevanceGrid();
+  ~NetRelevanceGrid();
+
+  // empty the grid ; the cells size should be close to the searched radius
+  void reset(float i_cellSize);
+  void add(unsigned int i_id, float i_x, float i_y);
+
+  // append the ids of the players at most at i_radius of (i_x, i_y)
+  void getAround(float i_x,
+                 float i_y,
+                 float i_radius,
+                 std::vector<unsigned int> &o_ids) const;
+
+private:
+  struct Entry {
+    unsigned int id;
+    float x, y;
+  };
+
+  long long cellKey(int i_cx, int i_cy) const;
+  int cellCoord(float i_v) const;
+
+  float m_cellSize;
+  HashNamespace::unordered_map<long long, std::vector<Entry> > m_cells;
+};
+
+#endif
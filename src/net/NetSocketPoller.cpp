@@ -0,0 +1,221 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "NetSocketPoller.h"
+#include "extSDL_net.h"
+#include "helpers/Log.h"
+#include "helpers/VExcept.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+#define XM_NET_POLLER_SDL_INITIAL_SIZE 128
+#define XM_NET_POLLER_EPOLL_MIN_EVENTS 16
+
+NetSocketPoller *NetSocketPoller::create() {
+#if defined(__linux__)
+  try {
+    return new NetSocketPollerEpoll();
+  } catch (Exception &e) {
+    LogWarning("%s, polling sockets with sdl_net", e.getMsg().c_str());
+  }
+#endif
+  return new NetSocketPollerSDL();
+}
+
+/* sdl_net */
+
+NetSocketPollerSDL::NetSocketPollerSDL() {
+  m_setSize = XM_NET_POLLER_SDL_INITIAL_SIZE;
+  m_set = SDLNet_AllocSocketSet(m_setSize);
+  if (m_set == NULL) {
+    throw Exception("SDLNet_AllocSocketSet: " + std::string(SDLNet_GetError()));
+  }
+}
+
+NetSocketPollerSDL::~NetSocketPollerSDL() {
+  SDLNet_FreeSocketSet(m_set);
+}
+
+std::string NetSocketPollerSDL::name() const {
+  return "sdl_net";
+}
+
+void NetSocketPollerSDL::addTCPSocket(TCPsocket i_socket, void *i_tag) {
+  addSocket((SDLNet_GenericSocket)i_socket, i_tag);
+}
+
+void NetSocketPollerSDL::addUDPSocket(UDPsocket i_socket, void *i_tag) {
+  addSocket((SDLNet_GenericSocket)i_socket, i_tag);
+}
+
+void NetSocketPollerSDL::delTCPSocket(TCPsocket i_socket) {
+  delSocket((SDLNet_GenericSocket)i_socket);
+}
+
+void NetSocketPollerSDL::delUDPSocket(UDPsocket i_socket) {
+  delSocket((SDLNet_GenericSocket)i_socket);
+}
+
+void NetSocketPollerSDL::addSocket(SDLNet_GenericSocket i_socket,
+                                   void *i_tag) {
+  Entry v_entry;
+
+  // full set, move the sockets into a bigger one
+  if (m_entries.size() >= m_setSize) {
+    SDLNet_SocketSet v_set = SDLNet_AllocSocketSet(m_setSize * 2);
+    if (v_set == NULL) {
+      throw Exception("SDLNet_AllocSocketSet: " +
+                      std::string(SDLNet_GetError()));
+    }
+    for (unsigned int i = 0; i < m_entries.size(); i++) {
+      SDLNet_AddSocket(v_set, m_entries[i].socket);
+    }
+    SDLNet_FreeSocketSet(m_set);
+    m_set = v_set;
+    m_setSize *= 2;
+  }
+
+  if (SDLNet_AddSocket(m_set, i_socket) == -1) {
+    throw Exception("SDLNet_AddSocket: " + std::string(SDLNet_GetError()));
+  }
+
+  v_entry.socket = i_socket;
+  v_entry.tag = i_tag;
+  m_entries.push_back(v_entry);
+}
+
+void NetSocketPollerSDL::delSocket(SDLNet_GenericSocket i_socket) {
+  for (unsigned int i = 0; i < m_entries.size(); i++) {
+    if (m_entries[i].socket == i_socket) {
+      SDLNet_DelSocket(m_set, i_socket);
+      m_entries.erase(m_entries.begin() + i);
+      return;
+    }
+  }
+}
+
+void NetSocketPollerSDL::wait(int i_timeout, std::vector<void *> &o_tags) {
+  int n_activ;
+
+  o_tags.clear();
+
+  n_activ = SDLNet_CheckSockets(m_set, i_timeout);
+  if (n_activ == -1) {
+    throw Exception("SDLNet_CheckSockets: " + std::string(SDLNet_GetError()));
+  }
+
+  for (unsigned int i = 0; i < m_entries.size() && n_activ > 0; i++) {
+    if (SDLNet_SocketReady(m_entries[i].socket)) {
+      o_tags.push_back(m_entries[i].tag);
+      n_activ--;
+    }
+  }
+}
+
+/* epoll */
+
+#if defined(__linux__)
+NetSocketPollerEpoll::NetSocketPollerEpoll() {
+  m_nbFds = 0;
+  m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (m_epollFd == -1) {
+    throw Exception("epoll_create1: " + std::string(strerror(errno)));
+  }
+}
+
+NetSocketPollerEpoll::~NetSocketPollerEpoll() {
+  ::close(m_epollFd);
+}
+
+std::string NetSocketPollerEpoll::name() const {
+  return "epoll";
+}
+
+void NetSocketPollerEpoll::addTCPSocket(TCPsocket i_socket, void *i_tag) {
+  addFd(SDLNet_TCP_GetSystemSocket(i_socket), i_tag);
+}
+
+void NetSocketPollerEpoll::addUDPSocket(UDPsocket i_socket, void *i_tag) {
+  addFd(SDLNet_UDP_GetSystemSocket(i_socket), i_tag);
+}
+
+void NetSocketPollerEpoll::delTCPSocket(TCPsocket i_socket) {
+  delFd(SDLNet_TCP_GetSystemSocket(i_socket));
+}
+
+void NetSocketPollerEpoll::delUDPSocket(UDPsocket i_socket) {
+  delFd(SDLNet_UDP_GetSystemSocket(i_socket));
+}
+
+void NetSocketPollerEpoll::addFd(int i_fd, void *i_tag) {
+  struct epoll_event v_event;
+
+  // level triggered : a socket not fully read is given again by the next wait
+  memset(&v_event, 0, sizeof(v_event));
+  v_event.events = EPOLLIN;
+  v_event.data.ptr = i_tag;
+
+  if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, i_fd, &v_event) == -1) {
+    throw Exception("epoll_ctl: " + std::string(strerror(errno)));
+  }
+  m_nbFds++;
+}
+
+void NetSocketPollerEpoll::delFd(int i_fd) {
+  struct epoll_event v_event; // required by kernels older than 2.6.9
+
+  if (epoll_ctl(m_epollFd, EPOLL_CTL_DEL, i_fd, &v_event) == 0) {
+    m_nbFds--;
+  }
+}
+
+void NetSocketPollerEpoll::wait(int i_timeout, std::vector<void *> &o_tags) {
+  struct epoll_event *v_events;
+  unsigned int v_maxEvents;
+  int n_activ;
+
+  o_tags.clear();
+
+  v_maxEvents = m_nbFds < XM_NET_POLLER_EPOLL_MIN_EVENTS
+                  ? XM_NET_POLLER_EPOLL_MIN_EVENTS
+                  : m_nbFds;
+  if (m_events.size() < v_maxEvents * sizeof(struct epoll_event)) {
+    m_events.resize(v_maxEvents * sizeof(struct epoll_event));
+  }
+  v_events = (struct epoll_event *)&m_events[0];
+
+  n_activ = epoll_wait(m_epollFd, v_events, v_maxEvents, i_timeout);
+  if (n_activ == -1) {
+    if (errno == EINTR) {
+      return;
+    }
+    throw Exception("epoll_wait: " + std::string(strerror(errno)));
+  }
+
+  for (int i = 0; i < n_activ; i++) {
+    o_tags.push_back(v_events[i].data.ptr);
+  }
+}
+#endif
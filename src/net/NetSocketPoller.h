@@ -0,0 +1,104 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __NETSOCKETPOLLER_H__
+#define __NETSOCKETPOLLER_H__
+
+#include "../include/xm_SDL_net.h"
+#include <string>
+#include <vector>
+
+/*
+  wait for activity on a set of sockets ; each socket is registered with a tag
+  which is given back when the socket is ready, so that the caller doesn't have
+  to scan all its sockets
+*/
+class NetSocketPoller {
+public:
+  virtual ~NetSocketPoller(){};
+
+  // epoll on linux, a sdl_net socket set elsewhere
+  static NetSocketPoller *create();
+
+  virtual std::string name() const = 0;
+
+  // throw an exception if the socket cannot be added
+  virtual void addTCPSocket(TCPsocket i_socket, void *i_tag) = 0;
+  virtual void addUDPSocket(UDPsocket i_socket, void *i_tag) = 0;
+  virtual void delTCPSocket(TCPsocket i_socket) = 0;
+  virtual void delUDPSocket(UDPsocket i_socket) = 0;
+
+  // wait at most i_timeout ms (-1 for no limit), then fill o_tags with the tags
+  // of all the ready sockets ; throw an exception on error
+  virtual void wait(int i_timeout, std::vector<void *> &o_tags) = 0;
+};
+
+/* portable poller, limited by select() */
+class NetSocketPollerSDL : public NetSocketPoller {
+public:
+  NetSocketPollerSDL();
+  ~NetSocketPollerSDL();
+
+  std::string name() const;
+  void addTCPSocket(TCPsocket i_socket, void *i_tag);
+  void addUDPSocket(UDPsocket i_socket, void *i_tag);
+  void delTCPSocket(TCPsocket i_socket);
+  void delUDPSocket(UDPsocket i_socket);
+  void wait(int i_timeout, std::vector<void *> &o_tags);
+
+private:
+  struct Entry {
+    SDLNet_GenericSocket socket;
+    void *tag;
+  };
+
+  void addSocket(SDLNet_GenericSocket i_socket, void *i_tag);
+  void delSocket(SDLNet_GenericSocket i_socket);
+
+  SDLNet_SocketSet m_set;
+  unsigned int m_setSize; // the set is reallocated bigger once full
+  std::vector<Entry> m_entries;
+};
+
+#if defined(__linux__)
+/* the ready sockets are given by the kernel, there is no sockets limit */
+class NetSocketPollerEpoll : public NetSocketPoller {
+public:
+  NetSocketPollerEpoll(); // throw an exception if epoll is not available
+  ~NetSocketPollerEpoll();
+
+  std::string name() const;
+  void addTCPSocket(TCPsocket i_socket, void *i_tag);
+  void addUDPSocket(UDPsocket i_socket, void *i_tag);
+  void delTCPSocket(TCPsocket i_socket);
+  void delUDPSocket(UDPsocket i_socket);
+  void wait(int i_timeout, std::vector<void *> &o_tags);
+
+private:
+  void addFd(int i_fd, void *i_tag);
+  void delFd(int i_fd);
+
+  int m_epollFd;
+  unsigned int m_nbFds;
+  std::vector<char> m_events; // struct epoll_event buffer
+};
+#endif
+
+#endif
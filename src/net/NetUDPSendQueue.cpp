@@ -0,0 +1,96 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "NetUDPSendQueue.h"
+#include "NetActions.h"
+#include "extSDL_net.h"
+#include "helpers/Log.h"
+#include "helpers/System.h"
+#include "helpers/VExcept.h"
+#include <string.h>
+
+NetUDPSendQueue::NetUDPSendQueue(unsigned int i_maxPacketSize) {
+  m_maxPacketSize = i_maxPacketSize;
+  m_nbPackets = 0;
+}
+
+NetUDPSendQueue::~NetUDPSendQueue() {
+  for (unsigned int i = 0; i < m_packets.size(); i++) {
+    SDLNet_FreePacket(m_packets[i]);
+  }
+}
+
+bool NetUDPSendQueue::push(const char *i_data,
+                           unsigned int i_size,
+                           const IPaddress *i_remoteIP) {
+  UDPpacket *v_packet;
+
+  if (i_size > m_maxPacketSize) {
+    return false;
+  }
+
+  if (m_nbPackets == m_packets.size()) {
+    v_packet = SDLNet_AllocPacket(m_maxPacketSize);
+    if (v_packet == NULL) {
+      throw Exception("SDLNet_AllocPacket: " + std::string(SDLNet_GetError()));
+    }
+    m_packets.push_back(v_packet);
+  }
+
+  v_packet = m_packets[m_nbPackets];
+  memcpy(v_packet->data, i_data, i_size);
+  v_packet->len = i_size;
+  v_packet->address = *i_remoteIP;
+  m_nbPackets++;
+
+  return true;
+}
+
+void NetUDPSendQueue::flush(UDPsocket i_udpsd) {
+  unsigned long long v_startTime;
+  unsigned int v_offset = 0;
+  int v_nsent;
+
+  if (m_nbPackets == 0) {
+    return;
+  }
+
+  v_startTime = System::getTimeUs();
+  while (v_offset < m_nbPackets) {
+    v_nsent = SDLNet_UDP_SendBatch(
+      i_udpsd, &m_packets[v_offset], m_nbPackets - v_offset);
+    NetAction::m_nbUDPSendCalls++;
+
+    if (v_nsent <= 0) {
+      // udp : the lost datagrams are not sent again
+      LogWarning("SDLNet_UDP_SendBatch failed : %s (%u datagrams lost)",
+                 SDLNet_GetError(),
+                 m_nbPackets - v_offset);
+      break;
+    }
+    v_offset += v_nsent;
+  }
+  m_nbPackets = 0;
+  NetAction::m_sendingTime += System::getTimeUs() - v_startTime;
+}
+
+unsigned int NetUDPSendQueue::size() const {
+  return m_nbPackets;
+}
@@ -0,0 +1,49 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __NETUDPSENDQUEUE_H__
+#define __NETUDPSENDQUEUE_H__
+
+#include "../include/xm_SDL_net.h"
+#include <vector>
+
+/*
+  datagrams waiting to be sent together by flush(), with as few system calls
+  as possible ; the packets are kept from a flush to the next one
+*/
+class NetUDPSendQueue {
+public:
+  NetUDPSendQueue(unsigned int i_maxPacketSize);
+  ~NetUDPSendQueue();
+
+  // copy the datagram ; false if it is too big
+  bool push(const char *i_data,
+            unsigned int i_size,
+            const IPaddress *i_remoteIP);
+  void flush(UDPsocket i_udpsd);
+  unsigned int size() const;
+
+private:
+  unsigned int m_maxPacketSize;
+  std::vector<UDPpacket *> m_packets;
+  unsigned int m_nbPackets; // used packets of m_packets
+};
+
+#endif
@@ -28,6 +28,7 @@ luaL_Reg ServerRules::m_rulesFuncs[] = {
   { "Player_setPoints", ServerRules::L_Rules_player_setPoints },
   { "Player_addPoints", ServerRules::L_Rules_player_addPoints },
   { "SendPointsToPlayers", ServerRules::L_Rules_sendPointsToPlayers },
+  { "SetFramesRadii", ServerRules::L_Rules_setFramesRadii },
   { "GetTime", ServerRules::L_Rules_Round_getTime },
   { "GetNbRemainingEntitiesToTake",
     ServerRules::L_Rules_Round_getNbRemainingEntitiesToTake },
@@ -39,10 +40,25 @@ ServerThread *ServerRules::m_exec_server = NULL;
 ServerRules::ServerRules(ServerThread *i_st)
   : LuaLibBase("Rules", m_rulesFuncs) {
   m_server = i_st;
+  m_framesNearRadius = 0.0;
+  m_framesFarRadius = 0.0;
 }
 
 ServerRules::~ServerRules() {}
 
+void ServerRules::setFramesRadii(float i_near, float i_far) {
+  m_framesNearRadius = i_near < 0.0 ? 0.0 : i_near;
+  m_framesFarRadius = i_far < m_framesNearRadius ? m_framesNearRadius : i_far;
+}
+
+float ServerRules::framesNearRadius() const {
+  return m_framesNearRadius;
+}
+
+float ServerRules::framesFarRadius() const {
+  return m_framesFarRadius;
+}
+
 void ServerRules::setInstance() {
   m_exec_server = m_server;
 }
@@ -86,6 +102,17 @@ int ServerRules::L_Rules_sendPointsToPlayers(lua_State *pL) {
   return 0;
 }
 
+int ServerRules::L_Rules_setFramesRadii(lua_State *pL) {
+  float v_near;
+  float v_far;
+
+  args_CheckNumberOfArguments(pL, 2);
+  v_near = (float)luaL_checknumber(pL, 1);
+  v_far = (float)luaL_checknumber(pL, 2);
+  m_exec_server->getRules()->setFramesRadii(v_near, v_far);
+  return 0;
+}
+
 int ServerRules::L_Rules_Round_getTime(lua_State *pL) {
   args_CheckNumberOfArguments(pL, 0);
 
@@ -30,11 +30,19 @@ public:
   ServerRules(ServerThread *i_st);
   ~ServerRules();
 
+  // players farther than the near radius from a client receive less frames,
+  // and even less when they are farther than the far radius ; 0 to disable
+  void setFramesRadii(float i_near, float i_far);
+  float framesNearRadius() const;
+  float framesFarRadius() const;
+
 protected:
   void setInstance();
 
 private:
   ServerThread *m_server;
+  float m_framesNearRadius;
+  float m_framesFarRadius;
 
   static luaL_Reg m_rulesFuncs[];
   static ServerThread *m_exec_server;
@@ -47,6 +55,7 @@ private:
   static int L_Rules_player_setPoints(lua_State *pL);
   static int L_Rules_player_addPoints(lua_State *pL);
   static int L_Rules_sendPointsToPlayers(lua_State *pL);
+  static int L_Rules_setFramesRadii(lua_State *pL);
 
   // on a round
   static int L_Rules_Round_whenRound_new(lua_State *pL);
@@ -21,8 +21,37 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "extSDL_net.h"
 #include <errno.h>
 
+static int UDP_RecvOneByOne(UDPsocket sock, UDPpacket **packets, int n) {
+  int nread = 0;
+  int res;
+
+  while (nread < n) {
+    res = SDLNet_UDP_Recv(sock, packets[nread]);
+    if (res < 0) {
+      return nread == 0 ? -1 : nread;
+    }
+    if (res == 0) {
+      break;
+    }
+    nread++;
+  }
+  return nread;
+}
+
+static int UDP_SendOneByOne(UDPsocket sock, UDPpacket **packets, int n) {
+  if (n < 1) {
+    return 0;
+  }
+  if (SDLNet_UDP_Send(sock, -1, packets[0]) == 0) {
+    return -1;
+  }
+  return 1;
+}
+
 // read the .h to understand why i redefine SDLNet_TCP_Send
 #if !defined(WIN32) && !defined(__APPLE__)
+#include <netinet/in.h>
+#include <string.h>
 #include <sys/socket.h>
 
 #define SOCKET int
@@ -35,6 +64,16 @@ struct _TCPsocket {
   int sflag;
 };
 
+struct _UDPsocket {
+  int ready;
+  SOCKET channel;
+  IPaddress address;
+  struct UDP_channel {
+    int numbound;
+    IPaddress address[SDLNET_MAX_UDPADDRESSES];
+  } binding[SDLNET_MAX_UDPCHANNELS];
+};
+
 int SDLNet_TCP_Send_noBlocking(TCPsocket sock, const void *datap, int len) {
   const Uint8 *data = (const Uint8 *)datap; /* For pointer arithmetic */
   int sent, left;
@@ -61,10 +100,130 @@ int SDLNet_TCP_Send_noBlocking(TCPsocket sock, const void *datap, int len) {
   return (sent);
 }
 
+int SDLNet_TCP_GetSystemSocket(TCPsocket sock) {
+  return sock->channel;
+}
+
+int SDLNet_UDP_GetSystemSocket(UDPsocket sock) {
+  return sock->channel;
+}
+
+#define XM_UDP_RECV_BATCH_MAX 64
+#define XM_UDP_SEND_BATCH_MAX 64
+
+int SDLNet_UDP_RecvBatch(UDPsocket sock, UDPpacket **packets, int n) {
+#if defined(__linux__)
+  struct mmsghdr msgs[XM_UDP_RECV_BATCH_MAX];
+  struct iovec iovecs[XM_UDP_RECV_BATCH_MAX];
+  struct sockaddr_in addrs[XM_UDP_RECV_BATCH_MAX];
+  int nread;
+
+  if (n > XM_UDP_RECV_BATCH_MAX) {
+    n = XM_UDP_RECV_BATCH_MAX;
+  }
+
+  memset(msgs, 0, sizeof(struct mmsghdr) * n);
+  for (int i = 0; i < n; i++) {
+    iovecs[i].iov_base = packets[i]->data;
+    iovecs[i].iov_len = packets[i]->maxlen;
+    msgs[i].msg_hdr.msg_iov = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_name = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+  }
+
+  do {
+    nread = recvmmsg(sock->channel, msgs, n, MSG_DONTWAIT, NULL);
+  } while (nread < 0 && errno == EINTR);
+
+  if (nread < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return 0;
+    }
+    SDLNet_SetError("recvmmsg: %s", strerror(errno));
+    return -1;
+  }
+
+  for (int i = 0; i < nread; i++) {
+    // like sdl_net, addresses are kept in network byte order
+    packets[i]->len = msgs[i].msg_len;
+    packets[i]->status = msgs[i].msg_len;
+    packets[i]->channel = -1;
+    packets[i]->address.host = addrs[i].sin_addr.s_addr;
+    packets[i]->address.port = addrs[i].sin_port;
+  }
+  sock->ready = 0;
+
+  return nread;
+#else
+  return UDP_RecvOneByOne(sock, packets, n);
+#endif
+}
+
+int SDLNet_UDP_SendBatch(UDPsocket sock, UDPpacket **packets, int n) {
+#if defined(__linux__)
+  struct mmsghdr msgs[XM_UDP_SEND_BATCH_MAX];
+  struct iovec iovecs[XM_UDP_SEND_BATCH_MAX];
+  struct sockaddr_in addrs[XM_UDP_SEND_BATCH_MAX];
+  int nsent;
+
+  if (n > XM_UDP_SEND_BATCH_MAX) {
+    n = XM_UDP_SEND_BATCH_MAX;
+  }
+
+  memset(msgs, 0, sizeof(struct mmsghdr) * n);
+  memset(addrs, 0, sizeof(struct sockaddr_in) * n);
+  for (int i = 0; i < n; i++) {
+    iovecs[i].iov_base = packets[i]->data;
+    iovecs[i].iov_len = packets[i]->len;
+    addrs[i].sin_family = AF_INET;
+    addrs[i].sin_addr.s_addr = packets[i]->address.host;
+    addrs[i].sin_port = packets[i]->address.port;
+    msgs[i].msg_hdr.msg_iov = &iovecs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    msgs[i].msg_hdr.msg_name = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+  }
+
+  do {
+    nsent = sendmmsg(sock->channel, msgs, n, 0);
+  } while (nsent < 0 && errno == EINTR);
+
+  if (nsent < 0) {
+    SDLNet_SetError("sendmmsg: %s", strerror(errno));
+    return -1;
+  }
+
+  for (int i = 0; i < nsent; i++) {
+    packets[i]->status = msgs[i].msg_len;
+  }
+
+  return nsent;
+#else
+  return UDP_SendOneByOne(sock, packets, n);
+#endif
+}
+
 #else
 // i don't know whether it's blocking or not ; i mainly want it works for the
 // servers on linux
 int SDLNet_TCP_Send_noBlocking(TCPsocket sock, const void *datap, int len) {
   return SDLNet_TCP_Send(sock, datap, len);
 }
+
+int SDLNet_TCP_GetSystemSocket(TCPsocket sock) {
+  return -1;
+}
+
+int SDLNet_UDP_GetSystemSocket(UDPsocket sock) {
+  return -1;
+}
+
+int SDLNet_UDP_RecvBatch(UDPsocket sock, UDPpacket **packets, int n) {
+  return UDP_RecvOneByOne(sock, packets, n);
+}
+
+int SDLNet_UDP_SendBatch(UDPsocket sock, UDPpacket **packets, int n) {
+  return UDP_SendOneByOne(sock, packets, n);
+}
 #endif
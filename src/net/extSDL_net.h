@@ -32,4 +32,24 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 int SDLNet_TCP_Send_noBlocking(TCPsocket sock, const void *datap, int len);
 
+/*
+  the system sockets under the sdl_net ones, to poll them with epoll ; -1 where
+  it is not available
+*/
+int SDLNet_TCP_GetSystemSocket(TCPsocket sock);
+int SDLNet_UDP_GetSystemSocket(UDPsocket sock);
+
+/*
+  receive up to n waiting datagrams without blocking, with one recvmmsg call on
+  linux ; packets are filled like SDLNet_UDP_Recv does ; return the number of
+  packets received, -1 on error
+*/
+int SDLNet_UDP_RecvBatch(UDPsocket sock, UDPpacket **packets, int n);
+
+/*
+  send packets to their address, with one sendmmsg call on linux (one packet
+  per call elsewhere) ; return the number of packets sent, -1 on error
+*/
+int SDLNet_UDP_SendBatch(UDPsocket sock, UDPpacket **packets, int n);
+
 #endif
@@ -21,6 +21,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "ServerThread.h"
 #include "../ActionReader.h"
 #include "../NetActions.h"
+#include "../NetSocketPoller.h"
+#include "../NetUDPSendQueue.h"
+#include "../extSDL_net.h"
 #include "../ServerRules.h"
 #include "../helpers/Net.h"
 #include "common/DBuffer.h"
@@ -43,13 +46,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #define XM_SERVER_UPLOADING_FPS_PLAYER 40
 #define XM_SERVER_UPLOADING_FPS_OPLAYERS 15
+#define XM_SERVER_UPLOADING_FPS_FAR_OPLAYERS 5
+#define XM_SERVER_UPLOADING_FPS_VERYFAR_OPLAYERS 1
 #define XM_SERVER_PLAYER_INACTIV_TIME_MAX 1000
 #define XM_SERVER_PLAYER_INACTIV_TIME_PREV 300
-#define XM_SERVER_NB_SOCKETS_MAX 128
 #define XM_SERVER_MAX_UDP_PACKET_SIZE 1024 // bytes
 #define XM_SERVER_PREPLAYING_TIME 300
 #define XM_SERVER_DEFAULT_BAN_NBDAYS 30
-#define XM_SERVER_MAX_FOLLOWING_UDP 100
+#define XM_SERVER_MAX_FOLLOWING_UDP 100 // per wakeup, to avoid tcp famine
+#define XM_SERVER_UDP_BATCH_SIZE 32
 #define XM_SERVER_DEFAULT_BANNER "Welcome on this server"
 #define XM_SERVER_UNPLAYING_SLEEP 10
 #define XM_SERVER_NICK_LENGTH_MAX 16
@@ -60,6 +65,57 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #define XM_SERVER_DEFAULT_RULES "Rules/classical.rules"
 
+/*
+  an action sent to several clients : each framing is encoded at most once,
+  the first time a client needs it
+*/
+class NetBroadcast {
+public:
+  NetBroadcast(NetAction *i_netAction, int i_src, int i_subsrc) {
+    m_netAction = i_netAction;
+    m_src = i_src;
+    m_subsrc = i_subsrc;
+    for (unsigned int i = 0; i < 2; i++) {
+      m_packets[i] = NULL;
+      m_encoded[i] = false;
+    }
+  }
+
+  ~NetBroadcast() {
+    for (unsigned int i = 0; i < 2; i++) {
+      if (m_packets[i] != NULL) {
+        m_packets[i]->unref();
+      }
+    }
+  }
+
+  // NULL if there is no action or if it can't be encoded
+  NetPacket *packet(bool i_binaryFraming) {
+    unsigned int n = i_binaryFraming ? 1 : 0;
+
+    if (m_encoded[n] == false && m_netAction != NULL) {
+      m_encoded[n] = true;
+      m_netAction->setSource(m_src, m_subsrc);
+      m_netAction->setBinaryFraming(i_binaryFraming);
+      try {
+        m_packets[n] = m_netAction->encode();
+      } catch (Exception &e) {
+        LogWarning("server: unable to encode the action %s (%s)",
+                   m_netAction->actionKey().c_str(),
+                   e.getMsg().c_str());
+      }
+    }
+    return m_packets[n];
+  }
+
+private:
+  NetAction *m_netAction;
+  int m_src;
+  int m_subsrc;
+  NetPacket *m_packets[2]; // text, binary
+  bool m_encoded[2];
+};
+
 NetSClient::NetSClient(unsigned int i_id,
                        TCPsocket i_tcpSocket,
                        IPaddress *i_tcpRemoteIP) {
@@ -89,9 +145,45 @@ NetSClient::NetSClient(unsigned int i_id,
 }
 
 NetSClient::~NetSClient() {
+  HashNamespace::unordered_map<int, NetFrameHistory *>::iterator it;
+
+  for (it = m_frameHistories.begin(); it != m_frameHistories.end(); it++) {
+    delete it->second;
+  }
   delete tcpReader;
 }
 
+NetFrameHistory *NetSClient::frameHistory(int i_src, int i_subsrc) {
+  int v_key = (i_src + 1) * NETACTION_MAX_SUBSRC + i_subsrc;
+  HashNamespace::unordered_map<int, NetFrameHistory *>::iterator it =
+    m_frameHistories.find(v_key);
+
+  if (it != m_frameHistories.end()) {
+    return it->second;
+  }
+
+  NetFrameHistory *v_history = new NetFrameHistory();
+  m_frameHistories[v_key] = v_history;
+  return v_history;
+}
+
+void NetSClient::ackFrame(int i_src, int i_subsrc, unsigned short i_seq) {
+  HashNamespace::unordered_map<int, NetFrameHistory *>::iterator it =
+    m_frameHistories.find((i_src + 1) * NETACTION_MAX_SUBSRC + i_subsrc);
+
+  if (it != m_frameHistories.end()) {
+    it->second->ack(i_seq);
+  }
+}
+
+void NetSClient::clearFrameHistories() {
+  HashNamespace::unordered_map<int, NetFrameHistory *>::iterator it;
+
+  for (it = m_frameHistories.begin(); it != m_frameHistories.end(); it++) {
+    it->second->clear();
+  }
+}
+
 bool NetSClient::isAdminConnected() const {
   return m_isAdminConnected;
 }
@@ -279,9 +371,13 @@ ServerThread::ServerThread(const std::string &i_dbKey,
   m_port = i_port;
   m_adminPassword = i_adminPassword;
 
-  m_set = NULL;
+  m_poller = NULL;
   m_nextClientId = 0;
   m_udpPacket = SDLNet_AllocPacket(XM_SERVER_MAX_UDP_PACKET_SIZE);
+  m_udpPackets = SDLNet_AllocPacketV(XM_SERVER_UDP_BATCH_SIZE,
+                                     XM_SERVER_MAX_UDP_PACKET_SIZE);
+  m_udpSendQueue = new NetUDPSendQueue(XM_SERVER_MAX_UDP_PACKET_SIZE);
+  m_udpSendQueueing = false;
 
   m_universe = NULL;
   m_DBuffer = new DBuffer();
@@ -289,33 +385,33 @@ ServerThread::ServerThread(const std::string &i_dbKey,
   m_sp2phase = SP2_PHASE_NONE;
   m_lastFrameTimeStamp = -1;
   m_frameLate = 0;
+  m_frameLateMax = 0;
+  m_lastTickStatsDump = System::getTimeUs();
   m_currentFrame = 0;
-  m_nFollowingUdp = 0;
   m_startTimeStr = GameApp::getTimeStamp();
   m_banner = XM_SERVER_DEFAULT_BANNER;
   m_acceptConnections = false;
   m_unmanagedActions = 0;
   m_rules = NULL;
   m_needToReloadRules = false;
-  m_sceneHook = new XMServerSceneHooks(this);
 
-  if (!m_udpPacket) {
+  if (!m_udpPacket || !m_udpPackets) {
     throw Exception("SDLNet_AllocPacket: " + std::string(SDLNet_GetError()));
   }
 }
 
 ServerThread::~ServerThread() {
   SDLNet_FreePacket(m_udpPacket);
+  SDLNet_FreePacketV(m_udpPackets);
+  delete m_udpSendQueue;
   delete m_DBuffer;
   if (m_rules != NULL) {
     delete m_rules;
   }
-  delete m_sceneHook;
 }
 
 int ServerThread::realThreadFunction() {
   IPaddress ip;
-  int ssn;
 
   LogInfo("server: starting");
 
@@ -337,9 +433,10 @@ int ServerThread::realThreadFunction() {
     return 1;
   }
 
-  m_set = SDLNet_AllocSocketSet(XM_SERVER_NB_SOCKETS_MAX);
-  if (!m_set) {
-    LogError("server: SDLNet_AllocSocketSet: %s", SDLNet_GetError());
+  try {
+    m_poller = NetSocketPoller::create();
+  } catch (Exception &e) {
+    LogError("server: %s", e.getMsg().c_str());
     return 1;
   }
 
@@ -347,33 +444,32 @@ int ServerThread::realThreadFunction() {
   LogInfo("server: open connexion");
   if ((m_tcpsd = SDLNet_TCP_Open(&ip)) == 0) {
     LogError("server: SDLNet_TCP_Open: %s", SDLNet_GetError());
-    SDLNet_FreeSocketSet(m_set);
+    delete m_poller;
+    m_poller = NULL;
     return 1;
   }
 
   if ((m_udpsd = SDLNet_UDP_Open(m_port)) == 0) {
     LogError("server: SDLNet_UDP_Open: %s", SDLNet_GetError());
-    SDLNet_FreeSocketSet(m_set);
+    delete m_poller;
+    m_poller = NULL;
     SDLNet_TCP_Close(m_tcpsd);
     return 1;
   }
 
-  ssn = SDLNet_TCP_AddSocket(m_set, m_tcpsd);
-  if (ssn == -1) {
-    LogError("server: SDLNet_TCP_AddSocket: %s", SDLNet_GetError());
-    SDLNet_FreeSocketSet(m_set);
-    SDLNet_TCP_Close(m_tcpsd);
-    SDLNet_UDP_Close(m_udpsd);
-    return 1;
-  }
-  ssn = SDLNet_UDP_AddSocket(m_set, m_udpsd);
-  if (ssn == -1) {
-    LogError("server: SDLNet_UDP_AddSocket: %s", SDLNet_GetError());
-    SDLNet_FreeSocketSet(m_set);
+  // the sockets of the server are tagged with their own address
+  try {
+    m_poller->addTCPSocket(m_tcpsd, &m_tcpsd);
+    m_poller->addUDPSocket(m_udpsd, &m_udpsd);
+  } catch (Exception &e) {
+    LogError("server: %s", e.getMsg().c_str());
+    delete m_poller;
+    m_poller = NULL;
     SDLNet_TCP_Close(m_tcpsd);
     SDLNet_UDP_Close(m_udpsd);
     return 1;
   }
+  LogInfo("server: sockets polled with %s", m_poller->name().c_str());
 
   m_acceptConnections = true;
   if (StateManager::exists()) {
@@ -421,15 +517,15 @@ void ServerThread::close() {
     i++;
   }
 
-  SDLNet_TCP_DelSocket(m_set, m_tcpsd);
-  SDLNet_UDP_DelSocket(m_set, m_udpsd);
+  m_poller->delTCPSocket(m_tcpsd);
+  m_poller->delUDPSocket(m_udpsd);
 
   LogInfo("server: close connexion");
   SDLNet_TCP_Close(m_tcpsd);
   SDLNet_UDP_Close(m_udpsd);
 
-  SDLNet_FreeSocketSet(m_set);
-  m_set = NULL;
+  delete m_poller;
+  m_poller = NULL;
 
   if (StateManager::exists()) {
     StateManager::instance()->sendAsynchronousMessage("SERVER_STATUS_CHANGED");
@@ -478,9 +574,15 @@ void ServerThread::SP2_initPlaying() {
   m_universe = new Universe();
   m_universe->initPlayServer();
 
+  // frames of the previous round are not baselines anymore
+  for (unsigned int i = 0; i < m_clients.size(); i++) {
+    m_clients[i]->clearFrameHistories();
+  }
+
   // set hooks for the scenes
   for (unsigned int i = 0; i < m_universe->getScenes().size(); i++) {
-    m_universe->getScenes()[i]->setHooks(m_sceneHook);
+    m_sceneHooks.push_back(new XMServerSceneHooks(this, i));
+    m_universe->getScenes()[i]->setHooks(m_sceneHooks[i]);
   }
 
   try {
@@ -544,6 +646,7 @@ void ServerThread::SP2_initPlaying() {
 
 void ServerThread::SP2_uninitPlaying() {
   try {
+    ServerTickPhaseScope v_phase(&m_tickStats, STP_SCRIPT);
     m_rules->scriptCallVoid("Round_whenRound_ends");
   } catch (Exception &e) {
     // continue the game even if the rules are badly written
@@ -551,6 +654,11 @@ void ServerThread::SP2_uninitPlaying() {
   }
   delete m_universe;
   m_universe = NULL;
+
+  for (unsigned int i = 0; i < m_sceneHooks.size(); i++) {
+    delete m_sceneHooks[i];
+  }
+  m_sceneHooks.clear();
 }
 
 void ServerThread::SP2_manageInactivity() {
@@ -664,6 +772,7 @@ void ServerThread::SP2_updateScenePlaying() {
       m_sp2_gameStarted = true;
 
       try {
+        ServerTickPhaseScope v_phase(&m_tickStats, STP_SCRIPT);
         m_rules->scriptCallVoid("Round_whenRound_begins");
       } catch (Exception &e) {
         // continue the game even if the rules are badly written
@@ -676,27 +785,38 @@ void ServerThread::SP2_updateScenePlaying() {
     /* update the scene */
     m_DBuffer->clear();
     nPhysSteps = 0;
-
-    while (m_lastPhysTime + (PHYS_STEP_SIZE * 10) <= GameApp::getXMTimeInt() &&
-           nPhysSteps < 10) {
-      for (unsigned int i = 0; i < m_universe->getScenes().size(); i++) {
-        v_scene = m_universe->getScenes()[i];
-        v_scene->updateLevel(PHYS_STEP_SIZE,
-                             NULL,
-                             m_DBuffer,
-                             nPhysSteps != 0,
-                             false /* no particles */,
-                             false /* don't update died players */);
+    {
+      ServerTickPhaseScope v_phase(&m_tickStats, STP_PHYSICS);
+
+      while (m_lastPhysTime + (PHYS_STEP_SIZE * 10) <=
+               GameApp::getXMTimeInt() &&
+             nPhysSteps < 10) {
+        for (unsigned int i = 0; i < m_universe->getScenes().size(); i++) {
+          v_scene = m_universe->getScenes()[i];
+          v_scene->updateLevel(PHYS_STEP_SIZE,
+                               NULL,
+                               m_DBuffer,
+                               nPhysSteps != 0,
+                               false /* no particles */,
+                               false /* don't update died players */);
+        }
+        v_updateDone = true;
+        m_lastPhysTime += PHYS_STEP_SIZE * 10;
+        nPhysSteps++;
       }
-      v_updateDone = true;
-      m_lastPhysTime += PHYS_STEP_SIZE * 10;
-      nPhysSteps++;
+    }
+
+    // time the physics is late on the real time, once the scenes are updated
+    m_frameLate = GameApp::getXMTimeInt() - m_lastPhysTime;
+    if (m_frameLate > m_frameLateMax) {
+      m_frameLateMax = m_frameLate;
     }
 
     // if the delay is too long, reinitialize -- don't skip in server mode
     // if(m_fLastPhysTime + PHYS_STEP_SIZE/100.0 < GameApp::getXMTime()) {
     //  m_fLastPhysTime = GameApp::getXMTime();
     //}
+    ServerTickPhaseScope v_phase(&m_tickStats, STP_EVENTS);
     SP2_sendSceneEvents(m_DBuffer);
   } else {
     /* send the first frame regularly, so that the client received it once ready
@@ -712,9 +832,25 @@ void ServerThread::SP2_updateScenePlaying() {
 
   // send to each client his frame and the frame of the others
   if (v_updateDone || v_firstFrame) {
+    ServerTickPhaseScope v_phase(&m_tickStats, STP_EVENTS);
+    // the frames of the other players are sent less often when they are far
+    bool v_sendNear =
+      v_firstFrame ||
+      m_currentFrame % (100 / XM_SERVER_UPLOADING_FPS_OPLAYERS) == 0;
+    bool v_sendFar =
+      v_firstFrame ||
+      m_currentFrame % (100 / XM_SERVER_UPLOADING_FPS_FAR_OPLAYERS) == 0;
+    bool v_sendVeryFar =
+      v_firstFrame ||
+      m_currentFrame % (100 / XM_SERVER_UPLOADING_FPS_VERYFAR_OPLAYERS) == 0;
+
     if (v_firstFrame ||
-        (m_currentFrame % (100 / XM_SERVER_UPLOADING_FPS_PLAYER) == 0 ||
-         m_currentFrame % (100 / XM_SERVER_UPLOADING_FPS_OPLAYERS) == 0)) {
+        m_currentFrame % (100 / XM_SERVER_UPLOADING_FPS_PLAYER) == 0 ||
+        v_sendNear || v_sendFar || v_sendVeryFar) {
+      if (v_sendNear || v_sendFar || v_sendVeryFar) {
+        SP2_buildRelevanceGrids();
+      }
+
       for (unsigned int i = 0; i < m_clients.size(); i++) {
         if (m_clients[i]->isMarkedToPlay()) {
           v_scene = m_universe->getScenes()[m_clients[i]->getNumScene()];
@@ -731,15 +867,49 @@ void ServerThread::SP2_updateScenePlaying() {
               if (v_firstFrame ||
                   m_currentFrame % (100 / XM_SERVER_UPLOADING_FPS_PLAYER) ==
                     0) {
-                sendToClient(&na, i, -1, 0);
-              }
-              if (v_firstFrame ||
-                  m_currentFrame % (100 / XM_SERVER_UPLOADING_FPS_OPLAYERS) ==
-                    0) {
-                sendToAllClientsMarkedToPlay(&na, m_clients[i]->id(), 0, i);
+                if (clientUsesFrameDelta(i)) {
+                  sendFrameDeltaToClient(BikeState, i, -1, 0);
+                } else {
+                  sendToClient(&na, i, -1, 0);
+                }
               }
             } catch (Exception &e) {
             }
+
+            if (v_sendNear || v_sendFar || v_sendVeryFar) {
+              // old clients share the same full frame
+              NetBroadcast v_broadcast(&na, m_clients[i]->id(), 0);
+
+              SP2_computeFrameReceivers(i);
+
+              if (v_sendVeryFar) {
+                // everybody can get this frame, the tier of each client is
+                // needed
+                m_frameTiers.assign(m_clients.size(), SP2_FRAMETIER_VERYFAR);
+                for (unsigned int n = 0; n < m_frameReceivers.size(); n++) {
+                  m_frameTiers[m_frameReceivers[n]] = m_frameReceiversTiers[n];
+                }
+
+                for (unsigned int j = 0; j < m_clients.size(); j++) {
+                  if (j != i && m_clients[j]->isMarkedToPlay() &&
+                      isFrameDue(
+                        m_frameTiers[j], v_sendNear, v_sendFar, true)) {
+                    SP2_sendOtherPlayerFrame(BikeState, &v_broadcast, i, j);
+                  }
+                }
+              } else {
+                // only the players around and the dead ones get this frame
+                for (unsigned int n = 0; n < m_frameReceivers.size(); n++) {
+                  if (isFrameDue(m_frameReceiversTiers[n],
+                                 v_sendNear,
+                                 v_sendFar,
+                                 false)) {
+                    SP2_sendOtherPlayerFrame(
+                      BikeState, &v_broadcast, i, m_frameReceivers[n]);
+                  }
+                }
+              }
+            }
           }
         }
       }
@@ -748,6 +918,119 @@ void ServerThread::SP2_updateScenePlaying() {
   }
 }
 
+void ServerThread::SP2_buildRelevanceGrids() {
+  Scene *v_scene;
+  Biker *v_player;
+  float v_radius = m_rules->framesNearRadius();
+
+  if (v_radius <= 0.0) {
+    return;
+  }
+
+  m_relevanceGrids.resize(m_universe->getScenes().size());
+  m_deadClients.resize(m_universe->getScenes().size());
+  for (unsigned int i = 0; i < m_relevanceGrids.size(); i++) {
+    m_relevanceGrids[i].reset(v_radius);
+    m_deadClients[i].clear();
+  }
+
+  for (unsigned int i = 0; i < m_clients.size(); i++) {
+    if (m_clients[i]->isMarkedToPlay()) {
+      v_scene = m_universe->getScenes()[m_clients[i]->getNumScene()];
+      v_player = v_scene->Players()[m_clients[i]->getNumPlayer()];
+
+      if (v_player->isDead()) {
+        m_deadClients[m_clients[i]->getNumScene()].push_back(i);
+      } else {
+        m_relevanceGrids[m_clients[i]->getNumScene()].add(
+          i, v_player->getState()->CenterP.x, v_player->getState()->CenterP.y);
+      }
+    }
+  }
+}
+
+void ServerThread::SP2_computeFrameReceivers(unsigned int i_client) {
+  Biker *v_player;
+  unsigned int v_numScene = m_clients[i_client]->getNumScene();
+  float v_near2 = m_rules->framesNearRadius() * m_rules->framesNearRadius();
+  float v_x, v_y, dx, dy;
+  unsigned int j;
+
+  m_frameReceivers.clear();
+  m_frameReceiversTiers.clear();
+
+  // no radius, everybody is near
+  if (m_rules->framesNearRadius() <= 0.0) {
+    for (j = 0; j < m_clients.size(); j++) {
+      if (j != i_client && m_clients[j]->isMarkedToPlay()) {
+        m_frameReceivers.push_back(j);
+        m_frameReceiversTiers.push_back(SP2_FRAMETIER_NEAR);
+      }
+    }
+    return;
+  }
+
+  // a dead player's camera can follow anybody
+  for (unsigned int n = 0; n < m_deadClients[v_numScene].size(); n++) {
+    m_frameReceivers.push_back(m_deadClients[v_numScene][n]);
+    m_frameReceiversTiers.push_back(SP2_FRAMETIER_NEAR);
+  }
+
+  v_player = m_universe->getScenes()[v_numScene]
+               ->Players()[m_clients[i_client]->getNumPlayer()];
+  v_x = v_player->getState()->CenterP.x;
+  v_y = v_player->getState()->CenterP.y;
+
+  m_relevanceIds.clear();
+  m_relevanceGrids[v_numScene].getAround(
+    v_x, v_y, m_rules->framesFarRadius(), m_relevanceIds);
+  for (unsigned int n = 0; n < m_relevanceIds.size(); n++) {
+    j = m_relevanceIds[n];
+    if (j == i_client) {
+      continue;
+    }
+
+    v_player = m_universe->getScenes()[v_numScene]
+                 ->Players()[m_clients[j]->getNumPlayer()];
+    dx = v_player->getState()->CenterP.x - v_x;
+    dy = v_player->getState()->CenterP.y - v_y;
+    m_frameReceivers.push_back(j);
+    m_frameReceiversTiers.push_back(dx * dx + dy * dy <= v_near2
+                                      ? SP2_FRAMETIER_NEAR
+                                      : SP2_FRAMETIER_FAR);
+  }
+}
+
+bool ServerThread::isFrameDue(ServerP2FrameTier i_tier,
+                              bool i_sendNear,
+                              bool i_sendFar,
+                              bool i_sendVeryFar) {
+  switch (i_tier) {
+    case SP2_FRAMETIER_NEAR:
+      return i_sendNear;
+    case SP2_FRAMETIER_FAR:
+      return i_sendFar;
+    case SP2_FRAMETIER_VERYFAR:
+      return i_sendVeryFar;
+  }
+  return false;
+}
+
+void ServerThread::SP2_sendOtherPlayerFrame(const SerializedBikeState &i_state,
+                                            NetBroadcast *i_broadcast,
+                                            unsigned int i_sender,
+                                            unsigned int i_receiver) {
+  try {
+    if (clientUsesFrameDelta(i_receiver)) {
+      sendFrameDeltaToClient(
+        i_state, i_receiver, m_clients[i_sender]->id(), 0);
+    } else {
+      sendToClient(i_broadcast, i_receiver);
+    }
+  } catch (Exception &e) {
+  }
+}
+
 void ServerThread::SP2_updateCheckScenePlaying() {
   Scene *v_scene;
   bool v_nobodyPlaying = true;
@@ -863,8 +1146,18 @@ void ServerThread::run_loop() {
         m_sp2_lastLoopDelta = 0;
       }
       m_sp2_lastLoopTime = GameApp::getXMTimeInt();
+      m_tickStats.beginTick();
+
+      // the udp datagrams of the tick are sent together
+      m_udpSendQueueing = true;
+      try {
+        SP2_updateScenePlaying();
+      } catch (Exception &e) {
+        flushUDPSendQueue();
+        throw e;
+      }
+      flushUDPSendQueue();
 
-      SP2_updateScenePlaying();
       SP2_updateCheckScenePlaying();
 
       // mange the network according to time spent
@@ -877,6 +1170,14 @@ void ServerThread::run_loop() {
       } else {
         manageNetwork(0); // do at least one loop
       }
+      m_tickStats.endTick();
+
+      if (XMSession::instance()->serverTickStatsPeriod() > 0 &&
+          System::getTimeUs() - m_lastTickStatsDump >=
+            XMSession::instance()->serverTickStatsPeriod() * 1000000ULL) {
+        m_tickStats.dumpPeriod(XMSession::instance()->serverTickStatsFile());
+        m_lastTickStatsDump = System::getTimeUs();
+      }
       break;
   }
 }
@@ -897,79 +1198,89 @@ void ServerThread::manageNetwork(int i_timeout) {
 }
 
 bool ServerThread::manageNetworkOnePacket(int i_timeout) {
-  int n_activ;
-  unsigned int i;
-  bool v_needMore = false;
+  bool v_serverReady = false;
+  bool v_udpReady = false;
 
-  n_activ = SDLNet_CheckSockets(m_set, i_timeout);
-  if (n_activ == -1) {
-    LogError("SDLNet_CheckSockets: %s", SDLNet_GetError());
+  try {
+    ServerTickPhaseScope v_phase(&m_tickStats, STP_IDLE);
+    m_poller->wait(i_timeout, m_readySockets);
+  } catch (Exception &e) {
+    LogError("server: %s", e.getMsg().c_str());
     m_askThreadToEnd = true;
-  } else {
-    if (n_activ == 0) {
-      m_nFollowingUdp = 0;
-    } else {
-      v_needMore = true;
+    return false;
+  }
 
-      // server socket
-      if (SDLNet_SocketReady(m_tcpsd)) {
-        acceptClient();
-      }
+  if (m_readySockets.empty()) {
+    return false;
+  }
 
-      /*
-        avoid udp only management ; by the way, avoid (check tcp at least every
-        MAX_FOLLOWING_UDP)
-        but don't check at each time tcp packets while it's less a  priority and
-        less often
-       */
-      if (m_nFollowingUdp < XM_SERVER_MAX_FOLLOWING_UDP &&
-          SDLNet_SocketReady(m_udpsd)) {
-        manageClientUDP();
-        m_nFollowingUdp++;
-      } else {
-        m_nFollowingUdp = 0;
+  ServerTickPhaseScope v_phase(&m_tickStats, STP_NETWORK);
+  for (unsigned int n = 0; n < m_readySockets.size(); n++) {
+    if (m_readySockets[n] == &m_tcpsd) {
+      v_serverReady = true;
+    } else if (m_readySockets[n] == &m_udpsd) {
+      v_udpReady = true;
+    }
+  }
 
-        i = 0;
-        while (i < m_clients.size()) {
-          if (SDLNet_SocketReady(*(m_clients[i]->tcpSocket()))) {
-            try {
-              if (manageClientTCP(i) == false) {
-                removeClient(i);
-              } else {
-                i++;
-              }
-            } catch (Exception &e) {
-              if (e.getMsg() == "Disconnected") { // catch(DisconnectedException
-                // &e) won't work, i don't
-                // understand why
-                LogInfo("server: client %u disconnected (%s:%d) : %s",
-                        i,
-                        XMNet::getIp(m_clients[i]->tcpRemoteIP()).c_str(),
-                        SDLNet_Read16(&(m_clients[i]->tcpRemoteIP())->port),
-                        e.getMsg().c_str());
-                removeClient(i);
-              } else {
-                LogInfo(
-                  "server: bad TCP packet received by client %u (%s:%d) : %s",
-                  i,
-                  XMNet::getIp(m_clients[i]->tcpRemoteIP()).c_str(),
-                  SDLNet_Read16(&(m_clients[i]->tcpRemoteIP())->port),
-                  e.getMsg().c_str());
-                removeClient(i);
-              }
-            }
-          } else {
-            i++;
-          }
-        }
-      }
+  /*
+    accept first : clients are only removed after, so that a new client can't
+    get the address of a removed one still in the ready list
+  */
+  if (v_serverReady) {
+    acceptClient();
+  }
+
+  if (v_udpReady) {
+    manageClientsUDP();
+  }
+
+  for (unsigned int n = 0; n < m_readySockets.size(); n++) {
+    if (m_readySockets[n] != &m_tcpsd && m_readySockets[n] != &m_udpsd) {
+      manageClientReadyTCP((NetSClient *)m_readySockets[n]);
     }
   }
 
   // remove client marked to be removed
   cleanClientsMarkedToBeRemoved();
 
-  return v_needMore;
+  return true;
+}
+
+void ServerThread::manageClientReadyTCP(NetSClient *i_client) {
+  unsigned int i = 0;
+
+  // the client can have been removed while managing an other socket
+  while (i < m_clients.size() && m_clients[i] != i_client) {
+    i++;
+  }
+  if (i == m_clients.size()) {
+    return;
+  }
+
+  try {
+    if (manageClientTCP(i) == false) {
+      removeClient(i);
+    }
+  } catch (Exception &e) {
+    if (e.getMsg() == "Disconnected") { // catch(DisconnectedException
+      // &e) won't work, i don't
+      // understand why
+      LogInfo("server: client %u disconnected (%s:%d) : %s",
+              i,
+              XMNet::getIp(m_clients[i]->tcpRemoteIP()).c_str(),
+              SDLNet_Read16(&(m_clients[i]->tcpRemoteIP())->port),
+              e.getMsg().c_str());
+      removeClient(i);
+    } else {
+      LogInfo("server: bad TCP packet received by client %u (%s:%d) : %s",
+              i,
+              XMNet::getIp(m_clients[i]->tcpRemoteIP()).c_str(),
+              SDLNet_Read16(&(m_clients[i]->tcpRemoteIP())->port),
+              e.getMsg().c_str());
+      removeClient(i);
+    }
+  }
 }
 
 void ServerThread::removeClient(unsigned int i) {
@@ -981,7 +1292,7 @@ void ServerThread::removeClient(unsigned int i) {
     }
   }
 
-  SDLNet_TCP_DelSocket(m_set, *(m_clients[i]->tcpSocket()));
+  m_poller->delTCPSocket(*(m_clients[i]->tcpSocket()));
   SDLNet_TCP_Close(*(m_clients[i]->tcpSocket()));
   if (m_clients[i]->isUdpBinded()) {
     m_clients[i]->unbindUdp();
@@ -1011,6 +1322,8 @@ void ServerThread::sendToClient(NetAction *i_netAction,
                                 int i_subsrc,
                                 bool i_forceUdp) {
   i_netAction->setSource(i_src, i_subsrc);
+  i_netAction->setBinaryFraming(clientUsesBinaryFraming(i));
+  i_netAction->setUDPSendQueue(m_udpSendQueueing ? m_udpSendQueue : NULL);
   if (i_forceUdp) {
     i_netAction->send(NULL, &m_udpsd, m_udpPacket, m_clients[i]->udpRemoteIP());
   } else if (m_clients[i]->isUdpBinded() &&
@@ -1024,16 +1337,67 @@ void ServerThread::sendToClient(NetAction *i_netAction,
   }
 }
 
+void ServerThread::flushUDPSendQueue() {
+  ServerTickPhaseScope v_phase(&m_tickStats, STP_NETWORK);
+
+  m_udpSendQueueing = false;
+  m_udpSendQueue->flush(m_udpsd);
+}
+
+bool ServerThread::clientUsesBinaryFraming(unsigned int i) const {
+  return m_clients[i]->protocolVersion() >= XM_NET_PROTOCOL_BINARY;
+}
+
+bool ServerThread::clientUsesFrameDelta(unsigned int i) const {
+  return m_clients[i]->protocolVersion() >= XM_NET_PROTOCOL_FRAMEDELTA;
+}
+
+void ServerThread::sendFrameDeltaToClient(const SerializedBikeState &i_state,
+                                          unsigned int i,
+                                          int i_src,
+                                          int i_subsrc) {
+  NetFrameHistory *v_history = m_clients[i]->frameHistory(i_src, i_subsrc);
+  unsigned short v_seq = v_history->nextSeq();
+  unsigned short v_baseSeq = 0;
+  const SerializedBikeState *v_base = v_history->baseline(v_baseSeq);
+  SerializedBikeState v_rebuilt;
+
+  // full frame while the client didn't acknowledge a recent frame
+  NA_frameDelta na(v_seq, v_base, v_baseSeq, i_state, v_rebuilt);
+  v_history->store(v_seq, v_rebuilt);
+  sendToClient(&na, i, i_src, i_subsrc);
+}
+
+void ServerThread::sendToClient(NetBroadcast *i_broadcast, unsigned int i) {
+  NetPacket *v_packet = i_broadcast->packet(clientUsesBinaryFraming(i));
+
+  if (v_packet == NULL) {
+    return;
+  }
+
+  if (m_clients[i]->isUdpBinded() && m_clients[i]->isUdpBindedValidated()) {
+    v_packet->send(m_clients[i]->tcpSocket(),
+                   &m_udpsd,
+                   m_udpPacket,
+                   m_clients[i]->udpRemoteIP(),
+                   m_udpSendQueueing ? m_udpSendQueue : NULL);
+  } else {
+    v_packet->send(m_clients[i]->tcpSocket(), NULL, NULL, NULL);
+  }
+}
+
 void ServerThread::sendToAllClientsHavingMode(NetClientMode i_mode,
                                               NetAction *i_netAction,
                                               int i_src,
                                               int i_subsrc,
                                               int i_except) {
+  NetBroadcast v_broadcast(i_netAction, i_src, i_subsrc);
+
   for (unsigned int i = 0; i < m_clients.size(); i++) {
     if ((int)i != i_except &&
         (i_mode == NETCLIENT_ANY_MODE || i_mode == m_clients[i]->mode())) {
       try {
-        sendToClient(i_netAction, i, i_src, i_subsrc);
+        sendToClient(&v_broadcast, i);
       } catch (Exception &e) {
         // don't remove the client while removeclient function can call
         // sendToAllClients ...
@@ -1054,10 +1418,12 @@ void ServerThread::sendToAllClientsMarkedToPlay(NetAction *i_netAction,
                                                 int i_src,
                                                 int i_subsrc,
                                                 int i_except) {
+  NetBroadcast v_broadcast(i_netAction, i_src, i_subsrc);
+
   for (unsigned int i = 0; i < m_clients.size(); i++) {
     if ((int)i != i_except && m_clients[i]->isMarkedToPlay()) {
       try {
-        sendToClient(i_netAction, i, i_src, i_subsrc);
+        sendToClient(&v_broadcast, i);
       } catch (Exception &e) {
         // don't remove the client while removeclient function can call
         // sendToAllClients ...
@@ -1072,24 +1438,13 @@ void ServerThread::sendToAllClientsHavingProtocol(int i_protocol,
                                                   int i_src,
                                                   int i_subsrc,
                                                   int i_except) {
-  for (unsigned int i = 0; i < m_clients.size(); i++) {
-    try {
-      if ((int)i != i_except) {
-        if (m_clients[i]->protocolVersion() < i_protocol) {
-          if (i_netAction_lt != NULL) {
-            sendToClient(i_netAction_lt, i, i_src, i_subsrc);
-          }
-        } else {
-          if (i_netAction_ge != NULL) {
-            sendToClient(i_netAction_ge, i, i_src, i_subsrc);
-          }
-        }
-      }
-    } catch (Exception &e) {
-      // don't remove the client while removeclient function can call
-      // sendToAllClients ...
-    }
-  }
+  sendToAllClientsHavingModeAndProtocol(NETCLIENT_ANY_MODE,
+                                        i_protocol,
+                                        i_netAction_lt,
+                                        i_netAction_ge,
+                                        i_src,
+                                        i_subsrc,
+                                        i_except);
 }
 
 void ServerThread::sendToAllClientsHavingModeAndProtocol(
@@ -1100,20 +1455,17 @@ void ServerThread::sendToAllClientsHavingModeAndProtocol(
   int i_src,
   int i_subsrc,
   int i_except) {
+  NetBroadcast v_broadcast_lt(i_netAction_lt, i_src, i_subsrc);
+  NetBroadcast v_broadcast_ge(i_netAction_ge, i_src, i_subsrc);
+
   for (unsigned int i = 0; i < m_clients.size(); i++) {
     if ((int)i != i_except &&
         (i_mode == NETCLIENT_ANY_MODE || i_mode == m_clients[i]->mode())) {
       try {
-        if ((int)i != i_except) {
-          if (m_clients[i]->protocolVersion() < i_protocol) {
-            if (i_netAction_lt != NULL) {
-              sendToClient(i_netAction_lt, i, i_src, i_subsrc);
-            }
-          } else {
-            if (i_netAction_ge != NULL) {
-              sendToClient(i_netAction_ge, i, i_src, i_subsrc);
-            }
-          }
+        if (m_clients[i]->protocolVersion() < i_protocol) {
+          sendToClient(&v_broadcast_lt, i);
+        } else {
+          sendToClient(&v_broadcast_ge, i);
         }
       } catch (Exception &e) {
         // don't remove the client while removeclient function can call
@@ -1154,7 +1506,7 @@ void ServerThread::sendPointsToClient(unsigned int i_client) {
 void ServerThread::acceptClient() {
   TCPsocket csd;
   IPaddress *tcpRemoteIP;
-  int scn;
+  NetSClient *v_client;
 
   if ((csd = SDLNet_TCP_Accept(m_tcpsd)) == 0) {
     return;
@@ -1200,14 +1552,17 @@ void ServerThread::acceptClient() {
     return;
   }
 
-  scn = SDLNet_TCP_AddSocket(m_set, csd);
-  if (scn == -1) {
-    LogError("server: SDLNet_TCP_AddSocket: %s", SDLNet_GetError());
+  v_client = new NetSClient(m_nextClientId++, csd, tcpRemoteIP);
+  try {
+    m_poller->addTCPSocket(csd, v_client);
+  } catch (Exception &e) {
+    LogError("server: %s", e.getMsg().c_str());
+    delete v_client;
     SDLNet_TCP_Close(csd);
     return;
   }
 
-  m_clients.push_back(new NetSClient(m_nextClientId++, csd, tcpRemoteIP));
+  m_clients.push_back(v_client);
 }
 
 bool ServerThread::manageClientTCP(unsigned int i) {
@@ -1226,86 +1581,104 @@ bool ServerThread::manageClientTCP(unsigned int i) {
   return true;
 }
 
-void ServerThread::manageClientUDP() {
+void ServerThread::manageClientsUDP() {
+  int v_nread;
+  unsigned int v_nmanaged = 0;
+
+  do {
+    v_nread =
+      SDLNet_UDP_RecvBatch(m_udpsd, m_udpPackets, XM_SERVER_UDP_BATCH_SIZE);
+    if (v_nread < 0) {
+      LogWarning("server: %s", SDLNet_GetError());
+      return;
+    }
+
+    for (int n = 0; n < v_nread; n++) {
+      manageClientUDP(m_udpPackets[n]);
+    }
+    v_nmanaged += v_nread;
+  } while (v_nread == XM_SERVER_UDP_BATCH_SIZE &&
+           v_nmanaged < XM_SERVER_MAX_FOLLOWING_UDP);
+}
+
+void ServerThread::manageClientUDP(UDPpacket *i_packet) {
   bool v_managedPacket;
 
-  if (SDLNet_UDP_Recv(m_udpsd, m_udpPacket) == 1) {
-    v_managedPacket = false;
-    for (unsigned int i = 0; i < m_clients.size(); i++) {
-      if (m_clients[i]->udpRemoteIP()->host == m_udpPacket->address.host &&
-          m_clients[i]->udpRemoteIP()->port == m_udpPacket->address.port) {
-        v_managedPacket = true;
-        try {
-          ActionReader::UDPReadAction(
-            m_udpPacket->data, m_udpPacket->len, &m_preAllocatedNA);
-          if (manageAction(m_preAllocatedNA.master, i) == false) {
-            removeClient(i);
-            return;
-          }
-        } catch (Exception &e) {
-          m_unmanagedActions++;
-
-          // ok, a bad packet received, forget it
-          LogWarning(
-            "server: bad UDP packet received by client %u (%s:%i) : %s",
-            i,
-            XMNet::getIp(&(m_udpPacket->address)).c_str(),
-            SDLNet_Read16(&(m_udpPacket->address.port)),
-            e.getMsg().c_str());
+  v_managedPacket = false;
+  for (unsigned int i = 0; i < m_clients.size(); i++) {
+    if (m_clients[i]->udpRemoteIP()->host == i_packet->address.host &&
+        m_clients[i]->udpRemoteIP()->port == i_packet->address.port) {
+      v_managedPacket = true;
+      try {
+        ActionReader::UDPReadAction(
+          i_packet->data, i_packet->len, &m_preAllocatedNA);
+        if (manageAction(m_preAllocatedNA.master, i) == false) {
+          removeClient(i);
+          return;
         }
-        break; // stop : only one client
+      } catch (Exception &e) {
+        m_unmanagedActions++;
+
+        // ok, a bad packet received, forget it
+        LogWarning(
+          "server: bad UDP packet received by client %u (%s:%i) : %s",
+          i,
+          XMNet::getIp(&(i_packet->address)).c_str(),
+          SDLNet_Read16(&(i_packet->address.port)),
+          e.getMsg().c_str());
       }
+      break; // stop : only one client
     }
+  }
 
-    // anonym packet ? find the associated client
-    if (v_managedPacket == false) {
-      try {
-        ActionReader::UDPReadAction(
-          m_udpPacket->data, m_udpPacket->len, &m_preAllocatedNA);
-        if (m_preAllocatedNA.master->actionType() == TNA_udpBind) {
-          for (unsigned int i = 0; i < m_clients.size(); i++) {
-            if (m_clients[i]->isUdpBinded() == false) {
-              if (m_clients[i]->udpBindKey() ==
-                  ((NA_udpBind *)m_preAllocatedNA.master)->key()) {
-                // LogInfo("UDP bind key received via UDP: %s",
-                // ((NA_udpBind*)v_netAction)->key().c_str());
-                m_clients[i]->bindUdp(m_udpPacket->address);
-                if (m_clients[i]->protocolVersion() >=
-                    3) { // don't send if the version is lower because the
-                  // client will not understand -- udp could not work in
-                  // that case
-                  LogInfo("server: i can receive udp from the client %i", i);
-
-                  NA_udpBindValidation nabv;
-                  try {
-                    sendToClient(&nabv, i, -1, 0);
-                  } catch (Exception &e) {
-                  }
+  // anonym packet ? find the associated client
+  if (v_managedPacket == false) {
+    try {
+      ActionReader::UDPReadAction(
+        i_packet->data, i_packet->len, &m_preAllocatedNA);
+      if (m_preAllocatedNA.master->actionType() == TNA_udpBind) {
+        for (unsigned int i = 0; i < m_clients.size(); i++) {
+          if (m_clients[i]->isUdpBinded() == false) {
+            if (m_clients[i]->udpBindKey() ==
+                ((NA_udpBind *)m_preAllocatedNA.master)->key()) {
+              // LogInfo("UDP bind key received via UDP: %s",
+              // ((NA_udpBind*)v_netAction)->key().c_str());
+              m_clients[i]->bindUdp(i_packet->address);
+              if (m_clients[i]->protocolVersion() >=
+                  3) { // don't send if the version is lower because the
+                // client will not understand -- udp could not work in
+                // that case
+                LogInfo("server: i can receive udp from the client %i", i);
+
+                NA_udpBindValidation nabv;
+                try {
+                  sendToClient(&nabv, i, -1, 0);
+                } catch (Exception &e) {
+                }
 
-                  NA_udpBind nab("XMS");
-                  try {
-                    // send the packet 3 times to get more change it arrives
-                    for (unsigned int j = 0; j < 3; j++) {
-                      sendToClient(&nab, i, -1, 0, true);
-                    }
-                  } catch (Exception &e) {
+                NA_udpBind nab("XMS");
+                try {
+                  // send the packet 3 times to get more change it arrives
+                  for (unsigned int j = 0; j < 3; j++) {
+                    sendToClient(&nab, i, -1, 0, true);
                   }
+                } catch (Exception &e) {
                 }
-                break; // stop : only one client
               }
+              break; // stop : only one client
             }
           }
-        } else {
-          LogWarning("Packet of unknown client received");
         }
-      } catch (Exception &e) {
-        m_unmanagedActions++;
-
-        /* forget this bad packet */
-        LogWarning("server: bad anonym UDP packet received by %s:%i",
-                   XMNet::getIp(&(m_udpPacket->address)).c_str(),
-                   SDLNet_Read16(&(m_udpPacket->address.port)));
+      } else {
+        LogWarning("Packet of unknown client received");
       }
+    } catch (Exception &e) {
+      m_unmanagedActions++;
+
+      /* forget this bad packet */
+      LogWarning("server: bad anonym UDP packet received by %s:%i",
+                 XMNet::getIp(&(i_packet->address)).c_str(),
+                 SDLNet_Read16(&(i_packet->address.port)));
     }
   }
 }
@@ -1511,6 +1884,20 @@ bool ServerThread::manageAction(NetAction *i_netAction, unsigned int i_client) {
       }
     } break;
 
+    case TNA_frameAck: {
+      const std::vector<NetFrameAck> &v_acks =
+        ((NA_frameAck *)i_netAction)->getAcks();
+
+      for (unsigned int i = 0; i < v_acks.size(); i++) {
+        m_clients[i_client]->ackFrame(
+          v_acks[i].Src, v_acks[i].SubSrc, v_acks[i].Seq);
+      }
+    } break;
+
+    case TNA_frameDelta:
+      /* should not happend */
+      break;
+
     case TNA_changeName: {
       m_clients[i_client]->setName(((NA_changeName *)i_netAction)->getName());
       if (m_clients[i_client]->name() == "") {
@@ -1703,6 +2090,8 @@ void ServerThread::manageSrvCmd(unsigned int i_client,
       v_answer += "ping <all|id player>: information about player network "
                   "connection to the server\n";
       v_answer += "stats: server statistics\n";
+      v_answer += "ticks [reset]: time spent in each phase of the server "
+                  "ticks\n";
       v_answer += "msg <msg>: message to players\n";
     }
 
@@ -2048,6 +2437,13 @@ void ServerThread::manageSrvCmd(unsigned int i_client,
                "-------------");
       v_answer += v_line;
 
+      snprintf(v_line,
+               256,
+               "frame lateness : %i ms (max %i ms)\n",
+               m_frameLate,
+               m_frameLateMax);
+      v_answer += v_line;
+
       std::ostringstream v_nup;
       v_answer += "unmanaged packets : ";
       v_nup << m_unmanagedActions;
@@ -2063,6 +2459,16 @@ void ServerThread::manageSrvCmd(unsigned int i_client,
       v_answer += System::getMemoryInfo();
     }
 
+  } else if (v_args[0] == "ticks") {
+    if (v_args.size() == 1) {
+      v_answer += m_tickStats.summary();
+    } else if (v_args.size() == 2 && v_args[1] == "reset") {
+      m_tickStats.reset();
+      v_answer += "ticks stats reset\n";
+    } else {
+      v_answer += "ticks: invalid arguments\n";
+    }
+
   } else if (v_args[0] == "msg") {
     if (v_args.size() < 2) {
       v_answer += "msg: invalid arguments\n";
@@ -2206,6 +2612,10 @@ ServerRules *ServerThread::getRules() {
   return m_rules;
 }
 
+ServerTickStats *ServerThread::getTickStats() {
+  return &m_tickStats;
+}
+
 Universe *ServerThread::getUniverse() {
   return m_universe;
 }
@@ -2234,18 +2644,21 @@ void ServerThread::reloadRules(const std::string &i_rulesFile) {
   }
 }
 
-XMServerSceneHooks::XMServerSceneHooks(ServerThread *i_st) {
+XMServerSceneHooks::XMServerSceneHooks(ServerThread *i_st,
+                                       unsigned int i_numScene) {
   m_server = i_st;
+  m_numScene = i_numScene;
 }
 
 XMServerSceneHooks::~XMServerSceneHooks() {}
 
 void XMServerSceneHooks::OnEntityToTakeTakenByPlayer(unsigned int i_player) {
-  // only one scene is managed on the server -- for the moment
-  NetSClient *v_client = m_server->getNetSClientByScenePlayer(0, i_player);
+  NetSClient *v_client =
+    m_server->getNetSClientByScenePlayer(m_numScene, i_player);
 
   if (v_client != NULL) {
     try {
+      ServerTickPhaseScope v_phase(m_server->getTickStats(), STP_SCRIPT);
       m_server->getRules()->scriptCallVoidNumberArg(
         "Round_whenPlayer_onEntityToTakeTaken", v_client->id());
     } catch (Exception &e) {
@@ -2257,6 +2670,7 @@ void XMServerSceneHooks::OnEntityToTakeTakenByPlayer(unsigned int i_player) {
 
 void XMServerSceneHooks::OnEntityToTakeTakenExternal() {
   try {
+    ServerTickPhaseScope v_phase(m_server->getTickStats(), STP_SCRIPT);
     m_server->getRules()->scriptCallVoid(
       "Round_whenExternal_onEntityToTakeTaken");
   } catch (Exception &e) {
@@ -2266,11 +2680,12 @@ void XMServerSceneHooks::OnEntityToTakeTakenExternal() {
 }
 
 void XMServerSceneHooks::OnPlayerWins(unsigned int i_player) {
-  // only one scene is managed on the server -- for the moment
-  NetSClient *v_client = m_server->getNetSClientByScenePlayer(0, i_player);
+  NetSClient *v_client =
+    m_server->getNetSClientByScenePlayer(m_numScene, i_player);
 
   if (v_client != NULL) {
     try {
+      ServerTickPhaseScope v_phase(m_server->getTickStats(), STP_SCRIPT);
       m_server->getRules()->scriptCallVoidNumberArg("Round_whenPlayer_wins",
                                                     v_client->id());
     } catch (Exception &e) {
@@ -2281,11 +2696,12 @@ void XMServerSceneHooks::OnPlayerWins(unsigned int i_player) {
 }
 
 void XMServerSceneHooks::OnPlayerDies(unsigned int i_player) {
-  // only one scene is managed on the server -- for the moment
-  NetSClient *v_client = m_server->getNetSClientByScenePlayer(0, i_player);
+  NetSClient *v_client =
+    m_server->getNetSClientByScenePlayer(m_numScene, i_player);
 
   if (v_client != NULL) {
     try {
+      ServerTickPhaseScope v_phase(m_server->getTickStats(), STP_SCRIPT);
       m_server->getRules()->scriptCallVoidNumberArg("Round_whenPlayer_dies",
                                                     v_client->id());
     } catch (Exception &e) {
@@ -2297,11 +2713,12 @@ void XMServerSceneHooks::OnPlayerDies(unsigned int i_player) {
 
 void XMServerSceneHooks::OnPlayerSomersault(unsigned int i_player,
                                             bool i_counterclock) {
-  // only one scene is managed on the server -- for the moment
-  NetSClient *v_client = m_server->getNetSClientByScenePlayer(0, i_player);
+  NetSClient *v_client =
+    m_server->getNetSClientByScenePlayer(m_numScene, i_player);
 
   if (v_client != NULL) {
     try {
+      ServerTickPhaseScope v_phase(m_server->getTickStats(), STP_SCRIPT);
       m_server->getRules()->scriptCallVoidNumberArg(
         "Round_whenPlayer_DoesASomersault",
         v_client->id(),
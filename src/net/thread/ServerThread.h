@@ -22,19 +22,32 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define __SERVERTHREAD_H__
 
 #include "../../include/xm_SDL_net.h"
+#include "../../include/xm_hashmap.h"
 #include "../../thread/XMThread.h"
 #include "../../xmscene/Scene.h"
 #include "../BasicStructures.h"
 #include "../NetActions.h"
+#include "../NetRelevanceGrid.h"
+#include "ServerTickStats.h"
 #include <vector>
 
 class ActionReader;
+class NetSocketPoller;
+class NetUDPSendQueue;
 class NetAction;
+class NetBroadcast;
 class Universe;
 class DBuffer;
 class ServerRules;
 class XMServerSceneHooks;
 
+// how often the frames of a player are sent to an other one
+enum ServerP2FrameTier {
+  SP2_FRAMETIER_NEAR,
+  SP2_FRAMETIER_FAR,
+  SP2_FRAMETIER_VERYFAR
+};
+
 enum ServerP2Phase {
   SP2_PHASE_NONE,
   SP2_PHASE_WAIT_CLIENTS,
@@ -102,6 +115,11 @@ public:
 
   NetPing *lastPing();
 
+  // delta frames sent to the client, one history per player
+  NetFrameHistory *frameHistory(int i_src, int i_subsrc); // created if needed
+  void ackFrame(int i_src, int i_subsrc, unsigned short i_seq);
+  void clearFrameHistories(); // the numbering of the frames goes on
+
 private:
   unsigned int m_id; // uniq id of the client
   NetClientMode m_mode; // playing mode (simple ghost or slave)
@@ -128,6 +146,7 @@ private:
   // this is your name at the moment you login
   int m_lastGhostFrameTime;
   NetPing m_lastPing;
+  HashNamespace::unordered_map<int, NetFrameHistory *> m_frameHistories;
 };
 
 class ServerThread : public XMThread {
@@ -148,12 +167,16 @@ public:
   NetSClient *getNetSClientById(unsigned int i_id) const;
   Universe *getUniverse(); // NULL if no party is currently playing
   ServerRules *getRules();
+  ServerTickStats *getTickStats();
   void sendPointsToSlavePlayers();
 
 private:
   TCPsocket m_tcpsd;
   UDPsocket m_udpsd;
-  UDPpacket *m_udpPacket;
+  UDPpacket *m_udpPacket; // to send
+  UDPpacket **m_udpPackets; // received together
+  NetUDPSendQueue *m_udpSendQueue; // datagrams of the current tick
+  bool m_udpSendQueueing;
   unsigned int m_nextClientId;
   NetActionU m_preAllocatedNA;
 
@@ -165,29 +188,43 @@ private:
   ServerP2Phase m_sp2phase;
   int m_lastPhysTime;
   int m_lastFrameTimeStamp;
-  int m_frameLate;
+  int m_frameLate; // ms the physics is late on the real time
+  int m_frameLateMax;
+  ServerTickStats m_tickStats;
+  unsigned long long m_lastTickStatsDump;
   int m_currentFrame;
   int m_sceneStartTime;
   int m_lastPrepareToGoAlert;
   int m_firstFrameSent; // send the first frame only one time before the game
   // starts
 
-  unsigned int m_nFollowingUdp; // to avoid tcp famine
   std::string m_startTimeStr;
   std::string m_banner;
   bool m_acceptConnections;
   int m_unmanagedActions;
 
-  SDLNet_SocketSet m_set;
+  NetSocketPoller *m_poller;
+  std::vector<void *> m_readySockets; // tags given by the poller
   std::vector<NetSClient *> m_clients;
   ServerRules *m_rules;
   bool m_needToReloadRules; // rules are reloaded only when out of a round, not
   // immediatly when requested
-  XMServerSceneHooks *m_sceneHook;
+  std::vector<XMServerSceneHooks *> m_sceneHooks; // one per scene
+
+  // positions of the alive players, rebuilt at each frame sending
+  std::vector<NetRelevanceGrid> m_relevanceGrids; // one per scene
+  std::vector<std::vector<unsigned int> > m_deadClients; // one per scene
+  std::vector<unsigned int> m_relevanceIds;
+  // clients getting the frames of a player more often than the very far ones
+  std::vector<unsigned int> m_frameReceivers;
+  std::vector<ServerP2FrameTier> m_frameReceiversTiers;
+  std::vector<ServerP2FrameTier> m_frameTiers; // indexed by client
 
   void acceptClient();
   bool manageClientTCP(unsigned int i);
-  void manageClientUDP();
+  void manageClientsUDP(); // all the waiting datagrams
+  void manageClientUDP(UDPpacket *i_packet);
+  void manageClientReadyTCP(NetSClient *i_client);
 
   // return false if the client must be deconnected
   bool manageAction(NetAction *i_netAction, unsigned int i_client);
@@ -198,7 +235,8 @@ private:
   // manageNetwork helper :
   bool manageNetworkOnePacket(int i_timeout); // return true if there is
   // possibly something else to
-  // manage on network
+  // manage on network ; all the
+  // ready sockets are managed
 
   // if i_execpt >= 0, send to all exept him
   void sendToAllClients(NetAction *i_netAction,
@@ -232,6 +270,16 @@ private:
                     int i_src,
                     int i_subsrc,
                     bool i_forceUdp = false);
+  // broadcast helper : the action is encoded once per framing, then the same
+  // bytes are sent to each client
+  void sendToClient(NetBroadcast *i_broadcast, unsigned int i);
+  void flushUDPSendQueue(); // and stop queueing
+  bool clientUsesBinaryFraming(unsigned int i) const;
+  bool clientUsesFrameDelta(unsigned int i) const;
+  void sendFrameDeltaToClient(const SerializedBikeState &i_state,
+                              unsigned int i,
+                              int i_src,
+                              int i_subsrc);
   void sendMsgToClient(unsigned int i_client, const std::string &i_msg);
   void removeClient(unsigned int i);
   unsigned int nbClientsInMode(NetClientMode i_mode);
@@ -248,6 +296,17 @@ private:
   bool SP2_managePreplayTime();
   std::string SP2_determineLevel();
   void SP2_sendSceneEvents(DBuffer *i_buffer);
+  void SP2_buildRelevanceGrids();
+  // fill m_frameReceivers, from the players around and the dead ones only
+  void SP2_computeFrameReceivers(unsigned int i_client);
+  static bool isFrameDue(ServerP2FrameTier i_tier,
+                         bool i_sendNear,
+                         bool i_sendFar,
+                         bool i_sendVeryFar);
+  void SP2_sendOtherPlayerFrame(const SerializedBikeState &i_state,
+                                NetBroadcast *i_broadcast,
+                                unsigned int i_sender,
+                                unsigned int i_receiver);
   bool m_sp2_gameStarted;
   int m_sp2_lastLoopTime;
   int m_sp2_lastLoopDelta;
@@ -265,7 +324,7 @@ private:
 
 class XMServerSceneHooks : public SceneHooks {
 public:
-  XMServerSceneHooks(ServerThread *i_st);
+  XMServerSceneHooks(ServerThread *i_st, unsigned int i_numScene);
   virtual ~XMServerSceneHooks();
 
   void OnEntityToTakeTakenByPlayer(unsigned int i_player);
@@ -276,6 +335,7 @@ public:
 
 private:
   ServerThread *m_server;
+  unsigned int m_numScene;
 };
 
 #endif
@@ -0,0 +1,293 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "ServerTickStats.h"
+#include "helpers/Log.h"
+#include "helpers/System.h"
+#include <stdio.h>
+#include <time.h>
+
+static const unsigned long long g_bucketBounds[XM_SERVER_TICK_NB_BUCKETS] = {
+  50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 0
+};
+
+ServerTickHistogram::ServerTickHistogram() {
+  reset();
+}
+
+void ServerTickHistogram::reset() {
+  m_nbTicks = 0;
+  m_sum = 0;
+  m_max = 0;
+  for (unsigned int i = 0; i < XM_SERVER_TICK_NB_BUCKETS; i++) {
+    m_buckets[i] = 0;
+  }
+}
+
+void ServerTickHistogram::add(unsigned long long i_us) {
+  unsigned int i = 0;
+
+  while (i < XM_SERVER_TICK_NB_BUCKETS - 1 && i_us >= g_bucketBounds[i]) {
+    i++;
+  }
+  m_buckets[i]++;
+
+  m_nbTicks++;
+  m_sum += i_us;
+  if (i_us > m_max) {
+    m_max = i_us;
+  }
+}
+
+unsigned int ServerTickHistogram::nbTicks() const {
+  return m_nbTicks;
+}
+
+unsigned long long ServerTickHistogram::average() const {
+  if (m_nbTicks == 0) {
+    return 0;
+  }
+  return m_sum / m_nbTicks;
+}
+
+unsigned long long ServerTickHistogram::maximum() const {
+  return m_max;
+}
+
+unsigned long long ServerTickHistogram::percentile(
+  unsigned int i_percent) const {
+  unsigned long long v_rank;
+  unsigned long long v_n = 0;
+
+  if (m_nbTicks == 0) {
+    return 0;
+  }
+
+  // rank of the tick, rounded up
+  v_rank = ((unsigned long long)m_nbTicks * i_percent + 99) / 100;
+  for (unsigned int i = 0; i < XM_SERVER_TICK_NB_BUCKETS - 1; i++) {
+    v_n += m_buckets[i];
+    if (v_n >= v_rank) {
+      // the max is more accurate than the bound for the last ticks
+      return g_bucketBounds[i] < m_max ? g_bucketBounds[i] : m_max;
+    }
+  }
+  return m_max;
+}
+
+unsigned int ServerTickHistogram::bucket(unsigned int i) const {
+  return m_buckets[i];
+}
+
+unsigned long long ServerTickHistogram::bucketBound(unsigned int i) {
+  return g_bucketBounds[i];
+}
+
+ServerTickStats::ServerTickStats()
+  : m_timer(STP_NB_PHASES, STP_OTHER) {
+  reset();
+}
+
+ServerTickStats::~ServerTickStats() {}
+
+void ServerTickStats::reset() {
+  for (unsigned int i = 0; i < STP_NB_PHASES + 1; i++) {
+    m_histograms[i].reset();
+    m_periodHistograms[i].reset();
+  }
+  m_overBudget = 0;
+  m_periodOverBudget = 0;
+  m_periodStart = System::getTimeUs();
+}
+
+void ServerTickStats::beginTick() {
+  m_timer.start();
+}
+
+void ServerTickStats::endTick() {
+  if (m_timer.isRunning() == false) {
+    return;
+  }
+  m_timer.stop();
+
+  addTick(m_histograms, m_overBudget);
+  addTick(m_periodHistograms, m_periodOverBudget);
+}
+
+void ServerTickStats::addTick(ServerTickHistogram *io_histograms,
+                              unsigned int &io_overBudget) {
+  unsigned long long v_busy = 0;
+
+  for (unsigned int i = 0; i < STP_NB_PHASES; i++) {
+    io_histograms[i].add(m_timer.time(i));
+    if (i != STP_IDLE) {
+      v_busy += m_timer.time(i);
+    }
+  }
+  io_histograms[STP_NB_PHASES].add(v_busy);
+
+  if (v_busy > XM_SERVER_TICK_BUDGET) {
+    io_overBudget++;
+  }
+}
+
+std::string ServerTickStats::phaseName(ServerTickPhase i_phase) {
+  switch (i_phase) {
+    case STP_PHYSICS:
+      return "physics";
+    case STP_SCRIPT:
+      return "script";
+    case STP_EVENTS:
+      return "events";
+    case STP_NETWORK:
+      return "network";
+    case STP_IDLE:
+      return "idle";
+    case STP_OTHER:
+      return "other";
+    default:
+      return "busy"; // the whole tick, idle excepted
+  }
+}
+
+std::string ServerTickStats::summary() const {
+  std::string v_answer;
+  char v_line[256];
+
+  snprintf(v_line,
+           256,
+           "ticks : %u (%u over the %i us budget)\n",
+           m_histograms[STP_NB_PHASES].nbTicks(),
+           m_overBudget,
+           XM_SERVER_TICK_BUDGET);
+  v_answer += v_line;
+
+  snprintf(v_line,
+           256,
+           "| %7s | %7s | %7s | %7s | %7s |\n",
+           "us",
+           "avg",
+           "p50",
+           "p99",
+           "max");
+  v_answer += v_line;
+  for (unsigned int i = 0; i < STP_NB_PHASES + 1; i++) {
+    snprintf(v_line,
+             256,
+             "| %7s | %7llu | %7llu | %7llu | %7llu |\n",
+             phaseName((ServerTickPhase)i).c_str(),
+             m_histograms[i].average(),
+             m_histograms[i].percentile(50),
+             m_histograms[i].percentile(99),
+             m_histograms[i].maximum());
+    v_answer += v_line;
+  }
+
+  // distribution of the busy time
+  v_answer += "busy :";
+  for (unsigned int i = 0; i < XM_SERVER_TICK_NB_BUCKETS; i++) {
+    if (ServerTickHistogram::bucketBound(i) != 0) {
+      snprintf(v_line,
+               256,
+               " <%llu:%u",
+               ServerTickHistogram::bucketBound(i),
+               m_histograms[STP_NB_PHASES].bucket(i));
+    } else {
+      snprintf(v_line, 256, " more:%u", m_histograms[STP_NB_PHASES].bucket(i));
+    }
+    v_answer += v_line;
+  }
+  v_answer += "\n";
+
+  return v_answer;
+}
+
+void ServerTickStats::dumpPeriod(const std::string &i_csvFile) {
+  const ServerTickHistogram &v_busy = m_periodHistograms[STP_NB_PHASES];
+  FILE *v_fd;
+
+  LogInfo("server: %u ticks, %u over budget, busy avg %llu us, p99 %llu us, "
+          "max %llu us (physics %llu, script %llu, events %llu, network %llu)",
+          v_busy.nbTicks(),
+          m_periodOverBudget,
+          v_busy.average(),
+          v_busy.percentile(99),
+          v_busy.maximum(),
+          m_periodHistograms[STP_PHYSICS].average(),
+          m_periodHistograms[STP_SCRIPT].average(),
+          m_periodHistograms[STP_EVENTS].average(),
+          m_periodHistograms[STP_NETWORK].average());
+
+  if (i_csvFile != "") {
+    v_fd = fopen(i_csvFile.c_str(), "a");
+    if (v_fd == NULL) {
+      LogWarning("Unable to open %s", i_csvFile.c_str());
+    } else {
+      // header only for a new file
+      fseek(v_fd, 0, SEEK_END);
+      if (ftell(v_fd) == 0) {
+        fprintf(v_fd, "time,duration_ms,ticks,over_budget");
+        for (unsigned int i = 0; i < STP_NB_PHASES + 1; i++) {
+          std::string v_name = phaseName((ServerTickPhase)i);
+          fprintf(v_fd,
+                  ",%s_avg,%s_p50,%s_p99,%s_max",
+                  v_name.c_str(),
+                  v_name.c_str(),
+                  v_name.c_str(),
+                  v_name.c_str());
+        }
+        for (unsigned int i = 0; i < XM_SERVER_TICK_NB_BUCKETS; i++) {
+          if (ServerTickHistogram::bucketBound(i) != 0) {
+            fprintf(v_fd, ",busy_lt%llu", ServerTickHistogram::bucketBound(i));
+          } else {
+            fprintf(v_fd, ",busy_more");
+          }
+        }
+        fprintf(v_fd, "\n");
+      }
+
+      fprintf(v_fd,
+              "%lu,%llu,%u,%u",
+              (unsigned long)time(NULL),
+              (System::getTimeUs() - m_periodStart) / 1000,
+              v_busy.nbTicks(),
+              m_periodOverBudget);
+      for (unsigned int i = 0; i < STP_NB_PHASES + 1; i++) {
+        fprintf(v_fd,
+                ",%llu,%llu,%llu,%llu",
+                m_periodHistograms[i].average(),
+                m_periodHistograms[i].percentile(50),
+                m_periodHistograms[i].percentile(99),
+                m_periodHistograms[i].maximum());
+      }
+      for (unsigned int i = 0; i < XM_SERVER_TICK_NB_BUCKETS; i++) {
+        fprintf(v_fd, ",%u", v_busy.bucket(i));
+      }
+      fprintf(v_fd, "\n");
+      fclose(v_fd);
+    }
+  }
+
+  for (unsigned int i = 0; i < STP_NB_PHASES + 1; i++) {
+    m_periodHistograms[i].reset();
+  }
+  m_periodOverBudget = 0;
+  m_periodStart = System::getTimeUs();
+}
@@ -0,0 +1,115 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __SERVERTICKSTATS_H__
+#define __SERVERTICKSTATS_H__
+
+#include "helpers/PhaseTimer.h"
+#include <string>
+
+#define XM_SERVER_TICK_BUDGET 10000 // us, one physics step
+#define XM_SERVER_TICK_NB_BUCKETS 12
+
+// where the time of a server tick goes ; a time is charged to one phase only
+enum ServerTickPhase {
+  STP_PHYSICS, // scenes update
+  STP_SCRIPT, // rules (lua) calls
+  STP_EVENTS, // events and frames serialization
+  STP_NETWORK, // reading the received packets, sending the queued ones
+  STP_IDLE, // waiting for the network
+  STP_OTHER,
+  STP_NB_PHASES
+};
+
+/*
+  distribution of a time per tick, in buckets of growing size (50us, 100us,
+  200us, 500us, ...)
+*/
+class ServerTickHistogram {
+public:
+  ServerTickHistogram();
+
+  void reset();
+  void add(unsigned long long i_us);
+
+  unsigned int nbTicks() const;
+  unsigned long long average() const;
+  unsigned long long maximum() const;
+  // upper bound of the bucket containing the i_percent percentile
+  unsigned long long percentile(unsigned int i_percent) const;
+  unsigned int bucket(unsigned int i) const;
+
+  static unsigned long long bucketBound(unsigned int i); // 0 for the last one
+
+private:
+  unsigned int m_nbTicks;
+  unsigned long long m_sum;
+  unsigned long long m_max;
+  unsigned int m_buckets[XM_SERVER_TICK_NB_BUCKETS];
+};
+
+/*
+  time spent by the server in each phase of a tick. Phases can be nested (a
+  rule called while the physics is updated) : the time is always charged to
+  the innermost one. Stats are kept since the start (or the last reset) and
+  since the last period dump.
+*/
+class ServerTickStats {
+public:
+  ServerTickStats();
+  ~ServerTickStats();
+
+  void beginTick();
+  void endTick(); // commit the times of the tick into the histograms
+  PhaseTimer *timer() { return &m_timer; }
+
+  void reset();
+
+  // table of the stats since the start
+  std::string summary() const;
+
+  // log the stats of the period and append them to i_csvFile if not empty ;
+  // then start a new period
+  void dumpPeriod(const std::string &i_csvFile);
+
+  static std::string phaseName(ServerTickPhase i_phase);
+
+private:
+  void addTick(ServerTickHistogram *io_histograms,
+               unsigned int &io_overBudget);
+
+  PhaseTimer m_timer; // times of the current tick
+
+  // STP_NB_PHASES is the whole tick, idle excepted
+  ServerTickHistogram m_histograms[STP_NB_PHASES + 1];
+  ServerTickHistogram m_periodHistograms[STP_NB_PHASES + 1];
+  unsigned int m_overBudget;
+  unsigned int m_periodOverBudget;
+  unsigned long long m_periodStart;
+};
+
+// charge the time of its scope to a phase of the current tick
+class ServerTickPhaseScope : public PhaseTimerScope {
+public:
+  ServerTickPhaseScope(ServerTickStats *i_stats, ServerTickPhase i_phase)
+    : PhaseTimerScope(i_stats->timer(), i_phase) {}
+};
+
+#endif
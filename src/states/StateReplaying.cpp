@@ -28,6 +28,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "helpers/Text.h"
 #include "xmoto/Game.h"
 #include "xmoto/GameText.h"
+#include "xmoto/RenderBenchmark.h"
 #include "xmoto/Renderer.h"
 #include "xmoto/SysMessage.h"
 #include "xmoto/Trainer.h"
@@ -59,6 +60,10 @@ void StateReplaying::enter() {
 
   m_stopToUpdate = false;
 
+  if (XMSession::instance()->benchmark()) {
+    RenderBenchmark::instance()->beginReplay(m_replay);
+  }
+
   if (m_renderer != NULL) {
     m_renderer->setShowEngineCounter(false);
 
@@ -97,6 +102,23 @@ void StateReplaying::enter() {
       }
     }
 
+    // jump where the video starts instead of replaying until there
+    if (m_universe != NULL &&
+        XMSession::instance()->enableVideoRecording() &&
+        XMSession::instance()->videoRecordingStartTime() > 0) {
+      for (unsigned int i = 0; i < m_universe->getScenes().size(); i++) {
+        Scene *v_scene = m_universe->getScenes()[i];
+        if (v_scene->getLevelSrc()->isScripted() == false &&
+            v_scene->getLevelSrc()->isPhysics() == false &&
+            v_scene->getTime() <
+              XMSession::instance()->videoRecordingStartTime()) {
+          v_scene->fastforward(
+            XMSession::instance()->videoRecordingStartTime() -
+            v_scene->getTime());
+        }
+      }
+    }
+
     // music
     playLevelMusic();
 
@@ -132,14 +154,26 @@ bool StateReplaying::update() {
     m_stopToUpdate = true;
 
     if (XMSession::instance()->benchmark()) {
-      m_requestForEnd = true;
-      closePlaying();
+      std::string v_nextReplay;
+
+      RenderBenchmark::instance()->endReplay();
       printf(" * %i frames rendered in %.2f seconds\n",
              m_benchmarkNbFrame,
              GameApp::getXMTime() - m_benchmarkStartTime);
       printf(" * Average framerate: %.2f fps\n",
              ((double)m_benchmarkNbFrame) /
                (GameApp::getXMTime() - m_benchmarkStartTime));
+
+      v_nextReplay = RenderBenchmark::instance()->nextReplay();
+      closePlaying();
+      if (v_nextReplay != "") {
+        StateManager::instance()->replaceState(
+          new StatePreplayingReplay(v_nextReplay, false), getStateId());
+      } else {
+        RenderBenchmark::instance()->report(
+          XMSession::instance()->benchmarkOutput());
+        m_requestForEnd = true;
+      }
     }
   }
 
@@ -34,6 +34,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "xmoto/Game.h"
 #include "xmoto/GameText.h"
 #include "xmoto/PhysSettings.h"
+#include "xmoto/RenderBenchmark.h"
 #include "xmoto/Renderer.h"
 #include "xmoto/Replay.h"
 #include "xmoto/SysMessage.h"
@@ -200,10 +201,17 @@ bool StateScene::update() {
     return false;
   }
 
+  /* a benchmarked frame is an update followed by its rendering */
+  if (RenderBenchmark::isRecording()) {
+    RenderBenchmark::instance()->nextFrame();
+  }
+
   try {
     int nPhysSteps = 0;
 
     if (isLockedScene() == false) {
+      RenderBenchmarkScope v_benchmarkScope(RBP_UPDATE);
+
       // don't update if that's not required
       // don't do this infinitely, maximum miss 10 frames, then give up
       // in videoRecording mode, don't try to do more to allow to record at a
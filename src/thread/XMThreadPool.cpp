@@ -0,0 +1,142 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "XMThreadPool.h"
+#include "helpers/Log.h"
+#include "include/xm_SDL.h"
+
+XMThreadPool::XMThreadPool(unsigned int i_nbThreads) {
+  m_nbRunningTasks = 0;
+  m_askToEnd = false;
+  m_mutex = SDL_CreateMutex();
+  m_taskCond = SDL_CreateCond();
+  m_doneCond = SDL_CreateCond();
+
+  if (i_nbThreads < 1) {
+    i_nbThreads = 1;
+  }
+
+  for (unsigned int i = 0; i < i_nbThreads; i++) {
+    SDL_Thread *v_thread = SDL_CreateThread(&XMThreadPool::run, this);
+    if (v_thread == NULL) {
+      LogWarning("Unable to create a pool thread (%s)", SDL_GetError());
+      break;
+    }
+    m_threads.push_back(v_thread);
+  }
+}
+
+XMThreadPool::~XMThreadPool() {
+  SDL_LockMutex(m_mutex);
+  m_askToEnd = true;
+  SDL_CondBroadcast(m_taskCond);
+  SDL_UnlockMutex(m_mutex);
+
+  for (unsigned int i = 0; i < m_threads.size(); i++) {
+    SDL_WaitThread(m_threads[i], NULL);
+  }
+
+  SDL_DestroyCond(m_doneCond);
+  SDL_DestroyCond(m_taskCond);
+  SDL_DestroyMutex(m_mutex);
+}
+
+unsigned int XMThreadPool::nbThreads() const {
+  return m_threads.size();
+}
+
+void XMThreadPool::addTask(XMThreadPoolTask *i_task) {
+  // no worker could be created, run it in the caller thread
+  if (m_threads.size() == 0) {
+    i_task->m_executed = false;
+    i_task->execute();
+    i_task->m_executed = true;
+    return;
+  }
+
+  SDL_LockMutex(m_mutex);
+  i_task->m_executed = false;
+  m_tasks.push_back(i_task);
+  SDL_CondSignal(m_taskCond);
+  SDL_UnlockMutex(m_mutex);
+}
+
+void XMThreadPool::waitTasks() {
+  SDL_LockMutex(m_mutex);
+  while (m_tasks.empty() == false || m_nbRunningTasks != 0) {
+    SDL_CondWait(m_doneCond, m_mutex);
+  }
+  SDL_UnlockMutex(m_mutex);
+}
+
+void XMThreadPool::waitTask(XMThreadPoolTask *i_task) {
+  SDL_LockMutex(m_mutex);
+  while (i_task->m_executed == false) {
+    SDL_CondWait(m_doneCond, m_mutex);
+  }
+  SDL_UnlockMutex(m_mutex);
+}
+
+bool XMThreadPool::isTaskExecuted(XMThreadPoolTask *i_task) {
+  bool v_executed;
+
+  SDL_LockMutex(m_mutex);
+  v_executed = i_task->m_executed;
+  SDL_UnlockMutex(m_mutex);
+
+  return v_executed;
+}
+
+int XMThreadPool::run(void *i_pool) {
+  XMThreadPool *v_pool = reinterpret_cast<XMThreadPool *>(i_pool);
+
+  return v_pool->workerFunction();
+}
+
+int XMThreadPool::workerFunction() {
+  XMThreadPoolTask *v_task;
+
+  SDL_LockMutex(m_mutex);
+  while (true) {
+    while (m_tasks.empty() && m_askToEnd == false) {
+      SDL_CondWait(m_taskCond, m_mutex);
+    }
+
+    // pending tasks are still run when the pool ends
+    if (m_tasks.empty()) {
+      break;
+    }
+
+    v_task = m_tasks.front();
+    m_tasks.pop_front();
+    m_nbRunningTasks++;
+    SDL_UnlockMutex(m_mutex);
+
+    v_task->execute();
+
+    SDL_LockMutex(m_mutex);
+    v_task->m_executed = true;
+    m_nbRunningTasks--;
+    SDL_CondBroadcast(m_doneCond);
+  }
+  SDL_UnlockMutex(m_mutex);
+
+  return 0;
+}
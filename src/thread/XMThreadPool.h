@@ -0,0 +1,81 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __XMTHREADPOOL_H__
+#define __XMTHREADPOOL_H__
+
+#include <deque>
+#include <vector>
+
+struct SDL_Thread;
+struct SDL_mutex;
+struct SDL_cond;
+
+/**
+ * a unit of work executed by a XMThreadPool worker. The pool never deletes the
+ * tasks ; execute() must not throw, the task keeps its own error state.
+ */
+class XMThreadPoolTask {
+public:
+  XMThreadPoolTask() { m_executed = false; }
+  virtual ~XMThreadPoolTask(){};
+  virtual void execute() = 0;
+
+private:
+  friend class XMThreadPool;
+  bool m_executed; // protected by the pool mutex
+};
+
+/**
+ * fixed size set of SDL worker threads. Unlike XMThread, workers don't own a
+ * database connection : they are meant for cpu bound jobs (physics, parsing).
+ */
+class XMThreadPool {
+public:
+  XMThreadPool(unsigned int i_nbThreads);
+  ~XMThreadPool();
+
+  unsigned int nbThreads() const;
+
+  // queue a task ; it can be run at once by any worker
+  void addTask(XMThreadPoolTask *i_task);
+  // block until all the queued tasks are executed
+  void waitTasks();
+  // block until this task is executed
+  void waitTask(XMThreadPoolTask *i_task);
+  bool isTaskExecuted(XMThreadPoolTask *i_task);
+
+  // don't use it
+  static int run(void *i_pool);
+
+private:
+  int workerFunction();
+
+  std::vector<SDL_Thread *> m_threads;
+  std::deque<XMThreadPoolTask *> m_tasks;
+  unsigned int m_nbRunningTasks;
+  bool m_askToEnd;
+
+  SDL_mutex *m_mutex;
+  SDL_cond *m_taskCond; // a task is available or the pool is ending
+  SDL_cond *m_doneCond; // a task is finished
+};
+
+#endif
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *  Collision detection.
  */
 #include "Collision.h"
+#include "CollisionFilter.h"
 #include "PhysSettings.h"
 #include "xmscene/Block.h"
 #include "xmscene/Entity.h"
@@ -54,8 +55,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
   (v).clear()
 
 CollisionSystem::CollisionSystem() {
-  m_pGrid = NULL;
   m_bDebugFlag = false;
+  m_bGridCompiled = false;
+  m_nGridWidth = m_nGridHeight = 0;
 }
 
 CollisionSystem::~CollisionSystem() {
@@ -67,15 +69,25 @@ Reset collision system
 ===========================================================================*/
 void CollisionSystem::reset(void) {
   /* Free everything */
-  if (m_pGrid != NULL) {
-    delete[] m_pGrid;
-    m_pGrid = NULL;
-  }
+  m_gridOffsets.clear();
+  m_gridX1.clear();
+  m_gridY1.clear();
+  m_gridX2.clear();
+  m_gridY2.clear();
+  m_gridGrip.clear();
+  m_gridLines.clear();
+  m_gridMinX.clear();
+  m_gridMinY.clear();
+  m_gridMaxX.clear();
+  m_gridMaxY.clear();
+  m_gridCandidates.clear();
+  m_bGridCompiled = false;
 
   EMPTY_AND_CLEAR_VECTOR(m_Lines);
 
   m_entitiesHandler.reset();
   m_dynBlocksHandler.reset();
+  m_queuedDynBlocks.clear();
   /* TODO::zone
   m_zonesHandler.reset();
   */
@@ -117,8 +129,8 @@ void CollisionSystem::setDims(float fMinX,
   m_fMaxX = fMaxX;
   m_fMaxY = fMaxY;
 
-  /* Allocate grid structure */
-  m_pGrid = new GridCell[m_nGridWidth * m_nGridHeight];
+  /* the grid is filled once the lines are defined */
+  m_bGridCompiled = false;
 
   m_entitiesHandler.setDims(Vector2f(m_fMinX, m_fMinY),
                             Vector2f(m_fMaxX, m_fMaxY),
@@ -166,12 +178,6 @@ void CollisionSystem::defineLine(float x1,
                                  float x2,
                                  float y2,
                                  float grip) {
-  /* Define bounding box of line */
-  float fLineMinX = CD_MIN(x1, x2);
-  float fLineMinY = CD_MIN(y1, y2);
-  float fLineMaxX = CD_MAX(x1, x2);
-  float fLineMaxY = CD_MAX(y1, y2);
-
   /* Add line */
   Line *pNewLine = new Line;
   pNewLine->x1 = x1;
@@ -181,41 +187,161 @@ void CollisionSystem::defineLine(float x1,
   pNewLine->fGrip = grip;
   m_Lines.push_back(pNewLine);
 
-  /* Calculate cell coordinates */
-  int nMinCX =
-    (int)floor(((fLineMinX - m_fMinX - CD_EPSILON) * (float)m_nGridWidth) /
+  m_bGridCompiled = false;
+}
+
+/*===========================================================================
+Put the lines in the grid cells
+===========================================================================*/
+void CollisionSystem::_getCellsRange(float fMinX,
+                                     float fMinY,
+                                     float fMaxX,
+                                     float fMaxY,
+                                     int &o_nMinCX,
+                                     int &o_nMinCY,
+                                     int &o_nMaxCX,
+                                     int &o_nMaxCY) {
+  o_nMinCX =
+    (int)floor(((fMinX - m_fMinX - CD_EPSILON) * (float)m_nGridWidth) /
                (m_fMaxX - m_fMinX));
-  int nMinCY =
-    (int)floor(((fLineMinY - m_fMinY - CD_EPSILON) * (float)m_nGridHeight) /
+  o_nMinCY =
+    (int)floor(((fMinY - m_fMinY - CD_EPSILON) * (float)m_nGridHeight) /
                (m_fMaxY - m_fMinY));
-  int nMaxCX =
-    (int)floor(((fLineMaxX - m_fMinX + CD_EPSILON) * (float)m_nGridWidth) /
+  o_nMaxCX =
+    (int)floor(((fMaxX - m_fMinX + CD_EPSILON) * (float)m_nGridWidth) /
                (m_fMaxX - m_fMinX));
-  int nMaxCY =
-    (int)floor(((fLineMaxY - m_fMinY + CD_EPSILON) * (float)m_nGridHeight) /
+  o_nMaxCY =
+    (int)floor(((fMaxY - m_fMinY + CD_EPSILON) * (float)m_nGridHeight) /
                (m_fMaxY - m_fMinY));
 
-  if (nMinCX < 0)
-    nMinCX = 0;
-  if (nMinCY < 0)
-    nMinCY = 0;
-  if (nMaxCX > m_nGridWidth - 1)
-    nMaxCX = m_nGridWidth - 1;
-  if (nMaxCY > m_nGridHeight - 1)
-    nMaxCY = m_nGridHeight - 1;
+  if (o_nMinCX < 0)
+    o_nMinCX = 0;
+  if (o_nMinCY < 0)
+    o_nMinCY = 0;
+  if (o_nMaxCX > m_nGridWidth - 1)
+    o_nMaxCX = m_nGridWidth - 1;
+  if (o_nMaxCY > m_nGridHeight - 1)
+    o_nMaxCY = m_nGridHeight - 1;
+}
 
-  /* Add line to touched cells */
-  for (int cx = nMinCX; cx <= nMaxCX; cx++) {
-    for (int cy = nMinCY; cy <= nMaxCY; cy++) {
-      int i = cx + cy * m_nGridWidth;
+void CollisionSystem::compileGrid() {
+  unsigned int v_nbCells = m_nGridWidth * m_nGridHeight;
+  std::vector<unsigned int> v_fill;
+  int nMinCX, nMinCY, nMaxCX, nMaxCY;
+
+  if (m_bGridCompiled) {
+    return;
+  }
 
-      m_pGrid[i].Lines.push_back(pNewLine);
+  /* first count the lines of each cell, then place them ; the lines of a
+     cell keep the order in which they were defined */
+  m_gridOffsets.assign(v_nbCells + 1, 0);
+  for (unsigned int n = 0; n < m_Lines.size(); n++) {
+    Line *pLine = m_Lines[n];
+
+    /* the cells touched by the bounding box of the line */
+    _getCellsRange(CD_MIN(pLine->x1, pLine->x2),
+                   CD_MIN(pLine->y1, pLine->y2),
+                   CD_MAX(pLine->x1, pLine->x2),
+                   CD_MAX(pLine->y1, pLine->y2),
+                   nMinCX,
+                   nMinCY,
+                   nMaxCX,
+                   nMaxCY);
+    for (int cx = nMinCX; cx <= nMaxCX; cx++) {
+      for (int cy = nMinCY; cy <= nMaxCY; cy++) {
+        m_gridOffsets[cx + cy * m_nGridWidth + 1]++;
+      }
     }
   }
+  for (unsigned int i = 0; i < v_nbCells; i++) {
+    m_gridOffsets[i + 1] += m_gridOffsets[i];
+  }
+
+  m_gridX1.resize(m_gridOffsets[v_nbCells]);
+  m_gridY1.resize(m_gridOffsets[v_nbCells]);
+  m_gridX2.resize(m_gridOffsets[v_nbCells]);
+  m_gridY2.resize(m_gridOffsets[v_nbCells]);
+  m_gridGrip.resize(m_gridOffsets[v_nbCells]);
+  m_gridLines.resize(m_gridOffsets[v_nbCells]);
+  m_gridMinX.resize(m_gridOffsets[v_nbCells]);
+  m_gridMinY.resize(m_gridOffsets[v_nbCells]);
+  m_gridMaxX.resize(m_gridOffsets[v_nbCells]);
+  m_gridMaxY.resize(m_gridOffsets[v_nbCells]);
+
+  v_fill.assign(m_gridOffsets.begin(), m_gridOffsets.end() - 1);
+  for (unsigned int n = 0; n < m_Lines.size(); n++) {
+    Line *pLine = m_Lines[n];
+
+    _getCellsRange(CD_MIN(pLine->x1, pLine->x2),
+                   CD_MIN(pLine->y1, pLine->y2),
+                   CD_MAX(pLine->x1, pLine->x2),
+                   CD_MAX(pLine->y1, pLine->y2),
+                   nMinCX,
+                   nMinCY,
+                   nMaxCX,
+                   nMaxCY);
+    for (int cx = nMinCX; cx <= nMaxCX; cx++) {
+      for (int cy = nMinCY; cy <= nMaxCY; cy++) {
+        unsigned int k = v_fill[cx + cy * m_nGridWidth]++;
+
+        m_gridX1[k] = pLine->x1;
+        m_gridY1[k] = pLine->y1;
+        m_gridX2[k] = pLine->x2;
+        m_gridY2[k] = pLine->y2;
+        m_gridGrip[k] = pLine->fGrip;
+        m_gridLines[k] = pLine;
+        m_gridMinX[k] = CD_MIN(pLine->x1, pLine->x2);
+        m_gridMinY[k] = CD_MIN(pLine->y1, pLine->y2);
+        m_gridMaxX[k] = CD_MAX(pLine->x1, pLine->x2);
+        m_gridMaxY[k] = CD_MAX(pLine->y1, pLine->y2);
+      }
+    }
+  }
+
+  unsigned int v_biggestCell = 0;
+  for (unsigned int i = 0; i < v_nbCells; i++) {
+    if (m_gridOffsets[i + 1] - m_gridOffsets[i] > v_biggestCell) {
+      v_biggestCell = m_gridOffsets[i + 1] - m_gridOffsets[i];
+    }
+  }
+  m_gridCandidates.resize(v_biggestCell);
 
   /* TODO: instead of just adding line to all cells which are touched
            box-box wise, do a more precise touch-check between the line and
            the cell box */
+
+  m_bGridCompiled = true;
+}
+
+/* the lines of the cell i whose bounding box touches the box, in
+   m_gridCandidates, in the order of the cell. The box must hold the points
+   where the exact checks can find a contact, with a margin */
+unsigned int CollisionSystem::_getCellLinesNearBox(int i,
+                                                   float fMinX,
+                                                   float fMinY,
+                                                   float fMaxX,
+                                                   float fMaxY) {
+  /* the debug information shows all the checked lines */
+  if (m_bDebugFlag) {
+    unsigned int n = 0;
+    for (unsigned int j = m_gridOffsets[i]; j < m_gridOffsets[i + 1]; j++) {
+      m_gridCandidates[n++] = j;
+    }
+    return n;
+  }
+
+  return CollisionFilter::linesInBox(m_gridMinX.data(),
+                                     m_gridMinY.data(),
+                                     m_gridMaxX.data(),
+                                     m_gridMaxY.data(),
+                                     m_gridOffsets[i],
+                                     m_gridOffsets[i + 1],
+                                     fMinX,
+                                     fMinY,
+                                     fMaxX,
+                                     fMaxY,
+                                     m_gridCandidates.data());
 }
 
 /*===========================================================================
@@ -228,16 +354,19 @@ bool CollisionSystem::checkLine(float x1, float y1, float x2, float y2) {
 /*===========================================================================
 Boolean check of collision between circle and system
 ===========================================================================*/
-bool CollisionSystem::_CheckCircleAndLine(Line *pLine,
+bool CollisionSystem::_CheckCircleAndLine(float x1,
+                                          float y1,
+                                          float x2,
+                                          float y2,
                                           float x,
                                           float y,
                                           float r) {
   /* Is circle "behind" the line? */
-  float vx = pLine->x2 - pLine->x1;
-  float vy = pLine->y2 - pLine->y1;
+  float vx = x2 - x1;
+  float vy = y2 - y1;
   float enx = -vy;
   float eny = vx;
-  if (enx * x + eny * y < enx * pLine->x1 + eny * pLine->y1) {
+  if (enx * x + eny * y < enx * x1 + eny * y1) {
     /* Yes it is, can't touch */
     return false;
   }
@@ -248,15 +377,15 @@ bool CollisionSystem::_CheckCircleAndLine(Line *pLine,
   }
 
   /* Is line endings inside the circle? */
-  float dx1 = pLine->x1 - x;
-  float dy1 = pLine->y1 - y;
+  float dx1 = x1 - x;
+  float dy1 = y1 - y;
   if (dx1 * dx1 + dy1 * dy1 <= r * r) {
     /* We have a touch! */
     return true;
   }
 
-  float dx2 = pLine->x2 - x;
-  float dy2 = pLine->y2 - y;
+  float dx2 = x2 - x;
+  float dy2 = y2 - y;
   if (dx2 * dx2 + dy2 * dy2 <= r * r) {
     /* We have a touch! */
     return true;
@@ -264,18 +393,18 @@ bool CollisionSystem::_CheckCircleAndLine(Line *pLine,
 
   /* Final check */
   Vector2f T1, T2;
-  int n = intersectLineCircle2f(Vector2f(x, y),
-                                r,
-                                Vector2f(pLine->x1, pLine->y1),
-                                Vector2f(pLine->x2, pLine->y2),
-                                T1,
-                                T2);
+  int n = intersectLineCircle2f(
+    Vector2f(x, y), r, Vector2f(x1, y1), Vector2f(x2, y2), T1, T2);
   if (n > 0)
     return true;
   return false;
 }
 
 bool CollisionSystem::checkCircle(float x, float y, float r) {
+  if (m_bGridCompiled == false) {
+    compileGrid();
+  }
+
   /* Calculate bounding box of circle */
   float fMinX = x - r;
   float fMinY = y - r;
@@ -314,7 +443,8 @@ bool CollisionSystem::checkCircle(float x, float y, float r) {
   AABB BBox;
   BBox.addPointToAABB2f(fMinX, fMinY);
   BBox.addPointToAABB2f(fMaxX, fMaxY);
-  std::vector<Block *> &blocks = getDynBlocksNearPosition(BBox);
+  getDynBlocksNearPosition(BBox, m_dynBlocksQuery);
+  std::vector<Block *> &blocks = m_dynBlocksQuery.elements;
 
   for (unsigned int i = 0; i < blocks.size(); i++) {
     Block *pBlock = blocks[i];
@@ -342,19 +472,23 @@ bool CollisionSystem::checkCircle(float x, float y, float r) {
         m_CheckedCells.push_back(CellBox);
       }
 
-      /* Empty? That would be nice */
-      if (m_pGrid[i].Lines.empty())
-        continue;
-
       /* TODO: currently we will probably check the same lines several times
        * each... AVOID THAT! */
 
-      /* Check all lines in cell */
-      for (unsigned int j = 0; j < m_pGrid[i].Lines.size(); j++) {
+      /* Check the lines of the cell near the circle */
+      unsigned int nNbLines = _getCellLinesNearBox(i,
+                                                   fMinX - CD_EPSILON,
+                                                   fMinY - CD_EPSILON,
+                                                   fMaxX + CD_EPSILON,
+                                                   fMaxY + CD_EPSILON);
+      for (unsigned int k = 0; k < nNbLines; k++) {
+        unsigned int j = m_gridCandidates[k];
+
         if (m_bDebugFlag)
-          m_CheckedLines.push_back(m_pGrid[i].Lines[j]);
+          m_CheckedLines.push_back(m_gridLines[j]);
 
-        if (_CheckCircleAndLine(m_pGrid[i].Lines[j], x, y, r))
+        if (_CheckCircleAndLine(
+              m_gridX1[j], m_gridY1[j], m_gridX2[j], m_gridY2[j], x, y, r))
           return true;
       }
     }
@@ -371,6 +505,10 @@ bool CollisionSystem::checkBoxFast(float fMinX,
                                    float fMinY,
                                    float fMaxX,
                                    float fMaxY) {
+  if (m_bGridCompiled == false) {
+    compileGrid();
+  }
+
   /* Calculate cell coordinates */
   int nMinCX =
     (int)floor(((fMinX - m_fMinX - CD_EPSILON) * (float)m_nGridWidth) /
@@ -399,7 +537,7 @@ bool CollisionSystem::checkBoxFast(float fMinX,
     for (int cy = nMinCY; cy <= nMaxCY; cy++) {
       int i = cx + cy * m_nGridWidth;
 
-      if (m_pGrid[i].Lines.empty())
+      if (m_gridOffsets[i] == m_gridOffsets[i + 1])
         return true; /* damn, we might touch something */
     }
   }
@@ -420,6 +558,10 @@ int CollisionSystem::collideLine(float x1,
                                  PhysicsSettings *i_physicsSettings) {
   int nNumC = 0;
 
+  if (m_bGridCompiled == false) {
+    compileGrid();
+  }
+
   /* Calculate bounding box of line */
   float fMinX = CD_MIN(x1, x2);
   float fMinY = CD_MIN(y1, y2);
@@ -453,7 +595,8 @@ int CollisionSystem::collideLine(float x1,
   AABB BBox;
   BBox.addPointToAABB2f(fMinX, fMinY);
   BBox.addPointToAABB2f(fMaxX, fMaxY);
-  std::vector<Block *> &blocks = getDynBlocksNearPosition(BBox);
+  getDynBlocksNearPosition(BBox, m_dynBlocksQuery);
+  std::vector<Block *> &blocks = m_dynBlocksQuery.elements;
 
   for (unsigned int i = 0; i < blocks.size(); i++) {
     Block *pBlock = blocks[i];
@@ -498,23 +641,19 @@ int CollisionSystem::collideLine(float x1,
     for (int cy = nMinCY; cy <= nMaxCY; cy++) {
       int i = cx + cy * m_nGridWidth;
 
-      /* Empty? That would be nice */
-      if (m_pGrid[i].Lines.empty())
-        continue;
-
       /* TODO: currently we will probably check the same lines several times
        * each... AVOID THAT! */
 
       /* Check all lines in cell */
-      for (unsigned int j = 0; j < m_pGrid[i].Lines.size(); j++) {
+      for (unsigned int j = m_gridOffsets[i]; j < m_gridOffsets[i + 1]; j++) {
         /* Is the beginning "behind" the line? */
         // nicolas : it seems not work
-        float vx = m_pGrid[i].Lines[j]->x2 - m_pGrid[i].Lines[j]->x1;
-        float vy = m_pGrid[i].Lines[j]->y2 - m_pGrid[i].Lines[j]->y1;
+        float vx = m_gridX2[j] - m_gridX1[j];
+        float vy = m_gridY2[j] - m_gridY1[j];
         // float enx = -vy;
         // float eny = vx;
-        // if(enx*x1 + eny*y1 < enx*m_pGrid[i].Lines[j]->x1 +
-        // eny*m_pGrid[i].Lines[j]->y1) {
+        // if(enx*x1 + eny*y1 < enx*m_gridX1[j] +
+        // eny*m_gridY1[j]) {
         //  /* Yes it is, can't touch */
         //  continue;
         //}
@@ -529,8 +668,8 @@ int CollisionSystem::collideLine(float x1,
         int n = intersectLineLine2f(
           Vector2f(x1, y1),
           Vector2f(x2, y2),
-          Vector2f(m_pGrid[i].Lines[j]->x1, m_pGrid[i].Lines[j]->y1),
-          Vector2f(m_pGrid[i].Lines[j]->x2, m_pGrid[i].Lines[j]->y2),
+          Vector2f(m_gridX1[j], m_gridY1[j]),
+          Vector2f(m_gridX2[j], m_gridY2[j]),
           T);
         if (n > 0) {
           dContact c;
@@ -538,7 +677,7 @@ int CollisionSystem::collideLine(float x1,
           W.normalize();
 
           _SetWheelContactParams(
-            &c, T, W, 0.0f, m_pGrid[i].Lines[j]->fGrip, i_physicsSettings);
+            &c, T, W, 0.0f, m_gridGrip[j], i_physicsSettings);
           nNumC = _AddContactToList(pContacts, nNumC, &c, nMaxC);
         }
       }
@@ -552,7 +691,10 @@ int CollisionSystem::collideLine(float x1,
 /*===========================================================================
 Calculate precise intersections between circle and geometry, if any
 ===========================================================================*/
-int CollisionSystem::_CollideCircleAndLine(Line *pLine,
+int CollisionSystem::_CollideCircleAndLine(float x1,
+                                           float y1,
+                                           float x2,
+                                           float y2,
                                            float x,
                                            float y,
                                            float r,
@@ -560,17 +702,18 @@ int CollisionSystem::_CollideCircleAndLine(Line *pLine,
                                            int nOldNumC,
                                            int nMaxC,
                                            float fGrip,
-                                           PhysicsSettings *i_physicsSettings) {
+                                           PhysicsSettings *i_physicsSettings,
+                                           Line *pDebugLine) {
   int nNumC = nOldNumC;
 
   /* First do a bounding box collision check */
 
   /* Is circle "behind" the line? */
-  float vx = pLine->x2 - pLine->x1;
-  float vy = pLine->y2 - pLine->y1;
+  float vx = x2 - x1;
+  float vy = y2 - y1;
   float enx = -vy;
   float eny = vx;
-  if (enx * x + eny * y < enx * pLine->x1 + eny * pLine->y1) {
+  if (enx * x + eny * y < enx * x1 + eny * y1) {
     /* Yes it is, can't touch */
     return nNumC;
   }
@@ -581,11 +724,11 @@ int CollisionSystem::_CollideCircleAndLine(Line *pLine,
   }
 
   if (m_bDebugFlag)
-    m_CheckedLinesW.push_back(pLine);
+    m_CheckedLinesW.push_back(pDebugLine);
 
   /* Is line endings inside the circle? */
-  float dx1 = pLine->x1 - x;
-  float dy1 = pLine->y1 - y;
+  float dx1 = x1 - x;
+  float dy1 = y1 - y;
   if (sqrt(dx1 * dx1 + dy1 * dy1) <= r + 0.0001f) {
     /* We have a touch! */
     dContact c;
@@ -597,17 +740,16 @@ int CollisionSystem::_CollideCircleAndLine(Line *pLine,
     // W.normalize();
 
     //      float fDepth =
-    //      _CalculateCircleLineDepth(Vector2f(x,y),r,Vector2f(pLine->x1,pLine->y1),Vector2f(pLine->x2,pLine->y2));
-    double fDepth =
-      _CalculateDepth(Vector2f(x, y), r, Vector2f(pLine->x1, pLine->y1));
+    //      _CalculateCircleLineDepth(Vector2f(x,y),r,Vector2f(x1,y1),Vector2f(x2,y2));
+    double fDepth = _CalculateDepth(Vector2f(x, y), r, Vector2f(x1, y1));
     _SetWheelContactParams(
-      &c, Vector2f(pLine->x1, pLine->y1), W, fDepth, fGrip, i_physicsSettings);
+      &c, Vector2f(x1, y1), W, fDepth, fGrip, i_physicsSettings);
     nNumC = _AddContactToList(pContacts, nNumC, &c, nMaxC);
     // return nNumC;
   }
 
-  float dx2 = pLine->x2 - x;
-  float dy2 = pLine->y2 - y;
+  float dx2 = x2 - x;
+  float dy2 = y2 - y;
   if (sqrt(dx2 * dx2 + dy2 * dy2) <= r + 0.0001f) {
     /* We have a touch! */
     dContact c;
@@ -619,33 +761,26 @@ int CollisionSystem::_CollideCircleAndLine(Line *pLine,
     // W.normalize();
 
     //      float fDepth =
-    //      _CalculateCircleLineDepth(Vector2f(x,y),r,Vector2f(pLine->x1,pLine->y1),Vector2f(pLine->x2,pLine->y2));
-    double fDepth =
-      _CalculateDepth(Vector2f(x, y), r, Vector2f(pLine->x2, pLine->y2));
+    //      _CalculateCircleLineDepth(Vector2f(x,y),r,Vector2f(x1,y1),Vector2f(x2,y2));
+    double fDepth = _CalculateDepth(Vector2f(x, y), r, Vector2f(x2, y2));
     _SetWheelContactParams(
-      &c, Vector2f(pLine->x2, pLine->y2), W, fDepth, fGrip, i_physicsSettings);
+      &c, Vector2f(x2, y2), W, fDepth, fGrip, i_physicsSettings);
     nNumC = _AddContactToList(pContacts, nNumC, &c, nMaxC);
     // return nNumC;
   }
 
   /* Calculate intersection */
   Vector2f T1, T2;
-  int n = intersectLineCircle2f(Vector2f(x, y),
-                                r,
-                                Vector2f(pLine->x1, pLine->y1),
-                                Vector2f(pLine->x2, pLine->y2),
-                                T1,
-                                T2);
+  int n = intersectLineCircle2f(
+    Vector2f(x, y), r, Vector2f(x1, y1), Vector2f(x2, y2), T1, T2);
   if (n > 0) {
     dContact c;
     Vector2f W = Vector2f(enx, eny);
     W.normalize();
 
     //_SetWheelContactParams(&c,T1,W,_CalculateDepth(Vector2f(x,y),r,T1));
-    double fDepth = _CalculateCircleLineDepth(Vector2f(x, y),
-                                              r,
-                                              Vector2f(pLine->x1, pLine->y1),
-                                              Vector2f(pLine->x2, pLine->y2));
+    double fDepth = _CalculateCircleLineDepth(
+      Vector2f(x, y), r, Vector2f(x1, y1), Vector2f(x2, y2));
     // fDepth = 0.0f;
     // fDepth *= 0.2;
     // static int xxx = 0,yyy = 0;
@@ -674,6 +809,10 @@ int CollisionSystem::collideCircle(float x,
                                    PhysicsSettings *i_physicsSettings) {
   int nNumC = 0;
 
+  if (m_bGridCompiled == false) {
+    compileGrid();
+  }
+
   /* Calculate bounding box of circle */
   float fMinX = x - r;
   float fMinY = y - r;
@@ -712,7 +851,8 @@ int CollisionSystem::collideCircle(float x,
   AABB BBox;
   BBox.addPointToAABB2f(fMinX, fMinY);
   BBox.addPointToAABB2f(fMaxX, fMaxY);
-  std::vector<Block *> &blocks = getDynBlocksNearPosition(BBox);
+  getDynBlocksNearPosition(BBox, m_dynBlocksQuery);
+  std::vector<Block *> &blocks = m_dynBlocksQuery.elements;
 
   for (unsigned int i = 0; i < blocks.size(); i++) {
     Block *pBlock = blocks[i];
@@ -750,24 +890,31 @@ int CollisionSystem::collideCircle(float x,
         m_CheckedCellsW.push_back(CellBox);
       }
 
-      /* Empty? That would be nice */
-      if (m_pGrid[i].Lines.empty())
-        continue;
-
       /* TODO: currently we will probably check the same lines several times
        * each... AVOID THAT! */
 
-      /* Check all lines in cell */
-      for (unsigned int j = 0; j < m_pGrid[i].Lines.size(); j++) {
-        nNumC = _CollideCircleAndLine(m_pGrid[i].Lines[j],
+      /* Check the lines of the cell near the circle */
+      unsigned int nNbLines = _getCellLinesNearBox(i,
+                                                   fMinX - CD_EPSILON,
+                                                   fMinY - CD_EPSILON,
+                                                   fMaxX + CD_EPSILON,
+                                                   fMaxY + CD_EPSILON);
+      for (unsigned int k = 0; k < nNbLines; k++) {
+        unsigned int j = m_gridCandidates[k];
+
+        nNumC = _CollideCircleAndLine(m_gridX1[j],
+                                      m_gridY1[j],
+                                      m_gridX2[j],
+                                      m_gridY2[j],
                                       x,
                                       y,
                                       r,
                                       pContacts,
                                       nNumC,
                                       nMaxC,
-                                      m_pGrid[i].Lines[j]->fGrip,
-                                      i_physicsSettings);
+                                      m_gridGrip[j],
+                                      i_physicsSettings,
+                                      m_gridLines[j]);
       }
     }
   }
@@ -794,6 +941,10 @@ int CollisionSystem::collideCirclePath(float x1,
 Collection of stats
 ===========================================================================*/
 void CollisionSystem::getStats(CollisionSystemStats *p) {
+  if (m_bGridCompiled == false) {
+    compileGrid();
+  }
+
   p->nTotalLines = m_Lines.size();
   p->nGridWidth = m_nGridWidth;
   p->nGridHeight = m_nGridHeight;
@@ -802,7 +953,7 @@ void CollisionSystem::getStats(CollisionSystemStats *p) {
 
   int nEmpty = 0;
   for (int i = 0; i < m_nGridWidth * m_nGridHeight; i++) {
-    if (m_pGrid[i].Lines.empty())
+    if (m_gridOffsets[i] == m_gridOffsets[i + 1])
       nEmpty++;
   }
 
@@ -889,19 +1040,28 @@ int CollisionSystem::_AddContactToList(dContact *pContacts,
 
 /* entities */
 void CollisionSystem::addEntity(Entity *id) {
-  m_entitiesHandler.addElement(id);
+  id->setColElement(m_entitiesHandler.addElement(id));
 }
 
 void CollisionSystem::removeEntity(Entity *id) {
-  m_entitiesHandler.removeElement(id);
+  if (id->getColElement() == NULL) {
+    throw Exception("Collision element not found");
+  }
+  m_entitiesHandler.removeElement(id->getColElement());
+  id->setColElement(NULL);
 }
 
 void CollisionSystem::moveEntity(Entity *id) {
-  m_entitiesHandler.moveElement(id);
+  if (id->getColElement() == NULL) {
+    throw Exception("Collision element not found");
+  }
+  m_entitiesHandler.moveElement(id->getColElement());
 }
 
-std::vector<Entity *> &CollisionSystem::getEntitiesNearPosition(AABB &BBox) {
-  return m_entitiesHandler.getElementsNearPosition(BBox);
+void CollisionSystem::getEntitiesNearPosition(
+  AABB &BBox,
+  ElementsQuery<Entity> &io_query) const {
+  m_entitiesHandler.getElementsNearPosition(BBox, io_query);
 }
 
 /* TODO::zones
@@ -932,15 +1092,30 @@ ColElement<Block> *CollisionSystem::addDynBlock(Block *id) {
 }
 
 void CollisionSystem::removeDynBlock(Block *id) {
-  m_dynBlocksHandler.removeElement(id);
+  m_dynBlocksHandler.removeElement(id->getColElement());
 }
 
 void CollisionSystem::moveDynBlock(Block *id) {
   m_dynBlocksHandler.moveElement(id->getColElement());
 }
 
-std::vector<Block *> &CollisionSystem::getDynBlocksNearPosition(AABB &BBox) {
-  return m_dynBlocksHandler.getElementsNearPosition(BBox);
+void CollisionSystem::queueDynBlockMove(Block *id) {
+  m_queuedDynBlocks.push_back(id->getColElement());
+}
+
+void CollisionSystem::moveQueuedDynBlocks() {
+  if (m_queuedDynBlocks.size() == 0) {
+    return;
+  }
+
+  m_dynBlocksHandler.moveElements(m_queuedDynBlocks);
+  m_queuedDynBlocks.clear();
+}
+
+void CollisionSystem::getDynBlocksNearPosition(
+  AABB &BBox,
+  ElementsQuery<Block> &io_query) const {
+  m_dynBlocksHandler.getElementsNearPosition(BBox, io_query);
 }
 
 void CollisionSystem::addStaticBlock(Block *id, bool inFrontLayer) {
@@ -951,12 +1126,14 @@ void CollisionSystem::addStaticBlock(Block *id, bool inFrontLayer) {
   }
 }
 
-std::vector<Block *> &CollisionSystem::getStaticBlocksNearPosition(AABB &BBox,
-                                                                   int layer) {
+void CollisionSystem::getStaticBlocksNearPosition(
+  AABB &BBox,
+  ElementsQuery<Block> &io_query,
+  int layer) const {
   if (layer == -1) {
-    return m_staticBlocksHandler.getElementsNearPosition(BBox);
+    m_staticBlocksHandler.getElementsNearPosition(BBox, io_query);
   } else {
-    return m_staticBlocksHandlerSecondLayer.getElementsNearPosition(BBox);
+    m_staticBlocksHandlerSecondLayer.getElementsNearPosition(BBox, io_query);
   }
 }
 
@@ -964,9 +1141,11 @@ void CollisionSystem::addBlockInLayer(Block *id, int layer) {
   m_layerBlocksHandlers[layer]->addElement(id);
 }
 
-std::vector<Block *> &CollisionSystem::getBlocksNearPositionInLayer(AABB &BBox,
-                                                                    int layer) {
-  return m_layerBlocksHandlers[layer]->getElementsNearPosition(BBox);
+void CollisionSystem::getBlocksNearPositionInLayer(
+  AABB &BBox,
+  int layer,
+  ElementsQuery<Block> &io_query) const {
+  m_layerBlocksHandlers[layer]->getElementsNearPosition(BBox, io_query);
 }
 
 /*=====================================================
@@ -982,7 +1161,6 @@ ElementHandler<T>::ElementHandler()
 {
   m_pGrid = NULL;
   m_bDebugFlag = false;
-  m_curCheck = 0;
   reset();
 }
 */
@@ -995,8 +1173,6 @@ void ElementHandler<T>::reset() {
   }
 
   EMPTY_AND_CLEAR_VECTOR(m_ColElements);
-  // reserve 256 entry to avoid mallocs during the game
-  m_returnedElements.reserve(256);
 }
 
 template<class T>
@@ -1030,31 +1206,54 @@ template<class T>
 struct ColElement<T> *ElementHandler<T>::addElement(T *id) {
   struct ColElement<T> *pNewElem = new struct ColElement<T>;
   pNewElem->id = id;
+  pNewElem->index = m_ColElements.size();
   m_ColElements.push_back(pNewElem);
 
+  /* no cell yet */
+  pNewElem->minCX = pNewElem->minCY = 0;
+  pNewElem->maxCX = pNewElem->maxCY = -1;
+  _updateCellsRange(pNewElem);
   _addColElementInCells(pNewElem);
   return pNewElem;
 }
 
 template<class T>
-void ElementHandler<T>::removeElement(T *id) {
-  struct ColElement<T> *pColElem = _getAndRemoveColElement(id);
-  _removeColElementFromCells(pColElem);
+void ElementHandler<T>::removeElement(struct ColElement<T> *pColElem) {
+  /* the last element takes its place */
+  m_ColElements[pColElem->index] = m_ColElements.back();
+  m_ColElements[pColElem->index]->index = pColElem->index;
+  m_ColElements.pop_back();
 
+  _removeColElementFromCells(pColElem);
   delete pColElem;
 }
 
 template<class T>
-void ElementHandler<T>::moveElement(T *id) {
-  struct ColElement<T> *pColElem = _getColElement(id);
+void ElementHandler<T>::moveElement(struct ColElement<T> *pColElem) {
+  if (_updateCellsRange(pColElem) == false) {
+    return;
+  }
+
   _removeColElementFromCells(pColElem);
   _addColElementInCells(pColElem);
 }
 
 template<class T>
-void ElementHandler<T>::moveElement(struct ColElement<T> *pColElem) {
-  _removeColElementFromCells(pColElem);
-  _addColElementInCells(pColElem);
+void ElementHandler<T>::moveElements(
+  std::vector<struct ColElement<T> *> &i_colElems) {
+  m_movedElements.clear();
+  for (unsigned int i = 0; i < i_colElems.size(); i++) {
+    if (_updateCellsRange(i_colElems[i])) {
+      m_movedElements.push_back(i_colElems[i]);
+    }
+  }
+
+  for (unsigned int i = 0; i < m_movedElements.size(); i++) {
+    _removeColElementFromCells(m_movedElements[i]);
+  }
+  for (unsigned int i = 0; i < m_movedElements.size(); i++) {
+    _addColElementInCells(m_movedElements[i]);
+  }
 }
 
 inline int my_floor(float x) {
@@ -1063,8 +1262,10 @@ inline int my_floor(float x) {
 }
 
 template<class T>
-std::vector<T *> &ElementHandler<T>::getElementsNearPosition(AABB &BBox) {
-  m_returnedElements.clear();
+void ElementHandler<T>::getElementsNearPosition(
+  AABB &BBox,
+  ElementsQuery<T> &io_query) const {
+  io_query.elements.clear();
   Vector2f BMin = BBox.getBMin();
   Vector2f BMax = BBox.getBMax();
 
@@ -1087,8 +1288,15 @@ std::vector<T *> &ElementHandler<T>::getElementsNearPosition(AABB &BBox) {
     m_CheckedElements.clear();
   }
 
-  /* next check */
-  m_curCheck++;
+  /* next check ; the marks are reset when the counter wraps */
+  io_query.check++;
+  if (io_query.check == 0) {
+    io_query.visits.assign(io_query.visits.size(), 0);
+    io_query.check = 1;
+  }
+  if (io_query.visits.size() < m_ColElements.size()) {
+    io_query.visits.resize(m_ColElements.size(), 0);
+  }
 
   for (int i = nMinCX; i <= nMaxCX; i++) {
     if (i < 0 || i >= m_gridWidth)
@@ -1099,13 +1307,16 @@ std::vector<T *> &ElementHandler<T>::getElementsNearPosition(AABB &BBox) {
         continue;
 
       int cell = i + j * m_gridWidth;
-      std::vector<struct ColElement<T> *> &gridCellColElements =
+      const std::vector<struct ColElement<T> *> &gridCellColElements =
         m_pGrid[cell].ColElements;
       for (unsigned int k = 0; k < gridCellColElements.size(); k++) {
-        if (gridCellColElements[k]->curCheck != m_curCheck) {
-          gridCellColElements[k]->curCheck = m_curCheck;
+        unsigned int &v_visit =
+          io_query.visits[gridCellColElements[k]->index];
 
-          m_returnedElements.push_back(gridCellColElements[k]->id);
+        if (v_visit != io_query.check) {
+          v_visit = io_query.check;
+
+          io_query.elements.push_back(gridCellColElements[k]->id);
 
           if (m_bDebugFlag) {
             m_CheckedElements.push_back(gridCellColElements[k]->id);
@@ -1116,7 +1327,6 @@ std::vector<T *> &ElementHandler<T>::getElementsNearPosition(AABB &BBox) {
   }
 
   // printf("ElementHandler::getElementsNearPosition end\n");
-  return m_returnedElements;
 }
 
 /*=====================================================
@@ -1124,23 +1334,7 @@ std::vector<T *> &ElementHandler<T>::getElementsNearPosition(AABB &BBox) {
 =====================================================*/
 
 template<class T>
-struct ColElement<T> *ElementHandler<T>::_getColElement(T *id) {
-  unsigned int v_size =
-    m_ColElements.size(); // perf -- because size is called a lot of times
-  for (unsigned int i = 0; i < v_size; i++) {
-    if (m_ColElements[i]->id == id) {
-      return m_ColElements[i];
-    }
-  }
-
-  throw Exception("Collision element not found");
-}
-
-template<class T>
-void ElementHandler<T>::_addColElementInCells(struct ColElement<T> *pColElem) {
-  /* current check */
-  pColElem->curCheck = 0;
-
+bool ElementHandler<T>::_updateCellsRange(struct ColElement<T> *pColElem) {
   /* element aabb */
   AABB BBox = pColElem->id->getAABB();
   Vector2f BMin = BBox.getBMin();
@@ -1161,51 +1355,62 @@ void ElementHandler<T>::_addColElementInCells(struct ColElement<T> *pColElem) {
   if (nMaxCY >= m_gridHeight)
     nMaxCY = m_gridHeight;
 
+  if (nMinCX == pColElem->minCX && nMinCY == pColElem->minCY &&
+      nMaxCX == pColElem->maxCX && nMaxCY == pColElem->maxCY) {
+    return false;
+  }
+
+  pColElem->minCX = nMinCX;
+  pColElem->minCY = nMinCY;
+  pColElem->maxCX = nMaxCX;
+  pColElem->maxCY = nMaxCY;
+  return true;
+}
+
+template<class T>
+void ElementHandler<T>::_addColElementInCells(struct ColElement<T> *pColElem) {
   /* For each cells touched by the element, add it to the grid */
-  for (int i = nMinCX; i <= nMaxCX; i++) {
+  for (int i = pColElem->minCX; i <= pColElem->maxCX; i++) {
     if (i < 0 || i >= m_gridWidth)
       continue;
-    for (int j = nMinCY; j <= nMaxCY; j++) {
+    for (int j = pColElem->minCY; j <= pColElem->maxCY; j++) {
       if (j < 0 || j >= m_gridHeight)
         continue;
       int cell = i + j * m_gridWidth;
 
       pColElem->gridCells.push_back(cell);
+      pColElem->gridCellsIndex.push_back(m_pGrid[cell].ColElements.size());
       m_pGrid[cell].ColElements.push_back(pColElem);
     }
   }
 }
 
-template<class T>
-struct ColElement<T> *ElementHandler<T>::_getAndRemoveColElement(T *id) {
-  for (unsigned int i = 0; i < m_ColElements.size(); i++) {
-    if (m_ColElements[i]->id == id) {
-      struct ColElement<T> *pColElem = m_ColElements[i];
-      m_ColElements.erase(m_ColElements.begin() + i);
-
-      return pColElem;
-    }
-  }
-  throw Exception("Collision element not found");
-}
-
 template<class T>
 void ElementHandler<T>::_removeColElementFromCells(
   struct ColElement<T> *pColElem) {
   /* for each grid cell with the ColElem in it */
   for (unsigned int i = 0; i < pColElem->gridCells.size(); i++) {
     int cell = pColElem->gridCells[i];
-
-    for (unsigned int j = 0; j < m_pGrid[cell].ColElements.size(); j++) {
-      if (m_pGrid[cell].ColElements[j] == pColElem) {
-        /* remove ColElem from cell*/
-        m_pGrid[cell].ColElements.erase(m_pGrid[cell].ColElements.begin() + j);
-
-        break;
+    std::vector<struct ColElement<T> *> &v_cellElems =
+      m_pGrid[cell].ColElements;
+    unsigned int v_index = pColElem->gridCellsIndex[i];
+    struct ColElement<T> *v_last = v_cellElems.back();
+
+    /* remove ColElem from cell ; the last element of the cell takes its
+       place */
+    if (v_last != pColElem) {
+      v_cellElems[v_index] = v_last;
+      for (unsigned int j = 0; j < v_last->gridCells.size(); j++) {
+        if (v_last->gridCells[j] == cell) {
+          v_last->gridCellsIndex[j] = v_index;
+          break;
+        }
       }
     }
+    v_cellElems.pop_back();
   }
 
   /* remove cell from ColElem*/
   pColElem->gridCells.clear();
+  pColElem->gridCellsIndex.clear();
 }
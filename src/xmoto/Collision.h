@@ -31,7 +31,6 @@ class Entity;
 class Zone;
 class CollisionSystem;
 class PhysicsSettings;
-struct GridCell;
 
 /*===========================================================================
 Structs
@@ -45,15 +44,33 @@ struct Line {
 template<class T>
 struct ColElement {
   T *id;
+  /* place in the elements of the handler, to remove it in constant time */
+  unsigned int index;
   /* in order to remove efficiently an element from the grid,
      we need to know in which cells it is */
   /* if gridCells.size() == 0, then it means that the element is not in
      the level boundaries (moved out by a script for example) */
   std::vector<int> gridCells;
-  /* as an element can be in more than one cell,
-     we need to tell if an element has already be visited
-  */
-  int curCheck;
+  /* place of the element in each of these cells */
+  std::vector<unsigned int> gridCellsIndex;
+  /* cells covered by the element ; a move staying in the same cells
+     doesn't touch the grid */
+  int minCX, minCY, maxCX, maxCY;
+};
+
+/* the result of a query on an element handler, and what the query needs to
+   visit each element once. It belongs to the caller : keeping it from one
+   query to the next avoids the allocations, and queries with their own
+   ElementsQuery can run at the same time on a handler which is not changed */
+template<class T>
+struct ElementsQuery {
+  std::vector<T *> elements;
+  /* as an element can be in more than one cell, we need to tell if it has
+     already been visited : visits[index of the element] == check */
+  std::vector<unsigned int> visits;
+  unsigned int check;
+
+  ElementsQuery() { check = 0; }
 };
 
 template<class T>
@@ -61,17 +78,18 @@ class ElementHandler {
 public:
   typedef struct { std::vector<struct ColElement<T> *> ColElements; } GridCell;
 
-  /* The element must have a method getAABB() */
+  /* The element must have a method getAABB() ; the returned element is the
+     handle to move or remove it */
   struct ColElement<T> *addElement(T *id);
-  void removeElement(T *id);
-  void moveElement(T *id);
+  void removeElement(struct ColElement<T> *pColElem);
   void moveElement(struct ColElement<T> *pColElem);
-  std::vector<T *> &getElementsNearPosition(AABB &BBox);
+  /* the grid is updated once the new cells of all the elements are known */
+  void moveElements(std::vector<struct ColElement<T> *> &i_colElems);
+  void getElementsNearPosition(AABB &BBox, ElementsQuery<T> &io_query) const;
 
   ElementHandler() {
     m_pGrid = NULL;
     m_bDebugFlag = false;
-    m_curCheck = 0;
     reset();
   }
   void reset();
@@ -94,19 +112,17 @@ private:
   /* grid for the elements */
   GridCell *m_pGrid;
 
-  /* The current checking pass */
-  int m_curCheck;
-
   bool m_bDebugFlag;
-  std::vector<T *> m_CheckedElements;
+  /* written by the queries in debug mode only, which is not used from
+     several threads */
+  mutable std::vector<T *> m_CheckedElements;
 
-  // the vector returned by getElementsNearPosition
-  std::vector<T *> m_returnedElements;
+  // the elements changing of cells in moveElements
+  std::vector<struct ColElement<T> *> m_movedElements;
 
   /* helpers */
-  struct ColElement<T> *_getColElement(T *id);
+  bool _updateCellsRange(struct ColElement<T> *pColElem);
   void _addColElementInCells(struct ColElement<T> *pColElem);
-  struct ColElement<T> *_getAndRemoveColElement(T *id);
   void _removeColElementFromCells(struct ColElement<T> *pColElem);
 
   // precalculated values
@@ -114,11 +130,6 @@ private:
   float m_heightDivisor;
 };
 
-/* Grid cell */
-struct GridCell {
-  std::vector<Line *> Lines;
-};
-
 /* Stats */
 struct CollisionSystemStats {
   int nGridWidth, nGridHeight;
@@ -144,6 +155,9 @@ public:
                unsigned int numberBackgroundLayers,
                std::vector<Vector2f> &layerOffsets);
   void defineLine(float x1, float y1, float x2, float y2, float grip);
+  /* put the lines defined so far in the grid ; done by the queries if the
+     lines changed since */
+  void compileGrid();
 
   bool checkLine(float x1, float y1, float x2, float y2);
   bool checkCircle(float x, float y, float r);
@@ -196,7 +210,8 @@ public:
   void addEntity(Entity *id);
   void removeEntity(Entity *id);
   void moveEntity(Entity *id);
-  std::vector<Entity *> &getEntitiesNearPosition(AABB &BBox);
+  void getEntitiesNearPosition(AABB &BBox,
+                               ElementsQuery<Entity> &io_query) const;
 
   /* TODO::zones
   void addZone(Zone* id);
@@ -208,15 +223,23 @@ public:
   struct ColElement<Block> *addDynBlock(Block *id);
   void removeDynBlock(Block *id);
   void moveDynBlock(Block *id);
-  std::vector<Block *> &getDynBlocksNearPosition(AABB &BBox);
+  /* the blocks moved by a physics step are moved in the grid at once */
+  void queueDynBlockMove(Block *id);
+  void moveQueuedDynBlocks();
+  void getDynBlocksNearPosition(AABB &BBox,
+                                ElementsQuery<Block> &io_query) const;
 
   /* -1 for actual static block layer, other value (0) for the second static
    * layer */
   void addStaticBlock(Block *id, bool inFrontLayer = false);
-  std::vector<Block *> &getStaticBlocksNearPosition(AABB &BBox, int layer = -1);
+  void getStaticBlocksNearPosition(AABB &BBox,
+                                   ElementsQuery<Block> &io_query,
+                                   int layer = -1) const;
 
   void addBlockInLayer(Block *id, int layer);
-  std::vector<Block *> &getBlocksNearPositionInLayer(AABB &BBox, int layer);
+  void getBlocksNearPositionInLayer(AABB &BBox,
+                                    int layer,
+                                    ElementsQuery<Block> &io_query) const;
 
 private:
   /* Data */
@@ -225,6 +248,9 @@ private:
 
   ElementHandler<Entity> m_entitiesHandler;
   ElementHandler<Block> m_dynBlocksHandler;
+  std::vector<struct ColElement<Block> *> m_queuedDynBlocks;
+  // the dynamic blocks near the queries of the physics
+  ElementsQuery<Block> m_dynBlocksQuery;
   /* TODO::zones
   ElementHandler<Zone>   m_zonesHandler;
   */
@@ -237,12 +263,45 @@ private:
   float m_fCellWidth, m_fCellHeight;
   int m_nGridWidth, m_nGridHeight;
 
-  GridCell *m_pGrid;
+  /* the lines of the cell i are the ones from m_gridOffsets[i] to
+     m_gridOffsets[i + 1] - 1 ; they are stored by component, so that a query
+     reads the lines of a cell contiguously */
+  bool m_bGridCompiled;
+  std::vector<unsigned int> m_gridOffsets;
+  std::vector<float> m_gridX1, m_gridY1, m_gridX2, m_gridY2;
+  std::vector<float> m_gridGrip;
+  std::vector<Line *> m_gridLines; // only for the debug information
+  /* bounding boxes of the lines, for the first pass of the circle queries */
+  std::vector<float> m_gridMinX, m_gridMinY, m_gridMaxX, m_gridMaxY;
+  std::vector<unsigned int> m_gridCandidates; // as big as the biggest cell
 
   bool m_bDynamicTouched;
 
   /* Helpers */
-  bool _CheckCircleAndLine(Line *pLine, float x, float y, float r);
+  void _getCellsRange(float fMinX,
+                      float fMinY,
+                      float fMaxX,
+                      float fMaxY,
+                      int &o_nMinCX,
+                      int &o_nMinCY,
+                      int &o_nMaxCX,
+                      int &o_nMaxCY);
+  unsigned int _getCellLinesNearBox(int i,
+                                    float fMinX,
+                                    float fMinY,
+                                    float fMaxX,
+                                    float fMaxY);
+  bool _CheckCircleAndLine(Line *pLine, float x, float y, float r) {
+    return _CheckCircleAndLine(
+      pLine->x1, pLine->y1, pLine->x2, pLine->y2, x, y, r);
+  }
+  bool _CheckCircleAndLine(float x1,
+                           float y1,
+                           float x2,
+                           float y2,
+                           float x,
+                           float y,
+                           float r);
   int _CollideCircleAndLine(Line *pLine,
                             float x,
                             float y,
@@ -251,7 +310,34 @@ private:
                             int nOldNumC,
                             int nMaxC,
                             float fGrip,
-                            PhysicsSettings *i_physicsSettings);
+                            PhysicsSettings *i_physicsSettings) {
+    return _CollideCircleAndLine(pLine->x1,
+                                 pLine->y1,
+                                 pLine->x2,
+                                 pLine->y2,
+                                 x,
+                                 y,
+                                 r,
+                                 pContacts,
+                                 nOldNumC,
+                                 nMaxC,
+                                 fGrip,
+                                 i_physicsSettings,
+                                 pLine);
+  }
+  int _CollideCircleAndLine(float x1,
+                            float y1,
+                            float x2,
+                            float y2,
+                            float x,
+                            float y,
+                            float r,
+                            dContact *pContacts,
+                            int nOldNumC,
+                            int nMaxC,
+                            float fGrip,
+                            PhysicsSettings *i_physicsSettings,
+                            Line *pDebugLine);
   void _SetWheelContactParams(dContact *pc,
                               const Vector2f &Pos,
                               const Vector2f &NormalT,
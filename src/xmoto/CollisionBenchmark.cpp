@@ -0,0 +1,157 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "CollisionBenchmark.h"
+#include "CollisionFilter.h"
+#include "helpers/System.h"
+#include "helpers/VExcept.h"
+#include "xmscene/Block.h"
+#include "xmscene/Level.h"
+#include "xmscene/PhysicsSettings.h"
+#include "xmscene/Scene.h"
+
+#define XM_COLLISION_BENCHMARK_QUERIES 100000 // per level
+#define XM_COLLISION_BENCHMARK_MAX_CONTACTS 100
+
+CollisionBenchmark::CollisionBenchmark(xmDatabase *i_db)
+  : LevelsBenchmark(i_db) {
+  m_duration = 0;
+  m_nbContacts = 0;
+  m_nbQueries = 0;
+}
+
+CollisionBenchmark::~CollisionBenchmark() {}
+
+void CollisionBenchmark::beginRun() {
+  m_duration = 0;
+  m_nbContacts = 0;
+  m_nbQueries = 0;
+}
+
+void CollisionBenchmark::benchmarkLevel(Scene *i_scene,
+                                        const std::string &i_id_level) {
+  LevelResult v_result;
+
+  v_result.id_level = i_id_level;
+  v_result.nbLines = 0;
+  v_result.nbQueries = 0;
+  v_result.nbContacts = 0;
+  v_result.duration = 0;
+
+  i_scene->prePlayLevel(NULL, false, true, false);
+  runQueries(i_scene, v_result);
+  printResult(v_result);
+
+  m_duration += v_result.duration;
+  m_nbContacts += v_result.nbContacts;
+  m_nbQueries += v_result.nbQueries;
+}
+
+void CollisionBenchmark::levelFailed(const std::string &i_id_level,
+                                     const std::string &i_error) {
+  printf("%s: ERROR (%s)\n", i_id_level.c_str(), i_error.c_str());
+}
+
+void CollisionBenchmark::endRun(unsigned int i_nbLevels) {
+  printf(" * %llu queries on %u levels in %.2f seconds\n",
+         m_nbQueries,
+         i_nbLevels,
+         m_duration / 1000000.0);
+  if (m_duration > 0) {
+    printf(" * %.0f queries/s, %.0f contacts/s\n",
+           m_nbQueries * 1000000.0 / m_duration,
+           m_nbContacts * 1000000.0 / m_duration);
+  }
+  printf(" * lines filtered with %s\n",
+         CollisionFilter::implementation().c_str());
+}
+
+void CollisionBenchmark::runQueries(Scene *i_scene, LevelResult &io_result) {
+  std::vector<Vector2f> v_vertices;
+  std::vector<Vector2f> v_centers;
+  CollisionSystem *v_collision = i_scene->getCollisionHandler();
+  PhysicsSettings *v_physicsSettings = i_scene->getPhysicsSettings();
+  float v_radius = v_physicsSettings->BikeWheelRadius();
+  dContact v_contacts[XM_COLLISION_BENCHMARK_MAX_CONTACTS];
+  CollisionSystemStats v_stats;
+  unsigned int v_seed = 1;
+  unsigned long long v_start;
+
+  /* the queries are made where the wheels roll : near the lines */
+  std::vector<Block *> &v_blocks = i_scene->getLevelSrc()->Blocks();
+  for (unsigned int i = 0; i < v_blocks.size(); i++) {
+    if (v_blocks[i]->isBackground() || v_blocks[i]->isDynamic() ||
+        v_blocks[i]->getLayer() != -1) {
+      continue;
+    }
+    for (unsigned int j = 0; j < v_blocks[i]->Vertices().size(); j++) {
+      v_vertices.push_back(v_blocks[i]->DynamicPosition() +
+                           v_blocks[i]->Vertices()[j]->Position());
+    }
+  }
+  if (v_vertices.size() == 0) {
+    throw Exception("no static block");
+  }
+
+  /* same pseudo random centers for all the runs */
+  for (unsigned int i = 0; i < XM_COLLISION_BENCHMARK_QUERIES; i++) {
+    Vector2f v_center;
+
+    v_seed = v_seed * 1103515245 + 12345;
+    v_center = v_vertices[(v_seed >> 8) % v_vertices.size()];
+    v_seed = v_seed * 1103515245 + 12345;
+    v_center.x += v_radius * (((v_seed >> 8) & 0xffff) / 32768.0 - 1.0);
+    v_seed = v_seed * 1103515245 + 12345;
+    v_center.y += v_radius * (((v_seed >> 8) & 0xffff) / 32768.0 - 1.0);
+    v_centers.push_back(v_center);
+  }
+
+  v_collision->getStats(&v_stats);
+  io_result.nbLines = v_stats.nTotalLines;
+
+  v_start = System::getTimeUs();
+  for (unsigned int i = 0; i < v_centers.size(); i++) {
+    io_result.nbContacts +=
+      v_collision->collideCircle(v_centers[i].x,
+                                 v_centers[i].y,
+                                 v_radius,
+                                 v_contacts,
+                                 XM_COLLISION_BENCHMARK_MAX_CONTACTS,
+                                 v_physicsSettings);
+  }
+  io_result.duration = System::getTimeUs() - v_start;
+  io_result.nbQueries = v_centers.size();
+}
+
+void CollisionBenchmark::printResult(const LevelResult &i_result) {
+  printf("%s: lines=%u queries=%u contacts=%llu (%.1f ms, %.0f queries/s, "
+         "%.0f contacts/s)\n",
+         i_result.id_level.c_str(),
+         i_result.nbLines,
+         i_result.nbQueries,
+         i_result.nbContacts,
+         i_result.duration / 1000.0,
+         i_result.duration > 0
+           ? i_result.nbQueries * 1000000.0 / i_result.duration
+           : 0.0,
+         i_result.duration > 0
+           ? i_result.nbContacts * 1000000.0 / i_result.duration
+           : 0.0);
+}
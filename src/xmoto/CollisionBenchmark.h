@@ -0,0 +1,60 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __COLLISIONBENCHMARK_H__
+#define __COLLISIONBENCHMARK_H__
+
+#include "LevelsBenchmark.h"
+
+/*
+  loads levels without graphics and times the wheel queries of the collision
+  system on them : circles of the size of a wheel around the vertices of the
+  static blocks, always the same ones for a level
+*/
+class CollisionBenchmark : public LevelsBenchmark {
+public:
+  CollisionBenchmark(xmDatabase *i_db);
+  ~CollisionBenchmark();
+
+protected:
+  void beginRun();
+  void benchmarkLevel(Scene *i_scene, const std::string &i_id_level);
+  void levelFailed(const std::string &i_id_level, const std::string &i_error);
+  void endRun(unsigned int i_nbLevels);
+
+private:
+  struct LevelResult {
+    std::string id_level;
+    unsigned int nbLines;
+    unsigned int nbQueries;
+    unsigned long long nbContacts;
+    unsigned long long duration; // us
+  };
+
+  void runQueries(Scene *i_scene, LevelResult &io_result);
+  void printResult(const LevelResult &i_result);
+
+  // all the levels
+  unsigned long long m_duration;
+  unsigned long long m_nbContacts;
+  unsigned long long m_nbQueries;
+};
+
+#endif
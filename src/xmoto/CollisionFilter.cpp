@@ -0,0 +1,222 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "CollisionFilter.h"
+
+/* the vector versions need the gcc/clang builtins to be chosen at runtime */
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define XM_COLLISION_FILTER_X86
+#include <immintrin.h>
+#endif
+
+typedef unsigned int (*LinesInBoxFunction)(const float *i_linesMinX,
+                                           const float *i_linesMinY,
+                                           const float *i_linesMaxX,
+                                           const float *i_linesMaxY,
+                                           unsigned int i_begin,
+                                           unsigned int i_end,
+                                           float i_boxMinX,
+                                           float i_boxMinY,
+                                           float i_boxMaxX,
+                                           float i_boxMaxY,
+                                           unsigned int *o_lines);
+
+static unsigned int linesInBoxScalar(const float *i_linesMinX,
+                                     const float *i_linesMinY,
+                                     const float *i_linesMaxX,
+                                     const float *i_linesMaxY,
+                                     unsigned int i_begin,
+                                     unsigned int i_end,
+                                     float i_boxMinX,
+                                     float i_boxMinY,
+                                     float i_boxMaxX,
+                                     float i_boxMaxY,
+                                     unsigned int *o_lines) {
+  unsigned int n = 0;
+
+  for (unsigned int i = i_begin; i < i_end; i++) {
+    if (i_linesMaxX[i] >= i_boxMinX && i_linesMinX[i] <= i_boxMaxX &&
+        i_linesMaxY[i] >= i_boxMinY && i_linesMinY[i] <= i_boxMaxY) {
+      o_lines[n++] = i;
+    }
+  }
+
+  return n;
+}
+
+#ifdef XM_COLLISION_FILTER_X86
+__attribute__((target("sse2"))) static unsigned int linesInBoxSSE2(
+  const float *i_linesMinX,
+  const float *i_linesMinY,
+  const float *i_linesMaxX,
+  const float *i_linesMaxY,
+  unsigned int i_begin,
+  unsigned int i_end,
+  float i_boxMinX,
+  float i_boxMinY,
+  float i_boxMaxX,
+  float i_boxMaxY,
+  unsigned int *o_lines) {
+  __m128 v_boxMinX = _mm_set1_ps(i_boxMinX);
+  __m128 v_boxMinY = _mm_set1_ps(i_boxMinY);
+  __m128 v_boxMaxX = _mm_set1_ps(i_boxMaxX);
+  __m128 v_boxMaxY = _mm_set1_ps(i_boxMaxY);
+  unsigned int n = 0;
+  unsigned int i = i_begin;
+
+  for (; i + 4 <= i_end; i += 4) {
+    __m128 v_in =
+      _mm_and_ps(_mm_cmpge_ps(_mm_loadu_ps(i_linesMaxX + i), v_boxMinX),
+                 _mm_cmple_ps(_mm_loadu_ps(i_linesMinX + i), v_boxMaxX));
+    v_in = _mm_and_ps(v_in,
+                      _mm_cmpge_ps(_mm_loadu_ps(i_linesMaxY + i), v_boxMinY));
+    v_in = _mm_and_ps(v_in,
+                      _mm_cmple_ps(_mm_loadu_ps(i_linesMinY + i), v_boxMaxY));
+
+    /* one bit per line in the box */
+    int v_mask = _mm_movemask_ps(v_in);
+    while (v_mask != 0) {
+      o_lines[n++] = i + __builtin_ctz(v_mask);
+      v_mask &= v_mask - 1;
+    }
+  }
+
+  return n + linesInBoxScalar(i_linesMinX,
+                              i_linesMinY,
+                              i_linesMaxX,
+                              i_linesMaxY,
+                              i,
+                              i_end,
+                              i_boxMinX,
+                              i_boxMinY,
+                              i_boxMaxX,
+                              i_boxMaxY,
+                              o_lines + n);
+}
+
+__attribute__((target("avx"))) static unsigned int linesInBoxAVX(
+  const float *i_linesMinX,
+  const float *i_linesMinY,
+  const float *i_linesMaxX,
+  const float *i_linesMaxY,
+  unsigned int i_begin,
+  unsigned int i_end,
+  float i_boxMinX,
+  float i_boxMinY,
+  float i_boxMaxX,
+  float i_boxMaxY,
+  unsigned int *o_lines) {
+  __m256 v_boxMinX = _mm256_set1_ps(i_boxMinX);
+  __m256 v_boxMinY = _mm256_set1_ps(i_boxMinY);
+  __m256 v_boxMaxX = _mm256_set1_ps(i_boxMaxX);
+  __m256 v_boxMaxY = _mm256_set1_ps(i_boxMaxY);
+  unsigned int n = 0;
+  unsigned int i = i_begin;
+
+  for (; i + 8 <= i_end; i += 8) {
+    __m256 v_in = _mm256_and_ps(
+      _mm256_cmp_ps(_mm256_loadu_ps(i_linesMaxX + i), v_boxMinX, _CMP_GE_OQ),
+      _mm256_cmp_ps(_mm256_loadu_ps(i_linesMinX + i), v_boxMaxX, _CMP_LE_OQ));
+    v_in = _mm256_and_ps(
+      v_in,
+      _mm256_cmp_ps(_mm256_loadu_ps(i_linesMaxY + i), v_boxMinY, _CMP_GE_OQ));
+    v_in = _mm256_and_ps(
+      v_in,
+      _mm256_cmp_ps(_mm256_loadu_ps(i_linesMinY + i), v_boxMaxY, _CMP_LE_OQ));
+
+    /* one bit per line in the box */
+    int v_mask = _mm256_movemask_ps(v_in);
+    while (v_mask != 0) {
+      o_lines[n++] = i + __builtin_ctz(v_mask);
+      v_mask &= v_mask - 1;
+    }
+  }
+
+  return n + linesInBoxScalar(i_linesMinX,
+                              i_linesMinY,
+                              i_linesMaxX,
+                              i_linesMaxY,
+                              i,
+                              i_end,
+                              i_boxMinX,
+                              i_boxMinY,
+                              i_boxMaxX,
+                              i_boxMaxY,
+                              o_lines + n);
+}
+#endif
+
+static LinesInBoxFunction chooseLinesInBox(std::string &o_name) {
+#ifdef XM_COLLISION_FILTER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx")) {
+    o_name = "avx";
+    return linesInBoxAVX;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    o_name = "sse2";
+    return linesInBoxSSE2;
+  }
+#endif
+  o_name = "scalar";
+  return linesInBoxScalar;
+}
+
+/* chosen once, the first time it's required */
+static LinesInBoxFunction linesInBoxFunction(std::string *o_name = NULL) {
+  static std::string s_name;
+  static LinesInBoxFunction s_function = chooseLinesInBox(s_name);
+
+  if (o_name != NULL) {
+    *o_name = s_name;
+  }
+  return s_function;
+}
+
+unsigned int CollisionFilter::linesInBox(const float *i_linesMinX,
+                                         const float *i_linesMinY,
+                                         const float *i_linesMaxX,
+                                         const float *i_linesMaxY,
+                                         unsigned int i_begin,
+                                         unsigned int i_end,
+                                         float i_boxMinX,
+                                         float i_boxMinY,
+                                         float i_boxMaxX,
+                                         float i_boxMaxY,
+                                         unsigned int *o_lines) {
+  return linesInBoxFunction()(i_linesMinX,
+                              i_linesMinY,
+                              i_linesMaxX,
+                              i_linesMaxY,
+                              i_begin,
+                              i_end,
+                              i_boxMinX,
+                              i_boxMinY,
+                              i_boxMaxX,
+                              i_boxMaxY,
+                              o_lines);
+}
+
+std::string CollisionFilter::implementation() {
+  std::string v_name;
+
+  linesInBoxFunction(&v_name);
+  return v_name;
+}
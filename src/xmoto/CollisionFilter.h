@@ -0,0 +1,53 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __COLLISIONFILTER_H__
+#define __COLLISIONFILTER_H__
+
+#include <string>
+
+/*
+  first pass of the circle queries of the collision system : keeps the lines
+  whose bounding box touches the box of the query, several lines at once with
+  the vector instructions of the cpu. The kept lines are then checked one by
+  one, as before, so that the contacts don't change.
+*/
+class CollisionFilter {
+public:
+  /* write in o_lines the indexes, between i_begin and i_end - 1, of the lines
+     touching the box, in order ; return their number. The lines are given by
+     the bounds of their boxes */
+  static unsigned int linesInBox(const float *i_linesMinX,
+                                 const float *i_linesMinY,
+                                 const float *i_linesMaxX,
+                                 const float *i_linesMaxY,
+                                 unsigned int i_begin,
+                                 unsigned int i_end,
+                                 float i_boxMinX,
+                                 float i_boxMinY,
+                                 float i_boxMaxX,
+                                 float i_boxMaxY,
+                                 unsigned int *o_lines);
+
+  /* the implementation chosen for this cpu : "avx", "sse2" or "scalar" */
+  static std::string implementation();
+};
+
+#endif
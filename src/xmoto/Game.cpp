@@ -36,6 +36,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "drawlib/DrawLib.h"
 #include "gui/specific/GUIXMoto.h"
 #include "helpers/Log.h"
+#include "helpers/System.h"
 #include "helpers/Text.h"
 #include "xmscene/Bike.h"
 #include "xmscene/BikeGhost.h"
@@ -52,10 +53,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "states/StatePause.h"
 #include "states/StatePlaying.h"
 #include "states/StatePreplaying.h"
+#include "thread/XMThreadPool.h"
 #include "thread/XMThreadStats.h"
 #include <curl/curl.h>
 #include <iomanip>
+#include <set>
 #include <sstream>
+#include <sys/stat.h>
 
 void GameApp::getMousePos(int *pnX, int *pnY) {
   SDL_GetMouseState(pnX, pnY);
@@ -104,9 +108,14 @@ int GameApp::getXMTimeInt(void) {
 /*===========================================================================
 Quits the application
 ===========================================================================*/
-void GameApp::quit(void) {
+void GameApp::quit(int i_exitCode) {
   /* Set quit flag */
   m_bQuit = true;
+  m_exitCode = i_exitCode;
+}
+
+int GameApp::exitCode() const {
+  return m_exitCode;
 }
 
 /*===========================================================================
@@ -164,6 +173,7 @@ GameApp::~GameApp() {
 
 GameApp::GameApp() {
   m_bQuit = false;
+  m_exitCode = 0;
   drawLib = NULL;
 
   m_pNotifyMsgBox = NULL;
@@ -503,30 +513,139 @@ void GameApp::reloadTheme() {
   }
 }
 
+/* reads the header of a replay file on a pool thread */
+class ReplayInfosTask : public XMThreadPoolTask {
+public:
+  ReplayInfosTask(const std::string &i_file,
+                  const std::string &i_name,
+                  long long i_size,
+                  long long i_mtime) {
+    m_file = i_file;
+    m_name = i_name;
+    m_size = i_size;
+    m_mtime = i_mtime;
+    m_infos = NULL;
+  }
+
+  ~ReplayInfosTask() {
+    if (m_infos != NULL) {
+      delete m_infos;
+    }
+  }
+
+  void execute() {
+    try {
+      m_infos = Replay::getReplayInfosFromFile(m_file, m_name);
+    } catch (Exception &e) {
+      m_infos = NULL;
+    }
+  }
+
+  std::string m_file;
+  std::string m_name;
+  long long m_size;
+  long long m_mtime;
+  ReplayInfo *m_infos; // NULL if the replay is invalid
+};
+
 void GameApp::initReplaysFromDir(
   xmDatabase *threadDb,
   XMotoLoadReplaysInterface *pLoadReplaysInterface) {
   std::vector<std::string> ReplayFiles;
+  std::map<std::string, std::pair<long long, long long> > v_stamps;
+  std::map<std::string, std::pair<long long, long long> >::iterator v_stamp;
+  std::vector<ReplayInfosTask *> v_tasks;
+  std::set<std::string> v_names;
+  std::string v_name;
+  struct stat v_st;
+  long long v_size, v_mtime;
 
   ReplayFiles = XMFS::findPhysFiles(FDT_DATA, "Replays/*.rpl");
-  threadDb->replays_add_begin();
+  threadDb->replays_fileStamps(v_stamps);
 
+  /* the files which didn't change since they were read are kept as is ; the
+     user dir is listed first, its replays hide the ones of the data dir */
   for (unsigned int i = 0; i < ReplayFiles.size(); i++) {
-    try {
-      if (XMFS::getFileBaseName(ReplayFiles[i]) == "Latest") {
+    v_name = XMFS::getFileBaseName(ReplayFiles[i]);
+    if (v_name == "Latest" || v_names.insert(v_name).second == false) {
+      continue;
+    }
+
+    v_size = v_mtime = -1; // files of the package : always read
+    if (stat(ReplayFiles[i].c_str(), &v_st) == 0) {
+      v_size = (long long)v_st.st_size;
+      v_mtime = (long long)v_st.st_mtime;
+    }
+
+    v_stamp = v_stamps.find(v_name);
+    if (v_stamp != v_stamps.end()) {
+      if (v_size != -1 && v_stamp->second.first == v_size &&
+          v_stamp->second.second == v_mtime) {
+        v_stamps.erase(v_stamp); // up to date
         continue;
       }
-      addReplay(ReplayFiles[i], threadDb, false);
+    }
+
+    v_tasks.push_back(
+      new ReplayInfosTask(ReplayFiles[i], v_name, v_size, v_mtime));
+  }
+
+  if (v_tasks.empty() && v_stamps.empty()) {
+    return;
+  }
+
+  /* the headers are read on the pool while the database is updated in the
+     files order, in one transaction */
+  XMThreadPool *v_pool = NULL;
+  if (v_tasks.size() > 1) {
+    v_pool = new XMThreadPool(System::getNumberOfCpus());
+    for (unsigned int i = 0; i < v_tasks.size(); i++) {
+      v_pool->addTask(v_tasks[i]);
+    }
+  }
+
+  threadDb->replays_add_begin();
+
+  /* changed or removed files */
+  for (v_stamp = v_stamps.begin(); v_stamp != v_stamps.end(); ++v_stamp) {
+    threadDb->replays_delete(v_stamp->first);
+  }
+
+  for (unsigned int i = 0; i < v_tasks.size(); i++) {
+    if (v_pool != NULL) {
+      v_pool->waitTask(v_tasks[i]);
+    } else {
+      v_tasks[i]->execute();
+    }
+
+    try {
+      if (v_tasks[i]->m_infos != NULL) {
+        threadDb->replays_add(v_tasks[i]->m_infos->Level,
+                              v_tasks[i]->m_infos->Name,
+                              v_tasks[i]->m_infos->Player,
+                              v_tasks[i]->m_infos->IsFinished,
+                              v_tasks[i]->m_infos->finishTime,
+                              v_tasks[i]->m_size,
+                              v_tasks[i]->m_mtime);
+      }
       if (pLoadReplaysInterface != NULL) {
         pLoadReplaysInterface->loadReplayHook(
-          ReplayFiles[i], (int)((i * 100) / ((float)ReplayFiles.size())));
+          v_tasks[i]->m_file, (int)((i * 100) / ((float)v_tasks.size())));
       }
 
     } catch (Exception &e) {
       // ok, forget this replay
     }
   }
+
   threadDb->replays_add_end();
+
+  if (v_pool != NULL) {
+    delete v_pool;
+  }
+  for (unsigned int i = 0; i < v_tasks.size(); i++) {
+    delete v_tasks[i];
+  }
 }
 
 void GameApp::addReplay(const std::string &i_file,
@@ -90,7 +90,8 @@ public:
   static float timeToFloat(int i_time);
   static int floatToTime(float ftime);
 
-  void quit(void);
+  void quit(int i_exitCode = 0);
+  int exitCode() const; // status of the process, set by quit()
   static void getMousePos(int *pnX, int *pnY);
 
   Img *grabScreen(void);
@@ -264,6 +265,7 @@ private:
 
   /* Run-time fun */
   bool m_bQuit; /* Quit flag */
+  int m_exitCode;
 
   // calculate sleeping time
   int m_lastFrameTimeStamp;
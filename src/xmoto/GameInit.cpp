@@ -32,10 +32,15 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "helpers/Environment.h"
 #include "helpers/Log.h"
 #include "helpers/Random.h"
+#include "helpers/System.h"
 
+#include "CollisionBenchmark.h"
 #include "Credits.h"
 #include "GeomsManager.h"
+#include "PhysicsBenchmark.h"
+#include "RenderBenchmark.h"
 #include "Replay.h"
+#include "ReplayVerifier.h"
 #include "SysMessage.h"
 #include "XMDemo.h"
 #include "common/Packager.h"
@@ -64,6 +69,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "net/ActionReader.h"
 #include "net/NetActions.h"
 #include "net/NetClient.h"
+#include "net/NetLoadClient.h"
 #include "net/NetServer.h"
 
 #if !defined(WIN32)
@@ -111,10 +117,13 @@ int main(int nNumArgs, char **ppcArgs) {
   }
 #endif
 
+  int v_exitCode = 0;
+
   /* Start application */
   try {
     /* Setup basic info */
     GameApp::instance()->run(nNumArgs, ppcArgs);
+    v_exitCode = GameApp::instance()->exitCode();
     GameApp::destroy();
   } catch (Exception &e) {
     if (Logger::isInitialized()) {
@@ -135,7 +144,7 @@ int main(int nNumArgs, char **ppcArgs) {
     MessageBox(NULL, cBuf, "X-Moto Error", MB_OK | MB_ICONERROR);
 #endif
   }
-  return 0;
+  return v_exitCode;
 }
 
 void xmexit_term(int i_signal) {
@@ -270,10 +279,39 @@ void GameApp::run_load(int nNumArgs, char **ppcArgs) {
   LogInfo("User config directory: %s", XMFS::getUserDir(FDT_CONFIG).c_str());
   LogInfo("User cache  directory: %s", XMFS::getUserDir(FDT_CACHE).c_str());
   LogInfo("System data directory: %s", XMFS::getSystemDataDir().c_str());
+  LogInfo("Package: %u files loaded and indexed in %.3f ms",
+          XMFS::packFilesNumber(),
+          XMFS::packLoadingTime() / 1000.0);
+
+  /* simulated players, to measure a server */
+  if (v_xmArgs.isOptLoadClients()) {
+    if (SDLNet_Init() == -1) {
+      throw Exception(SDLNet_GetError());
+    }
+
+    try {
+      NetLoadClient v_loadClient(
+        "localhost",
+        v_xmArgs.isOptServerPort() ? v_xmArgs.getOptServerPort_value()
+                                   : XMSession::instance()->serverPort(),
+        v_xmArgs.getOptLoadClients_value(),
+        v_xmArgs.isOptLoadClientsDuration()
+          ? v_xmArgs.getOptLoadClientsDuration_value()
+          : XM_LOADCLIENT_DEFAULT_DURATION);
+      v_loadClient.run();
+    } catch (Exception &e) {
+      LogError((std::string("Exception: ") + e.getMsg()).c_str());
+    }
+
+    quit();
+    return;
+  }
 
   if (v_xmArgs.isOptListLevels() || v_xmArgs.isOptListReplays() ||
       v_xmArgs.isOptReplayInfos() || v_xmArgs.isOptServerOnly() ||
-      v_xmArgs.isOptUpdateLevelsOnly()) {
+      v_xmArgs.isOptUpdateLevelsOnly() || v_xmArgs.isOptVerifyReplays() ||
+      v_xmArgs.isOptBenchmarkCollisions() ||
+      v_xmArgs.isOptBenchmarkPhysics()) {
     v_useGraphics = false;
   }
 
@@ -442,7 +480,10 @@ void GameApp::run_load(int nNumArgs, char **ppcArgs) {
     v_updateAfterInitDone = true;
   }
 
-  if (v_xmArgs.isOptServerOnly() == false) {
+  if (v_xmArgs.isOptServerOnly() == false &&
+      v_xmArgs.isOptVerifyReplays() == false &&
+      v_xmArgs.isOptBenchmarkCollisions() == false &&
+      v_xmArgs.isOptBenchmarkPhysics() == false) {
     try {
       reloadTheme();
     } catch (Exception &e) {
@@ -506,6 +547,15 @@ void GameApp::run_load(int nNumArgs, char **ppcArgs) {
   }
   if (v_xmArgs.isOptReplay()) {
     m_PlaySpecificReplay = v_xmArgs.getOpt_replay_file();
+
+    /* the next replays are played once the first one is finished */
+    if (XMSession::instance()->benchmark()) {
+      for (unsigned int i = 1; i < v_xmArgs.getOpt_replay_files().size();
+           i++) {
+        RenderBenchmark::instance()->addReplay(
+          v_xmArgs.getOpt_replay_files()[i]);
+      }
+    }
   }
   if (v_xmArgs.isOptDemo()) {
     /* demo : download the level and the replay
@@ -575,12 +625,15 @@ void GameApp::run_load(int nNumArgs, char **ppcArgs) {
   }
 
   /* requires graphics now */
-  if (v_useGraphics == false && v_xmArgs.isOptServerOnly() == false) {
+  if (v_useGraphics == false && v_xmArgs.isOptServerOnly() == false &&
+      v_xmArgs.isOptVerifyReplays() == false &&
+      v_xmArgs.isOptBenchmarkCollisions() == false &&
+      v_xmArgs.isOptBenchmarkPhysics() == false) {
     quit();
     return;
   }
 
-  if (v_xmArgs.isOptServerOnly() == false) {
+  if (v_useGraphics) {
     _UpdateLoadingScreen();
 
     /* Find all files in the textures dir and load them */
@@ -628,7 +681,7 @@ void GameApp::run_load(int nNumArgs, char **ppcArgs) {
   LevelsManager::checkPrerequires();
 
   // don't need to create packs in server mode
-  if (v_xmArgs.isOptServerOnly() == false) {
+  if (v_useGraphics) {
     LevelsManager::instance()->makePacks(XMSession::instance()->profile(),
                                          XMSession::instance()->idRoom(0),
                                          XMSession::instance()->debug(),
@@ -637,7 +690,7 @@ void GameApp::run_load(int nNumArgs, char **ppcArgs) {
   }
 
   /* Update stats */
-  if (v_xmArgs.isOptServerOnly() == false) {
+  if (v_useGraphics) {
     if (XMSession::instance()->profile() != "") {
       pDb->stats_xmotoStarted(XMSession::instance()->sitekey(),
                               XMSession::instance()->profile());
@@ -649,6 +702,68 @@ void GameApp::run_load(int nNumArgs, char **ppcArgs) {
     _UpdateLoadingShell(); // no more loading screen
   }
 
+  if (v_xmArgs.isOptVerifyReplays()) {
+    int v_exitCode = 0;
+
+    try {
+      ReplayVerifier v_verifier(pDb,
+                                v_xmArgs.isOptVerifyThreads()
+                                  ? v_xmArgs.getOptVerifyThreads_value()
+                                  : System::getNumberOfCpus());
+
+      for (unsigned int i = 0;
+           i < v_xmArgs.getOptVerifyReplays_files().size();
+           i++) {
+        v_verifier.addReplay(v_xmArgs.getOptVerifyReplays_files()[i]);
+      }
+      if (v_verifier.run() > 0) {
+        v_exitCode = 1; // some replays are invalid
+      }
+    } catch (Exception &e) {
+      LogError((std::string("Exception: ") + e.getMsg()).c_str());
+      v_exitCode = 2;
+    }
+
+    quit(v_exitCode);
+    return;
+  }
+
+  if (v_xmArgs.isOptBenchmarkCollisions()) {
+    try {
+      CollisionBenchmark v_benchmark(pDb);
+
+      for (unsigned int i = 0;
+           i < v_xmArgs.getOptBenchmarkCollisions_levels().size();
+           i++) {
+        v_benchmark.addLevel(v_xmArgs.getOptBenchmarkCollisions_levels()[i]);
+      }
+      v_benchmark.run();
+    } catch (Exception &e) {
+      LogError((std::string("Exception: ") + e.getMsg()).c_str());
+    }
+
+    quit();
+    return;
+  }
+
+  if (v_xmArgs.isOptBenchmarkPhysics()) {
+    try {
+      PhysicsBenchmark v_benchmark(pDb);
+
+      for (unsigned int i = 0;
+           i < v_xmArgs.getOptBenchmarkPhysics_levels().size();
+           i++) {
+        v_benchmark.addLevel(v_xmArgs.getOptBenchmarkPhysics_levels()[i]);
+      }
+      v_benchmark.run();
+    } catch (Exception &e) {
+      LogError((std::string("Exception: ") + e.getMsg()).c_str());
+    }
+
+    quit();
+    return;
+  }
+
   if (v_xmArgs.isOptServerOnly()) {
     try {
       // start the server
@@ -1000,6 +1115,7 @@ void GameApp::run_unload() {
   LevelsManager::destroy();
   GeomsManager::destroy();
   Theme::destroy();
+  RenderBenchmark::destroy();
   XMSession::destroy("live");
   XMSession::destroy("file");
 
@@ -0,0 +1,67 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "LevelsBenchmark.h"
+#include "db/xmDatabase.h"
+#include "helpers/VExcept.h"
+#include "xmscene/Level.h"
+#include "xmscene/Scene.h"
+
+LevelsBenchmark::LevelsBenchmark(xmDatabase *i_db) {
+  m_db = i_db;
+}
+
+LevelsBenchmark::~LevelsBenchmark() {}
+
+void LevelsBenchmark::addLevel(const std::string &i_id_level) {
+  m_levels.push_back(i_id_level);
+}
+
+void LevelsBenchmark::run() {
+  if (m_levels.size() == 0) {
+    char **v_result;
+    unsigned int nrow;
+
+    v_result =
+      m_db->readDB("SELECT id_level FROM levels ORDER BY id_level;", nrow);
+    for (unsigned int i = 0; i < nrow; i++) {
+      m_levels.push_back(m_db->getResult(v_result, 1, i, 0));
+    }
+    m_db->read_DB_free(v_result);
+  }
+
+  beginRun();
+  for (unsigned int i = 0; i < m_levels.size(); i++) {
+    Scene *v_scene = new Scene();
+
+    try {
+      v_scene->loadLevel(m_db, m_levels[i], true);
+      if (v_scene->getLevelSrc()->isXMotoTooOld()) {
+        throw Exception("level too recent");
+      }
+      benchmarkLevel(v_scene, m_levels[i]);
+    } catch (Exception &e) {
+      levelFailed(m_levels[i], e.getMsg());
+    }
+
+    delete v_scene;
+  }
+  endRun(m_levels.size());
+}
@@ -0,0 +1,59 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __LEVELSBENCHMARK_H__
+#define __LEVELSBENCHMARK_H__
+
+#include <string>
+#include <vector>
+
+class xmDatabase;
+class Scene;
+
+/*
+  benchmark run without graphics on some levels, or on all the levels of the
+  database : each level is loaded into a new scene given to benchmarkLevel()
+*/
+class LevelsBenchmark {
+public:
+  LevelsBenchmark(xmDatabase *i_db);
+  virtual ~LevelsBenchmark();
+
+  // queue a level ; all the levels are benchmarked if none is queued
+  void addLevel(const std::string &i_id_level);
+
+  void run();
+
+protected:
+  virtual void beginRun() {}
+  // exception if the level can't be benchmarked
+  virtual void benchmarkLevel(Scene *i_scene,
+                              const std::string &i_id_level) = 0;
+  virtual void levelFailed(const std::string &i_id_level,
+                           const std::string &i_error) = 0;
+  virtual void endRun(unsigned int i_nbLevels) = 0;
+
+  xmDatabase *m_db;
+
+private:
+  std::vector<std::string> m_levels;
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "LevelsLoader.h"
+#include "common/VXml.h"
+#include "helpers/System.h"
+#include "helpers/VExcept.h"
+#include "thread/XMThreadPool.h"
+#include "xmscene/Level.h"
+#include "xmscene/LevelCacheArchive.h"
+#include "xmscene/LevelCacheManifest.h"
+
+class LevelLoadTask : public XMThreadPoolTask {
+public:
+  LevelLoadTask(const std::string &i_levelFile, bool i_loadMainLayerOnly) {
+    m_levelFile = i_levelFile;
+    m_loadMainLayerOnly = i_loadMainLayerOnly;
+    m_level = new Level();
+  }
+
+  void execute() {
+    try {
+      m_level->setFileName(m_levelFile);
+      m_level->loadReducedFromFile(m_loadMainLayerOnly);
+    } catch (Exception &e) {
+      m_error = e.getMsg();
+      if (m_error == "") {
+        m_error = "unable to load the level";
+      }
+    } catch (...) {
+      m_error = "unable to load the level";
+    }
+  }
+
+  std::string m_levelFile;
+  bool m_loadMainLayerOnly;
+  Level *m_level;
+  std::string m_error;
+};
+
+LevelsLoader::LevelsLoader(bool i_loadMainLayerOnly) {
+  m_loadMainLayerOnly = i_loadMainLayerOnly;
+  m_pool = NULL;
+}
+
+LevelsLoader::~LevelsLoader() {
+  /* the workers still running use the tasks */
+  if (m_pool != NULL) {
+    m_pool->waitTasks();
+    delete m_pool;
+  }
+
+  for (unsigned int i = 0; i < m_tasks.size(); i++) {
+    delete m_tasks[i]->m_level;
+    delete m_tasks[i];
+  }
+}
+
+void LevelsLoader::load(const std::string &i_levelFile) {
+  /* most of the time, all the levels are already known : don't start the
+     threads for nothing */
+  if (m_pool == NULL) {
+    XMLDocument::init();
+    /* the singletons used by the workers are not created thread safely */
+    LevelCacheManifest::instance();
+    LevelCacheArchive::instance();
+    m_pool = new XMThreadPool(System::getNumberOfCpus());
+  }
+
+  LevelLoadTask *v_task = new LevelLoadTask(i_levelFile, m_loadMainLayerOnly);
+  m_tasks.push_back(v_task);
+  m_pool->addTask(v_task);
+}
+
+unsigned int LevelsLoader::nbPending() const {
+  return m_tasks.size();
+}
+
+bool LevelsLoader::isNextLoaded() {
+  if (m_tasks.empty()) {
+    return false;
+  }
+  return m_pool->isTaskExecuted(m_tasks.front());
+}
+
+Level *LevelsLoader::next(std::string &o_error) {
+  if (m_tasks.empty()) {
+    throw Exception("no level to load");
+  }
+
+  LevelLoadTask *v_task = m_tasks.front();
+  m_pool->waitTask(v_task);
+  m_tasks.pop_front();
+
+  Level *v_level = v_task->m_level;
+  o_error = v_task->m_error;
+  delete v_task;
+
+  return v_level;
+}
@@ -0,0 +1,58 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __LEVELSLOADER_H__
+#define __LEVELSLOADER_H__
+
+#include <deque>
+#include <string>
+
+class Level;
+class XMThreadPool;
+class LevelLoadTask;
+
+/**
+ * loads the reduced levels (cache or xml) on a pool of worker threads while
+ * the caller, the only one to touch the database, adds them. Results are
+ * given back in the order the files were queued.
+ */
+class LevelsLoader {
+public:
+  LevelsLoader(bool i_loadMainLayerOnly);
+  ~LevelsLoader();
+
+  // queue a level file to load
+  void load(const std::string &i_levelFile);
+
+  // number of queued levels not taken yet
+  unsigned int nbPending() const;
+  // true if the first queued level is loaded
+  bool isNextLoaded();
+  /* wait for the first queued level and take it ; the caller must delete it.
+     o_error is set to the loading error, if any */
+  Level *next(std::string &o_error);
+
+private:
+  bool m_loadMainLayerOnly;
+  XMThreadPool *m_pool;
+  std::deque<LevelLoadTask *> m_tasks;
+};
+
+#endif
@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "LevelsManager.h"
 #include "GameText.h"
+#include "LevelsLoader.h"
 #include "SysMessage.h"
 #include "common/VFileIO.h"
 #include "common/VXml.h"
@@ -27,6 +28,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "db/xmDatabase.h"
 #include "helpers/Log.h"
 #include "sqlqueries.h"
+#include "xmscene/LevelCacheArchive.h"
+#include "xmscene/LevelCacheManifest.h"
 #include <algorithm>
 #include <sstream>
 #include <time.h>
@@ -883,6 +886,7 @@ void LevelsManager::reloadExternalLevels(
   std::vector<std::string> LvlFiles =
     XMFS::findPhysFiles(FDT_DATA, "Levels/MyLevels/*.lvl", true);
   std::string v_levelName;
+  unsigned int v_nbDone = 0;
 
   // main case : no external level
   if (LvlFiles.size() == 0) {
@@ -890,44 +894,33 @@ void LevelsManager::reloadExternalLevels(
   }
 
   i_db->levels_add_begin(true);
-  for (unsigned int i = 0; i < LvlFiles.size(); i++) {
-    /* add the level from the unloaded levels if possible to make it faster */
-    if (i_db->levels_add_fast(LvlFiles[i], v_levelName, true) == false) {
-      Level *v_level = new Level();
+  LevelsLoader v_loader(i_loadMainLayerOnly);
 
-      try {
-        v_level->setFileName(LvlFiles[i]);
-        v_level->loadReducedFromFile(i_loadMainLayerOnly);
-
-        v_levelName = v_level->Name();
+  for (unsigned int i = 0; i < LvlFiles.size() || v_loader.nbPending() > 0;) {
+    /* add the loaded levels first, waiting for them once all are queued */
+    if (v_loader.isNextLoaded() ||
+        (i >= LvlFiles.size() && v_loader.nbPending() > 0)) {
+      addLoadedLevel(v_loader, i_db, true, v_levelName);
+    } else {
+      const std::string &v_levelFile = LvlFiles[i++];
 
-        // Check for ID conflict
-        if (doesLevelExist(v_level->Id(), i_db)) {
-          throw Exception("Duplicate level ID");
-        }
-        i_db->levels_add(v_level->Id(),
-                         v_level->FileName(),
-                         v_level->Name(),
-                         v_level->Checksum(),
-                         v_level->Author(),
-                         v_level->Description(),
-                         v_level->Date(),
-                         v_level->Music(),
-                         v_level->isScripted(),
-                         v_level->isPhysics(),
-                         true);
-      } catch (Exception &e) {
+      /* add the level from the unloaded levels if possible to make it faster
+       */
+      if (i_db->levels_add_fast(v_levelFile, v_levelName, true) == false) {
+        v_loader.load(v_levelFile);
+        continue;
       }
-      delete v_level;
     }
 
+    v_nbDone++;
     if (i_loadLevelsInterface != NULL) {
       i_loadLevelsInterface->loadLevelHook(v_levelName,
-                                           ((i + 1) * 100) / LvlFiles.size());
+                                           (v_nbDone * 100) / LvlFiles.size());
     }
   }
 
   i_db->levels_add_end();
+  LevelCacheManifest::instance()->save();
 }
 
 void LevelsManager::addExternalLevel(std::string i_levelFile,
@@ -957,6 +950,7 @@ void LevelsManager::addExternalLevel(std::string i_levelFile,
     LogWarning("Unable to add external level (%s)", e.getMsg().c_str());
   }
   delete v_level;
+  LevelCacheManifest::instance()->save();
 }
 
 void LevelsManager::reloadLevelsFromLvl(
@@ -974,58 +968,85 @@ void LevelsManager::reloadInternalLevels(
   std::vector<std::string> LvlFiles =
     XMFS::findPhysFiles(FDT_DATA, "Levels/*.lvl", true);
   std::string v_levelName;
+  unsigned int v_nbDone = 0;
 
   i_db->levels_add_begin(false);
+  LevelsLoader v_loader(i_loadMainLayerOnly);
 
-  for (unsigned int i = 0; i < LvlFiles.size(); i++) {
-    int v_isExternal;
+  for (unsigned int i = 0; i < LvlFiles.size() || v_loader.nbPending() > 0;) {
+    /* add the loaded levels first, waiting for them once all are queued */
+    if (v_loader.isNextLoaded() ||
+        (i >= LvlFiles.size() && v_loader.nbPending() > 0)) {
+      addLoadedLevel(v_loader, i_db, false, v_levelName);
+    } else {
+      int v_isExternal;
 
-    v_isExternal = LvlFiles[i].find("Levels/MyLevels/") != std::string::npos;
-    if (v_isExternal) {
-      continue; // don't load external levels now
-    }
+      v_isExternal = LvlFiles[i].find("Levels/MyLevels/") != std::string::npos;
+      if (v_isExternal) {
+        i++;
+        v_nbDone++;
+        continue; // don't load external levels now
+      }
 
-    /* add the level from the unloaded levels if possible to make it faster */
-    if (i_db->levels_add_fast(LvlFiles[i], v_levelName, false) == false) {
-      Level *v_level = new Level();
+      const std::string &v_levelFile = LvlFiles[i++];
 
-      try {
-        v_level->setFileName(LvlFiles[i]);
-        v_level->loadReducedFromFile(i_loadMainLayerOnly);
-
-        // Check for ID conflict
-        if (doesLevelExist(v_level->Id(), i_db)) {
-          throw Exception("Duplicate level ID");
-        }
-        i_db->levels_add(v_level->Id(),
-                         v_level->FileName(),
-                         v_level->Name(),
-                         v_level->Checksum(),
-                         v_level->Author(),
-                         v_level->Description(),
-                         v_level->Date(),
-                         v_level->Music(),
-                         v_level->isScripted(),
-                         v_level->isPhysics(),
-                         false);
-      } catch (Exception &e) {
-        LogWarning("(just mean that the level has been updated if the level is "
-                   "in xmoto.bin) ** : %s (%s - %s)",
-                   e.getMsg().c_str(),
-                   v_level->Name().c_str(),
-                   v_level->FileName().c_str());
+      /* add the level from the unloaded levels if possible to make it faster
+       */
+      if (i_db->levels_add_fast(v_levelFile, v_levelName, false) == false) {
+        v_loader.load(v_levelFile);
+        continue;
       }
-      v_levelName = v_level->Name();
-      delete v_level;
     }
 
+    v_nbDone++;
     if (i_loadLevelsInterface != NULL) {
       i_loadLevelsInterface->loadLevelHook(v_levelName,
-                                           ((i + 1) * 100) / LvlFiles.size());
+                                           (v_nbDone * 100) / LvlFiles.size());
     }
   }
 
   i_db->levels_add_end();
+  LevelCacheManifest::instance()->save();
+}
+
+void LevelsManager::addLoadedLevel(LevelsLoader &i_loader,
+                                   xmDatabase *i_db,
+                                   bool i_isToReload,
+                                   std::string &o_levelName) {
+  std::string v_error;
+  Level *v_level = i_loader.next(v_error);
+
+  try {
+    if (v_error != "") {
+      throw Exception(v_error);
+    }
+
+    // Check for ID conflict
+    if (doesLevelExist(v_level->Id(), i_db)) {
+      throw Exception("Duplicate level ID");
+    }
+    i_db->levels_add(v_level->Id(),
+                     v_level->FileName(),
+                     v_level->Name(),
+                     v_level->Checksum(),
+                     v_level->Author(),
+                     v_level->Description(),
+                     v_level->Date(),
+                     v_level->Music(),
+                     v_level->isScripted(),
+                     v_level->isPhysics(),
+                     i_isToReload);
+  } catch (Exception &e) {
+    if (i_isToReload == false) {
+      LogWarning("(just mean that the level has been updated if the level is "
+                 "in xmoto.bin) ** : %s (%s - %s)",
+                 e.getMsg().c_str(),
+                 v_level->Name().c_str(),
+                 v_level->FileName().c_str());
+    }
+  }
+  o_levelName = v_level->Name();
+  delete v_level;
 }
 
 void LevelsManager::checkPrerequires() {
@@ -1041,7 +1062,10 @@ void LevelsManager::checkPrerequires() {
 }
 
 void LevelsManager::cleanCache() {
-  /* Find all .blv-files in the directory */
+  LevelCacheArchive::instance()->clear();
+
+  /* remove the .blv-files of the versions caching each level in its own
+     file */
   std::vector<std::string> BlvFiles =
     XMFS::findPhysFiles(FDT_CACHE, "LCache/*.blv");
   for (unsigned int i = 0; i < BlvFiles.size(); i++) {
@@ -1106,8 +1130,18 @@ void LevelsManager::updateLevelsFromLvl(
   WWWAppInterface *pCaller,
   xmDatabase *i_db) {
   Level *v_level;
+  std::string v_error;
   int current = 0;
   float total = 100.0 / (float)(NewLvl.size() + UpdatedLvl.size());
+  LevelsLoader v_loader(i_loadMainLayerOnly);
+
+  /* load all of them at once, they come back in the same order */
+  for (unsigned int i = 0; i < NewLvl.size(); i++) {
+    v_loader.load(NewLvl[i]);
+  }
+  for (unsigned int i = 0; i < UpdatedLvl.size(); i++) {
+    v_loader.load(UpdatedLvl[i]);
+  }
 
   try {
     i_db->levels_addToNew_begin();
@@ -1115,14 +1149,15 @@ void LevelsManager::updateLevelsFromLvl(
 
     /* new */
     for (unsigned int i = 0; i < NewLvl.size(); i++) {
-      v_level = new Level();
+      v_level = v_loader.next(v_error);
 
       try {
         pCaller->setTaskProgress(current * total);
         current++;
 
-        v_level->setFileName(NewLvl[i]);
-        v_level->loadReducedFromFile(i_loadMainLayerOnly);
+        if (v_error != "") {
+          throw Exception(v_error);
+        }
 
         // Check for ID conflict
         if (doesLevelExist(v_level->Id(), i_db)) {
@@ -1148,11 +1183,12 @@ void LevelsManager::updateLevelsFromLvl(
 
     /* updated */
     for (unsigned int i = 0; i < UpdatedLvl.size(); i++) {
-      v_level = new Level();
+      v_level = v_loader.next(v_error);
 
       try {
-        v_level->setFileName(UpdatedLvl[i]);
-        v_level->loadReducedFromFile(i_loadMainLayerOnly);
+        if (v_error != "") {
+          throw Exception(v_error);
+        }
 
         pCaller->setTaskProgress(current * total);
         pCaller->setBeingDownloadedInformation(v_level->Name());
@@ -1177,8 +1213,10 @@ void LevelsManager::updateLevelsFromLvl(
       delete v_level;
     }
     i_db->levels_addToNew_end();
+    LevelCacheManifest::instance()->save();
   } catch (Exception &e) {
     i_db->levels_addToNew_end(); // commit what has been done even if it failed
+    LevelCacheManifest::instance()->save();
     throw e;
   }
 }
@@ -30,6 +30,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define XM_SQLQUERIES_GEN_FILE "./sqlqueries.h"
 
 class WWWAppInterface;
+class LevelsLoader;
 
 class LevelsPack {
 public:
@@ -190,6 +191,11 @@ private:
     xmDatabase *i_db,
     bool i_loadMainLayerOnly,
     XMotoLoadLevelsInterface *i_loadLevelsInterface = NULL);
+  // add the next level of i_loader to the database
+  void addLoadedLevel(LevelsLoader &i_loader,
+                      xmDatabase *i_db,
+                      bool i_isToReload,
+                      std::string &o_levelName);
 
   std::vector<LevelsPack *> m_levelsPacks;
   SDL_mutex *m_levelsPackMutex;
@@ -0,0 +1,203 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "PhysicsBenchmark.h"
+#include "Game.h"
+#include "common/Theme.h"
+#include "helpers/System.h"
+#include "helpers/Text.h"
+#include "helpers/VExcept.h"
+#include "xmscene/BikeController.h"
+#include "xmscene/BikePlayer.h"
+#include "xmscene/Level.h"
+#include "xmscene/Scene.h"
+#include <stdio.h>
+
+#define XM_PHYSICS_BENCHMARK_DURATION 6000 // hundredths, per level
+/* the scripted controls change every this time */
+#define XM_PHYSICS_BENCHMARK_CONTROLS_PERIOD 50 // hundredths
+
+PhaseTimer PhysicsBenchmark::m_timer(PBP_NB_PHASES + 1, PBP_NB_PHASES);
+
+PhysicsBenchmark::PhysicsBenchmark(xmDatabase *i_db)
+  : LevelsBenchmark(i_db) {
+  m_updateTime = 0;
+  m_nbSteps = 0;
+  for (unsigned int j = 0; j < PBP_NB_PHASES; j++) {
+    m_phaseTimes[j] = 0;
+  }
+}
+
+PhysicsBenchmark::~PhysicsBenchmark() {}
+
+void PhysicsBenchmark::beginRun() {
+  m_updateTime = 0;
+  m_nbSteps = 0;
+  for (unsigned int j = 0; j < PBP_NB_PHASES; j++) {
+    m_phaseTimes[j] = 0;
+  }
+
+  printf("%-24s %6s %8s %9s %9s %9s %9s %9s %s\n",
+         "level",
+         "steps",
+         "played",
+         "update",
+         "world",
+         "collide",
+         "level",
+         "other",
+         "end");
+  printf("%-24s %6s %8s %9s %9s %9s %9s %9s\n",
+         "",
+         "",
+         "",
+         "us/step",
+         "us/step",
+         "us/step",
+         "us/step",
+         "us/step");
+}
+
+void PhysicsBenchmark::benchmarkLevel(Scene *i_scene,
+                                      const std::string &i_id_level) {
+  LevelResult v_result;
+
+  v_result.id_level = i_id_level;
+  v_result.nbSteps = 0;
+  v_result.playedTime = 0;
+  v_result.died = false;
+  v_result.finished = false;
+  v_result.updateTime = 0;
+  for (unsigned int j = 0; j < PBP_NB_PHASES; j++) {
+    v_result.phaseTimes[j] = 0;
+  }
+
+  try {
+    play(i_scene, v_result);
+  } catch (Exception &e) {
+    m_timer.stop();
+    throw e;
+  }
+  printResult(v_result);
+
+  m_nbSteps += v_result.nbSteps;
+  m_updateTime += v_result.updateTime;
+  for (unsigned int j = 0; j < PBP_NB_PHASES; j++) {
+    m_phaseTimes[j] += v_result.phaseTimes[j];
+  }
+}
+
+void PhysicsBenchmark::levelFailed(const std::string &i_id_level,
+                                   const std::string &i_error) {
+  printf("%-24s ERROR (%s)\n", i_id_level.c_str(), i_error.c_str());
+}
+
+void PhysicsBenchmark::endRun(unsigned int i_nbLevels) {
+  printf(" * %llu steps on %u levels in %.2f seconds\n",
+         m_nbSteps,
+         i_nbLevels,
+         m_updateTime / 1000000.0);
+  if (m_nbSteps > 0) {
+    printf(" * per step : update %.1f us, world step %.1f us, collisions "
+           "%.1f us, level physics %.1f us\n",
+           (double)m_updateTime / m_nbSteps,
+           (double)m_phaseTimes[PBP_WORLD_STEP] / m_nbSteps,
+           (double)m_phaseTimes[PBP_COLLISIONS] / m_nbSteps,
+           (double)m_phaseTimes[PBP_LEVEL_PHYSICS] / m_nbSteps);
+  }
+}
+
+void PhysicsBenchmark::play(Scene *i_scene, LevelResult &io_result) {
+  PlayerLocalBiker *v_biker;
+  BikeController *v_controller;
+  unsigned int v_seed = 1;
+  unsigned long long v_start;
+
+  i_scene->prePlayLevel(NULL, true, true, false);
+  v_biker = i_scene->addPlayerLocalBiker(
+    0,
+    i_scene->getLevelSrc()->PlayerStart(),
+    DD_RIGHT,
+    Theme::instance(),
+    Theme::instance()->getPlayerTheme(),
+    GameApp::getColorFromPlayerNumber(0),
+    GameApp::getUglyColorFromPlayerNumber(0),
+    false);
+  i_scene->playInitLevel();
+  v_controller = v_biker->getControler();
+
+  m_timer.start();
+
+  while (i_scene->getTime() < XM_PHYSICS_BENCHMARK_DURATION &&
+         v_biker->isDead() == false && v_biker->isFinished() == false) {
+    /* pseudo random controls, the same ones for all the runs */
+    if (io_result.nbSteps % XM_PHYSICS_BENCHMARK_CONTROLS_PERIOD == 0) {
+      v_seed = v_seed * 1103515245 + 12345;
+      if (((v_seed >> 8) & 3) != 0) {
+        v_controller->setBreak(0.0);
+        v_controller->setThrottle(1.0);
+      } else {
+        v_controller->setThrottle(0.0);
+        v_controller->setBreak(1.0);
+      }
+      v_controller->setPull((float)((int)((v_seed >> 10) % 3) - 1));
+      v_controller->setChangeDir(((v_seed >> 12) & 15) == 0);
+    }
+
+    v_start = System::getTimeUs();
+    i_scene->updateLevel(PHYS_STEP_SIZE,
+                         NULL,
+                         NULL,
+                         false,
+                         false /* no particles */,
+                         false /* don't update the died players */);
+    io_result.updateTime += System::getTimeUs() - v_start;
+    io_result.nbSteps++;
+  }
+
+  m_timer.stop();
+  for (unsigned int i = 0; i < PBP_NB_PHASES; i++) {
+    io_result.phaseTimes[i] = m_timer.time(i);
+  }
+  io_result.playedTime = i_scene->getTime();
+  io_result.died = v_biker->isDead();
+  io_result.finished = v_biker->isFinished();
+}
+
+void PhysicsBenchmark::printResult(const LevelResult &i_result) {
+  unsigned long long v_other = i_result.updateTime;
+  /* the biker can be dead before the first step */
+  unsigned int v_nbSteps = i_result.nbSteps > 0 ? i_result.nbSteps : 1;
+
+  for (unsigned int i = 0; i < PBP_NB_PHASES; i++) {
+    v_other -= i_result.phaseTimes[i];
+  }
+
+  printf("%-24s %6u %8s %9.1f %9.1f %9.1f %9.1f %9.1f %s\n",
+         i_result.id_level.c_str(),
+         i_result.nbSteps,
+         formatTime(i_result.playedTime).c_str(),
+         (double)i_result.updateTime / v_nbSteps,
+         (double)i_result.phaseTimes[PBP_WORLD_STEP] / v_nbSteps,
+         (double)i_result.phaseTimes[PBP_COLLISIONS] / v_nbSteps,
+         (double)i_result.phaseTimes[PBP_LEVEL_PHYSICS] / v_nbSteps,
+         (double)v_other / v_nbSteps,
+         i_result.finished ? "finished" : (i_result.died ? "died" : "-"));
+}
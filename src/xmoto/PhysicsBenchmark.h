@@ -0,0 +1,83 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __PHYSICSBENCHMARK_H__
+#define __PHYSICSBENCHMARK_H__
+
+#include "LevelsBenchmark.h"
+#include "helpers/PhaseTimer.h"
+
+// where the time of the physics goes ; a time is charged to one phase only
+enum PhysicsBenchmarkPhase {
+  PBP_WORLD_STEP, // dWorldQuickStep of the bikers
+  PBP_COLLISIONS, // queries of the bikers on the collision system
+  PBP_LEVEL_PHYSICS, // Level::updatePhysics (chipmunk, dynamic blocks)
+  PBP_NB_PHASES
+};
+
+/*
+  loads levels without graphics and plays each one with a local biker driven
+  by always the same scripted controls ; times Scene::updateLevel and the
+  phases of the physics inside it, then prints a table with a line per level.
+  Phases can be nested : the time is always charged to the innermost one.
+*/
+class PhysicsBenchmark : public LevelsBenchmark {
+public:
+  PhysicsBenchmark(xmDatabase *i_db);
+  ~PhysicsBenchmark();
+
+  // running while a level is played ; PBP_NB_PHASES out of the phases
+  static PhaseTimer *timer() { return &m_timer; }
+
+protected:
+  void beginRun();
+  void benchmarkLevel(Scene *i_scene, const std::string &i_id_level);
+  void levelFailed(const std::string &i_id_level, const std::string &i_error);
+  void endRun(unsigned int i_nbLevels);
+
+private:
+  struct LevelResult {
+    std::string id_level;
+    unsigned int nbSteps;
+    int playedTime; // hundredths
+    bool died, finished;
+    unsigned long long updateTime; // us, in Scene::updateLevel
+    unsigned long long phaseTimes[PBP_NB_PHASES]; // us
+  };
+
+  void play(Scene *i_scene, LevelResult &io_result);
+  void printResult(const LevelResult &i_result);
+
+  // all the levels
+  unsigned long long m_updateTime;
+  unsigned long long m_phaseTimes[PBP_NB_PHASES];
+  unsigned long long m_nbSteps;
+
+  static PhaseTimer m_timer;
+};
+
+// charge the time of its scope to a phase while a level is benchmarked
+class PhysicsBenchmarkScope : public PhaseTimerScope {
+public:
+  PhysicsBenchmarkScope(PhysicsBenchmarkPhase i_phase)
+    : PhaseTimerScope(PhysicsBenchmark::timer(), i_phase) {}
+};
+
+#endif
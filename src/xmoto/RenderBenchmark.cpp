@@ -0,0 +1,312 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "RenderBenchmark.h"
+#include "common/VFileIO.h"
+#include "helpers/Log.h"
+#include "helpers/System.h"
+#include <algorithm>
+#include <stdio.h>
+
+bool RenderBenchmark::m_recording = false;
+PhaseTimer RenderBenchmark::m_frameTimer(RBP_NB_PHASES, RBP_OTHER);
+
+RenderBenchmark::RenderBenchmark() {
+  m_replayStart = 0;
+}
+
+RenderBenchmark::~RenderBenchmark() {
+  for (unsigned int i = 0; i < m_frames.size(); i++) {
+    delete m_frames[i];
+  }
+}
+
+void RenderBenchmark::addReplay(const std::string &i_replay) {
+  m_replays.push_back(i_replay);
+}
+
+std::string RenderBenchmark::nextReplay() {
+  std::string v_replay;
+
+  if (m_replays.empty()) {
+    return "";
+  }
+  v_replay = m_replays.front();
+  m_replays.pop_front();
+  return v_replay;
+}
+
+void RenderBenchmark::beginReplay(const std::string &i_replay) {
+  ReplayFrames *v_frames = new ReplayFrames();
+
+  v_frames->replay = i_replay;
+  v_frames->duration = 0;
+  m_frames.push_back(v_frames);
+
+  m_frameTimer.stop();
+  m_replayStart = System::getTimeUs();
+  m_recording = true;
+}
+
+void RenderBenchmark::endReplay() {
+  if (m_recording == false) {
+    return;
+  }
+  endFrame();
+  m_recording = false;
+  m_frames.back()->duration = System::getTimeUs() - m_replayStart;
+}
+
+void RenderBenchmark::nextFrame() {
+  if (m_recording == false) {
+    return;
+  }
+  endFrame();
+  m_frameTimer.start();
+}
+
+void RenderBenchmark::endFrame() {
+  unsigned long long v_total = 0;
+
+  if (m_frameTimer.isRunning() == false) {
+    return;
+  }
+  m_frameTimer.stop();
+
+  for (unsigned int i = 0; i < RBP_NB_PHASES; i++) {
+    m_frames.back()->times[i].push_back(m_frameTimer.time(i));
+    v_total += m_frameTimer.time(i);
+  }
+  m_frames.back()->times[RBP_NB_PHASES].push_back(v_total);
+}
+
+std::string RenderBenchmark::phaseName(RenderBenchmarkPhase i_phase) {
+  switch (i_phase) {
+    case RBP_UPDATE:
+      return "update";
+    case RBP_SKY:
+      return "sky";
+    case RBP_STATIC_BLOCKS:
+      return "static_blocks";
+    case RBP_DYNAMIC_BLOCKS:
+      return "dynamic_blocks";
+    case RBP_SPRITES:
+      return "sprites";
+    case RBP_PARTICLES:
+      return "particles";
+    case RBP_BIKES:
+      return "bikes";
+    case RBP_HUD:
+      return "hud";
+    case RBP_OTHER:
+      return "other";
+    default:
+      return "frame"; // the whole frame
+  }
+}
+
+RenderBenchmark::PhaseStats RenderBenchmark::stats(
+  const std::vector<unsigned int> &i_times) {
+  PhaseStats v_stats;
+  std::vector<unsigned int> v_sorted = i_times;
+  unsigned long long v_sum = 0;
+  unsigned int n = v_sorted.size();
+
+  if (n == 0) {
+    v_stats.mean = v_stats.p50 = v_stats.p90 = v_stats.p99 = v_stats.max = 0;
+    return v_stats;
+  }
+
+  std::sort(v_sorted.begin(), v_sorted.end());
+  for (unsigned int i = 0; i < n; i++) {
+    v_sum += v_sorted[i];
+  }
+
+  // nearest rank
+  v_stats.mean = v_sum / n;
+  v_stats.p50 = v_sorted[(n * 50 + 99) / 100 - 1];
+  v_stats.p90 = v_sorted[(n * 90 + 99) / 100 - 1];
+  v_stats.p99 = v_sorted[(n * 99 + 99) / 100 - 1];
+  v_stats.max = v_sorted[n - 1];
+
+  return v_stats;
+}
+
+void RenderBenchmark::report(const std::string &i_file) {
+  ReplayFrames v_all;
+  PhaseStats v_stats;
+
+  v_all.replay = "all";
+  v_all.duration = 0;
+  for (unsigned int i = 0; i < m_frames.size(); i++) {
+    v_all.duration += m_frames[i]->duration;
+    for (unsigned int j = 0; j < RBP_NB_PHASES + 1; j++) {
+      v_all.times[j].insert(v_all.times[j].end(),
+                            m_frames[i]->times[j].begin(),
+                            m_frames[i]->times[j].end());
+    }
+  }
+
+  printf(" * %u replays, %u frames in %.2f seconds\n",
+         (unsigned int)m_frames.size(),
+         (unsigned int)v_all.times[RBP_NB_PHASES].size(),
+         v_all.duration / 1000000.0);
+  printf("| %14s | %7s | %7s | %7s | %7s | %7s |\n",
+         "us",
+         "mean",
+         "p50",
+         "p90",
+         "p99",
+         "max");
+  for (unsigned int i = 0; i < RBP_NB_PHASES + 1; i++) {
+    v_stats = stats(v_all.times[i]);
+    printf("| %14s | %7llu | %7llu | %7llu | %7llu | %7llu |\n",
+           phaseName((RenderBenchmarkPhase)i).c_str(),
+           v_stats.mean,
+           v_stats.p50,
+           v_stats.p90,
+           v_stats.p99,
+           v_stats.max);
+  }
+
+  if (i_file == "") {
+    return;
+  }
+
+  m_frames.push_back(&v_all);
+  try {
+    if (XMFS::getFileExtension(i_file) == "json") {
+      writeJson(i_file);
+    } else {
+      writeCsv(i_file);
+    }
+  } catch (...) {
+    m_frames.pop_back();
+    throw;
+  }
+  m_frames.pop_back();
+}
+
+void RenderBenchmark::writeCsv(const std::string &i_file) {
+  FILE *v_fd;
+  PhaseStats v_stats;
+
+  v_fd = fopen(i_file.c_str(), "w");
+  if (v_fd == NULL) {
+    LogWarning("Unable to open %s", i_file.c_str());
+    return;
+  }
+
+  fprintf(v_fd, "replay,frames,duration_ms,phase,mean_us,p50_us,p90_us,"
+                "p99_us,max_us\n");
+  for (unsigned int i = 0; i < m_frames.size(); i++) {
+    for (unsigned int j = 0; j < RBP_NB_PHASES + 1; j++) {
+      v_stats = stats(m_frames[i]->times[j]);
+      fprintf(v_fd,
+              "\"%s\",%u,%.1f,%s,%llu,%llu,%llu,%llu,%llu\n",
+              csvEscape(m_frames[i]->replay).c_str(),
+              (unsigned int)m_frames[i]->times[RBP_NB_PHASES].size(),
+              m_frames[i]->duration / 1000.0,
+              phaseName((RenderBenchmarkPhase)j).c_str(),
+              v_stats.mean,
+              v_stats.p50,
+              v_stats.p90,
+              v_stats.p99,
+              v_stats.max);
+    }
+  }
+
+  fclose(v_fd);
+}
+
+std::string RenderBenchmark::csvEscape(const std::string &i_value) {
+  std::string v_res;
+
+  for (unsigned int i = 0; i < i_value.size(); i++) {
+    if (i_value[i] == '"') {
+      v_res += '"';
+    }
+    v_res += i_value[i];
+  }
+  return v_res;
+}
+
+std::string RenderBenchmark::jsonEscape(const std::string &i_value) {
+  std::string v_res;
+
+  for (unsigned int i = 0; i < i_value.size(); i++) {
+    if (i_value[i] == '"' || i_value[i] == '\\') {
+      v_res += '\\';
+    }
+    v_res += i_value[i];
+  }
+  return v_res;
+}
+
+void RenderBenchmark::writeJson(const std::string &i_file) {
+  FILE *v_fd;
+  PhaseStats v_stats;
+
+  v_fd = fopen(i_file.c_str(), "w");
+  if (v_fd == NULL) {
+    LogWarning("Unable to open %s", i_file.c_str());
+    return;
+  }
+
+  // the last one is the whole run
+  fprintf(v_fd, "{\n  \"unit\": \"us\",\n  \"replays\": [\n");
+  for (unsigned int i = 0; i < m_frames.size(); i++) {
+    if (i == m_frames.size() - 1) {
+      fprintf(v_fd, "  ],\n  \"all\": {\n");
+    } else {
+      fprintf(v_fd, "    {\n");
+      fprintf(v_fd,
+              "      \"replay\": \"%s\",\n",
+              jsonEscape(m_frames[i]->replay).c_str());
+    }
+    fprintf(v_fd,
+            "      \"frames\": %u,\n      \"duration_ms\": %.1f,\n",
+            (unsigned int)m_frames[i]->times[RBP_NB_PHASES].size(),
+            m_frames[i]->duration / 1000.0);
+    fprintf(v_fd, "      \"phases\": {\n");
+    for (unsigned int j = 0; j < RBP_NB_PHASES + 1; j++) {
+      v_stats = stats(m_frames[i]->times[j]);
+      fprintf(v_fd,
+              "        \"%s\": { \"mean\": %llu, \"p50\": %llu, \"p90\": %llu, "
+              "\"p99\": %llu, \"max\": %llu }%s\n",
+              phaseName((RenderBenchmarkPhase)j).c_str(),
+              v_stats.mean,
+              v_stats.p50,
+              v_stats.p90,
+              v_stats.p99,
+              v_stats.max,
+              j == RBP_NB_PHASES ? "" : ",");
+    }
+    fprintf(v_fd, "      }\n");
+    if (i == m_frames.size() - 1) {
+      fprintf(v_fd, "  }\n");
+    } else {
+      fprintf(v_fd, "    }%s\n", i == m_frames.size() - 2 ? "" : ",");
+    }
+  }
+  fprintf(v_fd, "}\n");
+
+  fclose(v_fd);
+}
@@ -0,0 +1,110 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __RENDERBENCHMARK_H__
+#define __RENDERBENCHMARK_H__
+
+#include "helpers/PhaseTimer.h"
+#include "helpers/Singleton.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+// where the time of a frame goes ; a time is charged to one phase only
+enum RenderBenchmarkPhase {
+  RBP_UPDATE, // physics steps
+  RBP_SKY,
+  RBP_STATIC_BLOCKS, // static blocks, background and layers
+  RBP_DYNAMIC_BLOCKS,
+  RBP_SPRITES,
+  RBP_PARTICLES,
+  RBP_BIKES, // bikers and ghosts
+  RBP_HUD, // minimap, counters, time panel, messages
+  RBP_OTHER, // the rest of the frame, flushing the graphics included
+  RBP_NB_PHASES
+};
+
+/*
+  times of the frames of the replays played with --benchmark, by phase. Phases
+  can be nested : the time is always charged to the innermost one. The report
+  gives the percentiles of each phase per replay and for all the replays.
+*/
+class RenderBenchmark : public Singleton<RenderBenchmark> {
+  friend class Singleton<RenderBenchmark>;
+
+public:
+  // the replays to play once the current one is finished
+  void addReplay(const std::string &i_replay);
+  // "" if there is no more replay to play
+  std::string nextReplay();
+
+  void beginReplay(const std::string &i_replay);
+  void endReplay();
+  static bool isRecording() { return m_recording; }
+  static PhaseTimer *frameTimer() { return &m_frameTimer; }
+
+  // ends the current frame, if any, and starts a new one
+  void nextFrame();
+
+  // print the summary ; write the report as json if i_file ends with .json,
+  // as csv else (nothing if i_file is empty)
+  void report(const std::string &i_file);
+
+  static std::string phaseName(RenderBenchmarkPhase i_phase);
+
+private:
+  RenderBenchmark();
+  ~RenderBenchmark();
+
+  struct ReplayFrames {
+    std::string replay;
+    unsigned long long duration; // us
+    // times per phase, then the whole frame ; one value per frame
+    std::vector<unsigned int> times[RBP_NB_PHASES + 1];
+  };
+
+  struct PhaseStats {
+    unsigned long long mean, p50, p90, p99, max;
+  };
+
+  void endFrame();
+  static PhaseStats stats(const std::vector<unsigned int> &i_times);
+  void writeCsv(const std::string &i_file);
+  void writeJson(const std::string &i_file);
+  // contents of a quoted field/string
+  static std::string csvEscape(const std::string &i_value);
+  static std::string jsonEscape(const std::string &i_value);
+
+  static bool m_recording;
+  std::deque<std::string> m_replays;
+  std::vector<ReplayFrames *> m_frames;
+
+  static PhaseTimer m_frameTimer; // running while in a frame
+  unsigned long long m_replayStart;
+};
+
+// charge the time of its scope to a phase while a replay is benchmarked
+class RenderBenchmarkScope : public PhaseTimerScope {
+public:
+  RenderBenchmarkScope(RenderBenchmarkPhase i_phase)
+    : PhaseTimerScope(RenderBenchmark::frameTimer(), i_phase) {}
+};
+
+#endif
@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "GameText.h"
 #include "GeomsManager.h"
 #include "PhysSettings.h"
+#include "RenderBenchmark.h"
 #include "SysMessage.h"
 #include "Universe.h"
 #include "common/VFileIO.h"
@@ -601,13 +602,13 @@ void GameRenderer::renderMiniMap(Scene *i_scene,
 
   /* TOFIX::Draw the static blocks only once in a texture, and reuse it after */
   /* Render blocks */
-  std::vector<Block *> Blocks;
+  std::vector<Block *> &Blocks = m_blocksQuery.elements;
 
   pDrawlib->setTexture(NULL, BLEND_MODE_NONE);
 
   for (int layer = -1; layer <= 0; layer++) {
-    Blocks = i_scene->getCollisionHandler()->getStaticBlocksNearPosition(
-      mapBBox, layer);
+    i_scene->getCollisionHandler()->getStaticBlocksNearPosition(
+      mapBBox, m_blocksQuery, layer);
     for (unsigned int i = 0; i < Blocks.size(); i++) {
       /* Don't draw background blocks neither dynamic ones */
       if (Blocks[i]->isBackground() == false && Blocks[i]->getLayer() == -1) {
@@ -633,7 +634,8 @@ void GameRenderer::renderMiniMap(Scene *i_scene,
 
   /* Render dynamic blocks */
   /* display only visible dyn blocks */
-  Blocks = i_scene->getCollisionHandler()->getDynBlocksNearPosition(mapBBox);
+  i_scene->getCollisionHandler()->getDynBlocksNearPosition(mapBBox,
+                                                           m_blocksQuery);
 
   /* TOFIX::do not calculate this again. (already done in Block.cpp) */
   for (unsigned int i = 0; i < Blocks.size(); i++) {
@@ -698,8 +700,9 @@ void GameRenderer::renderMiniMap(Scene *i_scene,
   }
 
   /* FIX::display only visible entities */
-  std::vector<Entity *> Entities =
-    i_scene->getCollisionHandler()->getEntitiesNearPosition(mapBBox);
+  i_scene->getCollisionHandler()->getEntitiesNearPosition(mapBBox,
+                                                          m_entitiesQuery);
+  std::vector<Entity *> &Entities = m_entitiesQuery.elements;
 
   for (unsigned int i = 0; i < Entities.size(); i++) {
     Vector2f entityPos(LEVEL_TO_SCREEN_X(Entities[i]->DynamicPosition().x),
@@ -729,6 +732,8 @@ void GameRenderer::_RenderGhost(Scene *i_scene,
                                 Biker *i_ghost,
                                 int i,
                                 float i_textOffset) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_BIKES);
+
   float v_diffInfoTextTime;
   int v_textTrans;
 
@@ -849,6 +854,8 @@ void GameRenderer::_RenderGhost(Scene *i_scene,
 void GameRenderer::_RenderGhostTrail(Scene *i_scene,
                                      AABB *i_screenBBox,
                                      float i_scale) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_BIKES);
+
   // get trail data
   GhostTrail *v_ghostTrail = i_scene->getGhostTrail();
   if (v_ghostTrail == NULL) {
@@ -1445,6 +1452,8 @@ void GameRenderer::render(Scene *i_scene) {
 
   pCamera->setCamera2d();
 
+  RenderBenchmarkScope v_benchmarkScope(RBP_HUD);
+
   /* minimap + counter */
   if (pCamera->getPlayerToFollow() != NULL) {
     if (showMinimap()) {
@@ -1756,6 +1765,8 @@ Sprite rendering main
 void GameRenderer::_RenderSprites(Scene *i_scene,
                                   bool bForeground,
                                   bool bBackground) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_SPRITES);
+
   Entity *pEnt;
 
   AABB screenBigger;
@@ -1770,8 +1781,9 @@ void GameRenderer::_RenderSprites(Scene *i_scene,
                                 screenMax.y + ENTITY_OFFSET);
 
   /* DONE::display only visible entities */
-  std::vector<Entity *> Entities =
-    i_scene->getCollisionHandler()->getEntitiesNearPosition(screenBigger);
+  i_scene->getCollisionHandler()->getEntitiesNearPosition(screenBigger,
+                                                          m_entitiesQuery);
+  std::vector<Entity *> &Entities = m_entitiesQuery.elements;
   unsigned int size = Entities.size();
 
   if (size == 0)
@@ -2022,11 +2034,14 @@ void GameRenderer::_RenderSprite(Scene *i_scene,
 Blocks (dynamic)
 ===========================================================================*/
 void GameRenderer::_RenderDynamicBlocks(Scene *i_scene, bool bBackground) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_DYNAMIC_BLOCKS);
+
   DrawLib *pDrawlib = GameApp::instance()->getDrawLib();
 
   /* FIX::display only visible dyn blocks */
-  std::vector<Block *> Blocks =
-    i_scene->getCollisionHandler()->getDynBlocksNearPosition(m_screenBBox);
+  i_scene->getCollisionHandler()->getDynBlocksNearPosition(m_screenBBox,
+                                                           m_blocksQuery);
+  std::vector<Block *> &Blocks = m_blocksQuery.elements;
 
   /* sort blocks on their texture */
   std::sort(Blocks.begin(), Blocks.end(), AscendingTextureSort());
@@ -2380,14 +2395,15 @@ void GameRenderer::_RenderBlockEdges(Block *pBlock) {
 Blocks (static)
 ===========================================================================*/
 void GameRenderer::_RenderStaticBlocks(Scene *i_scene) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_STATIC_BLOCKS);
+
   DrawLib *pDrawlib = GameApp::instance()->getDrawLib();
 
   for (int layer = -1; layer <= 0; layer++) {
-    std::vector<Block *> Blocks;
-
     /* Render all non-background blocks */
-    Blocks = i_scene->getCollisionHandler()->getStaticBlocksNearPosition(
-      m_screenBBox, layer);
+    i_scene->getCollisionHandler()->getStaticBlocksNearPosition(
+      m_screenBBox, m_blocksQuery, layer);
+    std::vector<Block *> &Blocks = m_blocksQuery.elements;
 
     /* sort blocks on their texture */
     std::sort(Blocks.begin(), Blocks.end(), AscendingTextureSort());
@@ -2488,6 +2504,8 @@ void GameRenderer::_RenderSky(Scene *i_scene,
                               float i_driftZoom,
                               const TColor &i_driftColor,
                               bool i_drifted) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_SKY);
+
   DrawLib *pDrawlib = GameApp::instance()->getDrawLib();
   float fDrift = 0.0;
   float uZoom = 1.0 / i_zoom;
@@ -2574,9 +2592,12 @@ void GameRenderer::_RenderSky(Scene *i_scene,
 And background rendering
 ===========================================================================*/
 void GameRenderer::_RenderBackground(Scene *i_scene) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_STATIC_BLOCKS);
+
   /* Render STATIC background blocks */
-  std::vector<Block *> Blocks =
-    i_scene->getCollisionHandler()->getStaticBlocksNearPosition(m_screenBBox);
+  i_scene->getCollisionHandler()->getStaticBlocksNearPosition(m_screenBBox,
+                                                              m_blocksQuery);
+  std::vector<Block *> &Blocks = m_blocksQuery.elements;
 
   /* sort blocks on their texture */
   std::sort(Blocks.begin(), Blocks.end(), AscendingTextureSort());
@@ -2639,9 +2660,9 @@ void GameRenderer::_RenderLayer(Scene *i_scene, int layer) {
   layerBBox.addPointToAABB2f(levelLeftTop.x + translationInLayer.x + size.x,
                              levelLeftTop.y + translationInLayer.y - size.y);
 
-  std::vector<Block *> Blocks =
-    i_scene->getCollisionHandler()->getBlocksNearPositionInLayer(layerBBox,
-                                                                 layer);
+  i_scene->getCollisionHandler()->getBlocksNearPositionInLayer(
+    layerBBox, layer, m_blocksQuery);
+  std::vector<Block *> &Blocks = m_blocksQuery.elements;
   /* sort blocks on their texture */
   std::sort(Blocks.begin(), Blocks.end(), AscendingTextureSort());
 
@@ -2657,6 +2678,8 @@ void GameRenderer::_RenderLayer(Scene *i_scene, int layer) {
 }
 
 void GameRenderer::_RenderLayers(Scene *i_scene, bool renderFront) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_STATIC_BLOCKS);
+
   /* Render background level blocks */
   for (int layer = 0; layer < i_scene->getLevelSrc()->getNumberLayer();
        layer++) {
@@ -3180,6 +3203,8 @@ void GameRenderer::_RenderParticle(Scene *i_scene,
 }
 
 void GameRenderer::_RenderParticles(Scene *i_scene, bool bFront) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_PARTICLES);
+
   AABB screenBigger;
   Vector2f screenMin = m_screenBBox.getBMin();
   Vector2f screenMax = m_screenBBox.getBMax();
@@ -3192,8 +3217,9 @@ void GameRenderer::_RenderParticles(Scene *i_scene, bool bFront) {
                                 screenMax.y + ENTITY_OFFSET);
 
   try {
-    std::vector<Entity *> Entities =
-      i_scene->getCollisionHandler()->getEntitiesNearPosition(screenBigger);
+    i_scene->getCollisionHandler()->getEntitiesNearPosition(screenBigger,
+                                                            m_entitiesQuery);
+    std::vector<Entity *> &Entities = m_entitiesQuery.elements;
     std::vector<Entity *> ExternalEntities =
       i_scene->getLevelSrc()->EntitiesExterns();
     std::vector<Entity *> *allEntities[] = { &Entities,
@@ -3416,6 +3442,8 @@ void GameRenderer::_RenderBike(Biker *i_biker,
                                bool i_renderBikeFront,
                                const TColor &i_filterColor,
                                const TColor &i_filterUglyColor) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_BIKES);
+
   BikeState *pBike = i_biker->getState();
   BikeParameters *pBikeParms = pBike->Parameters();
   BikerTheme *p_theme = i_biker->getBikeTheme();
@@ -3939,6 +3967,8 @@ void GameRenderer::setScreenShade(bool i_doShade_global,
 }
 
 void GameRenderer::renderGameMessages(Scene *i_scene) {
+  RenderBenchmarkScope v_benchmarkScope(RBP_HUD);
+
   /* this is implemented as a non-private function to make game message callable
      from elsewhere
      (needed for multiplayer, where cams may cover screenwide text displays) */
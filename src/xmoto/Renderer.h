@@ -193,6 +193,11 @@ private:
   AABB m_screenBBox;
   AABB m_layersBBox;
 
+  /* the results of the collision queries of the frame, kept so that the
+     queries don't allocate */
+  ElementsQuery<Block> m_blocksQuery;
+  ElementsQuery<Entity> m_entitiesQuery;
+
   float m_sizeMultOfEntitiesToTake;
   float m_sizeMultOfEntitiesWhichMakeWin;
   int m_nParticlesRendered;
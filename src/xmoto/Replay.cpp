@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include "Game.h"
 #include "GameEvents.h"
+#include "ReplayColumns.h"
 #include "db/xmDatabase.h"
 #include "helpers/FileCompression.h"
 #include "helpers/Log.h"
@@ -67,6 +68,8 @@ Replay::Replay() {
   m_finishTime = 0;
   m_pcInputEventsData = NULL;
   m_nInputEventsDataSize = 0;
+  m_pcChunksData = NULL;
+  m_firstStateTime = 0;
   m_saved = false;
 }
 
@@ -84,12 +87,19 @@ void Replay::_FreeReplay(void) {
 
   /* Dealloc chunks */
   for (unsigned int i = 0; i < m_Chunks.size(); i++) {
-    if (m_Chunks[i]->pcChunkData != NULL) {
+    if (m_Chunks[i]->pcChunkData != NULL && m_Chunks[i]->bOwnData) {
       delete[] m_Chunks[i]->pcChunkData;
     }
     delete m_Chunks[i];
   }
   m_Chunks.clear();
+  m_chunksFirstState.clear();
+  m_decodedChunks.clear();
+
+  if (m_pcChunksData != NULL) {
+    delete[] m_pcChunksData;
+    m_pcChunksData = NULL;
+  }
 
   if (m_pcInputEventsData != NULL) {
     delete[] m_pcInputEventsData;
@@ -97,6 +107,72 @@ void Replay::_FreeReplay(void) {
   }
 }
 
+const char *Replay::_ChunkData(unsigned int i_chunk) {
+  if (m_Chunks[i_chunk]->pcChunkData == NULL) {
+    if (_DecodeChunk(i_chunk) == false) {
+      LogWarning("Failed to uncompress chunk %u in replay", i_chunk);
+    }
+  }
+  return m_Chunks[i_chunk]->pcChunkData;
+}
+
+bool Replay::_DecodeChunk(unsigned int i_chunk) {
+  ReplayStateChunk *Chunk = m_Chunks[i_chunk];
+  int nSize = m_nStateSize * Chunk->nNumStates;
+
+  /* free the chunks the replay is far from, keep the neighbours for
+     interpolation and small rewinds */
+  for (unsigned int i = 0; i < m_decodedChunks.size();) {
+    unsigned int n = m_decodedChunks[i];
+    if (n + 1 < i_chunk || n > i_chunk + 1) {
+      delete[] m_Chunks[n]->pcChunkData;
+      m_Chunks[n]->pcChunkData = NULL;
+      m_decodedChunks[i] = m_decodedChunks.back();
+      m_decodedChunks.pop_back();
+    } else {
+      i++;
+    }
+  }
+
+  Chunk->pcChunkData = new char[nSize];
+  Chunk->bOwnData = true;
+  m_decodedChunks.push_back(i_chunk);
+
+  if (Chunk->nColumnsSize > 0) {
+    char *pcColumns = new char[Chunk->nColumnsSize];
+    try {
+      FileCompression::zuncompress(Chunk->pcCompressedData,
+                                   Chunk->nCompressedSize,
+                                   pcColumns,
+                                   Chunk->nColumnsSize);
+      ReplayColumns::decode(pcColumns,
+                            Chunk->nColumnsSize,
+                            Chunk->pcChunkData,
+                            Chunk->nNumStates,
+                            m_nStateSize);
+    } catch (Exception &e) {
+      delete[] pcColumns;
+      /* still give some states */
+      memset(Chunk->pcChunkData, 0, nSize);
+      return false;
+    }
+    delete[] pcColumns;
+    return true;
+  }
+
+  uLongf nDestLen = nSize;
+  int nZRet = uncompress((Bytef *)Chunk->pcChunkData,
+                         &nDestLen,
+                         (Bytef *)Chunk->pcCompressedData,
+                         Chunk->nCompressedSize);
+  if (nZRet != Z_OK || nDestLen != (uLongf)nSize) {
+    /* still give some states */
+    memset(Chunk->pcChunkData, 0, nSize);
+    return false;
+  }
+  return true;
+}
+
 void Replay::finishReplay(bool bFinished, int finishTime) {
   m_finishTime = finishTime;
   m_bFinished = bFinished;
@@ -139,6 +215,10 @@ void Replay::saveReplayIfNot(int i_format) {
       saveReplay_3(pfh);
       break;
 
+    case 4:
+      saveReplay_4(pfh);
+      break;
+
     default:
       XMFS::closeFile(pfh);
       throw Exception("Invalid replay format");
@@ -157,16 +237,7 @@ void Replay::saveReplay_3(FileHandle *pfh) {
   DBuffer v_replay;
 
   /* keep header uncompressed to be faster to read just it */
-
-  /* Header */
-  XMFS::writeByte(pfh, 3); /* Version: 3 */
-  XMFS::writeInt_LE(pfh, 0x12345678); /* Endianness guard */
-  XMFS::writeString(pfh, m_LevelID);
-  XMFS::writeString(pfh, m_PlayerName);
-  XMFS::writeFloat_LE(pfh, m_fFrameRate);
-  XMFS::writeInt_LE(pfh, m_nStateSize);
-  XMFS::writeBool(pfh, m_bFinished);
-  XMFS::writeFloat_LE(pfh, GameApp::timeToFloat(m_finishTime));
+  _SaveHeader(pfh, 3);
 
   /* ***** ***** ***** ***** ***** **/
   /* compress all except the header */
@@ -185,44 +256,11 @@ void Replay::saveReplay_3(FileHandle *pfh) {
   v_replay << (unsigned int)m_Chunks.size();
   for (unsigned int i = 0; i < m_Chunks.size(); i++) {
     v_replay << m_Chunks[i]->nNumStates;
-    v_replay.writeBuf(m_Chunks[i]->pcChunkData,
-                      m_nStateSize * m_Chunks[i]->nNumStates);
+    v_replay.writeBuf(_ChunkData(i), m_nStateSize * m_Chunks[i]->nNumStates);
   }
 
   /* Moving blocks */
-  int nstates = 0;
-  unsigned int nmovingBlocks = 0;
-
-  // save only moving blocks
-  for (unsigned int i = 0; i < m_movingBlocksForSaving.size(); i++) {
-    if (m_movingBlocksForSaving[i].states.size() >
-        1) { // > 1 because if there is only one state, the block has not moved
-      nmovingBlocks++;
-    }
-  }
-  v_replay << nmovingBlocks;
-  for (unsigned int i = 0; i < m_movingBlocksForSaving.size(); i++) {
-    if (m_movingBlocksForSaving[i].states.size() >
-        1) { // > 1 because if there is only one state, the block has not moved
-      v_replay << m_movingBlocksForSaving[i].name;
-      v_replay << m_movingBlocksForSaving[i].states.size();
-      for (unsigned int j = 0; j < m_movingBlocksForSaving[i].states.size();
-           j++) {
-        v_replay << m_movingBlocksForSaving[i].states[j].time;
-        v_replay << m_movingBlocksForSaving[i].states[j].position.x;
-        v_replay << m_movingBlocksForSaving[i].states[j].position.y;
-        v_replay << m_movingBlocksForSaving[i].states[j].rotation;
-        nstates++;
-      }
-    }
-  }
-
-  LogInfo("Replay moving block states size = %iKB (%i blocks, %i states, %i "
-          "bytes/state)",
-          nstates * sizeof(rmblockState) / 1024,
-          m_movingBlocksForSaving.size(),
-          nstates,
-          sizeof(rmblockState));
+  _SaveMovingBlocks(v_replay);
 
   /* zip and write into the file */
   pcData = v_replay.convertOutputToInput();
@@ -241,14 +279,7 @@ void Replay::saveReplay_3(FileHandle *pfh) {
 
 void Replay::saveReplay_1(FileHandle *pfh) {
   /* Write header */
-  XMFS::writeByte(pfh, 1); /* Version: 1 */
-  XMFS::writeInt_LE(pfh, 0x12345678); /* Endianness guard */
-  XMFS::writeString(pfh, m_LevelID);
-  XMFS::writeString(pfh, m_PlayerName);
-  XMFS::writeFloat_LE(pfh, m_fFrameRate);
-  XMFS::writeInt_LE(pfh, m_nStateSize);
-  XMFS::writeBool(pfh, m_bFinished);
-  XMFS::writeFloat_LE(pfh, GameApp::timeToFloat(m_finishTime));
+  _SaveHeader(pfh, 1);
 
   /* Events */
   const char *pcUncompressedEvents = convertOutputToInput();
@@ -288,16 +319,14 @@ void Replay::saveReplay_1(FileHandle *pfh) {
       new unsigned char[m_nStateSize * m_Chunks[i]->nNumStates * 2 + 12];
     uLongf nDestLen = m_nStateSize * m_Chunks[i]->nNumStates * 2 + 12;
     uLongf nSrcLen = m_nStateSize * m_Chunks[i]->nNumStates;
-    int nZRet = compress2((Bytef *)pcCompressed,
-                          &nDestLen,
-                          (Bytef *)m_Chunks[i]->pcChunkData,
-                          nSrcLen,
-                          9);
+    int nZRet = compress2(
+      (Bytef *)pcCompressed, &nDestLen, (Bytef *)_ChunkData(i), nSrcLen, 9);
     if (nZRet != Z_OK) {
       /* Failed to compress... Save uncompressed chunk then */
       XMFS::writeBool(pfh, false); /* compression: false */
-      XMFS::writeBuf(
-        pfh, m_Chunks[i]->pcChunkData, m_nStateSize * m_Chunks[i]->nNumStates);
+      XMFS::writeBuf(pfh,
+                     (char *)_ChunkData(i),
+                     m_nStateSize * m_Chunks[i]->nNumStates);
     } else {
       /* Compressed ok */
       XMFS::writeBool(pfh, true); /* compression: true */
@@ -308,75 +337,142 @@ void Replay::saveReplay_1(FileHandle *pfh) {
   }
 }
 
-void Replay::openReplay_3(FileHandle *pfh, bool bDisplayInformation) {
-  DBuffer v_replay;
-  int v_nDataSize;
-  char *v_pcData;
-  int v_nCompressedDataSize;
-  char *v_pcCompressedData;
+void Replay::_SaveHeader(FileHandle *pfh, int i_version) {
+  XMFS::writeByte(pfh, i_version);
+  XMFS::writeInt_LE(pfh, 0x12345678); /* Endianness guard */
+  XMFS::writeString(pfh, m_LevelID);
+  XMFS::writeString(pfh, m_PlayerName);
+  XMFS::writeFloat_LE(pfh, m_fFrameRate);
+  XMFS::writeInt_LE(pfh, m_nStateSize);
+  XMFS::writeBool(pfh, m_bFinished);
+  XMFS::writeFloat_LE(pfh, GameApp::timeToFloat(m_finishTime));
+}
 
-  /* Little/big endian safety check */
-  if (XMFS::readInt_LE(pfh) != 0x12345678) {
-    LogWarning("Sorry, the replay you're trying to open are not "
-               "endian-compatible with your computer!");
-    throw Exception("Unable to open the replay");
-  }
+void Replay::_SaveMovingBlocks(DBuffer &o_buffer) {
+  int nstates = 0;
+  unsigned int nmovingBlocks = 0;
 
-  /* Header */
-  m_LevelID = XMFS::readString(pfh);
-  if (bDisplayInformation) {
-    printf("%-30s: %s\n", "Level Id", m_LevelID.c_str());
+  // save only moving blocks
+  for (unsigned int i = 0; i < m_movingBlocksForSaving.size(); i++) {
+    if (m_movingBlocksForSaving[i].states.size() >
+        1) { // > 1 because if there is only one state, the block has not moved
+      nmovingBlocks++;
+    }
   }
-
-  m_PlayerName = XMFS::readString(pfh);
-  if (bDisplayInformation) {
-    printf("%-30s: %s\n", "Player", m_PlayerName.c_str());
+  o_buffer << nmovingBlocks;
+  for (unsigned int i = 0; i < m_movingBlocksForSaving.size(); i++) {
+    if (m_movingBlocksForSaving[i].states.size() >
+        1) { // > 1 because if there is only one state, the block has not moved
+      o_buffer << m_movingBlocksForSaving[i].name;
+      o_buffer << m_movingBlocksForSaving[i].states.size();
+      for (unsigned int j = 0; j < m_movingBlocksForSaving[i].states.size();
+           j++) {
+        o_buffer << m_movingBlocksForSaving[i].states[j].time;
+        o_buffer << m_movingBlocksForSaving[i].states[j].position.x;
+        o_buffer << m_movingBlocksForSaving[i].states[j].position.y;
+        o_buffer << m_movingBlocksForSaving[i].states[j].rotation;
+        nstates++;
+      }
+    }
   }
 
-  m_fFrameRate = XMFS::readFloat_LE(pfh);
+  LogInfo("Replay moving block states size = %iKB (%i blocks, %i states, %i "
+          "bytes/state)",
+          nstates * sizeof(rmblockState) / 1024,
+          m_movingBlocksForSaving.size(),
+          nstates,
+          sizeof(rmblockState));
+}
 
-  m_nStateSize = XMFS::readInt_LE(pfh);
-  if (bDisplayInformation) {
-    printf("%-30s: %i\n", "State size", m_nStateSize);
-  }
+void Replay::saveReplay_4(FileHandle *pfh) {
+  const char *pcData;
+  int nDataSize;
+  char *pcCompressedData;
+  int nCompressedDataSize;
+  int nStatesSize = 0;
+  int nChunksSize = 0;
+  std::string v_columns;
 
-  m_bFinished = XMFS::readBool(pfh);
-  m_finishTime = GameApp::floatToTime(XMFS::readFloat_LE(pfh));
-  if (bDisplayInformation) {
-    if (m_bFinished) {
-      printf("%-30s: %.2f (%f)\n",
-             "Finish time",
-             m_finishTime / 100.0,
-             m_finishTime / 100.0);
-    } else {
-      printf("%-30s: %s\n", "Finish time", "unfinished");
-    }
+  DBuffer v_replay;
+
+  /* keep header uncompressed to be faster to read just it */
+  _SaveHeader(pfh, 4);
+
+  /* events and moving blocks, compressed together */
+  v_replay.initOutput(32);
+
+  pcData = convertOutputToInput();
+  nDataSize = numRemainingBytes();
+  v_replay << nDataSize;
+  v_replay.writeBuf(pcData, nDataSize);
+
+  _SaveMovingBlocks(v_replay);
+
+  pcData = v_replay.convertOutputToInput();
+  nDataSize = v_replay.numRemainingBytes();
+  pcCompressedData =
+    FileCompression::zcompress(pcData, nDataSize, nCompressedDataSize);
+  XMFS::writeInt_LE(pfh, nDataSize);
+  XMFS::writeInt_LE(pfh, nCompressedDataSize);
+  XMFS::writeBuf(pfh, (char *)pcCompressedData, nCompressedDataSize);
+  free(pcCompressedData);
+
+  /* Chunks, stored by columns and compressed one by one to be uncompressed
+     only when they are reached */
+  XMFS::writeInt_LE(pfh, m_Chunks.size());
+  for (unsigned int i = 0; i < m_Chunks.size(); i++) {
+    ReplayColumns::encode(
+      _ChunkData(i), m_Chunks[i]->nNumStates, m_nStateSize, v_columns);
+    pcCompressedData = FileCompression::zcompress(
+      v_columns.c_str(), v_columns.size(), nCompressedDataSize);
+
+    XMFS::writeInt_LE(pfh, m_Chunks[i]->nNumStates);
+    XMFS::writeInt_LE(pfh, v_columns.size());
+    XMFS::writeInt_LE(pfh, nCompressedDataSize);
+    XMFS::writeBuf(pfh, (char *)pcCompressedData, nCompressedDataSize);
+    free(pcCompressedData);
+
+    nStatesSize += m_nStateSize * m_Chunks[i]->nNumStates;
+    nChunksSize += nCompressedDataSize;
   }
 
+  LogInfo("Replay states - raw = %iKB ; compressed = %iKB",
+          nStatesSize / 1024,
+          nChunksSize / 1024);
+}
+
+void Replay::openReplay_3(FileHandle *pfh, bool bDisplayInformation) {
+  DBuffer v_replay;
+  int v_nDataSize;
+  int v_nCompressedDataSize;
+  char *v_pcCompressedData;
+
+  _OpenHeader(pfh, bDisplayInformation);
+
   /* zuncompressed */
   v_nDataSize = XMFS::readInt_LE(pfh);
   v_nCompressedDataSize = XMFS::readInt_LE(pfh);
 
-  v_pcData = (char *)malloc(v_nDataSize);
-  if (v_pcData == NULL) {
-    throw Exception("Unable to malloc for decompression");
+  if (v_nDataSize < 0 || v_nCompressedDataSize < 0) {
+    throw Exception("Unable to open the replay");
   }
+
+  /* the chunks are views over the uncompressed data */
+  m_pcChunksData = new char[v_nDataSize];
   v_pcCompressedData = (char *)malloc(v_nCompressedDataSize);
   if (v_pcCompressedData == NULL) {
-    free(v_pcData);
     throw Exception("Unable to malloc for decompression");
   }
   XMFS::readBuf(pfh, v_pcCompressedData, v_nCompressedDataSize);
   try {
     FileCompression::zuncompress(
-      v_pcCompressedData, v_nCompressedDataSize, v_pcData, v_nDataSize);
+      v_pcCompressedData, v_nCompressedDataSize, m_pcChunksData, v_nDataSize);
   } catch (Exception &e) {
-    free(v_pcData);
     free(v_pcCompressedData);
     throw e;
   }
   free(v_pcCompressedData);
-  v_replay.initInput(v_pcData, v_nDataSize);
+  v_replay.initInput(m_pcChunksData, v_nDataSize);
 
   /* Events */
   v_replay >> m_nInputEventsDataSize;
@@ -411,83 +507,19 @@ void Replay::openReplay_3(FileHandle *pfh, bool bDisplayInformation) {
       printf("   %-27s: %i\n", "Number of states", Chunk->nNumStates);
     }
 
-    Chunk->pcChunkData = new char[Chunk->nNumStates * m_nStateSize];
-
-    v_replay.readBuf(Chunk->pcChunkData, m_nStateSize * Chunk->nNumStates);
     m_Chunks.push_back(Chunk);
+    Chunk->pcChunkData =
+      (char *)v_replay.readBufView(m_nStateSize * Chunk->nNumStates);
   }
 
   /* moving blocks */
-  unsigned int v_nmovingBlocks;
-  unsigned int v_nstates;
-  rmtime t;
-  rmtimeState s;
-
-  v_replay >> v_nmovingBlocks;
-
-  for (unsigned int i = 0; i < v_nmovingBlocks; i++) {
-    v_replay >> t.name;
-    t.block = NULL; // don't initialize now, the level is not loaded
-    t.readPos = 0;
-    m_movingBlocksForLoading.push_back(t);
-
-    v_replay >> v_nstates;
-    for (unsigned int j = 0; j < v_nstates; j++) {
-      v_replay >> s.time;
-      v_replay >> s.position.x;
-      v_replay >> s.position.y;
-      v_replay >> s.rotation;
-
-      m_movingBlocksForLoading[m_movingBlocksForLoading.size() - 1]
-        .states.push_back(s);
-    }
-  }
+  _OpenMovingBlocks(v_replay);
 }
 
 void Replay::openReplay_1(FileHandle *pfh,
                           bool bDisplayInformation,
                           int nVersion) {
-  /* Little/big endian safety check */
-  if (XMFS::readInt_LE(pfh) != 0x12345678) {
-    LogWarning("Sorry, the replay you're trying to open are not "
-               "endian-compatible with your computer!");
-    throw Exception("Unable to open the replay");
-  }
-
-  /* Read level ID */
-  m_LevelID = XMFS::readString(pfh);
-  if (bDisplayInformation) {
-    printf("%-30s: %s\n", "Level Id", m_LevelID.c_str());
-  }
-
-  /* Read player name */
-  m_PlayerName = XMFS::readString(pfh);
-  if (bDisplayInformation) {
-    printf("%-30s: %s\n", "Player", m_PlayerName.c_str());
-  }
-
-  /* Read replay frame rate */
-  m_fFrameRate = XMFS::readFloat_LE(pfh);
-
-  /* Read state size */
-  m_nStateSize = XMFS::readInt_LE(pfh);
-  if (bDisplayInformation) {
-    printf("%-30s: %i\n", "State size", m_nStateSize);
-  }
-
-  /* Read finish time if any */
-  m_bFinished = XMFS::readBool(pfh);
-  m_finishTime = GameApp::floatToTime(XMFS::readFloat_LE(pfh));
-  if (bDisplayInformation) {
-    if (m_bFinished) {
-      printf("%-30s: %.2f (%f)\n",
-             "Finish time",
-             m_finishTime / 100.0,
-             m_finishTime / 100.0);
-    } else {
-      printf("%-30s: %s\n", "Finish time", "unfinished");
-    }
-  }
+  _OpenHeader(pfh, bDisplayInformation);
 
   /* Version 1 includes event data */
   if (nVersion == 1) {
@@ -548,62 +580,261 @@ void Replay::openReplay_1(FileHandle *pfh,
     throw Exception("Replay with no chunk !");
   }
 
-  for (unsigned int i = 0; i < nNumChunks; i++) {
-    if (bDisplayInformation) {
-      printf("Chunk %02i\n", i);
+  /* keep the chunks as they are in the file, they are uncompressed when the
+     replay reaches them */
+  DBuffer v_chunks;
+  _ReadChunksData(pfh, v_chunks);
+
+  try {
+    for (unsigned int i = 0; i < nNumChunks; i++) {
+      if (bDisplayInformation) {
+        printf("Chunk %02i\n", i);
+      }
+
+      ReplayStateChunk *Chunk = new ReplayStateChunk();
+      m_Chunks.push_back(Chunk);
+      v_chunks >> Chunk->nNumStates;
+      if (Chunk->nNumStates < 0) {
+        throw Exception("Invalid number of states");
+      }
+
+      if (bDisplayInformation) {
+        printf("   %-27s: %i\n", "Number of states", Chunk->nNumStates);
+      }
+
+      /* Compressed or not compressed? */
+      bool bCompressed;
+      v_chunks >> bCompressed;
+      if (bCompressed) {
+        if (bDisplayInformation) {
+          printf("   %-27s: %s\n", "Compressed data", "true");
+        }
+
+        /* Compressed! - read compressed size */
+        v_chunks >> Chunk->nCompressedSize;
+        if (bDisplayInformation) {
+          printf(
+            "   %-27s: %i\n", "Compressed states size", Chunk->nCompressedSize);
+        }
+
+        Chunk->pcCompressedData = v_chunks.readBufView(Chunk->nCompressedSize);
+      } else {
+        if (bDisplayInformation) {
+          printf("   %-27s: %s\n", "Compressed data", "false");
+        }
+
+        /* Not compressed! */
+        Chunk->pcChunkData =
+          (char *)v_chunks.readBufView(m_nStateSize * Chunk->nNumStates);
+      }
     }
+  } catch (Exception &e) {
+    _FreeReplay();
+    LogWarning("Failed to read the chunks of the replay");
+    throw Exception("Unable to open the replay");
+  }
 
-    ReplayStateChunk *Chunk = new ReplayStateChunk();
-    Chunk->nNumStates = XMFS::readInt_LE(pfh);
+  _CheckFirstChunk();
+}
+
+void Replay::_OpenHeader(FileHandle *pfh, bool bDisplayInformation) {
+  /* Little/big endian safety check */
+  if (XMFS::readInt_LE(pfh) != 0x12345678) {
+    LogWarning("Sorry, the replay you're trying to open are not "
+               "endian-compatible with your computer!");
+    throw Exception("Unable to open the replay");
+  }
+
+  /* Read level ID */
+  m_LevelID = XMFS::readString(pfh);
+  if (bDisplayInformation) {
+    printf("%-30s: %s\n", "Level Id", m_LevelID.c_str());
+  }
+
+  /* Read player name */
+  m_PlayerName = XMFS::readString(pfh);
+  if (bDisplayInformation) {
+    printf("%-30s: %s\n", "Player", m_PlayerName.c_str());
+  }
+
+  /* Read replay frame rate */
+  m_fFrameRate = XMFS::readFloat_LE(pfh);
+
+  /* Read state size */
+  m_nStateSize = XMFS::readInt_LE(pfh);
+  if (bDisplayInformation) {
+    printf("%-30s: %i\n", "State size", m_nStateSize);
+  }
+
+  /* Read finish time if any */
+  m_bFinished = XMFS::readBool(pfh);
+  m_finishTime = GameApp::floatToTime(XMFS::readFloat_LE(pfh));
+  if (bDisplayInformation) {
+    if (m_bFinished) {
+      printf("%-30s: %.2f (%f)\n",
+             "Finish time",
+             m_finishTime / 100.0,
+             m_finishTime / 100.0);
+    } else {
+      printf("%-30s: %s\n", "Finish time", "unfinished");
+    }
+  }
+}
+
+void Replay::_OpenMovingBlocks(DBuffer &i_buffer) {
+  unsigned int v_nmovingBlocks;
+  unsigned int v_nstates;
+  rmtime t;
+  rmtimeState s;
+
+  i_buffer >> v_nmovingBlocks;
+
+  for (unsigned int i = 0; i < v_nmovingBlocks; i++) {
+    i_buffer >> t.name;
+    t.block = NULL; // don't initialize now, the level is not loaded
+    t.readPos = 0;
+    m_movingBlocksForLoading.push_back(t);
+
+    i_buffer >> v_nstates;
+    for (unsigned int j = 0; j < v_nstates; j++) {
+      i_buffer >> s.time;
+      i_buffer >> s.position.x;
+      i_buffer >> s.position.y;
+      i_buffer >> s.rotation;
+
+      m_movingBlocksForLoading[m_movingBlocksForLoading.size() - 1]
+        .states.push_back(s);
+    }
+  }
+}
+
+void Replay::_ReadChunksData(FileHandle *pfh, DBuffer &o_chunks) {
+  int nChunksStart = XMFS::getOffset(pfh);
+  XMFS::setEnd(pfh);
+  int nChunksDataSize = XMFS::getOffset(pfh) - nChunksStart;
+  XMFS::setOffset(pfh, nChunksStart);
+  if (nChunksDataSize < 0) {
+    _FreeReplay();
+    throw Exception("Unable to open the replay");
+  }
+
+  m_pcChunksData = new char[nChunksDataSize];
+  if (XMFS::readBuf(pfh, m_pcChunksData, nChunksDataSize) == false) {
+    _FreeReplay();
+    LogWarning("Failed to read the chunks of the replay");
+    throw Exception("Unable to open the replay");
+  }
+
+  o_chunks.initInput(m_pcChunksData, nChunksDataSize);
+}
+
+void Replay::_CheckFirstChunk() {
+  /* the first chunk is needed at once, and a broken replay is likely to be
+     broken from the beginning */
+  if (m_Chunks[0]->pcChunkData == NULL && _DecodeChunk(0) == false) {
+    _FreeReplay();
+    LogWarning("Failed to uncompress chunk 0 in replay");
+    throw Exception("Unable to open the replay");
+  }
+}
+
+void Replay::openReplay_4(FileHandle *pfh, bool bDisplayInformation) {
+  DBuffer v_replay;
+  int v_nDataSize;
+  char *v_pcData;
+  int v_nCompressedDataSize;
+  char *v_pcCompressedData;
+
+  _OpenHeader(pfh, bDisplayInformation);
+
+  /* the states are stored field by field, whatever the state size was */
+  m_nStateSize = sizeof(SerializedBikeState);
+
+  /* events and moving blocks */
+  v_nDataSize = XMFS::readInt_LE(pfh);
+  v_nCompressedDataSize = XMFS::readInt_LE(pfh);
+  if (v_nDataSize < 0 || v_nCompressedDataSize < 0) {
+    throw Exception("Unable to open the replay");
+  }
+
+  v_pcData = (char *)malloc(v_nDataSize);
+  if (v_pcData == NULL) {
+    throw Exception("Unable to malloc for decompression");
+  }
+  v_pcCompressedData = (char *)malloc(v_nCompressedDataSize);
+  if (v_pcCompressedData == NULL) {
+    free(v_pcData);
+    throw Exception("Unable to malloc for decompression");
+  }
+  XMFS::readBuf(pfh, v_pcCompressedData, v_nCompressedDataSize);
+  try {
+    FileCompression::zuncompress(
+      v_pcCompressedData, v_nCompressedDataSize, v_pcData, v_nDataSize);
+    free(v_pcCompressedData);
+    v_pcCompressedData = NULL;
+    v_replay.initInput(v_pcData, v_nDataSize);
 
+    /* Events */
+    v_replay >> m_nInputEventsDataSize;
     if (bDisplayInformation) {
-      printf("   %-27s: %i\n", "Number of states", Chunk->nNumStates);
+      printf("%-30s: %i\n", "Events data size", m_nInputEventsDataSize);
     }
+    m_pcInputEventsData = new char[m_nInputEventsDataSize];
+    v_replay.readBuf(m_pcInputEventsData, m_nInputEventsDataSize);
+    initInput(m_pcInputEventsData, m_nInputEventsDataSize);
 
-    Chunk->pcChunkData = new char[Chunk->nNumStates * m_nStateSize];
+    /* moving blocks */
+    _OpenMovingBlocks(v_replay);
+  } catch (Exception &e) {
+    free(v_pcData);
+    if (v_pcCompressedData != NULL) {
+      free(v_pcCompressedData);
+    }
+    throw e;
+  }
+  free(v_pcData);
 
-    /* Compressed or not compressed? */
-    if (XMFS::readBool(pfh)) {
-      if (bDisplayInformation) {
-        printf("   %-27s: %s\n", "Compressed data", "true");
-      }
+  /* Chunks */
+  unsigned int nNumChunks = XMFS::readInt_LE(pfh);
+  if (bDisplayInformation) {
+    printf("%-30s: %i\n", "Number of chunks", nNumChunks);
+  }
+  if (nNumChunks == 0) {
+    _FreeReplay();
+    LogWarning("try to open a replay with no chunk");
+    throw Exception("Replay with no chunk !");
+  }
 
-      /* Compressed! - read compressed size */
-      int nCompressedSize = XMFS::readInt_LE(pfh);
-      if (bDisplayInformation) {
-        printf("   %-27s: %i\n", "Compressed states size", nCompressedSize);
-      }
+  DBuffer v_chunks;
+  _ReadChunksData(pfh, v_chunks);
 
-      /* Read compressed data */
-      unsigned char *pcCompressed = new unsigned char[nCompressedSize];
-      XMFS::readBuf(pfh, (char *)pcCompressed, nCompressedSize);
-
-      /* Uncompress it */
-      uLongf nDestLen = Chunk->nNumStates * m_nStateSize;
-      uLongf nSrcLen = nCompressedSize;
-      int nZRet = uncompress(
-        (Bytef *)Chunk->pcChunkData, &nDestLen, (Bytef *)pcCompressed, nSrcLen);
-      if (nZRet != Z_OK || nDestLen != Chunk->nNumStates * m_nStateSize) {
-        LogWarning("Failed to uncompress chunk %d in replay");
-        delete[] pcCompressed;
-        Chunk->pcChunkData = NULL;
-        _FreeReplay();
-        throw Exception("Unable to open the replay");
+  try {
+    for (unsigned int i = 0; i < nNumChunks; i++) {
+      ReplayStateChunk *Chunk = new ReplayStateChunk();
+      m_Chunks.push_back(Chunk);
+      v_chunks >> Chunk->nNumStates;
+      v_chunks >> Chunk->nColumnsSize;
+      v_chunks >> Chunk->nCompressedSize;
+      if (Chunk->nNumStates < 0 || Chunk->nColumnsSize < 0) {
+        throw Exception("Invalid chunk");
       }
+      Chunk->pcCompressedData = v_chunks.readBufView(Chunk->nCompressedSize);
 
-      /* Clean up */
-      delete[] pcCompressed;
-    } else {
       if (bDisplayInformation) {
-        printf("   %-27s: %s\n", "Compressed data", "false");
+        printf("Chunk %02i\n", i);
+        printf("   %-27s: %i\n", "Number of states", Chunk->nNumStates);
+        printf("   %-27s: %i\n", "Columns size", Chunk->nColumnsSize);
+        printf(
+          "   %-27s: %i\n", "Compressed states size", Chunk->nCompressedSize);
       }
-
-      /* Not compressed! */
-      XMFS::readBuf(pfh, Chunk->pcChunkData, m_nStateSize * Chunk->nNumStates);
     }
-
-    m_Chunks.push_back(Chunk);
+  } catch (Exception &e) {
+    _FreeReplay();
+    LogWarning("Failed to read the chunks of the replay");
+    throw Exception("Unable to open the replay");
   }
+
+  _CheckFirstChunk();
 }
 
 std::string Replay::openReplay(const std::string &FileName,
@@ -653,6 +884,15 @@ std::string Replay::openReplay(const std::string &FileName,
       }
       break;
 
+    case 4:
+      try {
+        openReplay_4(pfh, bDisplayInformation);
+      } catch (Exception &e) {
+        XMFS::closeFile(pfh);
+        throw e;
+      }
+      break;
+
     default:
       XMFS::closeFile(pfh);
       LogWarning("Unsupported replay file version (%d): %s",
@@ -668,6 +908,7 @@ std::string Replay::openReplay(const std::string &FileName,
 
   Player = m_PlayerName;
 
+  _IndexChunks();
   m_nCurChunk = 0;
   m_nCurState = 0.0;
 
@@ -837,8 +1078,11 @@ void Replay::storeState(const SerializedBikeState &state) {
     ReplayStateChunk *Chunk = new ReplayStateChunk();
     Chunk->pcChunkData = new char[STATES_PER_CHUNK * m_nStateSize];
     Chunk->nNumStates = 1;
+    Chunk->bOwnData = true;
     addr = Chunk->pcChunkData;
     m_Chunks.push_back(Chunk);
+    m_chunksFirstState.push_back(0);
+    m_firstStateTime = GameApp::floatToTime(state.fGameTime);
   } else {
     int i = m_Chunks.size() - 1;
     if (m_Chunks[i]->nNumStates < STATES_PER_CHUNK) {
@@ -848,8 +1092,10 @@ void Replay::storeState(const SerializedBikeState &state) {
       ReplayStateChunk *Chunk = new ReplayStateChunk();
       Chunk->pcChunkData = new char[STATES_PER_CHUNK * m_nStateSize];
       Chunk->nNumStates = 1;
+      Chunk->bOwnData = true;
       addr = Chunk->pcChunkData;
       m_Chunks.push_back(Chunk);
+      m_chunksFirstState.push_back(m_chunksFirstState[i] + STATES_PER_CHUNK);
     }
   }
 
@@ -858,7 +1104,82 @@ void Replay::storeState(const SerializedBikeState &state) {
 }
 
 int Replay::CurrentFrame() const {
-  return (int)(m_nCurChunk * STATES_PER_CHUNK + m_nCurState + 1);
+  return (int)(_CurrentState() + 1);
+}
+
+void Replay::_IndexChunks() {
+  unsigned int nFirstState = 0;
+
+  m_chunksFirstState.clear();
+  for (unsigned int i = 0; i < m_Chunks.size(); i++) {
+    m_chunksFirstState.push_back(nFirstState);
+    nFirstState += m_Chunks[i]->nNumStates;
+  }
+
+  m_firstStateTime = _NbStates() > 0 ? _StateTime(0) : 0;
+}
+
+unsigned int Replay::_NbStates() const {
+  if (m_Chunks.empty()) {
+    return 0;
+  }
+  return m_chunksFirstState.back() + m_Chunks.back()->nNumStates;
+}
+
+unsigned int Replay::_ChunkOfState(unsigned int i_state) const {
+  /* all the chunks are full, except the last one : the guess is right, except
+     for odd replays */
+  unsigned int nChunk = i_state / STATES_PER_CHUNK;
+
+  if (nChunk >= m_Chunks.size()) {
+    nChunk = m_Chunks.size() - 1;
+  }
+  while (nChunk > 0 && m_chunksFirstState[nChunk] > i_state) {
+    nChunk--;
+  }
+  while (nChunk + 1 < m_Chunks.size() &&
+         m_chunksFirstState[nChunk + 1] <= i_state) {
+    nChunk++;
+  }
+
+  return nChunk;
+}
+
+float Replay::_CurrentState() const {
+  return m_chunksFirstState[m_nCurChunk] + m_nCurState;
+}
+
+bool Replay::_SeekState(float i_state) {
+  float nLastState = _NbStates() - 1;
+
+  /* if that's the beginning */
+  if (i_state < 0.0) {
+    i_state = 0.0;
+  }
+
+  /* if that's end */
+  if (i_state > nLastState) {
+    m_nCurChunk = m_Chunks.size() - 1;
+    m_nCurState = m_Chunks[m_nCurChunk]->nNumStates - 1;
+    return false;
+  }
+
+  m_nCurChunk = _ChunkOfState((unsigned int)i_state);
+  m_nCurState = i_state - m_chunksFirstState[m_nCurChunk];
+  return true;
+}
+
+int Replay::_StateTime(unsigned int i_state) {
+  SerializedBikeState v_bs;
+  unsigned int nChunk = _ChunkOfState(i_state);
+
+  memcpy(
+    (char *)&v_bs,
+    &_ChunkData(nChunk)[(i_state - m_chunksFirstState[nChunk]) * m_nStateSize],
+    m_nStateSize);
+  SwapEndian::LittleSerializedBikeState(v_bs);
+
+  return GameApp::floatToTime(v_bs.fGameTime);
 }
 
 bool Replay::nextNormalState() {
@@ -892,49 +1213,7 @@ ReplayPosition Replay::getReplayPosition() const {
 
 bool Replay::nextState(int p_frames) {
   m_bEndOfFile = false;
-
-  m_nCurState += p_frames;
-
-  /* end or start of a chunk */
-  if (m_nCurState >= STATES_PER_CHUNK || m_nCurState < 0.0) {
-    /* go on the following chunk */
-    if (m_nCurState >= STATES_PER_CHUNK) { /* end of a chunk */
-      if (m_nCurChunk < m_Chunks.size() - 1) {
-        m_nCurState = m_nCurState - m_Chunks[m_nCurChunk]->nNumStates - 1;
-        m_nCurChunk++;
-      }
-    } else {
-      if (m_nCurState < 0.0) { /* start of a chunk */
-        if (m_nCurChunk > 0) {
-          m_nCurState = m_nCurState + m_Chunks[m_nCurChunk - 1]->nNumStates - 1;
-          m_nCurChunk--;
-        }
-      }
-    }
-
-    /* if that's the beginning */
-    if (m_nCurState < 0.0) {
-      m_nCurState = 0.0;
-    }
-
-    /* if that's end */
-    if (m_nCurState >= m_Chunks[m_nCurChunk]->nNumStates) {
-      m_nCurState = m_Chunks[m_nCurChunk]->nNumStates - 1;
-      return false;
-    }
-
-  } else { /* that's not the end or the start of the chunk */
-
-    /* if that's the beginning, do nothing */
-
-    /* if that's end */
-    if (m_nCurState >= m_Chunks[m_nCurChunk]->nNumStates) {
-      m_nCurState = m_Chunks[m_nCurChunk]->nNumStates - 1;
-      return false;
-    }
-  }
-
-  return true;
+  return _SeekState(_CurrentState() + p_frames);
 }
 
 void Replay::loadState(BikeState *state, PhysicsSettings *i_physicsSettings) {
@@ -958,7 +1237,7 @@ void Replay::peekState(BikeState *state, PhysicsSettings *i_physicsSettings) {
   /* Like loadState() but this one does not advance the cursor... it just takes
    * a peek */
   memcpy((char *)&v_bs,
-         &m_Chunks[m_nCurChunk]->pcChunkData[((int)m_nCurState) * m_nStateSize],
+         &_ChunkData(m_nCurChunk)[((int)m_nCurState) * m_nStateSize],
          m_nStateSize);
   SwapEndian::LittleSerializedBikeState(v_bs);
 
@@ -1010,8 +1289,24 @@ ReplayInfo *Replay::getReplayInfos(const std::string p_ReplayName) {
     }
   }
 
+  return _ReadReplayInfos(pfh, p_ReplayName);
+}
+
+ReplayInfo *Replay::getReplayInfosFromFile(const std::string &i_file,
+                                           const std::string &i_name) {
+  FileHandle *pfh = XMFS::openIFile(FDT_DATA, i_file, true);
+  if (pfh == NULL) {
+    return NULL;
+  }
+
+  return _ReadReplayInfos(pfh, i_name);
+}
+
+ReplayInfo *Replay::_ReadReplayInfos(FileHandle *pfh,
+                                     const std::string &p_ReplayName) {
+  /* only the header is read, it's never compressed */
   int nVersion = XMFS::readByte(pfh);
-  if (nVersion != 0 && nVersion != 1 && nVersion != 3) {
+  if (nVersion != 0 && nVersion != 1 && nVersion != 3 && nVersion != 4) {
     XMFS::closeFile(pfh);
     return NULL;
   }
@@ -1057,6 +1352,38 @@ void Replay::fastforward(int i_time) {
   nextState(nNumStates);
 }
 
+void Replay::seekTime(int i_time) {
+  int nNbStates = _NbStates();
+  int nState;
+
+  /* the states are stored at the frame rate : guess the state from the time,
+     and fix the guess if some states are missing */
+  nState = (int)(((i_time - m_firstStateTime) * m_fFrameRate) / 100);
+  if (nState >= nNbStates) {
+    nState = nNbStates - 1;
+  }
+  if (nState < 0) {
+    nState = 0;
+  }
+
+  while (nState > 0 && _StateTime(nState) > i_time) {
+    nState--;
+  }
+  while (nState + 1 < nNbStates && _StateTime(nState + 1) <= i_time) {
+    nState++;
+  }
+
+  m_bEndOfFile = false;
+  _SeekState(nState);
+}
+
+int Replay::getLastStateTime() {
+  if (_NbStates() == 0) {
+    return 0;
+  }
+  return _StateTime(_NbStates() - 1);
+}
+
 void Replay::fastrewind(int i_time, int i_minimumNbFrame) {
   /* How many states should we move forward? */
   int nNumStates = (int)((i_time * m_fFrameRate) / 100);
@@ -47,8 +47,15 @@ struct ReplayInfo {
 /* Replays states (frames) are grouped together in chunks for easy
    processing */
 struct ReplayStateChunk {
-  char *pcChunkData;
+  char *pcChunkData; /* NULL while the chunk is not decoded */
   int nNumStates;
+  bool bOwnData; /* else, pcChunkData is a view over the replay data */
+
+  /* zlib compressed states of an opened replay, decoded when they are
+     reached and freed once the replay is far from them */
+  const char *pcCompressedData;
+  int nCompressedSize;
+  int nColumnsSize; /* if not 0, the states are stored by ReplayColumns */
 };
 
 /* to be able to rewind exactly at the same position */
@@ -124,6 +131,11 @@ public:
   int CurrentFrame() const;
 
   void fastforward(int i_time);
+  /* go on the last state at i_time or before ; constant time for the replays
+     recorded at their frame rate */
+  void seekTime(int i_time);
+  /* game time of the last recorded state */
+  int getLastStateTime();
   void fastrewind(int i_time, int i_minimumNbFrame = 0); // i_minimumNbFrame,
   // because sometimes,
   // rewind do nothing if
@@ -145,6 +157,9 @@ public:
 
   /* return NULL if the replay is not valid */
   static ReplayInfo *getReplayInfos(const std::string p_ReplayName);
+  /* same, from the file i_file without searching it */
+  static ReplayInfo *getReplayInfosFromFile(const std::string &i_file,
+                                            const std::string &i_name);
 
   void saveReplayIfNot(int i_format);
 
@@ -156,6 +171,8 @@ public:
 private:
   /* Data */
   std::vector<ReplayStateChunk *> m_Chunks;
+  std::vector<unsigned int> m_chunksFirstState; /* index of the chunks */
+  int m_firstStateTime;
   unsigned int m_nCurChunk;
   float m_nCurState; /* is a float so that manage slow */
   std::string m_FileName, m_LevelID, m_PlayerName;
@@ -167,9 +184,24 @@ private:
   char *m_pcInputEventsData;
   unsigned int m_nInputEventsDataSize;
 
+  /* chunks data of an opened replay, the chunks are views over it */
+  char *m_pcChunksData;
+  std::vector<unsigned int> m_decodedChunks;
+
   /* Helpers */
+  static ReplayInfo *_ReadReplayInfos(FileHandle *pfh,
+                                      const std::string &p_ReplayName);
   void _FreeReplay(void);
+  /* states of the chunk, decoded if needed */
+  const char *_ChunkData(unsigned int i_chunk);
+  bool _DecodeChunk(unsigned int i_chunk);
   bool nextState(int p_frames); /* go to the next state */
+  void _IndexChunks();
+  unsigned int _NbStates() const;
+  unsigned int _ChunkOfState(unsigned int i_state) const;
+  float _CurrentState() const;
+  bool _SeekState(float i_state);
+  int _StateTime(unsigned int i_state);
   bool nextNormalState(); /* go to the next state */
 
   bool m_saved;
@@ -179,9 +211,17 @@ private:
 
   void saveReplay_1(FileHandle *pfh);
   void saveReplay_3(FileHandle *pfh);
+  void saveReplay_4(FileHandle *pfh);
+  void _SaveHeader(FileHandle *pfh, int i_version);
+  void _SaveMovingBlocks(DBuffer &o_buffer);
 
   void openReplay_1(FileHandle *pfh, bool bDisplayInformation, int nVersion);
   void openReplay_3(FileHandle *pfh, bool bDisplayInformation);
+  void openReplay_4(FileHandle *pfh, bool bDisplayInformation);
+  void _OpenHeader(FileHandle *pfh, bool bDisplayInformation);
+  void _OpenMovingBlocks(DBuffer &i_buffer);
+  void _ReadChunksData(FileHandle *pfh, DBuffer &o_chunks);
+  void _CheckFirstChunk();
 
   /* moving blocks (physics) */
   std::vector<rmblock> m_movingBlocksForSaving;
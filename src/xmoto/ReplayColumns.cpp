@@ -0,0 +1,173 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "ReplayColumns.h"
+#include "helpers/VExcept.h"
+#include "xmscene/BasicSceneStructs.h"
+#include <stddef.h>
+#include <string.h>
+
+struct ReplayColumnField {
+  unsigned int offset;
+  unsigned int size;
+};
+
+#define REPLAY_COLUMN_FIELD(field) \
+  { offsetof(SerializedBikeState, field), sizeof(SerializedBikeState().field) }
+
+/* fields, in the order of the columns -- the padding is not stored */
+static const ReplayColumnField g_replayColumnFields[] = {
+  REPLAY_COLUMN_FIELD(cFlags),
+  REPLAY_COLUMN_FIELD(fGameTime),
+  REPLAY_COLUMN_FIELD(fFrameX),
+  REPLAY_COLUMN_FIELD(fFrameY),
+  REPLAY_COLUMN_FIELD(fMaxXDiff),
+  REPLAY_COLUMN_FIELD(fMaxYDiff),
+  REPLAY_COLUMN_FIELD(nRearWheelRot),
+  REPLAY_COLUMN_FIELD(nFrontWheelRot),
+  REPLAY_COLUMN_FIELD(nFrameRot),
+  REPLAY_COLUMN_FIELD(cBikeEngineRPM),
+  REPLAY_COLUMN_FIELD(cRearWheelX),
+  REPLAY_COLUMN_FIELD(cRearWheelY),
+  REPLAY_COLUMN_FIELD(cFrontWheelX),
+  REPLAY_COLUMN_FIELD(cFrontWheelY),
+  REPLAY_COLUMN_FIELD(cElbowX),
+  REPLAY_COLUMN_FIELD(cElbowY),
+  REPLAY_COLUMN_FIELD(cShoulderX),
+  REPLAY_COLUMN_FIELD(cShoulderY),
+  REPLAY_COLUMN_FIELD(cLowerBodyX),
+  REPLAY_COLUMN_FIELD(cLowerBodyY),
+  REPLAY_COLUMN_FIELD(cKneeX),
+  REPLAY_COLUMN_FIELD(cKneeY)
+};
+
+#define REPLAY_COLUMN_NB_FIELDS \
+  (sizeof(g_replayColumnFields) / sizeof(g_replayColumnFields[0]))
+
+/* little endian value of the field */
+static unsigned int readField(const char *i_state,
+                              const ReplayColumnField &i_field) {
+  const unsigned char *v_bytes =
+    (const unsigned char *)i_state + i_field.offset;
+  unsigned int v_res = 0;
+
+  for (unsigned int i = 0; i < i_field.size; i++) {
+    v_res |= ((unsigned int)v_bytes[i]) << (8 * i);
+  }
+  return v_res;
+}
+
+static void writeField(char *o_state,
+                       const ReplayColumnField &i_field,
+                       unsigned int i_value) {
+  unsigned char *v_bytes = (unsigned char *)o_state + i_field.offset;
+
+  for (unsigned int i = 0; i < i_field.size; i++) {
+    v_bytes[i] = (i_value >> (8 * i)) & 0xFF;
+  }
+}
+
+/* difference of two values of the field, as a signed value of its size */
+static int fieldDelta(unsigned int i_value,
+                      unsigned int i_previous,
+                      const ReplayColumnField &i_field) {
+  unsigned int v_shift = 32 - 8 * i_field.size;
+  return ((int)((i_value - i_previous) << v_shift)) >> v_shift;
+}
+
+static void writeVarint(std::string &o_buffer, int i_value) {
+  /* zigzag : small negative values are small too */
+  unsigned int v_value =
+    (((unsigned int)i_value) << 1) ^ (unsigned int)(i_value >> 31);
+
+  while (v_value >= 0x80) {
+    o_buffer += (char)((v_value & 0x7F) | 0x80);
+    v_value >>= 7;
+  }
+  o_buffer += (char)v_value;
+}
+
+static int readVarint(const char *i_buffer, int i_size, int &io_offset) {
+  unsigned int v_value = 0;
+  unsigned int v_shift = 0;
+  unsigned char v_byte;
+
+  do {
+    if (io_offset >= i_size || v_shift > 28) {
+      throw Exception("Invalid replay states");
+    }
+    v_byte = (unsigned char)i_buffer[io_offset++];
+    v_value |= ((unsigned int)(v_byte & 0x7F)) << v_shift;
+    v_shift += 7;
+  } while (v_byte & 0x80);
+
+  return (int)((v_value >> 1) ^ (~(v_value & 1) + 1));
+}
+
+void ReplayColumns::encode(const char *i_states,
+                           int i_nbStates,
+                           unsigned int i_stateSize,
+                           std::string &o_columns) {
+  if (i_stateSize < sizeof(SerializedBikeState)) {
+    throw Exception("Invalid replay state size");
+  }
+
+  o_columns.clear();
+  o_columns.reserve(i_nbStates * REPLAY_COLUMN_NB_FIELDS);
+
+  for (unsigned int f = 0; f < REPLAY_COLUMN_NB_FIELDS; f++) {
+    const ReplayColumnField &v_field = g_replayColumnFields[f];
+    unsigned int v_previous = 0;
+
+    for (int i = 0; i < i_nbStates; i++) {
+      unsigned int v_value = readField(i_states + i * i_stateSize, v_field);
+      writeVarint(o_columns, fieldDelta(v_value, v_previous, v_field));
+      v_previous = v_value;
+    }
+  }
+}
+
+void ReplayColumns::decode(const char *i_columns,
+                           int i_columnsSize,
+                           char *o_states,
+                           int i_nbStates,
+                           unsigned int i_stateSize) {
+  int v_offset = 0;
+
+  if (i_stateSize < sizeof(SerializedBikeState)) {
+    throw Exception("Invalid replay state size");
+  }
+
+  memset(o_states, 0, i_nbStates * i_stateSize);
+
+  for (unsigned int f = 0; f < REPLAY_COLUMN_NB_FIELDS; f++) {
+    const ReplayColumnField &v_field = g_replayColumnFields[f];
+    unsigned int v_value = 0;
+
+    for (int i = 0; i < i_nbStates; i++) {
+      v_value += (unsigned int)readVarint(i_columns, i_columnsSize, v_offset);
+      writeField(o_states + i * i_stateSize, v_field, v_value);
+    }
+  }
+
+  if (v_offset != i_columnsSize) {
+    throw Exception("Invalid replay states");
+  }
+}
@@ -0,0 +1,47 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __REPLAYCOLUMNS_H__
+#define __REPLAYCOLUMNS_H__
+
+#include <string>
+
+/*
+  replay states stored field by field instead of state by state ; each field
+  is coded as the difference with the same field of the previous state, as a
+  zigzag varint. Consecutive states are close : most fields take one byte and
+  the columns compress a lot better than the states. The states are the
+  little endian SerializedBikeState images stored in the replays
+*/
+class ReplayColumns {
+public:
+  static void encode(const char *i_states,
+                     int i_nbStates,
+                     unsigned int i_stateSize,
+                     std::string &o_columns);
+  // throw an exception if the columns are invalid
+  static void decode(const char *i_columns,
+                     int i_columnsSize,
+                     char *o_states,
+                     int i_nbStates,
+                     unsigned int i_stateSize);
+};
+
+#endif
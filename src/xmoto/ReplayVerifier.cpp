@@ -0,0 +1,313 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "ReplayVerifier.h"
+#include "GameEvents.h"
+#include "Replay.h"
+#include "common/Theme.h"
+#include "common/VXml.h"
+#include "db/xmDatabase.h"
+#include "helpers/System.h"
+#include "helpers/Text.h"
+#include "helpers/VExcept.h"
+#include "net/NetClient.h"
+#include "thread/XMThreadPool.h"
+#include "xmscene/BikeGhost.h"
+#include "xmscene/Level.h"
+#include "xmscene/LevelCacheArchive.h"
+#include "xmscene/LevelCacheManifest.h"
+#include "xmscene/Scene.h"
+
+/* the playback goes on a bit after the last state so that the events recorded
+   at the end are executed */
+#define XM_VERIFY_END_MARGIN 100 // hundredths
+
+class ReplayVerifyTask : public XMThreadPoolTask {
+public:
+  ReplayVerifyTask(const std::string &i_replayFile,
+                   const std::map<std::string, std::string> *i_levelFiles) {
+    m_replayFile = i_replayFile;
+    m_levelFiles = i_levelFiles;
+    m_allowSharedState = false;
+    m_deferred = false;
+    m_valid = false;
+    m_didFinish = false;
+    m_isFinished = false;
+    m_isDead = false;
+    m_finishTime = 0;
+    m_lastStateTime = 0;
+    m_playedTime = 0;
+    m_nbEvents = 0;
+    m_nbPassedEvents = 0;
+    m_nbRemainingStrawberries = 0;
+    m_duration = 0;
+  }
+
+  void execute() {
+    unsigned long long v_start = System::getTimeUs();
+    Scene *v_scene = new Scene();
+
+    m_deferred = false;
+    try {
+      play(v_scene);
+    } catch (Exception &e) {
+      m_error = e.getMsg();
+    } catch (...) {
+      m_error = "unable to play the replay";
+    }
+    delete v_scene;
+
+    m_duration = System::getTimeUs() - v_start;
+  }
+
+  std::string m_replayFile;
+  const std::map<std::string, std::string> *m_levelFiles;
+  /* scripted and physics levels use static data (lua calls, chipmunk) ; they
+     are only played when this is set, from the main thread */
+  bool m_allowSharedState;
+  bool m_deferred;
+
+  std::string m_levelId;
+  std::string m_error; // the replay can't be played
+  std::string m_invalidity; // the replay is played, but it's not consistent
+  bool m_valid;
+  bool m_didFinish; // as said by the replay
+  bool m_isFinished; // as played
+  bool m_isDead;
+  int m_finishTime;
+  int m_lastStateTime;
+  int m_playedTime;
+  unsigned int m_nbEvents;
+  unsigned int m_nbPassedEvents;
+  unsigned int m_nbRemainingStrawberries;
+  unsigned long long m_duration; // microseconds
+
+private:
+  void play(Scene *i_scene) {
+    ReplayInfo *v_info;
+    std::map<std::string, std::string>::const_iterator v_levelFile;
+    ReplayBiker *v_biker;
+    Replay *v_replay;
+    int v_endTime;
+
+    v_info = Replay::getReplayInfos(m_replayFile);
+    if (v_info == NULL) {
+      throw Exception("invalid replay");
+    }
+    m_levelId = v_info->Level;
+    delete v_info;
+
+    v_levelFile = m_levelFiles->find(m_levelId);
+    if (v_levelFile == m_levelFiles->end()) {
+      throw Exception("level " + m_levelId + " not found");
+    }
+
+    i_scene->loadLevelFile(v_levelFile->second, true);
+    if ((i_scene->getLevelSrc()->isScripted() ||
+         i_scene->getLevelSrc()->isPhysics()) &&
+        m_allowSharedState == false) {
+      m_deferred = true;
+      return;
+    }
+    if (i_scene->getLevelSrc()->isXMotoTooOld()) {
+      throw Exception("level " + m_levelId + " is too recent");
+    }
+
+    i_scene->prePlayLevel(NULL, false, true, false);
+    v_biker = i_scene->addReplayFromFile(m_replayFile,
+                                         Theme::instance(),
+                                         Theme::instance()->getPlayerTheme(),
+                                         false);
+    i_scene->playInitLevel();
+
+    v_replay = v_biker->getReplay();
+    m_didFinish = v_replay->didFinish();
+    m_finishTime = v_replay->getFinishTime();
+    m_lastStateTime = v_replay->getLastStateTime();
+    v_endTime = m_lastStateTime + XM_VERIFY_END_MARGIN;
+    if (m_didFinish && m_finishTime + XM_VERIFY_END_MARGIN > v_endTime) {
+      v_endTime = m_finishTime + XM_VERIFY_END_MARGIN;
+    }
+
+    while (i_scene->getTime() < v_endTime) {
+      i_scene->updateLevel(PHYS_STEP_SIZE,
+                           NULL,
+                           NULL,
+                           false,
+                           false /* no particles */,
+                           false /* nothing to see */);
+    }
+
+    m_isFinished = v_biker->isFinished();
+    m_isDead = v_biker->isDead();
+    m_playedTime = i_scene->getTime();
+    m_nbRemainingStrawberries = i_scene->getNbRemainingStrawberries();
+
+    m_nbEvents = v_replay->getEvents()->size();
+    m_nbPassedEvents = 0;
+    for (unsigned int i = 0; i < m_nbEvents; i++) {
+      if ((*v_replay->getEvents())[i]->bPassed) {
+        m_nbPassedEvents++;
+      }
+    }
+
+    check(v_replay->getFrameRate());
+  }
+
+  void check(float i_frameRate) {
+    /* the states are recorded at the frame rate and stop when the player
+       finishes : the last one is at most one frame before the end */
+    int v_tolerance = (int)(100.0 / i_frameRate) + PHYS_STEP_SIZE;
+
+    m_valid = false;
+
+    if (m_didFinish) {
+      if (m_isFinished == false) {
+        m_invalidity = "the playback doesn't finish";
+        return;
+      }
+      if (m_finishTime < m_lastStateTime ||
+          m_finishTime - m_lastStateTime > v_tolerance) {
+        m_invalidity = "the finish time doesn't match the last state";
+        return;
+      }
+      if (m_nbRemainingStrawberries != 0) {
+        m_invalidity = "finished with remaining strawberries";
+        return;
+      }
+    } else {
+      if (m_isDead == false) {
+        m_invalidity = "the playback doesn't end";
+        return;
+      }
+    }
+
+    m_valid = true;
+  }
+};
+
+ReplayVerifier::ReplayVerifier(xmDatabase *i_db, unsigned int i_nbThreads) {
+  char **v_result;
+  unsigned int nrow;
+
+  m_nbThreads = i_nbThreads;
+
+  /* the workers don't access the database */
+  v_result = i_db->readDB("SELECT id_level, filepath FROM levels;", nrow);
+  for (unsigned int i = 0; i < nrow; i++) {
+    m_levelFiles[i_db->getResult(v_result, 2, i, 0)] =
+      i_db->getResult(v_result, 2, i, 1);
+  }
+  i_db->read_DB_free(v_result);
+}
+
+ReplayVerifier::~ReplayVerifier() {
+  for (unsigned int i = 0; i < m_tasks.size(); i++) {
+    delete m_tasks[i];
+  }
+}
+
+void ReplayVerifier::addReplay(const std::string &i_replayFile) {
+  m_tasks.push_back(new ReplayVerifyTask(i_replayFile, &m_levelFiles));
+}
+
+unsigned int ReplayVerifier::run() {
+  unsigned long long v_start = System::getTimeUs();
+  unsigned long long v_duration;
+  unsigned int v_nbInvalid = 0;
+  unsigned int v_nbDeferred = 0;
+  int v_playedTime = 0;
+
+  /* the singletons used by the workers are not created thread safely */
+  XMLDocument::init();
+  LevelCacheManifest::instance();
+  LevelCacheArchive::instance();
+  Theme::instance();
+  NetClient::instance();
+
+  XMThreadPool v_pool(m_nbThreads);
+  for (unsigned int i = 0; i < m_tasks.size(); i++) {
+    v_pool.addTask(m_tasks[i]);
+  }
+  v_pool.waitTasks();
+
+  for (unsigned int i = 0; i < m_tasks.size(); i++) {
+    if (m_tasks[i]->m_deferred) {
+      m_tasks[i]->m_allowSharedState = true;
+      m_tasks[i]->execute();
+      v_nbDeferred++;
+    }
+  }
+
+  v_duration = System::getTimeUs() - v_start;
+
+  for (unsigned int i = 0; i < m_tasks.size(); i++) {
+    printResult(m_tasks[i]);
+    if (m_tasks[i]->m_valid == false) {
+      v_nbInvalid++;
+    }
+    v_playedTime += m_tasks[i]->m_playedTime;
+  }
+
+  printf(" * %u replays verified in %.2f seconds on %u threads (%u played "
+         "in the main thread)\n",
+         (unsigned int)m_tasks.size(),
+         v_duration / 1000000.0,
+         m_nbThreads,
+         v_nbDeferred);
+  if (v_duration > 0) {
+    printf(" * %.1f replays per minute, %.1f times the real time\n",
+           m_tasks.size() * 60000000.0 / v_duration,
+           (v_playedTime * 10000.0) / v_duration);
+  }
+  printf(" * %u valid, %u invalid\n",
+         (unsigned int)m_tasks.size() - v_nbInvalid,
+         v_nbInvalid);
+
+  return v_nbInvalid;
+}
+
+void ReplayVerifier::printResult(ReplayVerifyTask *i_task) {
+  if (i_task->m_error != "") {
+    printf("%s: ERROR (%s)\n",
+           i_task->m_replayFile.c_str(),
+           i_task->m_error.c_str());
+    return;
+  }
+
+  printf("%s: %s level=%s %s=%s last state=%s events=%u/%u%s%s "
+         "(%.1f ms, %.0fx)\n",
+         i_task->m_replayFile.c_str(),
+         i_task->m_valid ? "OK" : "INVALID",
+         i_task->m_levelId.c_str(),
+         i_task->m_didFinish ? "finished" : "died",
+         i_task->m_didFinish
+           ? formatTime(i_task->m_finishTime).c_str()
+           : "-",
+         formatTime(i_task->m_lastStateTime).c_str(),
+         i_task->m_nbPassedEvents,
+         i_task->m_nbEvents,
+         i_task->m_valid ? "" : " : ",
+         i_task->m_invalidity.c_str(),
+         i_task->m_duration / 1000.0,
+         i_task->m_duration > 0
+           ? (i_task->m_playedTime * 10000.0) / i_task->m_duration
+           : 0.0);
+}
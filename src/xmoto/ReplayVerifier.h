@@ -0,0 +1,55 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __REPLAYVERIFIER_H__
+#define __REPLAYVERIFIER_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+class xmDatabase;
+class ReplayVerifyTask;
+
+/*
+  plays replays back without graphics, each one in its own scene, on a pool of
+  threads ; checks that the end of the playback agrees with the replay header
+  and prints a line per replay, then the throughput
+*/
+class ReplayVerifier {
+public:
+  ReplayVerifier(xmDatabase *i_db, unsigned int i_nbThreads);
+  ~ReplayVerifier();
+
+  // queue a replay file to verify
+  void addReplay(const std::string &i_replayFile);
+
+  // verify the queued replays ; return the number of invalid ones
+  unsigned int run();
+
+private:
+  void printResult(ReplayVerifyTask *i_task);
+
+  unsigned int m_nbThreads;
+  std::map<std::string, std::string> m_levelFiles; // id_level => filepath
+  std::vector<ReplayVerifyTask *> m_tasks;
+};
+
+#endif
@@ -440,13 +440,10 @@ std::string Universe::getTemporaryReplayName() const {
 
 void Universe::saveReplayTemporary(xmDatabase *pDb) {
   /*
-    use old format if level is not physics to allow people having an old version
-    to read replays
-    in the future (today is 28/06/2009), once everybody can read 3 version, use
-    always 3 version
+    the 4 version stores the states by columns : the replays are smaller to
+    upload and faster to load as ghosts
   */
-  m_pJustPlayReplay->saveReplayIfNot(
-    m_scenes[0]->getLevelSrc()->isPhysics() ? 3 : 1);
+  m_pJustPlayReplay->saveReplayIfNot(4);
 }
 
 void Universe::saveReplay(xmDatabase *pDb, const std::string &Name) {
@@ -28,6 +28,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #define INTERPOLATION_MAXIMUM_TIME 300
 #define INTERPOLATION_MAXIMUM_SPACE 5.0
+// jump in the replay rather than reading all the states until the time
+#define SEEK_MINIMUM_TIME 100
 
 Ghost::Ghost(PhysicsSettings *i_physicsSettings,
              bool i_engineSound,
@@ -289,10 +291,13 @@ void FileGhost::updateToTime(int i_time,
 
   /* back in the past */
   // m_ghostBikeStates.size()/2-1 : it's the more recent frame in the past
-  if (m_ghostBikeStates[m_ghostBikeStates.size() / 2 - 1]->GameTime > i_time) {
-    m_replay->fastrewind(
-      m_ghostBikeStates[m_ghostBikeStates.size() / 2 - 1]->GameTime - i_time,
-      1);
+  // or far in the future (fast forward, jump to a time)
+  if (m_ghostBikeStates[m_ghostBikeStates.size() / 2 - 1]->GameTime > i_time ||
+      (m_ghostBikeStates[m_ghostBikeStates.size() - 1]->GameTime +
+           SEEK_MINIMUM_TIME <
+         i_time &&
+       m_replay->endOfFile() == false)) {
+    m_replay->seekTime(i_time);
 
     for (unsigned int i = 0; i < m_ghostBikeStates.size(); i++) {
       m_replay->peekState(m_ghostBikeStates[i], m_physicsSettings);
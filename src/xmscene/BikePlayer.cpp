@@ -30,6 +30,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "xmoto/Game.h"
 #include "xmoto/GameText.h"
 #include "xmoto/PhysSettings.h"
+#include "xmoto/PhysicsBenchmark.h"
 #include "xmoto/Replay.h"
 #include "xmoto/Sound.h"
 
@@ -851,9 +852,12 @@ void PlayerLocalBiker::updatePhysics(int i_time,
   m_bikeState->PrevPHq2 = PHq;
 
   /* Perform world simulation step */
-  dWorldQuickStep(m_WorldID,
-                  ((float)i_timeStep / 100.0) *
-                    m_physicsSettings->SimulationSpeedFactor());
+  {
+    PhysicsBenchmarkScope v_benchmarkScope(PBP_WORLD_STEP);
+    dWorldQuickStep(m_WorldID,
+                    ((float)i_timeStep / 100.0) *
+                      m_physicsSettings->SimulationSpeedFactor());
+  }
   // dWorldStep(m_WorldID,fTimeStep*PHYS_SPEED);
 
   /* Empty contact joint group */
@@ -868,6 +872,8 @@ bool PlayerLocalBiker::intersectHeadLevel(Vector2f Cp,
                                           float Cr,
                                           const Vector2f &LastCp,
                                           CollisionSystem *v_collisionSystem) {
+  PhysicsBenchmarkScope v_benchmarkScope(PBP_COLLISIONS);
+
   // check the circle
   if (v_collisionSystem->checkCircle(Cp.x, Cp.y, Cr))
     return true;
@@ -890,6 +896,8 @@ int PlayerLocalBiker::intersectBodyLevel(Vector2f Cp,
                                          float Cr,
                                          dContact *pContacts,
                                          CollisionSystem *v_collisionSystem) {
+  PhysicsBenchmarkScope v_benchmarkScope(PBP_COLLISIONS);
+
   int nNumContacts = v_collisionSystem->collideCircle(
     Cp.x, Cp.y, Cr, pContacts, 100, m_physicsSettings);
   if (nNumContacts == 0) {
@@ -904,6 +912,8 @@ int PlayerLocalBiker::intersectWheelLevel(Vector2f Cp,
                                           float Cr,
                                           dContact *pContacts,
                                           CollisionSystem *v_collisionSystem) {
+  PhysicsBenchmarkScope v_benchmarkScope(PBP_COLLISIONS);
+
   int nNumContacts = v_collisionSystem->collideCircle(
     Cp.x, Cp.y, Cr, pContacts, 100, m_physicsSettings);
   if (nNumContacts == 0) {
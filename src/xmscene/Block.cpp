@@ -304,8 +304,9 @@ void Block::updatePhysics(int i_time,
   }
 
   if (moved == true) {
-    // inform collision system that there has been a change
-    io_collisionSystem->moveDynBlock(this);
+    // inform collision system that there has been a change ; it's applied
+    // once all the blocks are updated
+    io_collisionSystem->queueDynBlockMove(this);
   }
 
   cpBodyResetForces(mBody);
@@ -68,6 +68,7 @@ Entity::Entity(const std::string &i_id) {
   m_isBBoxDirty = true;
   m_speciality = ET_NONE;
   m_isCheckpoint = false;
+  m_collisionElement = NULL;
 }
 
 Entity::~Entity() {}
@@ -35,6 +35,8 @@ class Block;
 class ChipmunkWorld;
 class Level;
 class PhysicsSettings;
+template<class T>
+struct ColElement;
 
 /**
   An entity is an object that the biker can found on his way
@@ -111,6 +113,12 @@ public:
 
   void loadSpriteTextures();
 
+  /* handle in the collision system, NULL while it's not in */
+  inline ColElement<Entity> *getColElement() { return m_collisionElement; }
+  inline void setColElement(ColElement<Entity> *i_collisionElement) {
+    m_collisionElement = i_collisionElement;
+  }
+
 protected:
   std::string m_id; /** Its own identifer */
   std::string m_spriteName; /** Name of the sprite to be drawn */
@@ -133,6 +141,7 @@ protected:
 
   BoundingCircle m_BCircle;
   bool m_isBBoxDirty;
+  ColElement<Entity> *m_collisionElement;
   EntitySpeciality m_speciality;
 
   static Entity *createEntity(const std::string &id,
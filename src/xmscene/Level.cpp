@@ -28,6 +28,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "Block.h"
 #include "ChipmunkWorld.h"
 #include "Entity.h"
+#include "LevelCacheArchive.h"
+#include "LevelCacheManifest.h"
 #include "PhysicsSettings.h"
 #include "Scene.h"
 #include "SkyApparence.h"
@@ -41,6 +43,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include "helpers/Log.h"
 #include "helpers/Text.h"
 #include "xmoto/Collision.h"
+#include "xmoto/PhysicsBenchmark.h"
 #include <chipmunk.h>
 
 Level::Level() {
@@ -178,12 +181,15 @@ void Level::updatePhysics(int i_time,
     return;
   }
 
+  PhysicsBenchmarkScope v_benchmarkScope(PBP_LEVEL_PHYSICS);
+
   cpSpaceStep(i_chipmunkWorld->getSpace(), ((double)timeStep) / 100.0);
 
   // loop through all blocks, looking for chipmunky ones
   for (unsigned int i = 0; i < m_blocks.size(); i++) {
     m_blocks[i]->updatePhysics(i_time, timeStep, p_CollisionSystem, i_recorder);
   }
+  p_CollisionSystem->moveQueuedDynBlocks();
 }
 
 Block *Level::getBlockById(const std::string &i_id) {
@@ -725,7 +731,7 @@ void Level::loadXML(bool i_loadMainLayerOnly) {
 bool Level::loadReducedFromFile(bool i_loadMainLayerOnly) {
   std::string cacheFileName;
 
-  m_checkSum = XMFS::md5sum(FDT_DATA, FileName());
+  m_checkSum = LevelCacheManifest::instance()->checkSum(FileName());
 
   // First try to load it from the cache
   bool cached = false;
@@ -734,8 +740,8 @@ bool Level::loadReducedFromFile(bool i_loadMainLayerOnly) {
   cacheFileName = getNameInCache(i_loadMainLayerOnly);
 
   try {
-    cached = importBinaryHeaderFromFile(
-      FDT_CACHE, cacheFileName, m_checkSum, i_loadMainLayerOnly);
+    cached = importBinaryHeaderFromCache(
+      cacheFileName, m_checkSum, i_loadMainLayerOnly);
   } catch (Exception &e) {
     LogWarning("Exception while loading binary level, will load "
                "XML instead for '%s' (%s)",
@@ -746,10 +752,8 @@ bool Level::loadReducedFromFile(bool i_loadMainLayerOnly) {
   // If we couldn't get it from the cache, then load from (slow) XML
   if (!cached) {
     loadXML(i_loadMainLayerOnly);
-    exportBinary(FDT_CACHE,
-                 cacheFileName,
-                 m_checkSum,
-                 i_loadMainLayerOnly); /* Cache it now */
+    exportBinary(
+      cacheFileName, m_checkSum, i_loadMainLayerOnly); /* Cache it now */
   }
 
   unloadLevelBody(); /* remove body datas */
@@ -763,8 +767,7 @@ std::string Level::getNameInCache(bool i_loadMainLayerOnly) const {
   if (i_loadMainLayerOnly) {
     v_suffix = "mlo";
   }
-  return "LCache/" + Checksum() + XMFS::getFileBaseName(FileName()) + v_suffix +
-         ".blv";
+  return Checksum() + XMFS::getFileBaseName(FileName()) + v_suffix;
 }
 
 void Level::removeFromCache(xmDatabase *i_db, const std::string &i_id_level) {
@@ -778,9 +781,9 @@ void Level::removeFromCache(xmDatabase *i_db, const std::string &i_id_level) {
     try {
       std::string v_checkSum = i_db->getResult(v_result, 2, 0, 0);
       std::string v_filePath = i_db->getResult(v_result, 2, 0, 1);
-      XMFS::deleteFile(FDT_CACHE,
-                       "LCache/" + v_checkSum +
-                         XMFS::getFileBaseName(v_filePath) + ".blv");
+      std::string v_name = v_checkSum + XMFS::getFileBaseName(v_filePath);
+      LevelCacheArchive::instance()->removeLevel(v_name);
+      LevelCacheArchive::instance()->removeLevel(v_name + "mlo");
     } catch (Exception &e) {
       /* ok, it was perhaps not in cache */
     }
@@ -791,8 +794,7 @@ void Level::removeFromCache(xmDatabase *i_db, const std::string &i_id_level) {
 /*===========================================================================
   Export binary level file
   ===========================================================================*/
-void Level::exportBinary(FileDataType i_fdt,
-                         const std::string &FileName,
+void Level::exportBinary(const std::string &i_nameInCache,
                          const std::string &pSum,
                          bool i_loadMainLayerOnly) {
   /* Don't do this if we failed to load level from XML */
@@ -800,9 +802,9 @@ void Level::exportBinary(FileDataType i_fdt,
     return;
 
   /* Export binary... */
-  FileHandle *pfh = XMFS::openOFile(i_fdt, FileName);
+  FileHandle *pfh = XMFS::openOMemory(i_nameInCache);
   if (pfh == NULL) {
-    LogWarning("Failed to export binary: %s", FileName.c_str());
+    LogWarning("Failed to export binary: %s", i_nameInCache.c_str());
   } else {
     exportBinaryHeader(pfh, i_loadMainLayerOnly);
 
@@ -881,6 +883,9 @@ void Level::exportBinary(FileDataType i_fdt,
       m_zones[i]->saveBinary(pfh);
     }
 
+    LevelCacheArchive::instance()->storeLevel(i_nameInCache,
+                                              XMFS::getMemoryData(pfh));
+
     /* clean up */
     XMFS::closeFile(pfh);
   }
@@ -891,15 +896,12 @@ bool Level::isFullyLoaded() const {
 }
 
 void Level::loadFullyFromFile(bool i_loadMainLayerOnly) {
-  if (importBinary(FDT_CACHE,
-                   getNameInCache(i_loadMainLayerOnly),
+  if (importBinary(getNameInCache(i_loadMainLayerOnly),
                    Checksum(),
                    i_loadMainLayerOnly) == false) {
     loadXML(i_loadMainLayerOnly);
-    exportBinary(FDT_CACHE,
-                 getNameInCache(i_loadMainLayerOnly),
-                 m_checkSum,
-                 i_loadMainLayerOnly);
+    exportBinary(
+      getNameInCache(i_loadMainLayerOnly), m_checkSum, i_loadMainLayerOnly);
   }
   loadRemplacementSprites();
 }
@@ -968,12 +970,11 @@ void Level::importHeader(const std::string &i_id,
 /*===========================================================================
 Import binary level file
 ===========================================================================*/
-bool Level::importBinaryHeaderFromFile(FileDataType i_fdt,
-                                       const std::string &FileName,
-                                       const std::string &pSum,
-                                       bool i_loadMainLayerOnly) {
+bool Level::importBinaryHeaderFromCache(const std::string &i_nameInCache,
+                                        const std::string &pSum,
+                                        bool i_loadMainLayerOnly) {
   /* Import binary */
-  FileHandle *pfh = XMFS::openIFile(i_fdt, FileName, true);
+  FileHandle *pfh = LevelCacheArchive::instance()->openLevel(i_nameInCache);
   if (pfh == NULL) {
     return false;
   }
@@ -981,17 +982,17 @@ bool Level::importBinaryHeaderFromFile(FileDataType i_fdt,
   try {
     importBinaryHeader(pfh, i_loadMainLayerOnly);
     if (m_checkSum != pSum) {
-      LogWarning("CRC check failed, can't import: %s", FileName.c_str());
-      XMFS::closeFile(pfh);
+      LogWarning("CRC check failed, can't import: %s", i_nameInCache.c_str());
+      LevelCacheArchive::instance()->closeLevel(pfh);
       return false;
     }
   } catch (Exception &e) {
-    XMFS::closeFile(pfh);
+    LevelCacheArchive::instance()->closeLevel(pfh);
     return false;
   }
 
   /* clean up */
-  XMFS::closeFile(pfh);
+  LevelCacheArchive::instance()->closeLevel(pfh);
 
   return true;
 }
@@ -1017,8 +1018,7 @@ void Level::exportBinaryHeader(FileHandle *pfh, bool i_loadMainLayerOnly) {
   XMFS::writeBool(pfh, m_isPhysics);
 }
 
-bool Level::importBinary(FileDataType i_fdt,
-                         const std::string &FileName,
+bool Level::importBinary(const std::string &i_nameInCache,
                          const std::string &pSum,
                          bool i_loadMainLayerOnly) {
   unloadLevelBody();
@@ -1029,10 +1029,12 @@ bool Level::importBinary(FileDataType i_fdt,
   m_xmotoTooOld = false;
 
   /* Import binary */
-  FileHandle *pfh = XMFS::openIFile(i_fdt, FileName, true);
+  FileHandle *pfh = LevelCacheArchive::instance()->openLevel(i_nameInCache);
   if (pfh == NULL) {
     return false;
-  } else {
+  }
+
+  try {
     /* Read tag - it tells something about the format */
     int nFormat = XMFS::readInt_LE(pfh);
 
@@ -1044,7 +1046,8 @@ bool Level::importBinary(FileDataType i_fdt,
       if (i_loadMainLayerOnly == v_loadMainLayerOnly) {
         std::string md5sum = XMFS::readString(pfh);
         if (md5sum != pSum) {
-          LogWarning("CRC check failed, can't import: %s", FileName.c_str());
+          LogWarning("CRC check failed, can't import: %s",
+                     i_nameInCache.c_str());
           bRet = false;
         } else {
           /* Read header */
@@ -1183,21 +1186,27 @@ bool Level::importBinary(FileDataType i_fdt,
         }
       } else {
         LogWarning("Different main layer mode, can't import: %s",
-                   nFormat,
-                   FileName.c_str());
+                   i_nameInCache.c_str());
         bRet = false;
       }
     } else {
       LogWarning("Invalid binary format (%d), can't import: %s",
                  nFormat,
-                 FileName.c_str());
+                 i_nameInCache.c_str());
       bRet = false;
     }
-
-    /* clean up */
-    XMFS::closeFile(pfh);
+  } catch (Exception &e) {
+    LogWarning("Unable to read the binary level, can't import: %s (%s)",
+               i_nameInCache.c_str(),
+               e.getMsg().c_str());
+    LevelCacheArchive::instance()->closeLevel(pfh);
+    unloadLevelBody();
+    return false;
   }
 
+  /* clean up */
+  LevelCacheArchive::instance()->closeLevel(pfh);
+
   m_isBodyLoaded = bRet;
   return bRet;
 }
@@ -1463,10 +1472,8 @@ void Level::unloadLevelBody() {
 }
 
 void Level::rebuildCache(bool i_loadMainLayerOnly) {
-  exportBinary(FDT_CACHE,
-               getNameInCache(i_loadMainLayerOnly),
-               m_checkSum,
-               i_loadMainLayerOnly);
+  exportBinary(
+    getNameInCache(i_loadMainLayerOnly), m_checkSum, i_loadMainLayerOnly);
 }
 
 std::string Level::SpriteForStrawberry() const {
@@ -250,18 +250,16 @@ private:
   Sprite *m_checkpointSpriteUp;
 
   void addLimits();
-  void exportBinary(FileDataType i_fdt,
-                    const std::string &i_fileName,
+  void exportBinary(const std::string &i_nameInCache,
                     const std::string &i_sum,
                     bool i_loadMainLayerOnly);
-  bool importBinary(FileDataType i_fdt,
-                    const std::string &i_fileName,
+  bool importBinary(const std::string &i_nameInCache,
                     const std::string &i_sum,
                     bool i_loadMainLayerOnly);
-  bool importBinaryHeaderFromFile(FileDataType i_fdt,
-                                  const std::string &i_fileName,
-                                  const std::string &i_sum,
-                                  bool i_loadMainLayerOnly);
+  bool importBinaryHeaderFromCache(const std::string &i_nameInCache,
+                                   const std::string &i_sum,
+                                   bool i_loadMainLayerOnly);
+  /* name of the level in the LevelCacheArchive */
   std::string getNameInCache(bool i_loadMainLayerOnly) const;
 
   void loadRemplacementSprites();
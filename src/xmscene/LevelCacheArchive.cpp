@@ -0,0 +1,400 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "LevelCacheArchive.h"
+#include "common/VFileIO.h"
+#include "helpers/Log.h"
+#include "include/xm_SDL.h"
+#include <string.h>
+
+#define LEVEL_CACHE_ARCHIVE_FILE "LCache/levels.blc"
+#define LEVEL_CACHE_ARCHIVE_MAGIC "XLC1"
+#define LEVEL_CACHE_ARCHIVE_NAME_MAX 1024
+#define LEVEL_CACHE_ARCHIVE_REMOVED -1
+/* don't rewrite the archive to save less than that */
+#define LEVEL_CACHE_ARCHIVE_MIN_WASTE (1024 * 1024)
+
+/* archive : magic, then records : name length, name, data length (or -1 for a
+   removed level), data ; integers are 32 bits little endian */
+
+static void archivePutInt(std::string &o_buffer, int i_value) {
+  o_buffer += (char)(i_value & 0xff);
+  o_buffer += (char)((i_value >> 8) & 0xff);
+  o_buffer += (char)((i_value >> 16) & 0xff);
+  o_buffer += (char)((i_value >> 24) & 0xff);
+}
+
+static int archiveGetInt(const char *i_data) {
+  const unsigned char *v_data = (const unsigned char *)i_data;
+  return (int)(v_data[0] | v_data[1] << 8 | v_data[2] << 16 |
+               (unsigned int)v_data[3] << 24);
+}
+
+LevelCacheArchive::LevelCacheArchive() {
+  m_opened = false;
+  m_archiveSize = 0;
+  m_liveSize = 0;
+  m_fp = NULL;
+  m_nbViews = 0;
+  m_mutex = SDL_CreateMutex();
+}
+
+LevelCacheArchive::~LevelCacheArchive() {
+  close();
+  SDL_DestroyMutex(m_mutex);
+}
+
+std::string LevelCacheArchive::archivePath() const {
+  return XMFS::getUserDir(FDT_CACHE) + "/" + LEVEL_CACHE_ARCHIVE_FILE;
+}
+
+FileHandle *LevelCacheArchive::openLevel(const std::string &i_name) {
+  const char *v_data;
+  int v_size;
+
+  SDL_LockMutex(m_mutex);
+
+  if (m_opened == false) {
+    open();
+  }
+
+  HashNamespace::unordered_map<std::string, Record>::const_iterator it =
+    m_records.find(i_name);
+  if (it == m_records.end()) {
+    SDL_UnlockMutex(m_mutex);
+    return NULL;
+  }
+
+  /* cached since the archive has been mapped */
+  if (m_mappings.empty() ||
+      it->second.offset + it->second.size > m_mappings.back().size) {
+    if (remap() == false ||
+        it->second.offset + it->second.size > m_mappings.back().size) {
+      SDL_UnlockMutex(m_mutex);
+      return NULL;
+    }
+  }
+
+  v_data = m_mappings.back().data + it->second.offset;
+  v_size = it->second.size;
+  m_nbViews++;
+
+  SDL_UnlockMutex(m_mutex);
+
+  return XMFS::openIMemory(i_name, v_data, v_size);
+}
+
+void LevelCacheArchive::closeLevel(FileHandle *i_view) {
+  XMFS::closeFile(i_view);
+
+  SDL_LockMutex(m_mutex);
+
+  m_nbViews--;
+  unmapOldMappings();
+
+  SDL_UnlockMutex(m_mutex);
+}
+
+void LevelCacheArchive::storeLevel(const std::string &i_name,
+                                   const std::string &i_data) {
+  SDL_LockMutex(m_mutex);
+
+  if (m_opened == false) {
+    open();
+  }
+  appendRecord(i_name, i_data.c_str(), i_data.size());
+
+  SDL_UnlockMutex(m_mutex);
+}
+
+void LevelCacheArchive::removeLevel(const std::string &i_name) {
+  SDL_LockMutex(m_mutex);
+
+  if (m_opened == false) {
+    open();
+  }
+  if (m_records.find(i_name) != m_records.end()) {
+    appendRecord(i_name, NULL, LEVEL_CACHE_ARCHIVE_REMOVED);
+  }
+
+  SDL_UnlockMutex(m_mutex);
+}
+
+void LevelCacheArchive::clear() {
+  SDL_LockMutex(m_mutex);
+
+  close();
+  remove(archivePath().c_str());
+
+  SDL_UnlockMutex(m_mutex);
+}
+
+void LevelCacheArchive::open() {
+  Mapping v_mapping;
+  std::string v_path = archivePath();
+
+  m_opened = true;
+  m_records.clear();
+  m_archiveSize = 0;
+  m_liveSize = 0;
+
+  if (XMFS::mapFile(
+        v_path, &v_mapping.data, &v_mapping.size, &v_mapping.mapped)) {
+    size_t v_validSize = indexRecords(v_mapping);
+    size_t v_wastedSize =
+      v_validSize > 4 + m_liveSize ? v_validSize - 4 - m_liveSize : 0;
+
+    m_mappings.push_back(v_mapping);
+    m_archiveSize = v_mapping.size;
+
+    /* broken end of file (interrupted write), or a lot of superseded records
+     */
+    if (v_validSize != v_mapping.size ||
+        (v_wastedSize > m_liveSize &&
+         v_wastedSize > LEVEL_CACHE_ARCHIVE_MIN_WASTE)) {
+      compact();
+    }
+  }
+
+  m_fp = fopen(v_path.c_str(), "ab");
+  if (m_fp == NULL) {
+    LogWarning("Unable to open the level cache archive %s", v_path.c_str());
+    return;
+  }
+  /* one write per record, so that records of several instances sharing the
+     cache can't mix */
+  setvbuf(m_fp, NULL, _IONBF, 0);
+
+  if (m_archiveSize == 0) {
+    if (fwrite(LEVEL_CACHE_ARCHIVE_MAGIC, 4, 1, m_fp) != 1) {
+      fclose(m_fp);
+      m_fp = NULL;
+      return;
+    }
+    fflush(m_fp);
+    m_archiveSize = 4;
+  }
+}
+
+void LevelCacheArchive::close() {
+  if (m_fp != NULL) {
+    fclose(m_fp);
+    m_fp = NULL;
+  }
+
+  for (unsigned int i = 0; i < m_mappings.size(); i++) {
+    XMFS::unmapFile(
+      m_mappings[i].data, m_mappings[i].size, m_mappings[i].mapped);
+  }
+  m_mappings.clear();
+
+  m_records.clear();
+  m_archiveSize = 0;
+  m_liveSize = 0;
+  m_opened = false;
+}
+
+size_t LevelCacheArchive::indexRecords(const Mapping &i_mapping) {
+  const char *v_data = i_mapping.data;
+  size_t v_pos;
+
+  if (i_mapping.size < 4 ||
+      memcmp(v_data, LEVEL_CACHE_ARCHIVE_MAGIC, 4) != 0) {
+    return 0;
+  }
+
+  v_pos = 4;
+  while (v_pos + 8 <= i_mapping.size) {
+    int v_nameLength = archiveGetInt(v_data + v_pos);
+    if (v_nameLength <= 0 || v_nameLength > LEVEL_CACHE_ARCHIVE_NAME_MAX ||
+        v_pos + 8 + v_nameLength > i_mapping.size) {
+      break;
+    }
+
+    std::string v_name(v_data + v_pos + 4, v_nameLength);
+    int v_size = archiveGetInt(v_data + v_pos + 4 + v_nameLength);
+    size_t v_recordSize = 8 + v_nameLength;
+
+    if (v_size != LEVEL_CACHE_ARCHIVE_REMOVED) {
+      if (v_size < 0 || v_pos + v_recordSize + v_size > i_mapping.size) {
+        break;
+      }
+      v_recordSize += v_size;
+    }
+
+    /* the last record of a level supersedes the previous ones */
+    HashNamespace::unordered_map<std::string, Record>::iterator it =
+      m_records.find(v_name);
+    if (it != m_records.end()) {
+      m_liveSize -= 8 + it->first.size() + it->second.size;
+      m_records.erase(it);
+    }
+
+    if (v_size != LEVEL_CACHE_ARCHIVE_REMOVED) {
+      Record v_record;
+      v_record.offset = v_pos + 8 + v_nameLength;
+      v_record.size = v_size;
+      m_records[v_name] = v_record;
+      m_liveSize += v_recordSize;
+    }
+
+    v_pos += v_recordSize;
+  }
+
+  return v_pos;
+}
+
+void LevelCacheArchive::compact() {
+  std::string v_path = archivePath();
+  std::string v_tmpPath = v_path + ".tmp";
+  const Mapping &v_mapping = m_mappings.back();
+  HashNamespace::unordered_map<std::string, Record> v_records;
+  size_t v_size;
+  bool v_ok;
+
+  LogInfo("Compacting the level cache archive (%lu bytes, %lu used)",
+          (unsigned long)m_archiveSize,
+          (unsigned long)m_liveSize);
+
+  FILE *fp = fopen(v_tmpPath.c_str(), "wb");
+  v_ok = fp != NULL;
+  v_size = 4;
+
+  if (v_ok) {
+    v_ok = fwrite(LEVEL_CACHE_ARCHIVE_MAGIC, 4, 1, fp) == 1;
+  }
+
+  HashNamespace::unordered_map<std::string, Record>::const_iterator it;
+  for (it = m_records.begin(); v_ok && it != m_records.end(); ++it) {
+    std::string v_header;
+
+    archivePutInt(v_header, it->first.size());
+    v_header += it->first;
+    archivePutInt(v_header, it->second.size);
+
+    v_ok = fwrite(v_header.c_str(), v_header.size(), 1, fp) == 1 &&
+           (it->second.size == 0 ||
+            fwrite(v_mapping.data + it->second.offset,
+                   it->second.size,
+                   1,
+                   fp) == 1);
+
+    Record v_record;
+    v_record.offset = v_size + v_header.size();
+    v_record.size = it->second.size;
+    v_records[it->first] = v_record;
+    v_size += v_header.size() + it->second.size;
+  }
+
+  if (fp != NULL) {
+    v_ok = fclose(fp) == 0 && v_ok;
+  }
+
+  /* no view can be open yet : the file can be replaced */
+  close();
+  m_opened = true;
+
+  if (v_ok) {
+    remove(v_path.c_str());
+    v_ok = rename(v_tmpPath.c_str(), v_path.c_str()) == 0;
+  }
+
+  if (v_ok == false) {
+    LogWarning("Unable to compact the level cache archive, clearing it");
+    remove(v_tmpPath.c_str());
+    remove(v_path.c_str());
+    return;
+  }
+
+  m_records = v_records;
+  m_archiveSize = v_size;
+  m_liveSize = v_size - 4;
+}
+
+bool LevelCacheArchive::remap() {
+  Mapping v_mapping;
+
+  if (XMFS::mapFile(
+        archivePath(), &v_mapping.data, &v_mapping.size, &v_mapping.mapped) ==
+      false) {
+    return false;
+  }
+
+  m_mappings.push_back(v_mapping);
+  unmapOldMappings();
+  return true;
+}
+
+void LevelCacheArchive::unmapOldMappings() {
+  if (m_nbViews > 0 || m_mappings.size() < 2) {
+    return;
+  }
+
+  for (unsigned int i = 0; i < m_mappings.size() - 1; i++) {
+    XMFS::unmapFile(
+      m_mappings[i].data, m_mappings[i].size, m_mappings[i].mapped);
+  }
+  m_mappings.erase(m_mappings.begin(), m_mappings.end() - 1);
+}
+
+void LevelCacheArchive::appendRecord(const std::string &i_name,
+                                     const char *i_data,
+                                     int i_size) {
+  std::string v_record;
+  long v_end;
+
+  if (m_fp == NULL || i_name.size() == 0 ||
+      i_name.size() > LEVEL_CACHE_ARCHIVE_NAME_MAX) {
+    return;
+  }
+
+  archivePutInt(v_record, i_name.size());
+  v_record += i_name;
+  archivePutInt(v_record, i_size);
+  if (i_size > 0) {
+    v_record.append(i_data, i_size);
+  }
+
+  if (fwrite(v_record.c_str(), v_record.size(), 1, m_fp) != 1 ||
+      (v_end = ftell(m_fp)) < (long)v_record.size()) {
+    /* the end of the archive is unknown now ; it is fixed at next start */
+    LogWarning("Unable to write in the level cache archive");
+    fclose(m_fp);
+    m_fp = NULL;
+    return;
+  }
+  /* another instance may have appended records too */
+  m_archiveSize = v_end;
+
+  HashNamespace::unordered_map<std::string, Record>::iterator it =
+    m_records.find(i_name);
+  if (it != m_records.end()) {
+    m_liveSize -= 8 + it->first.size() + it->second.size;
+    m_records.erase(it);
+  }
+
+  if (i_size != LEVEL_CACHE_ARCHIVE_REMOVED) {
+    Record v_newRecord;
+    v_newRecord.offset = v_end - i_size;
+    v_newRecord.size = i_size;
+    m_records[i_name] = v_newRecord;
+    m_liveSize += v_record.size();
+  }
+}
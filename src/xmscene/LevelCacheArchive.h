@@ -0,0 +1,96 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __LEVELCACHEARCHIVE_H__
+#define __LEVELCACHEARCHIVE_H__
+
+#include "helpers/Singleton.h"
+#include "include/xm_hashmap.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct FileHandle;
+struct SDL_mutex;
+
+/**
+ * binary levels cache, stored in a single append-only file instead of one
+ * file per level. The file is mapped and indexed by cache name the first
+ * time a level is looked for ; the levels cached afterwards are appended. A
+ * level cached again or removed only supersedes its previous record : the
+ * wasted space is reclaimed when the archive is opened. Thread safe.
+ */
+class LevelCacheArchive : public Singleton<LevelCacheArchive> {
+  friend class Singleton<LevelCacheArchive>;
+
+public:
+  // view over the cached level, NULL if it is not cached ; close it with
+  // closeLevel
+  FileHandle *openLevel(const std::string &i_name);
+  void closeLevel(FileHandle *i_view);
+  void storeLevel(const std::string &i_name, const std::string &i_data);
+  void removeLevel(const std::string &i_name);
+
+  // remove all the levels ; no cached level must be open
+  void clear();
+
+private:
+  LevelCacheArchive();
+  ~LevelCacheArchive();
+
+  struct Record {
+    size_t offset;
+    int size;
+  };
+
+  struct Mapping {
+    const char *data;
+    size_t size;
+    bool mapped;
+  };
+
+  std::string archivePath() const;
+  void open();
+  void close();
+  // index the records of the mapping ; return the size of the valid records
+  size_t indexRecords(const Mapping &i_mapping);
+  // rewrite the archive with the current records only
+  void compact();
+  bool remap();
+  void unmapOldMappings(); // once no view is open
+  void appendRecord(const std::string &i_name,
+                    const char *i_data,
+                    int i_size);
+
+  bool m_opened;
+  HashNamespace::unordered_map<std::string, Record> m_records;
+  size_t m_archiveSize;
+  size_t m_liveSize;
+  FILE *m_fp;
+
+  /* the last mapping is the current one ; the previous ones are kept while
+     some views over them are open */
+  std::vector<Mapping> m_mappings;
+  unsigned int m_nbViews;
+
+  SDL_mutex *m_mutex;
+};
+
+#endif
@@ -0,0 +1,174 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#include "LevelCacheManifest.h"
+#include "common/VFileIO.h"
+#include "helpers/Log.h"
+#include "helpers/VExcept.h"
+#include "include/xm_SDL.h"
+#include "md5sum/md5file.h"
+#include <sys/stat.h>
+
+#define LEVEL_CACHE_MANIFEST_FILE "LCache/manifest.lst"
+#define LEVEL_CACHE_MANIFEST_HEADER "xmoto_lcache_manifest 1"
+
+LevelCacheManifest::LevelCacheManifest() {
+  m_loaded = false;
+  m_modified = false;
+  m_mutex = SDL_CreateMutex();
+}
+
+LevelCacheManifest::~LevelCacheManifest() {
+  SDL_DestroyMutex(m_mutex);
+}
+
+std::string LevelCacheManifest::checkSum(const std::string &i_levelFile) {
+  std::string v_path = XMFS::FullPath(FDT_DATA, i_levelFile);
+  struct stat v_st;
+
+  if (stat(v_path.c_str(), &v_st) != 0) {
+    /* not a real file ; the package index has the md5 */
+    return XMFS::md5sum(FDT_DATA, i_levelFile);
+  }
+
+  SDL_LockMutex(m_mutex);
+  if (m_loaded == false) {
+    load();
+  }
+
+  HashNamespace::unordered_map<std::string, Entry>::const_iterator it =
+    m_entries.find(v_path);
+  if (it != m_entries.end() && it->second.size == (long long)v_st.st_size &&
+      it->second.mtime == (long long)v_st.st_mtime) {
+    std::string v_md5sum = it->second.md5sum;
+    SDL_UnlockMutex(m_mutex);
+    return v_md5sum;
+  }
+  SDL_UnlockMutex(m_mutex);
+
+  /* new or changed file, hash it without holding the lock */
+  Entry v_entry;
+  v_entry.size = (long long)v_st.st_size;
+  v_entry.mtime = (long long)v_st.st_mtime;
+  v_entry.md5sum = md5file(v_path);
+
+  SDL_LockMutex(m_mutex);
+  m_entries[v_path] = v_entry;
+  m_modified = true;
+  SDL_UnlockMutex(m_mutex);
+
+  return v_entry.md5sum;
+}
+
+void LevelCacheManifest::load() {
+  m_loaded = true;
+
+  FileHandle *pfh = XMFS::openIFile(FDT_CACHE, LEVEL_CACHE_MANIFEST_FILE);
+  if (pfh == NULL) {
+    return;
+  }
+
+  try {
+    std::string v_line;
+
+    /* another version : ignore it, it will be rewritten */
+    if (XMFS::readNextLine(pfh, v_line) == false ||
+        v_line != LEVEL_CACHE_MANIFEST_HEADER) {
+      XMFS::closeFile(pfh);
+      return;
+    }
+
+    /* size mtime md5 path */
+    while (XMFS::readNextLine(pfh, v_line)) {
+      long long v_size, v_mtime;
+      char v_md5sum[64];
+      int v_pathStart;
+
+      if (sscanf(v_line.c_str(),
+                 "%lld %lld %63s %n",
+                 &v_size,
+                 &v_mtime,
+                 v_md5sum,
+                 &v_pathStart) != 3 ||
+          v_pathStart >= (int)v_line.length()) {
+        continue;
+      }
+
+      Entry v_entry;
+      v_entry.size = v_size;
+      v_entry.mtime = v_mtime;
+      v_entry.md5sum = v_md5sum;
+      m_entries[v_line.substr(v_pathStart)] = v_entry;
+    }
+  } catch (Exception &e) {
+    LogWarning("Unable to read the level cache manifest (%s)",
+               e.getMsg().c_str());
+  }
+
+  XMFS::closeFile(pfh);
+}
+
+void LevelCacheManifest::save() {
+  SDL_LockMutex(m_mutex);
+
+  if (m_modified == false) {
+    SDL_UnlockMutex(m_mutex);
+    return;
+  }
+
+  FileHandle *pfh = XMFS::openOFile(FDT_CACHE, LEVEL_CACHE_MANIFEST_FILE);
+  if (pfh == NULL) {
+    LogWarning("Unable to write the level cache manifest");
+    SDL_UnlockMutex(m_mutex);
+    return;
+  }
+
+  try {
+    XMFS::writeLine(pfh, LEVEL_CACHE_MANIFEST_HEADER);
+
+    HashNamespace::unordered_map<std::string, Entry>::iterator it =
+      m_entries.begin();
+    while (it != m_entries.end()) {
+      /* forget the removed levels */
+      if (XMFS::doesRealFileOrDirectoryExists(it->first) == false) {
+        it = m_entries.erase(it);
+        continue;
+      }
+
+      char v_line[2048];
+      snprintf(v_line,
+               sizeof(v_line),
+               "%lld %lld %s %s",
+               it->second.size,
+               it->second.mtime,
+               it->second.md5sum.c_str(),
+               it->first.c_str());
+      XMFS::writeLine(pfh, v_line);
+      ++it;
+    }
+    m_modified = false;
+  } catch (Exception &e) {
+    LogWarning("Unable to write the level cache manifest (%s)",
+               e.getMsg().c_str());
+  }
+
+  XMFS::closeFile(pfh);
+  SDL_UnlockMutex(m_mutex);
+}
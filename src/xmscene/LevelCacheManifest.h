@@ -0,0 +1,65 @@
+/*=============================================================================
+XMOTO
+
+This file is part of XMOTO.
+
+XMOTO is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+XMOTO is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with XMOTO; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+=============================================================================*/
+
+#ifndef __LEVELCACHEMANIFEST_H__
+#define __LEVELCACHEMANIFEST_H__
+
+#include "helpers/Singleton.h"
+#include "include/xm_hashmap.h"
+#include <string>
+
+struct SDL_mutex;
+
+/**
+ * md5 of the level files, remembered with the size and the modification time
+ * of the file they were computed from. The level cache is named and checked
+ * by the md5 of the level ; this avoids hashing the levels which didn't change
+ * each time they are loaded. Levels of the package already have their md5 in
+ * the package index. Thread safe.
+ */
+class LevelCacheManifest : public Singleton<LevelCacheManifest> {
+  friend class Singleton<LevelCacheManifest>;
+
+public:
+  // md5 of the level file, computed only if the file changed
+  std::string checkSum(const std::string &i_levelFile);
+
+  // write the manifest if some md5 were computed since the last save
+  void save();
+
+private:
+  LevelCacheManifest();
+  ~LevelCacheManifest();
+
+  struct Entry {
+    long long size;
+    long long mtime;
+    std::string md5sum;
+  };
+
+  void load();
+
+  HashNamespace::unordered_map<std::string, Entry> m_entries;
+  bool m_loaded;
+  bool m_modified;
+  SDL_mutex *m_mutex;
+};
+
+#endif
@@ -115,6 +115,19 @@ void Scene::loadLevel(xmDatabase *i_db,
   }
 }
 
+void Scene::loadLevelFile(const std::string &i_levelFile,
+                          bool i_loadMainLayerOnly) {
+  m_pLevelSrc = new Level();
+  try {
+    m_pLevelSrc->setFileName(i_levelFile);
+    m_pLevelSrc->loadReducedFromFile(i_loadMainLayerOnly);
+  } catch (Exception &e) {
+    delete m_pLevelSrc;
+    m_pLevelSrc = NULL;
+    throw e;
+  }
+}
+
 void Scene::cleanGhosts() {
   for (unsigned int i = 0; i < m_ghosts.size(); i++) {
     delete m_ghosts[i];
@@ -913,6 +926,9 @@ void Scene::_GenerateLevel(bool i_loadBSP) {
                            m_pLevelSrc->TopLimit(),
                            m_physicsSettings->BikeWheelBlockGrip());
 
+    /* the static lines are all defined */
+    m_Collision.compileGrid();
+
     /* Show stats about the collision system */
     CollisionSystemStats CStats;
     m_Collision.getStats(&CStats);
@@ -1102,8 +1118,8 @@ void Scene::_UpdateEntities(void) {
         v_player->getState()->RearWheelP[0] + wheelRadius + securityMargin,
         v_player->getState()->RearWheelP[1] + wheelRadius + securityMargin);
 
-      std::vector<Entity *> entities =
-        m_Collision.getEntitiesNearPosition(BBox);
+      m_Collision.getEntitiesNearPosition(BBox, m_touchedEntitiesQuery);
+      std::vector<Entity *> &entities = m_touchedEntitiesQuery.elements;
 
       /* Do player touch anything? */
       for (unsigned int i = 0; i < entities.size(); i++) {
@@ -146,6 +146,9 @@ public:
   void loadLevel(xmDatabase *i_db,
                  const std::string &i_id_level,
                  bool i_loadMainLayerOnly = false);
+  /* same, without the database ; for the threads which can't access it */
+  void loadLevelFile(const std::string &i_levelFile,
+                     bool i_loadMainLayerOnly = false);
   void prePlayLevel(DBuffer *i_eventRecorder,
                     bool i_playEvents,
                     bool i_loadMainLayerOnly = false,
@@ -382,6 +385,7 @@ private:
   Vector2f m_PhysGravity; /* gravity */
   ArrowPointer m_Arrow; /* Arrow */
   CollisionSystem m_Collision; /* Collision system */
+  ElementsQuery<Entity> m_touchedEntitiesQuery; /* Entities near the players */
   Level *m_pLevelSrc; /* Source of level */
   LuaLibGame *m_luaGame;
 